@@ -68,3 +68,5 @@ template <typename ElemType>
 void DoConvertFromDbn(const ConfigParameters& config);
 template<typename ElemType>
 void DoExportToDbn(const ConfigParameters& config);
+template <typename ElemType>
+void DoConvertLatticeArchive(const ConfigParameters& config);
@@ -179,12 +179,17 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
         // By not compiling the network before patching, we avoid double log output for validation.
         net = make_shared<ComputationNetwork>(deviceId);
         net->SetTraceLevel(config(L"traceLevel", 0));
+        net->SetMemoryMapModel(config(L"memoryMapModel", false));
         net->Read<ElemType>(modelPath);
         if (outputNodeNames.size() > 0)
             PatchOutputNodes(net, outputNodeNames, outputNodeNamesVector);
         net->CompileNetwork();
     }
 
+    // move products with loop-invariant inputs out of recurrent loops
+    if (config(L"hoistLoopInvariantProjections", false))
+        net->HoistLoopInvariantProjections<ElemType>();
+
     return net;
 }
 
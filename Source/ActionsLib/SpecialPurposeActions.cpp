@@ -17,6 +17,8 @@
 #include "SimpleNetworkBuilder.h"
 #include "Config.h"
 #include "ScriptableObjects.h"
+#include "latticearchive.h"
+#include "simplesenonehmm.h"
 
 #include <string>
 #include <chrono>
@@ -69,7 +71,28 @@ void DoExportToDbn(const ConfigParameters& config)
     net->SaveToDbnFile<ElemType>(net, dbnModelPath);
 }
 
+// ===========================================================================
+// DoConvertLatticeArchive() - implements CNTK "convertLatticeArchive" command
+// ===========================================================================
+
+// Converts a lattice archive for sequence training to the compact format, which is memory-mapped when reading.
+// The converted archive is used like the original one, by pointing denLatTocFile of the reader to outputPath.toc.
+// The units are mapped to those of the HMM given by phoneFile, labelMappingFile and transPFile, as in the reader config.
+template <typename ElemType>
+void DoConvertLatticeArchive(const ConfigParameters& config)
+{
+    wstring latTocFile = config(L"latTocFile");
+    wstring outputPath = config(L"outputPath");
+
+    msra::asr::simplesenonehmm hset;
+    hset.loadfromfile(config(L"phoneFile"), config(L"labelMappingFile"), config(L"transPFile"));
+
+    msra::lattices::archive::convertcompact(latTocFile, outputPath, hset.getsymmap());
+}
+
 template void DoConvertFromDbn<float>(const ConfigParameters& config);
 template void DoConvertFromDbn<double>(const ConfigParameters& config);
 template void DoExportToDbn<float>(const ConfigParameters& config);
 template void DoExportToDbn<double>(const ConfigParameters& config);
+template void DoConvertLatticeArchive<float>(const ConfigParameters& config);
+template void DoConvertLatticeArchive<double>(const ConfigParameters& config);
@@ -242,6 +242,9 @@ void DoEdit(const ConfigParameters& config)
         DEVICEID_TYPE deviceId = DeviceFromConfig(config);
         let createNetworkFn = GetNetworkFactory<ConfigParameters, ElemType>(config);
         let net = createNetworkFn(deviceId);
+        // e.g. parameterStorageEncoding=float16 to write a smaller model for deployment
+        wstring parameterStorageEncoding = config(L"parameterStorageEncoding", L"native");
+        net->SetParameterStorageEncoding(ParameterStorageEncodingFromString(parameterStorageEncoding));
         net->Save(outputPathname);
         LOGPRINTF(stderr, "\nModel with %d nodes saved as '%ls'.\n", (int)net->GetTotalNumberOfNodes(), outputPathname.c_str());
         return;
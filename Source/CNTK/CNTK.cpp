@@ -313,6 +313,10 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
                 {
                     DoExportToDbn<ElemType>(commandParams);
                 }
+                else if (thisAction == "convertLatticeArchive")
+                {
+                    DoConvertLatticeArchive<ElemType>(commandParams);
+                }
                 else if (thisAction == "createLabelMap")
                 {
                     DoCreateLabelMap<ElemType>(commandParams);
@@ -522,6 +526,7 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
         Globals::ForceDeterministicAlgorithms();
     if (config(L"forceConstantRandomSeed", false))
         Globals::ForceConstantRandomSeed();
+    Globals::SetMaxSingleThreadedLoopStepSize(config(L"maxSingleThreadedLoopStepSize", Globals::GetMaxSingleThreadedLoopStepSize()));
 
 #ifndef CPUONLY
     auto valpp = config.Find(L"deviceId");
@@ -681,6 +686,7 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
         Globals::ForceDeterministicAlgorithms();
     if (config(L"forceConstantRandomSeed", false))
         Globals::ForceConstantRandomSeed();
+    Globals::SetMaxSingleThreadedLoopStepSize(config(L"maxSingleThreadedLoopStepSize", Globals::GetMaxSingleThreadedLoopStepSize()));
 
     // get the command param set they want
     wstring logpath = config(L"stderr", L"");
@@ -798,6 +798,18 @@ namespace CNTK
         template <typename ElementType>
         CNTK_API static ValuePtr Create(size_t vocabularySize, const std::vector<std::vector<size_t>>& oneHotSequences, const DeviceDescriptor& device, bool readOnly = false);
 
+        ///
+        /// Create a new Value object over a batch of variable length sequences stored back to back in the caller-owned CPU buffer 'sequencesData',
+        /// sequence i consisting of 'sequenceLengths[i]' consecutive samples of shape 'sampleShape'.
+        /// If all sequences have a single sample, the data is not copied: the Value object refers to the buffer, and so does the corresponding input
+        /// of a Function evaluated on the CPU with the Value object. The buffer must then remain valid and unchanged as long as the Value object or
+        /// the BackPropState of such an evaluation is in use.
+        /// Otherwise the created Value object contains a copy of the data, with each sequence in a separate parallel sequence as for the
+        /// Create overload taking a vector of sequences.
+        ///
+        template <typename ElementType>
+        CNTK_API static ValuePtr Create(const NDShape& sampleShape, const std::vector<size_t>& sequenceLengths, ElementType* sequencesData, bool readOnly = true);
+
         ///
         /// Destruct 'this' Value object.
         ///
@@ -2194,6 +2206,8 @@ namespace CNTK
         /// Note that the returned BackPropState instance also stores a reference to the supplied 'inputs' Values and generated 'outputs' Values
         /// and the user is responsible for ensuring that the contents of the inputs and outputs are unchanged until after any uses of the BackPropState instance
         /// for backpropagating gradients through this function.
+        /// Forward calls on a composite Function that do not retain backward state may be made concurrently from multiple threads; each concurrent
+        /// call uses its own intermediate values, while all calls share the Function's Parameters and Constants.
         ///
         virtual BackPropStatePtr Forward(const std::unordered_map<Variable, ValuePtr>& arguments,
                                          std::unordered_map<Variable, ValuePtr>& outputs,
@@ -2233,6 +2247,13 @@ namespace CNTK
         ///
         CNTK_API FunctionPtr Clone(ParameterCloningMethod parameterCloneMethod = ParameterCloningMethod::Clone, const std::unordered_map<Variable, Variable>& replacements = {}) const;
 
+        ///
+        /// Builds and compiles the internal computation network that Forward computations of 'this' Function on the specified 'computeDevice' use,
+        /// so that the first Forward call does not pay for it, e.g. to warm up a model before it starts serving requests.
+        /// 'outputsToRetainBackwardStateFor' has the same meaning as for the Forward method.
+        ///
+        CNTK_API void Warmup(const DeviceDescriptor& computeDevice = DeviceDescriptor::UseDefaultDevice(), const std::unordered_set<Variable>& outputsToRetainBackwardStateFor = {});
+
         ///
         /// Generates a dictionary that captures the state of the Function graph underlying this Function.
         ///
@@ -221,6 +221,11 @@ namespace CNTK
         CNTK_API void SetComputationNetworkTraceLevel(int traceLevel);
         int GetComputationNetworkTraceLevel();
 
+        // Maximum number of compiled computation networks kept for reuse after the composite Functions they were built for
+        // are destroyed (0, the default, disables the cache). Cached networks keep their memory allocated.
+        CNTK_API void SetComputationNetworkCacheCapacity(size_t capacity);
+        size_t GetComputationNetworkCacheCapacity();
+
         CNTK_API void SetGPUMemoryAllocationTraceLevel(int traceLevel);
 
         CNTK_API void ForceSynchronousCUDAKernelExecutions();
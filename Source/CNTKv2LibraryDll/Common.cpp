@@ -241,6 +241,17 @@ namespace CNTK
             return s_computationNetworkTraceLevel.load();
         }
 
+        std::atomic<size_t> s_computationNetworkCacheCapacity(0);
+        void SetComputationNetworkCacheCapacity(size_t capacity)
+        {
+            s_computationNetworkCacheCapacity.store(capacity);
+        }
+
+        size_t GetComputationNetworkCacheCapacity()
+        {
+            return s_computationNetworkCacheCapacity.load();
+        }
+
         void SetGPUMemoryAllocationTraceLevel(int traceLevel)
         {
             Microsoft::MSR::CNTK::TracingGPUMemoryAllocator::SetTraceLevel(traceLevel);
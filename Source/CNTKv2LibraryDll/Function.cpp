@@ -461,6 +461,15 @@ namespace CNTK
         return clonedComposite;
     }
 
+    void Function::Warmup(const DeviceDescriptor& computeDevice, const std::unordered_set<Variable>& outputsToRetainBackwardStateFor)
+    {
+        CompositeFunction* compositeFunction = dynamic_cast<CompositeFunction*>(this);
+        if (compositeFunction == nullptr)
+            LogicError("Currently only warming up of composite functions is supported");
+
+        compositeFunction->Warmup(computeDevice, outputsToRetainBackwardStateFor);
+    }
+
 
     /*virtual*/ void Function::RestoreFromCheckpoint(const Dictionary& modelDictionary)
     {
@@ -1674,28 +1683,251 @@ namespace CNTK
         return computationNodePtr;
     }
 
-    template <typename ElementType>
-    ComputationNetworkPtr CompositeFunction::GetComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots, bool allocateNetworkMatrices)
+    ComputationNetworkCache& ComputationNetworkCache::Instance()
     {
-        if (m_computationNetwork != nullptr)
+        // Never destroyed, since Functions may still be destroyed during the destruction of static objects
+        static ComputationNetworkCache* s_instance = new ComputationNetworkCache();
+        return *s_instance;
+    }
+
+    void ComputationNetworkCache::Add(const FunctionGraphStructurePtr& structure, CompiledComputationNetwork&& network)
+    {
+        // Evicted networks are released after the lock
+        std::vector<CompiledComputationNetwork> evictedNetworks;
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        size_t capacity = Internal::GetComputationNetworkCacheCapacity();
+        if (capacity == 0)
+            return;
+
+        m_entries.emplace_back(structure, std::move(network));
+        while (m_entries.size() > capacity)
+        {
+            evictedNetworks.push_back(std::move(m_entries.front().second));
+            m_entries.pop_front();
+        }
+    }
+
+    bool ComputationNetworkCache::Take(const FunctionGraphStructure& structure, int deviceId, const std::vector<size_t>& backpropRoots, CompiledComputationNetwork& network)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (auto iter = m_entries.begin(); iter != m_entries.end(); ++iter)
         {
-            // TODO: We should either invalidate and readapt the network if he backpropRoots change compared to what was specified when the network
-            // was last constructed, to just recreate a new network.
-            // For now just disallow changing the backpropRoots after the network is created
-            if (!backpropRoots.empty() && (m_currentBackpropRoots != backpropRoots))
-                LogicError("Changing backprop roots across different Forward calls on a CNTK composite Function is currently unsupported");
+            const auto& compiled = iter->second;
+            if ((compiled.m_network->GetDeviceId() == deviceId) &&
+                (backpropRoots.empty() || (compiled.m_backpropRoots == backpropRoots)) &&
+                (*iter->first == structure))
+            {
+                network = std::move(iter->second);
+                m_entries.erase(iter);
+                return true;
+            }
+        }
 
-            // TODO: Support changing the device across different invocations of the forward method on a Function instance
-            if (AsDeviceDescriptor(m_computationNetwork->GetDeviceId()) != device)
-                LogicError("Changing device across different Forward calls on a CNTK composite Function is currently unsupported");
+        return false;
+    }
+
+    CompositeFunction::~CompositeFunction()
+    {
+        // Hand the networks over to the cache, for reuse by Functions with the same structure, e.g. clones of 'this' Function
+        if (Internal::GetComputationNetworkCacheCapacity() == 0)
+            return;
 
+        try
+        {
+            if (m_computationNetwork != nullptr)
+                m_inactiveComputationNetworks.push_back(DetachComputationNetwork());
+
+            for (auto& compiled : m_inactiveComputationNetworks)
+                ComputationNetworkCache::Instance().Add(m_graphStructure, std::move(compiled));
         }
-        else
+        catch (const std::exception& e)
         {
-            m_computationNetwork = std::make_shared<ComputationNetwork>(AsCNTKImplDeviceId(device));
+            fprintf(stderr, "Failed to add the computation networks of a Function to the cache: %s\n", e.what());
+        }
+    }
 
-            ComputationNetworkBuilder<ElementType> builder(*m_computationNetwork);
+    const FunctionGraphStructurePtr& CompositeFunction::GetGraphStructure()
+    {
+        if (m_graphStructure != nullptr)
+            return m_graphStructure;
+
+        auto structure = std::make_shared<FunctionGraphStructure>();
+        std::wstringstream signature;
+        auto variableIndex = [this, &signature](const Variable& var) -> size_t {
+            auto iter = m_graphStructureVariableIndices.find(var);
+            if (iter != m_graphStructureVariableIndices.end())
+                return iter->second;
+
+            size_t index = m_graphStructureVariables.size();
+            m_graphStructureVariables.push_back(var);
+            m_graphStructureVariableIndices[var] = index;
+
+            signature << L"v" << (int)var.Kind() << L"," << var.Name() << L"," << (int)var.GetDataType() << L"," << var.Shape().AsString() << L"," << var.NeedsGradient() << L"," << var.IsSparse();
+            for (const auto& axis : var.DynamicAxes())
+                signature << L"," << axis.Name() << L":" << axis.IsOrdered();
+            if (var.IsParameter() || var.IsConstant())
+                signature << L"," << var.Uid();
+            signature << L";";
+            return index;
+        };
+
+        // Number the Variables in the order of a depth-first traversal, visiting the inputs of each Function in order
+        std::unordered_set<const Function*> visitedFunctions;
+        std::function<void(const FunctionPtr&)> visit = [&](const FunctionPtr& function) {
+            if (!visitedFunctions.insert(function.get()).second)
+                return;
+
+            auto primitiveFunction = dynamic_cast<const PrimitiveFunction*>(function.get());
+            if (primitiveFunction == nullptr)
+                LogicError("User defined Functions are currently unsupported!");
+
+            auto inputs = function->Inputs();
+            for (const auto& input : inputs)
+            {
+                if (input.IsOutput())
+                    visit(input.Owner());
+            }
+
+            signature << L"f" << (int)primitiveFunction->OpType() << L"(";
+            for (const auto& input : inputs)
+                signature << variableIndex(input) << L",";
+            signature << L")";
+            for (const auto& output : function->Outputs())
+                signature << variableIndex(output) << L",";
+            signature << L";";
+            structure->m_attributes.push_back(function->Attributes());
+        };
+        visit(RootFunction());
+
+        structure->m_signature = signature.str();
+        m_graphStructure = structure;
+        return m_graphStructure;
+    }
+
+    CompiledComputationNetwork CompositeFunction::DetachComputationNetwork()
+    {
+        GetGraphStructure();
+
+        CompiledComputationNetwork compiled;
+        compiled.m_network = m_computationNetwork;
+        compiled.m_nodes.resize(m_graphStructureVariables.size());
+        compiled.m_isRoot.resize(m_graphStructureVariables.size(), false);
+        for (size_t i = 0; i < m_graphStructureVariables.size(); ++i)
+        {
+            const auto& var = m_graphStructureVariables[i];
+            auto nodeIter = m_variableToNodeMap.find(var);
+            if (nodeIter != m_variableToNodeMap.end())
+                compiled.m_nodes[i] = nodeIter->second;
+
+            auto isRootIter = m_isVariableRootMap.find(var);
+            if (isRootIter != m_isVariableRootMap.end())
+                compiled.m_isRoot[i] = isRootIter->second;
+
+            if (m_currentBackpropRoots.find(var) != m_currentBackpropRoots.end())
+                compiled.m_backpropRoots.push_back(i);
+        }
+        compiled.m_matricesAllocated = m_networkMatricesAllocated;
+
+        m_computationNetwork = nullptr;
+        m_variableToNodeMap.clear();
+        m_isVariableRootMap.clear();
+        m_currentBackpropRoots.clear();
+        m_networkMatricesAllocated = false;
+
+        return compiled;
+    }
+
+    void CompositeFunction::AttachComputationNetwork(CompiledComputationNetwork&& compiled)
+    {
+        for (size_t i = 0; i < m_graphStructureVariables.size(); ++i)
+        {
+            if (compiled.m_nodes[i] != nullptr)
+            {
+                m_variableToNodeMap[m_graphStructureVariables[i]] = compiled.m_nodes[i];
+                m_isVariableRootMap[m_graphStructureVariables[i]] = compiled.m_isRoot[i];
+            }
+        }
+
+        for (auto backpropRoot : compiled.m_backpropRoots)
+            m_currentBackpropRoots.insert(m_graphStructureVariables[backpropRoot]);
+
+        m_networkMatricesAllocated = compiled.m_matricesAllocated;
+        m_computationNetwork = std::move(compiled.m_network);
+    }
+
+    // Switches to a network built earlier for the specified device and backprop roots, either by 'this' Function or
+    // by a Function with the same structure that was since destroyed.
+    bool CompositeFunction::TryAttachCompiledComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots)
+    {
+        const auto& structure = GetGraphStructure();
 
+        std::vector<size_t> backpropRootIndices;
+        for (const auto& backpropRoot : backpropRoots)
+        {
+            auto iter = m_graphStructureVariableIndices.find(backpropRoot);
+            if (iter == m_graphStructureVariableIndices.end())
+                return false;
+
+            backpropRootIndices.push_back(iter->second);
+        }
+        std::sort(backpropRootIndices.begin(), backpropRootIndices.end());
+
+        int deviceId = AsCNTKImplDeviceId(device);
+        for (auto iter = m_inactiveComputationNetworks.begin(); iter != m_inactiveComputationNetworks.end(); ++iter)
+        {
+            if ((iter->m_network->GetDeviceId() == deviceId) && (backpropRootIndices.empty() || (iter->m_backpropRoots == backpropRootIndices)))
+            {
+                auto compiled = std::move(*iter);
+                m_inactiveComputationNetworks.erase(iter);
+                AttachComputationNetwork(std::move(compiled));
+                return true;
+            }
+        }
+
+        CompiledComputationNetwork compiled;
+        if (!ComputationNetworkCache::Instance().Take(*structure, deviceId, backpropRootIndices, compiled))
+            return false;
+
+        AttachComputationNetwork(std::move(compiled));
+        return true;
+    }
+
+    void CompositeFunction::Warmup(const DeviceDescriptor& computeDevice, const std::unordered_set<Variable>& outputsToRetainBackwardStateFor)
+    {
+        std::lock_guard<std::mutex> lock(m_computationNetworkMutex);
+
+        std::unordered_set<Variable> functionOutputs(this->Outputs().begin(), this->Outputs().end());
+        for (auto rootVarForBackprop : outputsToRetainBackwardStateFor)
+        {
+            if (functionOutputs.find(rootVarForBackprop) == functionOutputs.end())
+                InvalidArgument("Requested outputs to retain backward state for is not an Ouptut of the Function");
+        }
+
+        // Same as in Forward: the DataType of the arguments, or of the outputs if there are none
+        auto arguments = Arguments();
+        auto dataType = arguments.empty() ? this->Outputs()[0].GetDataType() : arguments[0].GetDataType();
+        if (dataType == DataType::Float)
+            GetComputationNetwork<float>(computeDevice, outputsToRetainBackwardStateFor, true);
+        else if (dataType == DataType::Double)
+            GetComputationNetwork<double>(computeDevice, outputsToRetainBackwardStateFor, true);
+        else
+            InvalidArgument("Unsupported DataType %s", DataTypeName(dataType));
+    }
+
+    template <typename ElementType>
+    ComputationNetworkPtr CompositeFunction::GetComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots, bool allocateNetworkMatrices)
+    {
+        if (m_computationNetwork != nullptr)
+        {
+            // The network was built for different backprop roots or another device; put it aside for later use
+            bool backpropRootsChanged = !backpropRoots.empty() && (m_currentBackpropRoots != backpropRoots);
+            if (backpropRootsChanged || (AsDeviceDescriptor(m_computationNetwork->GetDeviceId()) != device))
+                m_inactiveComputationNetworks.push_back(DetachComputationNetwork());
+        }
+
+        if (m_computationNetwork == nullptr)
+        {
             // TODO: We currently only support one backprop root
             if (backpropRoots.size() > 1)
                 LogicError("More than one backprop roots is currently unsupported");
@@ -1703,6 +1935,13 @@ namespace CNTK
             auto placeholders = Placeholders();
             if (!placeholders.empty())
                 InvalidArgument("All placeholders of a Function must be bound before performing a Forward computation on the Function!");
+        }
+
+        if ((m_computationNetwork == nullptr) && !TryAttachCompiledComputationNetwork(device, backpropRoots))
+        {
+            m_computationNetwork = std::make_shared<ComputationNetwork>(AsCNTKImplDeviceId(device));
+
+            ComputationNetworkBuilder<ElementType> builder(*m_computationNetwork);
 
             // Now recursively create the network in a top-down fashion
             auto rootFunction = RootFunction();
@@ -2142,9 +2381,21 @@ namespace CNTK
         MBLayoutPtr layout = CNTKMatrixAndMBLayout.second;
 
         auto& nodeData = computationNode->As<ComputationNode<ElementType>>()->Value();
+        const auto& valueData = *CNTKMatrixAndMBLayout.first;
+
+        // Data in caller-owned memory (see Value::Create) that is already on the device and of the type of the node is bound by reference
+        if (!valueData.OwnBuffer() && (valueData.GetDeviceId() == nodeData.GetDeviceId()) && (valueData.GetMatrixType() == nodeData.GetMatrixType()))
+            nodeData = valueData.AsReference();
+        else
+        {
+            // Do not copy into caller-owned memory bound by an earlier call
+            if (!nodeData.OwnBuffer())
+                nodeData = Matrix<ElementType>(nodeData.GetDeviceId());
+
+            // Switch the node matrix to the right matrix type
+            nodeData.AssignValuesOf(valueData);
+        }
 
-        // Switch the node matrix to the right matrix type
-        nodeData.AssignValuesOf(*CNTKMatrixAndMBLayout.first);
         computationNode->GetMBLayout()->CopyFrom(layout);
     }
 
@@ -2340,6 +2591,15 @@ namespace CNTK
         if (outputs.empty())
             InvalidArgument("CompositeFunction::Forward: At least one output has to be specified!");
 
+        std::unique_lock<std::mutex> lock(m_computationNetworkMutex, std::defer_lock);
+        if (!outputsToRetainBackwardStateFor.empty())
+            lock.lock();
+        else if (!lock.try_lock())
+        {
+            ForwardOnExecutionContext(arguments, outputs, computeDevice);
+            return nullptr;
+        }
+
         // Make sure that the DataType of the variables and corresponding values match
         // TODO: We need a better way to determine the ElementType for the network
         auto dataType = DataType::Unknown;
@@ -2430,6 +2690,42 @@ namespace CNTK
         return (outputsToRetainBackwardStateFor.size() > 0) ? MakeSharedObject<CNTKBackPropState>(this->shared_from_this(), std::make_pair(evalTimeStampVariable, m_variableToNodeMap[evalTimeStampVariable]->GetEvalTimeStamp())) : nullptr;
     }
 
+    // Evaluates 'this' Function on an idle execution context, or a new one if there is none
+    void CompositeFunction::ForwardOnExecutionContext(const std::unordered_map<Variable, ValuePtr>& arguments,
+                                                      std::unordered_map<Variable, ValuePtr>& outputs,
+                                                      const DeviceDescriptor& computeDevice)
+    {
+        CompositeFunctionPtr executionContext;
+        {
+            std::lock_guard<std::mutex> lock(m_executionContextsMutex);
+            if (!m_idleExecutionContexts.empty())
+            {
+                executionContext = m_idleExecutionContexts.back();
+                m_idleExecutionContexts.pop_back();
+            }
+        }
+
+        if (executionContext == nullptr)
+            executionContext = CompositeFunction::Create(RootFunction(), Name());
+
+        auto releaseExecutionContext = [this, &executionContext]() {
+            std::lock_guard<std::mutex> lock(m_executionContextsMutex);
+            m_idleExecutionContexts.push_back(executionContext);
+        };
+
+        try
+        {
+            executionContext->Forward(arguments, outputs, computeDevice, {});
+        }
+        catch (...)
+        {
+            releaseExecutionContext();
+            throw;
+        }
+
+        releaseExecutionContext();
+    }
+
     /*virtual*/ void CompositeFunction::Backward(const BackPropStatePtr& state,
                                                  const std::unordered_map<Variable, ValuePtr>& rootGradientValues,
                                                  std::unordered_map<Variable, ValuePtr>& backPropagatedGradientValuesForInputs)
@@ -2438,6 +2734,8 @@ namespace CNTK
         if (backpropState == nullptr)
             InvalidArgument("Invalid backprop state specified");
 
+        std::lock_guard<std::mutex> lock(m_computationNetworkMutex);
+
         // TODO: Support multiple concurrent backprop states
         if (backpropState->EvalTimeStamp().second != m_variableToNodeMap[backpropState->EvalTimeStamp().first]->GetEvalTimeStamp())
             LogicError("The specified backprop state specified cannot be used for backpropagation as the Function's internal state was modified by subsequent Forward calls to the function."
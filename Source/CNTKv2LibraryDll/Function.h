@@ -9,6 +9,8 @@
 #include "CNTKLibrary.h"
 #include "PrimitiveOpType.h"
 #include <iterator>
+#include <list>
+#include <mutex>
 #include "ComputationNetwork.h"
 #include "Utils.h"
 #include "ConvolveGeometry.h"
@@ -636,6 +638,54 @@ namespace CNTK
     };
     typedef std::shared_ptr<CNTKBackPropState> CNTKBackPropStatePtr;
 
+    // Structure of a Function graph, i.e. everything the ComputationNetwork built for the graph depends on:
+    // the op types, attributes and connectivity of its primitive Functions and the properties of its Variables.
+    // Parameters and Constants are identified by their Uid, since the network shares their values.
+    // The Variables are numbered in the order of a depth-first traversal of the graph, which is the same for
+    // all Functions with the same structure (e.g. a Function and its clones that share the parameters).
+    struct FunctionGraphStructure
+    {
+        std::wstring m_signature;
+        std::vector<Dictionary> m_attributes;
+
+        bool operator==(const FunctionGraphStructure& other) const
+        {
+            return (m_signature == other.m_signature) && (m_attributes == other.m_attributes);
+        }
+    };
+    typedef std::shared_ptr<const FunctionGraphStructure> FunctionGraphStructurePtr;
+
+    // A compiled ComputationNetwork that is currently not in use by a composite Function.
+    // The nodes are indexed by the numbering of the Variables in the FunctionGraphStructure of the Function.
+    struct CompiledComputationNetwork
+    {
+        Microsoft::MSR::CNTK::ComputationNetworkPtr m_network;
+        std::vector<Microsoft::MSR::CNTK::ComputationNodeBasePtr> m_nodes; // nullptr for Variables without a node
+        std::vector<bool> m_isRoot;
+        std::vector<size_t> m_backpropRoots;
+        bool m_matricesAllocated;
+    };
+
+    // Process wide cache of compiled ComputationNetworks, which composite Functions hand over their networks to when
+    // they are destroyed and which they look up before building a new network. A network is taken out of the cache
+    // while it is in use, so it is never used by two Functions at a time.
+    // Holds at most Internal::GetComputationNetworkCacheCapacity() networks, evicting the oldest ones first.
+    class ComputationNetworkCache
+    {
+    public:
+        static ComputationNetworkCache& Instance();
+
+        void Add(const FunctionGraphStructurePtr& structure, CompiledComputationNetwork&& network);
+
+        // Takes a network for the specified device and backprop roots out of the cache.
+        // Empty 'backpropRoots' match a network built for any backprop roots.
+        bool Take(const FunctionGraphStructure& structure, int deviceId, const std::vector<size_t>& backpropRoots, CompiledComputationNetwork& network);
+
+    private:
+        std::mutex m_mutex;
+        std::list<std::pair<FunctionGraphStructurePtr, CompiledComputationNetwork>> m_entries;
+    };
+
     class CompositeFunction;
     typedef std::shared_ptr<CompositeFunction> CompositeFunctionPtr;
 
@@ -700,6 +750,10 @@ namespace CNTK
             return CompositeFunctionOpName;
         }
 
+        virtual ~CompositeFunction();
+
+        void Warmup(const DeviceDescriptor& computeDevice, const std::unordered_set<Variable>& outputsToRetainBackwardStateFor);
+
     private:
         virtual void ReplacePlaceholdersInPlace(const std::unordered_map<Variable, Variable>& placeholderReplacements,
                                                 std::unordered_set<const Function*>& visitedFunctions,
@@ -774,6 +828,11 @@ namespace CNTK
         template <typename ElementType>
         Microsoft::MSR::CNTK::ComputationNetworkPtr GetComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots, bool allocateNetworkMatrices);
 
+        const FunctionGraphStructurePtr& GetGraphStructure();
+        CompiledComputationNetwork DetachComputationNetwork();
+        void AttachComputationNetwork(CompiledComputationNetwork&& compiled);
+        bool TryAttachCompiledComputationNetwork(const DeviceDescriptor& device, const std::unordered_set<Variable>& backpropRoots);
+
         template <typename ElementType>
         static Microsoft::MSR::CNTK::ComputationNodeBasePtr CreateComputationNode(const Variable& variable,
                                                                                   PrimitiveFunction* primitiveFunction,
@@ -816,6 +875,10 @@ namespace CNTK
 
         const std::vector<Variable>& GetArgumentDependencies(const Variable& output);
 
+        void ForwardOnExecutionContext(const std::unordered_map<Variable, ValuePtr>& arguments,
+                                       std::unordered_map<Variable, ValuePtr>& outputs,
+                                       const DeviceDescriptor& computeDevice);
+
     private:
 
         // Set of all primitive functions in the graph underlying 'this' Function. Also keeps the primitive Function objects alive 
@@ -840,6 +903,22 @@ namespace CNTK
 
         bool m_networkMatricesAllocated;
 
+        // Networks built earlier for other devices or backprop roots than the current one.
+        std::vector<CompiledComputationNetwork> m_inactiveComputationNetworks;
+
+        // Structure of the graph underlying 'this' Function and its Variables in the numbering of the structure; determined on first use.
+        FunctionGraphStructurePtr m_graphStructure;
+        std::vector<Variable> m_graphStructureVariables;
+        std::unordered_map<Variable, size_t> m_graphStructureVariableIndices;
+
+        // Serializes the calls that use the ComputationNetwork of 'this' Function. Forward calls that do not retain
+        // backward state and find the network in use by another thread run on an execution context instead: a composite
+        // Function over the same graph, which shares the Parameters and Constants of 'this' Function but has its own
+        // ComputationNetwork (activations and MBLayouts). Idle execution contexts are kept for reuse.
+        std::mutex m_computationNetworkMutex;
+        std::mutex m_executionContextsMutex;
+        std::vector<CompositeFunctionPtr> m_idleExecutionContexts;
+
         static const size_t s_serializationVersion = 1;
     };
 
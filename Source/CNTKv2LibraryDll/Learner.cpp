@@ -22,6 +22,19 @@
         NOT_IMPLEMENTED;                                                                                      \
     }
 
+#define FUSED_UPDATE_FUNCTION                                                                                 \
+    switch (parameters.front().GetDataType())                                                                 \
+    {                                                                                                         \
+    case DataType::Float:                                                                                     \
+        FusedUpdate<float>(parameters, gradientValues, smoothedGradientValues, trainingSampleCount);          \
+        break;                                                                                                \
+    case DataType::Double:                                                                                    \
+        FusedUpdate<double>(parameters, gradientValues, smoothedGradientValues, trainingSampleCount);         \
+        break;                                                                                                \
+    default:                                                                                                  \
+        NOT_IMPLEMENTED;                                                                                      \
+    }
+
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
 
@@ -95,6 +108,33 @@ namespace CNTK
         }
     }
 
+    template <typename ElementType>
+    /*static*/ void LearnerBase::GetFusedUpdateMatrices(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues, const vector<NDArrayViewPtr>& smoothedGradientValues,
+                                                        vector<shared_ptr<Matrix<ElementType>>>& matrices,
+                                                        vector<Matrix<ElementType>*>& parameterMatrices,
+                                                        vector<Matrix<ElementType>*>& gradientMatrices,
+                                                        vector<Matrix<ElementType>*>& smoothedGradientMatrices)
+    {
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            matrices.push_back(GetWritableMatrix<ElementType>(parameters[i].Value()));
+            parameterMatrices.push_back(matrices.back().get());
+            matrices.push_back(GetWritableMatrix<ElementType>(gradientValues[i]));
+            gradientMatrices.push_back(matrices.back().get());
+            matrices.push_back(GetWritableMatrix<ElementType>(smoothedGradientValues[i]));
+            smoothedGradientMatrices.push_back(matrices.back().get());
+        }
+    }
+
+    bool LearnerBase::CanFuseUpdates() const
+    {
+        // clipping by the norm needs the norm of each gradient first; noise and L1 are separate passes after the update
+        return SupportsFusedUpdate() &&
+               (m_additionalOptions.gradientClippingThresholdPerSample == numeric_limits<double>::infinity() || m_additionalOptions.gradientClippingWithTruncation) &&
+               m_additionalOptions.gaussianNoiseInjectionStdDev == 0 &&
+               m_additionalOptions.l1RegularizationWeight == 0;
+    }
+
     // Performs additional preprocessing before calling the update method 
     // (gradient clipping and L2 regularization depending on the additional learning parameters).
     template <typename ElementType>
@@ -111,7 +151,12 @@ namespace CNTK
             // multiply by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
             auto weight = ElementType(m_additionalOptions.l2RegularizationWeight * actualMBSize);
             const auto& parameterMatrix = parameterValue->GetWritableMatrix<ElementType>();
-            Matrix<ElementType>::ScaleAndAdd(weight, *parameterMatrix, *gradientMatrix);
+            // block sparse gradients are only regularized at the columns that are present in the minibatch, and stay sparse
+            if (gradientMatrix->GetMatrixType() == MatrixType::SPARSE &&
+                (gradientMatrix->GetFormat() == matrixFormatSparseBlockCol || gradientMatrix->GetFormat() == matrixFormatSparseBlockRow))
+                Matrix<ElementType>::ScaleAndAddToSparseBlocks(weight, *parameterMatrix, *gradientMatrix);
+            else
+                Matrix<ElementType>::ScaleAndAdd(weight, *parameterMatrix, *gradientMatrix);
         }
     }
 
@@ -213,10 +258,27 @@ namespace CNTK
         // make sure trainingSampleCount is a valid value
         assert(trainingSampleCount > 0);
 
+        // Parameters with dense gradients, of the same data type and on the same device as the first of them,
+        // are updated together after the loop, in a single pass over their elements.
+        bool canFuseUpdates = CanFuseUpdates();
+        vector<Parameter> fusedParameters;
+        vector<NDArrayViewPtr> fusedGradientValues, fusedSmoothedGradientValues;
+
         for (const auto& parameter : Parameters())
         {
             const auto& smoothedGradientValue = m_smoothedGradientValues.at(parameter);
             const auto& gradientValue = gradientValues.at(parameter);
+
+            if (canFuseUpdates && !gradientValue->IsSparse() &&
+                (fusedParameters.empty() || (parameter.GetDataType() == fusedParameters.front().GetDataType() &&
+                                             parameter.Value()->Device() == fusedParameters.front().Value()->Device())))
+            {
+                fusedParameters.push_back(parameter);
+                fusedGradientValues.push_back(gradientValue);
+                fusedSmoothedGradientValues.push_back(smoothedGradientValue);
+                continue;
+            }
+
 // TODO: make this a runtime parameter.
 #if DUMPOUTPUT
             LOGPRINTF(stderr, "Update_%ls\n", parameter.Uid().c_str());
@@ -249,6 +311,10 @@ namespace CNTK
                 LogicError("%ls has NaNs in parameter values after parameter update.", parameter.Uid().c_str());
 #endif
         }
+
+        if (!fusedParameters.empty())
+            FusedUpdate(fusedParameters, fusedGradientValues, fusedSmoothedGradientValues, trainingSampleCount);
+
         m_sampleCount += trainingSampleCount;
         m_minibatchCount++;
         return false;
@@ -364,6 +430,30 @@ namespace CNTK
                                            learningRate, momentum, m_useNesterovAcceleration);
     }
 
+    /*virtual*/ void LearnerSGD::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues, const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const /*override*/
+    {
+        FUSED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerSGD::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues, const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const
+    {
+        vector<shared_ptr<Matrix<ElementType>>> matrices;
+        vector<Matrix<ElementType>*> parameterMatrices, gradientMatrices, smoothedGradientMatrices;
+        GetFusedUpdateMatrices(parameters, gradientValues, smoothedGradientValues, matrices, parameterMatrices, gradientMatrices, smoothedGradientMatrices);
+
+        auto learningRate = LearningRate();
+        auto momentum = MomentumValueForMB(m_momentumValues[m_sampleCount], trainingSampleCount);
+
+        // the preprocessing, multiplied by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
+        auto clippingThreshold = m_additionalOptions.gradientClippingThresholdPerSample * trainingSampleCount;
+        vector<double> l2RegWeights(parameters.size(), m_additionalOptions.l2RegularizationWeight * trainingSampleCount);
+
+        Matrix<ElementType>::MultiTensorNormalGrad(smoothedGradientMatrices, gradientMatrices, parameterMatrices,
+                                                   vector<double>(parameters.size(), learningRate), l2RegWeights, clippingThreshold,
+                                                   momentum, m_useNesterovAcceleration);
+    }
+
     /*virtual*/ void LearnerAdaGrad::Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const /*override*/
     {
         UPDATE_FUNCTION;
@@ -426,6 +516,35 @@ namespace CNTK
         smoothedGradientMatrix->FSAdagradUpdate(trainingSampleCount, *gradientMatrix, *parameterMatrix, smoothedCount, learningRate, m_targetAdagradAvDenom, momentum, varMomentum);
     }
 
+    /*virtual*/ void LearnerFSAdaGrad::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues, const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const /*override*/
+    {
+        FUSED_UPDATE_FUNCTION;
+    }
+
+    template <typename ElementType>
+    void LearnerFSAdaGrad::FusedUpdate(const vector<Parameter>& parameters, const vector<NDArrayViewPtr>& gradientValues, const vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const
+    {
+        vector<shared_ptr<Matrix<ElementType>>> matrices;
+        vector<Matrix<ElementType>*> parameterMatrices, gradientMatrices, smoothedGradientMatrices;
+        GetFusedUpdateMatrices(parameters, gradientValues, smoothedGradientValues, matrices, parameterMatrices, gradientMatrices, smoothedGradientMatrices);
+
+        vector<double*> smoothedCounts;
+        for (const auto& parameter : parameters)
+            smoothedCounts.push_back(&m_smoothedCounts.at(parameter));
+
+        auto learningRate = LearningRate();
+        auto momentum = MomentumValueForMB(m_momentumValues[m_sampleCount], trainingSampleCount);
+        const double varMomentum = (exp(-1.0 * trainingSampleCount / m_adagradT));
+
+        // the preprocessing, multiplied by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
+        auto clippingThreshold = m_additionalOptions.gradientClippingThresholdPerSample * trainingSampleCount;
+        vector<double> l2RegWeights(parameters.size(), m_additionalOptions.l2RegularizationWeight * trainingSampleCount);
+
+        Matrix<ElementType>::MultiTensorFSAdagradUpdate(trainingSampleCount, smoothedGradientMatrices, gradientMatrices, parameterMatrices, smoothedCounts,
+                                                        vector<double>(parameters.size(), learningRate), l2RegWeights, clippingThreshold,
+                                                        m_targetAdagradAvDenom, momentum, varMomentum);
+    }
+
     LearnerRMSProp::LearnerRMSProp(const vector<Parameter>& parameters, 
                                    const LearningRatesPerSample& learningRates,
                                    double gamma, double inc, double dec, double max, double min,
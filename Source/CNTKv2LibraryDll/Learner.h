@@ -37,6 +37,17 @@ namespace CNTK
 
         virtual void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const = 0;
 
+        // Learners with an element-wise update rule can update all parameters with dense gradients in a single pass
+        // over their elements, instead of calling Update() for each of them; see LearnerSGD::FusedUpdate().
+        virtual bool SupportsFusedUpdate() const { return false; }
+
+        // Updates the given parameters, which have the same data type, reside on the same device and have dense gradients,
+        // including the preprocessing (only gradient clipping with truncation and L2 regularization are supported here).
+        virtual void FusedUpdate(const std::vector<Parameter>& /*parameters*/, const std::vector<NDArrayViewPtr>& /*gradientValues*/, const std::vector<NDArrayViewPtr>& /*smoothedGradientValues*/, size_t /*trainingSampleCount*/) const
+        {
+            LogicError("Learner %s does not support fused parameter updates.", LearnerType().c_str());
+        }
+
         std::string LearnerType() const;
 
         AdditionalLearningOptions m_additionalOptions;
@@ -62,6 +73,15 @@ namespace CNTK
         template <typename ElementType>
         void ClipGradient(Microsoft::MSR::CNTK::Matrix<ElementType>& gradient, size_t actualMBSize) const;
 
+        // Retrieves the matrices of a fused update. The matrices are created as views of the NDArrayViews,
+        // 'matrices' keeps them alive during the update.
+        template <typename ElementType>
+        static void GetFusedUpdateMatrices(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues, const std::vector<NDArrayViewPtr>& smoothedGradientValues,
+                                           std::vector<std::shared_ptr<Microsoft::MSR::CNTK::Matrix<ElementType>>>& matrices,
+                                           std::vector<Microsoft::MSR::CNTK::Matrix<ElementType>*>& parameterMatrices,
+                                           std::vector<Microsoft::MSR::CNTK::Matrix<ElementType>*>& gradientMatrices,
+                                           std::vector<Microsoft::MSR::CNTK::Matrix<ElementType>*>& smoothedGradientMatrices);
+
         // Performs additional preprocessing before calling the update method 
         // (gradient clipping and L2 regularization depending on the additional learning parameters).
         template <typename ElementType>
@@ -87,6 +107,10 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        // Whether FusedUpdate() can be used, i.e. whether the learner supports it and the additional learning options
+        // require no steps that are not element-wise.
+        bool CanFuseUpdates() const;
+
         // TODO: make these functions friends of NDViewArray and move to Utils?
         static bool HasNan(const NDArrayViewPtr& value, const char* name);
         static void Print(const NDArrayViewPtr& value, const char* msg);
@@ -114,6 +138,13 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        virtual bool SupportsFusedUpdate() const override { return true; }
+
+        virtual void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues, const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const override;
+
+        template <typename ElementType>
+        void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues, const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const;
+
         // TODO: Move m_momentumValues to LearnerMomentumSGD as soon as NormalGrad is refactored.
         MomentumValuesPerSample m_momentumValues;
         bool m_useNesterovAcceleration;
@@ -189,6 +220,11 @@ namespace CNTK
         template <typename ElementType>
         void Update(const Parameter& parameter, const NDArrayViewPtr& gradientValue, const NDArrayViewPtr& smoothedGradientValue, size_t trainingSampleCount) const;
 
+        virtual void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues, const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const override;
+
+        template <typename ElementType>
+        void FusedUpdate(const std::vector<Parameter>& parameters, const std::vector<NDArrayViewPtr>& gradientValues, const std::vector<NDArrayViewPtr>& smoothedGradientValues, size_t trainingSampleCount) const;
+
     private:
         mutable std::unordered_map<Parameter, double> m_smoothedCounts;
         double m_targetAdagradAvDenom;
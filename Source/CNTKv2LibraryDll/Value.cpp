@@ -137,6 +137,46 @@ namespace CNTK
         return MakeSharedObject<Value>(deviceValueData, deviceValueMask);
     }
 
+    template <typename ElementType>
+    /*static*/ ValuePtr Value::Create(const NDShape& sampleShape, const std::vector<size_t>& sequenceLengths, ElementType* sequencesData, bool readOnly/* = true*/)
+    {
+        if (sequenceLengths.empty())
+            InvalidArgument("Value::Create: At least one sequence has to be specified");
+
+        size_t numSamples = 0;
+        for (auto sequenceLength : sequenceLengths)
+        {
+            if (sequenceLength == 0)
+                InvalidArgument("Value::Create: Sequences of length 0 are not supported");
+
+            numSamples += sequenceLength;
+        }
+
+        // Only sequences of a single sample each can be described by a layout over the buffer as is, as parallel sequences of a single time step.
+        // Longer sequences would have to be placed back to back into a single parallel sequence, which serializes the computation over
+        // all their samples; they are copied into the usual layout of one parallel sequence per sequence instead.
+        size_t numSequences = sequenceLengths.size();
+        if (numSamples != numSequences)
+        {
+            size_t numElementsPerSample = sampleShape.TotalSize();
+            std::vector<std::vector<ElementType>> sequences(numSequences);
+            const ElementType* sequenceData = sequencesData;
+            for (size_t i = 0; i < numSequences; ++i)
+            {
+                sequences[i].assign(sequenceData, sequenceData + (sequenceLengths[i] * numElementsPerSample));
+                sequenceData += sequenceLengths[i] * numElementsPerSample;
+            }
+
+            return Create(sampleShape, sequences, DeviceDescriptor::CPUDevice(), readOnly);
+        }
+
+        auto layout = std::make_shared<Microsoft::MSR::CNTK::MBLayout>();
+        layout->InitAsFrameMode(numSequences);
+
+        auto matrix = std::make_shared<Microsoft::MSR::CNTK::Matrix<ElementType>>(sampleShape.TotalSize(), numSamples, sequencesData, CPUDEVICE, Microsoft::MSR::CNTK::matrixFlagDontOwnBuffer);
+        return MakeSharedObject<PackedValue>(sampleShape, matrix, layout, readOnly);
+    }
+
     /*virtual*/ Value::~Value()
     {
     }
@@ -222,4 +262,6 @@ namespace CNTK
     template /*static*/ CNTK_API ValuePtr Value::Create<double>(const NDShape& sampleShape, const std::vector<std::vector<double>>& sequences, const DeviceDescriptor& device, bool readOnly/* = false*/);
     template /*static*/ CNTK_API ValuePtr Value::Create<float>(size_t vocabSize, const std::vector<std::vector<size_t>>& oneHotSequences, const DeviceDescriptor& device, bool readOnly/* = false*/);
     template /*static*/ CNTK_API ValuePtr Value::Create<double>(size_t vocabSize, const std::vector<std::vector<size_t>>& oneHotSequences, const DeviceDescriptor& device, bool readOnly/* = false*/);
+    template /*static*/ CNTK_API ValuePtr Value::Create<float>(const NDShape& sampleShape, const std::vector<size_t>& sequenceLengths, float* sequencesData, bool readOnly/* = true*/);
+    template /*static*/ CNTK_API ValuePtr Value::Create<double>(const NDShape& sampleShape, const std::vector<size_t>& sequenceLengths, double* sequencesData, bool readOnly/* = true*/);
 }
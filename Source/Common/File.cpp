@@ -23,8 +23,14 @@
 #endif
 #ifdef __unix__
 #include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
 #include <linux/limits.h> // for PATH_MAX
 #endif
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 #define PCLOSE_ERROR -1
 
@@ -49,6 +55,60 @@ File::File(const wchar_t* filename, int fileOptions)
     Init(filename, fileOptions);
 }
 
+File::File(FILE* file, const std::wstring& name, int fileOptions)
+    : m_filename(name), m_file(file), m_pcloseNeeded(false), m_seekable(true), m_options(fileOptions)
+{
+}
+
+/*static*/ std::unique_ptr<File> File::CreateInMemory()
+{
+    FILE* file = nullptr;
+#ifdef _WIN32
+    wchar_t tempPath[MAX_PATH], tempFileName[MAX_PATH];
+    if (!GetTempPathW(MAX_PATH, tempPath) || !GetTempFileNameW(tempPath, L"cntk", 0, tempFileName))
+        RuntimeError("File: failed to create a temporary file name.");
+    // The file is never flushed to disk as long as there is enough memory, and is deleted when closed.
+    HANDLE handle = CreateFileW(tempFileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        RuntimeError("File: failed to create the temporary file '%ls'.", tempFileName);
+    int fd = _open_osfhandle((intptr_t)handle, _O_RDWR | _O_BINARY);
+    if (fd != -1)
+        file = _fdopen(fd, "w+b");
+#else
+#ifdef SYS_memfd_create
+    int fd = (int)syscall(SYS_memfd_create, "cntk", 0);
+    if (fd != -1)
+        file = fdopen(fd, "w+b");
+#endif
+    // Older kernels: fall back to an anonymous temporary file.
+    if (!file)
+        file = tmpfile();
+#endif
+    if (!file)
+        RuntimeError("File: failed to create an in-memory file: %s", strerror(errno));
+
+    return std::unique_ptr<File>(new File(file, L"<memory>", fileOptionsBinary | fileOptionsReadWrite));
+}
+
+void File::CopyContentTo(const std::wstring& filename)
+{
+    Flush();
+    uint64_t size = Size();
+    SetPosition(0);
+
+    File destination(filename, fileOptionsBinary | fileOptionsWrite);
+    std::vector<char> buffer(16 * 1024 * 1024);
+    for (uint64_t copied = 0; copied < size;)
+    {
+        size_t chunk = (size_t)std::min<uint64_t>(buffer.size(), size - copied);
+        freadOrDie(buffer.data(), 1, chunk, m_file);
+        fwriteOrDie(buffer.data(), 1, chunk, destination.m_file);
+        copied += chunk;
+    }
+
+    destination.Flush();
+}
+
 template<class String>
 static bool IsNonFilePath(const String& filename)
 {
@@ -836,6 +896,63 @@ void File::SetPosition(uint64_t pos)
     fsetpos(m_file, pos);
 }
 
+void File::PadToAlignment(size_t alignment)
+{
+    uint64_t position = GetPosition();
+    size_t padding = (size_t)((alignment - position % alignment) % alignment);
+    if (padding == 0)
+        return;
+
+    if (m_options & fileOptionsWrite)
+    {
+        std::vector<char> zeros(padding, 0);
+        fwriteOrDie(zeros.data(), 1, padding, m_file);
+    }
+    else
+        SetPosition(position + padding);
+}
+
+void File::MapIntoMemory()
+{
+    if (!(m_options & fileOptionsBinary) || !(m_options & fileOptionsRead) || (m_options & fileOptionsWrite) || !CanSeek())
+        LogicError("File: only binary files opened for reading can be mapped into memory (%ls).", m_filename.c_str());
+
+    uint64_t size = Size();
+    if (size == 0)
+        RuntimeError("File: cannot map the empty file %ls into memory.", m_filename.c_str());
+
+#ifdef _WIN32
+    HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(m_file));
+    HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+        RuntimeError("File: could not memory map file %ls.", m_filename.c_str());
+    char* data = (char*)MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mappingHandle); // the view keeps the mapping alive
+    if (data == nullptr)
+        RuntimeError("File: could not memory map file %ls.", m_filename.c_str());
+    m_mapping = std::shared_ptr<char>(data, [](char* p) { UnmapViewOfFile(p); });
+#else
+    void* data = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(m_file), 0);
+    if (data == MAP_FAILED)
+        RuntimeError("File: could not memory map file %ls: %s", m_filename.c_str(), strerror(errno));
+    m_mapping = std::shared_ptr<char>((char*)data, [size](char* p) { munmap(p, (size_t)size); });
+#endif
+    m_mappingSize = size;
+}
+
+char* File::ReadMapped(size_t size)
+{
+    if (!IsMappedIntoMemory())
+        LogicError("File: ReadMapped() called on file %ls which is not mapped into memory.", m_filename.c_str());
+
+    uint64_t position = GetPosition();
+    if (position + size > m_mappingSize)
+        RuntimeError("File: attempted to read beyond the end of the mapped file %ls.", m_filename.c_str());
+
+    SetPosition(position + size);
+    return m_mapping.get() + position;
+}
+
 // helper to load a matrix from a stream (file or string literal)
 // The input string is expected to contain one line per matrix row (natural printing order for humans).
 // Inputs:
@@ -12,5 +12,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
     // TODO: get rid of this source file once static initializers in methods are thread-safe (VS 2015)
     std::atomic<bool> Globals::m_forceDeterministicAlgorithms(false);
     std::atomic<bool> Globals::m_forceConstantRandomSeed(false);
+    // Not measured; an estimate of the step size below which the OpenMP fork/join of every operation costs more than it gains.
+    // To tune it, compare the lstm model of evalperformancetests (Tests/UnitTests/EvalPerformanceTests) with maxSingleThreadedLoopStepSize=0 and larger values.
+    std::atomic<size_t> Globals::m_maxSingleThreadedLoopStepSize(16384);
 
 }}}
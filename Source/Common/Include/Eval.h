@@ -355,6 +355,42 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // ForwardPassBatch - Evaluate a batch of independent requests in a single forward pass.
+    // Every request provides one sequence for every input, in the same layout as for ForwardPass(); the sequences
+    // of a request must have the same number of samples on all inputs. The requests are evaluated as parallel
+    // sequences of one minibatch, so the memory cells of RNNs are reset for every request.
+    // inputs - for every request, the vector of input buffers as given by GetInputSchema()
+    // outputs - for every request, the vector of output buffers. Must be sized to fit output schema.
+    //
+    virtual void ForwardPassBatch(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs) = 0;
+
+    //
+    // CreateSession - Create a session for streaming evaluation of a recurrent model. A session is a stream of samples
+    // that is evaluated chunk by chunk with ForwardPassSessions(); the memory cells of RNNs are carried over from
+    // one chunk to the next.
+    // Returns the id of the session, which is valid until DestroySession().
+    //
+    virtual size_t CreateSession() = 0;
+
+    virtual void DestroySession(size_t sessionId) = 0;
+
+    //
+    // ForwardPassSessions - Advance a number of sessions by a chunk each, in a single forward pass.
+    // The first chunk of a session starts from the initial state of the memory cells, every further chunk continues
+    // from the state at the end of the previous chunk of the session. Only the new chunk is evaluated.
+    // sessionIds - the sessions to advance, each at most once
+    // inputs, outputs - for every session, the input and output buffers of the chunk, as for ForwardPassBatch()
+    //
+    virtual void ForwardPassSessions(const std::vector<size_t>& sessionIds, const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs) = 0;
+
+    //
+    // ReorderSessions - Let sessions continue from the state of other sessions, e.g. to reorder the hypotheses of a
+    // beam search. After the call, session sessionIds[k] continues from the state session sourceSessionIds[k] had
+    // before the call. The sessions share the states, the memory cells are not copied.
+    //
+    virtual void ReorderSessions(const std::vector<size_t>& sessionIds, const std::vector<size_t>& sourceSessionIds) = 0;
 };
 
 template <typename ElemType>
@@ -362,4 +398,104 @@ void EVAL_API GetEvalExtended(IEvaluateModelExtended<ElemType>** peval);
 extern "C" EVAL_API void GetEvalExtendedF(IEvaluateModelExtended<float>** peval);
 extern "C" EVAL_API void GetEvalExtendedD(IEvaluateModelExtended<double>** peval);
 
+// ------------------------------------------------------------------------
+// Batching interface
+// ------------------------------------------------------------------------
+
+//
+// Latency and throughput of a batching evaluator, measured since its creation or the last ResetStatistics().
+//
+struct EvalBatchingStatistics
+{
+    size_t m_numRequests;               // Number of evaluated requests.
+    size_t m_numBatches;                // Number of forward passes.
+    double m_averageLatencyInMs;        // Time from submitting a request until its outputs are available.
+    double m_maxLatencyInMs;
+    double m_averageForwardPassTimeInMs;
+    double m_requestsPerSecond;         // Evaluated requests per second of wall clock time.
+};
+
+//
+// Front-end for serving many concurrent requests with a model: the requests submitted by multiple threads
+// are coalesced into a minibatch, which is evaluated with a single IEvaluateModelExtended::ForwardPassBatch().
+// A batch is evaluated as soon as it holds the maximum number of requests, or when its oldest request has
+// waited for the maximum latency.
+//
+template <typename ElemType>
+class IEvaluateModelBatching
+{
+public:
+    //
+    // Evaluate - Evaluate a single request. Blocks until the batch containing the request has been evaluated.
+    // Can be called from multiple threads at the same time.
+    // inputs - vector of input buffers, one for every input as given by GetInputSchema()
+    // outputs - vector of output buffers. Must be sized to fit output schema.
+    //
+    virtual void Evaluate(const Values<ElemType>& inputs, Values<ElemType>& outputs) = 0;
+
+    virtual EvalBatchingStatistics GetStatistics() const = 0;
+
+    virtual void ResetStatistics() = 0;
+
+    //
+    // Destroy - Evaluates the pending requests, stops the batching and releases this object.
+    // The evaluator passed to GetEvalBatching() is not destroyed.
+    //
+    virtual void Destroy() = 0;
+};
+
+//
+// Creates a batching front-end for an evaluator on which StartForwardEvaluation() has been called.
+// The evaluator must not be used otherwise while the front-end exists.
+// maxBatchSize - maximum number of requests evaluated in one forward pass
+// maxLatencyInMs - maximum time a request waits for further requests to batch with
+//
+template <typename ElemType>
+void EVAL_API GetEvalBatching(IEvaluateModelExtended<ElemType>* eval, size_t maxBatchSize, double maxLatencyInMs, IEvaluateModelBatching<ElemType>** peval);
+extern "C" EVAL_API void GetEvalBatchingF(IEvaluateModelExtended<float>* eval, size_t maxBatchSize, double maxLatencyInMs, IEvaluateModelBatching<float>** peval);
+extern "C" EVAL_API void GetEvalBatchingD(IEvaluateModelExtended<double>* eval, size_t maxBatchSize, double maxLatencyInMs, IEvaluateModelBatching<double>** peval);
+
+// ------------------------------------------------------------------------
+// Beam search interface
+// ------------------------------------------------------------------------
+
+//
+// Generates sequences with a recurrent model that predicts the next token from the previous ones, e.g. the decoder
+// of a translation model that is conditioned on the source sentence through the prefix. The model must have a single
+// input, the previous token as a one-hot vector (dense or sparse), and a single output, the unnormalized or log
+// probabilities of the next token, both of the dimension of the vocabulary.
+// Every hypothesis of the beam is a session of the evaluator. All hypotheses of all sequences are advanced by one
+// token in a single forward pass, and the states of the sessions are reordered when hypotheses are pruned.
+//
+template <typename ElemType>
+class IEvaluateModelBeamSearch
+{
+public:
+    //
+    // Decode - Generate the most probable continuation of every prefix.
+    // prefixes - for every sequence, the tokens it starts with, e.g. the sentence start symbol; not empty
+    // results - receives for every sequence the generated tokens, without the prefix. A result ends with the end
+    //           symbol, unless it was cut at the maximum length.
+    // scores - receives for every sequence the log probability of its result
+    //
+    virtual void Decode(const std::vector<std::vector<size_t>>& prefixes, std::vector<std::vector<size_t>>& results, std::vector<double>& scores) = 0;
+
+    //
+    // Destroy - Releases this object. The evaluator passed to GetEvalBeamSearch() is not destroyed.
+    //
+    virtual void Destroy() = 0;
+};
+
+//
+// Creates a beam search decoder for an evaluator on which StartForwardEvaluation() has been called.
+// The evaluator must not be used otherwise while Decode() runs.
+// beamWidth - number of hypotheses kept per sequence
+// endSymbol - token that ends a sequence
+// maxLength - maximum number of generated tokens per sequence
+//
+template <typename ElemType>
+void EVAL_API GetEvalBeamSearch(IEvaluateModelExtended<ElemType>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength, IEvaluateModelBeamSearch<ElemType>** peval);
+extern "C" EVAL_API void GetEvalBeamSearchF(IEvaluateModelExtended<float>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength, IEvaluateModelBeamSearch<float>** peval);
+extern "C" EVAL_API void GetEvalBeamSearchD(IEvaluateModelExtended<double>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength, IEvaluateModelBeamSearch<double>** peval);
+
 } } }
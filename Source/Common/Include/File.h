@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <memory>
 #include <stdint.h>
 #ifdef _WIN32
 #define NOMINMAX
@@ -99,7 +100,10 @@ private:
     bool m_pcloseNeeded; // was opened with popen(), use pclose() when destructing
     bool m_seekable;     // this stream is seekable
     int m_options;       // FileOptions ored togther
+    std::shared_ptr<char> m_mapping; // set by MapIntoMemory()
+    uint64_t m_mappingSize = 0;
     void Init(const wchar_t* filename, int fileOptions);
+    File(FILE* file, const std::wstring& name, int fileOptions);
 
 public:
     File(const std::wstring& filename, int fileOptions);
@@ -107,12 +111,32 @@ public:
     File(const wchar_t* filename, int fileOptions);
     ~File();
 
+    // Creates an anonymous, seekable binary read/write file that is kept in host memory as far as the OS permits
+    // (memfd on Linux, a delete-on-close temporary file on Windows). Allows to serialize data quickly and write it out later.
+    static std::unique_ptr<File> CreateInMemory();
+
+    // Writes the whole content of this file into a new file 'filename'.
+    void CopyContentTo(const std::wstring& filename);
+
     void Flush();
 
     bool CanSeek() const { return m_seekable; }
     size_t Size();
     uint64_t GetPosition();
     void SetPosition(uint64_t pos);
+
+    // Writes zero bytes (or skips them when reading) up to the next multiple of 'alignment' bytes from the file start.
+    void PadToAlignment(size_t alignment);
+
+    // Maps the whole (binary, seekable) file into memory, so that large blobs can be accessed in place with ReadMapped().
+    // The mapping is copy-on-write: unmodified pages are backed by the OS file cache and thus shared by all processes
+    // that map the same file. The mapping stays valid as long as a reference to GetMapping() is held.
+    void MapIntoMemory();
+    bool IsMappedIntoMemory() const { return m_mapping != nullptr; }
+    const std::shared_ptr<char>& GetMapping() const { return m_mapping; }
+
+    // Returns a pointer to the next 'size' bytes of the mapped file and moves the file position past them.
+    char* ReadMapped(size_t size);
     void SkipToDelimiter(int delim);
 
     bool IsTextBased();
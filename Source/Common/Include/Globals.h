@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -19,6 +20,10 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         static void       ForceConstantRandomSeed() {        m_forceConstantRandomSeed = true; }
         static bool ShouldForceConstantRandomSeed() { return m_forceConstantRandomSeed; }
 
+        // recurrent loops on the CPU whose per-step values have at most this many elements run single-threaded (config "maxSingleThreadedLoopStepSize")
+        static void     SetMaxSingleThreadedLoopStepSize(size_t maxStepSize) {        m_maxSingleThreadedLoopStepSize = maxStepSize; }
+        static size_t GetMaxSingleThreadedLoopStepSize()                     { return m_maxSingleThreadedLoopStepSize; }
+
         static bool UseV2Aggregator()
         {
             return false;
@@ -27,5 +32,6 @@ namespace Microsoft { namespace MSR { namespace CNTK {
     private:
         static std::atomic<bool> m_forceDeterministicAlgorithms;
         static std::atomic<bool> m_forceConstantRandomSeed;
+        static std::atomic<size_t> m_maxSingleThreadedLoopStepSize;
     };
 }}}
@@ -788,6 +788,51 @@ inline int fclose(auto_file_ptr& af)
     return af.fclose();
 }
 
+// ----------------------------------------------------------------------------
+// auto_mapped_file -- read-only memory mapping of an entire file, with
+// auto-unmap. The pages are shared through the OS file cache, i.e. several
+// processes that map the same file only hold one copy of it in RAM.
+// ----------------------------------------------------------------------------
+
+class auto_mapped_file
+{
+    const char* p;
+    size_t n;
+#ifdef _WIN32
+    void* filehandle; // HANDLE
+    void* maphandle;  // HANDLE
+#else
+    int fd;
+#endif
+    auto_mapped_file(const auto_mapped_file&); // can't ref-count: no copy
+    void operator=(const auto_mapped_file&);
+
+public:
+    auto_mapped_file();
+    ~auto_mapped_file()
+    {
+        close();
+    }
+    void open(const std::wstring& pathname); // map the file; closes a previously mapped one
+    void close();
+    bool isopen() const
+    {
+#ifdef _WIN32
+        return filehandle != (void*) -1; // INVALID_HANDLE_VALUE
+#else
+        return fd != -1;
+#endif
+    }
+    const char* data() const
+    {
+        return p;
+    }
+    size_t size() const
+    {
+        return n;
+    }
+};
+
 namespace msra { namespace files {
 
 // ----------------------------------------------------------------------------
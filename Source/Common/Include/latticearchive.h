@@ -67,6 +67,8 @@ enum mbrclassdefinition // used to identify definition of class in minimum bayes
 // ===========================================================================
 class lattice
 {
+    friend class latticetest; // unit tests run the forward-backward steps on synthetic lattices
+
     mutable int verbosity;
     struct header_v1_v2
     {
@@ -738,6 +740,8 @@ private:
     void parallelmmierrorsignal(parallelstate& parallelstate, const edgealignments& thisedgealignments,
                                 const std::vector<double>& logpps, msra::math::ssematrixbase& errorsignal) const;
 
+    void getforwardbackwardbatches(std::vector<size_t>& batchsizeforward, std::vector<size_t>& batchsizebackward) const;
+
     double parallelforwardbackwardlattice(parallelstate& parallelstate, const std::vector<float>& edgeacscores,
                                           const edgealignments& thisedgealignments, const float lmf, const float wp,
                                           const float amf, const float boostingfactor, std::vector<double>& logpps, std::vector<double>& logalphas,
@@ -999,21 +1003,8 @@ public:
             }
 #endif
             // This is critical--we have a buggy lattice set that requires no mapping where mapping would fail
-            bool needsmapping = false;
-            foreach_index (k, idmap)
-            {
-                if (idmap[k] != (size_t) k
-#if 1
-                    && (k != (int) idmap.size() - 1 || idmap[k] != spunit) // that HACK that we add one more /sp/ entry at the end...
-#endif
-                    )
-                {
-                    needsmapping = true;
-                    break;
-                }
-            }
             // map align ids to user's symmap  --the lattice gets updated in place here
-            if (needsmapping)
+            if (needsmapping(idmap, spunit))
             {
                 if (info.impliedspunitid != SIZE_MAX)
                     info.impliedspunitid = idmap[info.impliedspunitid];
@@ -1063,6 +1054,125 @@ public:
             RuntimeError("fread: unsupported lattice format version");
     }
 
+    // test whether an idmap (as passed to fread()) changes any unit id
+    template <class IDMAP>
+    static bool needsmapping(const IDMAP& idmap, size_t spunit)
+    {
+        foreach_index (k, idmap)
+        {
+            if (idmap[k] != (size_t) k
+#if 1
+                && (k != (int) idmap.size() - 1 || idmap[k] != spunit) // that HACK that we add one more /sp/ entry at the end...
+#endif
+                )
+                return true;
+        }
+        return false;
+    }
+
+    // compact lattice format
+    // This stores a lattice the way it is used in memory (nodes, edges, and align arrays; no uniq'ing of alignments), at 8-byte
+    // aligned positions. Compact archives are memory-mapped, and reading a lattice is just copying the arrays out of the mapping;
+    // there is no parsing and no rebuilding of the edges like for V2 lattices. This saves time, not memory: the lattice still
+    // holds its own copy of the arrays on the heap, just like after fread().
+    //  - file header: compactarchiveheader
+    //  - each lattice: compactheader, nodes[info.numnodes], edges[info.numedges], align[numalign], each padded to 8 bytes
+    // Unit ids refer to the archive's .symlist like in the other formats.
+    struct compactarchiveheader
+    {
+        char magic[8];    // "LATCOMPA"
+        uint64_t version; // format version
+    };
+    struct compactheader
+    {
+        char tag[4];          // "LATC"
+        unsigned int version; // same as compactarchiveheader::version
+        header_v1_v2 info;
+        uint64_t numalign;
+    };
+    static_assert(sizeof(compactarchiveheader) == 16, "unexpected size of compactarchiveheader");
+    static_assert(sizeof(compactheader) % 8 == 0, "compactheader must keep the arrays 8-byte aligned");
+    static const uint64_t compactversion = 1;
+    static size_t compactpadded(size_t bytes)
+    {
+        return (bytes + 7) & ~(size_t) 7;
+    }
+
+    // test whether the beginning of a file is the header of a compact archive
+    static bool iscompactarchive(const char* data, size_t size)
+    {
+        return size >= sizeof(compactarchiveheader::magic) && memcmp(data, "LATCOMPA", 8) == 0;
+    }
+
+    static void fwritecompactarchiveheader(FILE* f)
+    {
+        compactarchiveheader header;
+        memcpy(header.magic, "LATCOMPA", 8);
+        header.version = compactversion;
+        fwriteOrDie(&header, sizeof(header), 1, f);
+    }
+
+    // write in compact format; the file position must be 8-byte aligned
+    void fwritecompact(FILE* f) const
+    {
+        if (info.numnodes != nodes.size() || info.numedges != edges.size())
+            LogicError("fwritecompact: lattice must be in expanded format (call rebuildedges() first)");
+        compactheader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.tag, "LATC", 4);
+        header.version = (unsigned int) compactversion;
+        header.info = info;
+        header.numalign = align.size();
+        fwriteOrDie(&header, sizeof(header), 1, f);
+        const char zeroes[8] = {0};
+        fwriteOrDie(nodes.data(), sizeof(nodes[0]), nodes.size(), f);
+        fwriteOrDie(zeroes, 1, compactpadded(nodes.size() * sizeof(nodes[0])) - nodes.size() * sizeof(nodes[0]), f);
+        fwriteOrDie(edges.data(), sizeof(edges[0]), edges.size(), f);
+        fwriteOrDie(align.data(), sizeof(align[0]), align.size(), f);
+        fwriteOrDie(zeroes, 1, compactpadded(align.size() * sizeof(align[0])) - align.size() * sizeof(align[0]), f);
+    }
+
+    // read a lattice at a byte offset of a memory-mapped compact archive
+    // Like fread(), this replaces the content of an existing structure, reusing its memory.
+    template <class IDMAP>
+    void freadcompact(const char* data, size_t size, uint64_t offset, const IDMAP& idmap, size_t spunit)
+    {
+        if (offset + sizeof(compactheader) > size || offset % 8 != 0)
+            RuntimeError("freadcompact: invalid lattice offset %llu", (unsigned long long) offset);
+        const char* p = data + offset;
+        const compactheader& header = *(const compactheader*) p;
+        if (memcmp(header.tag, "LATC", 4) != 0 || header.version != compactversion)
+            RuntimeError("freadcompact: malformed file or unsupported version, no compact lattice at offset %llu", (unsigned long long) offset);
+        const size_t nodesbytes = compactpadded(header.info.numnodes * sizeof(nodeinfo));
+        const size_t edgesbytes = header.info.numedges * sizeof(edgeinfowithscores);
+        const size_t alignbytes = compactpadded(header.numalign * sizeof(aligninfo));
+        if (offset + sizeof(compactheader) + nodesbytes + edgesbytes + alignbytes > size)
+            RuntimeError("freadcompact: malformed file, lattice at offset %llu exceeds the end of the file", (unsigned long long) offset);
+        p += sizeof(compactheader);
+        info = header.info;
+        const nodeinfo* pnodes = (const nodeinfo*) p;
+        nodes.assign(pnodes, pnodes + info.numnodes);
+        p += nodesbytes;
+        const edgeinfowithscores* pedges = (const edgeinfowithscores*) p;
+        edges.assign(pedges, pedges + info.numedges);
+        p += edgesbytes;
+        const aligninfo* palign = (const aligninfo*) p;
+        align.assign(palign, palign + header.numalign);
+        if (nodes.empty() || nodes.back().t != info.numframes)
+            RuntimeError("freadcompact: mismatch between info.numframes and last node's time");
+        // V2 data is not used
+        edges2.clear();
+        uniquededgedatatokens.clear();
+        // map align ids to user's symmap  --the lattice gets updated in place here
+        if (needsmapping(idmap, spunit))
+        {
+            if (info.impliedspunitid < idmap.size()) // (like fread() does for V2 lattices)
+                info.impliedspunitid = idmap[info.impliedspunitid];
+            foreach_index (k, align)
+                align[k].updateunit(idmap); // updates itself
+        }
+    }
+
     // parallel versions (defined in parallelforwardbackward.cpp)
     class parallelstate
     {
@@ -1212,6 +1322,7 @@ class archive
 
     mutable size_t currentarchiveindex;               // which archive is open
     mutable auto_file_ptr f;                          // cached archive file handle of currentarchiveindex
+    mutable auto_mapped_file mappedarchive;           // memory mapping of currentarchiveindex instead of 'f' if it is a compact archive
     std::unordered_map<std::wstring, latticeref> toc; // [key] -> (file, offset)  --table of content (.toc file)
 public:
     // construct = open the archive
@@ -1335,18 +1446,32 @@ public:
         if (spunit2 != spunit)
             LogicError("getlattice: huh? same lookup of /sp/ gives different result?");
 #endif
-        // open archive file in case it is not the current one
-        if (archiveindex != currentarchiveindex)
-        {
-            f = fopenOrDie(archivepaths[archiveindex], L"rbS"); // or throw (will close old 'f' iff succeeded)
-            currentarchiveindex = archiveindex;
-        }
         try // (for read operation)
         {
-            // seek to start
-            fsetpos(f, offset);
-            // get it
-            L.fread(f, idmap, spunit);
+            // open archive file in case it is not the current one
+            // Compact archives are memory-mapped instead, and the file handle is not used for them.
+            if (archiveindex != currentarchiveindex)
+            {
+                currentarchiveindex = SIZE_MAX;
+                mappedarchive.close();
+                f = fopenOrDie(archivepaths[archiveindex], L"rbS"); // or throw (will close old 'f' iff succeeded)
+                char magic[8];
+                if (::fread(magic, 1, sizeof(magic), f) == sizeof(magic) && lattice::iscompactarchive(magic, sizeof(magic)))
+                {
+                    f = NULL;
+                    mappedarchive.open(archivepaths[archiveindex]);
+                }
+                currentarchiveindex = archiveindex;
+            }
+            if (mappedarchive.isopen())
+                L.freadcompact(mappedarchive.data(), mappedarchive.size(), offset, idmap, spunit);
+            else
+            {
+                // seek to start
+                fsetpos(f, offset);
+                // get it
+                L.fread(f, idmap, spunit);
+            }
             L.setverbosity(verbosity);
 #ifdef HACK_IN_SILENCE // hack to simulate DEL in the lattice
             const size_t silunit = getid(modelsymmap, "sil");
@@ -1358,6 +1483,7 @@ public:
         {
             currentarchiveindex = SIZE_MAX;
             f = NULL; // this closes the file handle
+            mappedarchive.close();
             throw;
         }
         // check if number of frames is as expected
@@ -1380,6 +1506,54 @@ public:
     //  - merge two lattices (for merging numer into denom lattices)
     static void convert(const std::wstring& intocpath, const std::wstring& intocpath2, const std::wstring& outpath,
                         const msra::asr::simplesenonehmm& hset);
+
+    // static method for converting an archive to the compact format, which is memory-mapped when reading
+    // The output gets the same .toc and .symlist files as the other formats, and getlattice() detects the format.
+    // The units are mapped to modelsymmap. This is the CNTK "convertLatticeArchive" action; implemented in SequenceTrainingLib.
+    static void convertcompact(const std::wstring& intocpath, const std::wstring& outpath,
+                               const std::unordered_map<std::string, size_t>& modelsymmap);
+
+    // helper to write a symbol hash (string -> int) to a file
+    // File has two sections:
+    //  - physicalunitname     // line number is mapping, starting with 0
+    //  - logunitname physicalunitname   // establishes a mapping; logunitname will get the same numeric index as physicalunitname
+    template <class UNITMAP>
+    static void writeunitmap(const std::wstring& symlistpath, const UNITMAP& unitmap)
+    {
+        std::vector<std::string> units;
+        units.reserve(unitmap.size());
+        std::vector<std::string> mappings;
+        mappings.reserve(unitmap.size());
+        for (auto iter = unitmap.cbegin(); iter != unitmap.cend(); iter++) // why would 'for (auto iter : unitmap)' not work?
+        {
+            const std::string label = iter->first;
+            const size_t unitid = iter->second;
+            if (units.size() <= unitid)
+                units.resize(unitid + 1); // we grow it on demand; the result must be compact (all entries filled), we check that later
+            if (!units[unitid].empty())   // many-to-one mapping: remember the unit; look it up while writing
+                mappings.push_back(label);
+            else
+                units[unitid] = label;
+        }
+
+        auto_file_ptr flist(fopenOrDie(symlistpath, L"wb"));
+        // write (physical) units
+        foreach_index (k, units)
+        {
+            if (units[k].empty())
+                LogicError("build: unitmap has gaps");
+            fprintfOrDie(flist, "%s\n", units[k].c_str());
+        }
+        // write log-phys mappings
+        foreach_index (k, mappings)
+        {
+            const std::string unit = mappings[k];             // logical name
+            const size_t unitid = unitmap.find(unit)->second; // get its unit id; this indexes the units array
+            const std::string tounit = units[unitid];         // and get the name from tehre
+            fprintfOrDie(flist, "%s %s\n", unit.c_str(), tounit.c_str());
+        }
+        fflushOrDie(flist);
+    }
 };
 };
 };
@@ -25,6 +25,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <glob.h>
+#include <sys/mman.h>
 #endif
 #include <stdio.h>
 #include <string.h>
@@ -1629,6 +1630,89 @@ void fgetfile(FILE* f, std::vector<char>& buffer)
     buffer.reserve(buffer.size());
 }
 
+// ----------------------------------------------------------------------------
+// auto_mapped_file -- read-only memory mapping of an entire file
+// ----------------------------------------------------------------------------
+
+auto_mapped_file::auto_mapped_file()
+    : p(nullptr), n(0)
+#ifdef _WIN32
+    , filehandle(INVALID_HANDLE_VALUE), maphandle(NULL)
+#else
+    , fd(-1)
+#endif
+{
+}
+
+void auto_mapped_file::open(const wstring& pathname)
+{
+    close();
+#ifdef _WIN32
+    filehandle = CreateFileW(pathname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (filehandle == INVALID_HANDLE_VALUE)
+        RuntimeError("auto_mapped_file: error opening file '%ls': %d", pathname.c_str(), GetLastError());
+    LARGE_INTEGER filesize;
+    if (!GetFileSizeEx(filehandle, &filesize))
+    {
+        close();
+        RuntimeError("auto_mapped_file: error getting size of file '%ls': %d", pathname.c_str(), GetLastError());
+    }
+    n = (size_t) filesize.QuadPart;
+    if (n == 0) // empty files cannot be mapped
+        return;
+    maphandle = CreateFileMapping(filehandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (maphandle != NULL)
+        p = (const char*) MapViewOfFile(maphandle, FILE_MAP_READ, 0, 0, 0);
+    if (p == nullptr)
+    {
+        close();
+        RuntimeError("auto_mapped_file: error memory-mapping file '%ls': %d", pathname.c_str(), GetLastError());
+    }
+#else
+    fd = ::open(msra::strfun::utf8(pathname).c_str(), O_RDONLY);
+    if (fd == -1)
+        RuntimeError("auto_mapped_file: error opening file '%ls': %s", pathname.c_str(), strerror(errno));
+    struct stat sb;
+    if (fstat(fd, &sb) == -1)
+    {
+        close();
+        RuntimeError("auto_mapped_file: error getting size of file '%ls': %s", pathname.c_str(), strerror(errno));
+    }
+    n = (size_t) sb.st_size;
+    if (n == 0) // empty files cannot be mapped
+        return;
+    void* mapped = mmap(nullptr, n, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        close();
+        RuntimeError("auto_mapped_file: error memory-mapping file '%ls': %s", pathname.c_str(), strerror(errno));
+    }
+    p = (const char*) mapped;
+#endif
+}
+
+void auto_mapped_file::close()
+{
+#ifdef _WIN32
+    if (p)
+        UnmapViewOfFile(p);
+    if (maphandle != NULL)
+        CloseHandle(maphandle);
+    if (filehandle != INVALID_HANDLE_VALUE)
+        CloseHandle(filehandle);
+    maphandle = NULL;
+    filehandle = INVALID_HANDLE_VALUE;
+#else
+    if (p)
+        munmap((void*) p, n);
+    if (fd != -1)
+        ::close(fd);
+    fd = -1;
+#endif
+    p = nullptr;
+    n = 0;
+}
+
 // load it into RAM in one huge chunk
 static size_t fgetfilechars(const std::wstring& path, vector<char>& buffer)
 {
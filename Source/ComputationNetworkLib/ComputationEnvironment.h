@@ -22,6 +22,25 @@ enum class NetworkOperationMode
     preComputing // precomputation is a part of training where most nodes should behave like they are inferring
 };
 
+// how LearnableParameter values are stored when a model is saved
+// Reduced precision encodings make model files smaller; the values are converted back to ElemType when loading.
+enum class ParameterStorageEncoding
+{
+    native,   // ElemType
+    float16,  // IEEE 754 half precision
+    bfloat16, // upper 16 bits of a float
+    int8      // 8-bit integers with a float scale per matrix row
+};
+
+static inline ParameterStorageEncoding ParameterStorageEncodingFromString(const std::wstring& s)
+{
+    if      (s == L"native")   return ParameterStorageEncoding::native;
+    else if (s == L"float16")  return ParameterStorageEncoding::float16;
+    else if (s == L"bfloat16") return ParameterStorageEncoding::bfloat16;
+    else if (s == L"int8")     return ParameterStorageEncoding::int8;
+    else InvalidArgument("Unknown parameter storage encoding '%ls', expected 'native', 'float16', 'bfloat16' or 'int8'.", s.c_str());
+}
+
 // class to store global properties of the network that are of interest to the nodes
 // For example, a network can be in 'training' or 'inference' mode, which affects what nodes like Dropout and BN do,
 // or what the seq-2-seq decoder feedback signal is.
@@ -48,6 +67,9 @@ struct ComputationEnvironment
     // Extreme tracing of node outputs. Make space on your disk.
     bool IsLogLevelNodeTrace() const { return traceLevel >= 1000000; }
 
+    // encoding of the LearnableParameter values when saving the network
+    ParameterStorageEncoding parameterStorageEncoding = ParameterStorageEncoding::native;
+
     // more properties should be added here as needed
 };
 typedef std::shared_ptr<ComputationEnvironment> ComputationEnvironmentPtr;
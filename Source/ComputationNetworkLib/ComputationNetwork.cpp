@@ -106,6 +106,12 @@ void ComputationNetwork::Save(const wstring& fileName, const FileOptions fileFor
 void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptions fileFormat) const
 {
     File fstream(fileName, fileFormat | FileOptions::fileOptionsWrite);
+    Save(fstream);
+}
+
+void ComputationNetwork::Save(File& fstream) const
+{
+    VerifyIsCompiled("Save");
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCN");
 
     // model version
@@ -267,6 +273,8 @@ void ComputationNetwork::Read(const wstring& fileName)
     ClearNetwork();
 
     File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
+    if (m_memoryMapModel && m_deviceId == CPUDEVICE)
+        fstream.MapIntoMemory();
 
     ReadPersistableParameters<ElemType>(fstream, true);
 
@@ -443,6 +451,7 @@ bool ComputationNetwork::IsTypicalCriterionNode(ComputationNodeBasePtr nodePtr)
         nodePtr->OperationName() == OperationNameOf(SequenceWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(CrossEntropyNode) ||
         nodePtr->OperationName() == OperationNameOf(ClassBasedCrossEntropyWithSoftmaxNode) ||
+        nodePtr->OperationName() == OperationNameOf(SampledCrossEntropyWithSoftmaxNode) ||
         nodePtr->OperationName() == OperationNameOf(ClassificationErrorNode) ||
 #ifdef COMING_SOON
         nodePtr->OperationName() == OperationNameOf(CRFNode) ||
@@ -1137,6 +1146,325 @@ void ComputationNetwork::PerformSVDecomposition(const map<wstring, float>& SVDCo
     CompileNetwork();
 }
 
+// -----------------------------------------------------------------------
+// inference optimization
+// -----------------------------------------------------------------------
+
+// This function rewrites the network for evaluating the given output nodes in inference mode:
+//  - nodes that only depend on LearnableParameters are computed once and replaced by LearnableParameters holding their value,
+//  - a BatchNormalization that follows a Times or a Convolution, possibly followed by a Plus of a bias, is folded into the weights and the bias,
+//  - nodes that the output nodes do not depend on are removed.
+// Replaced nodes keep their names. The outputs are the same as before up to rounding, but the network can no longer be trained.
+template <class ElemType>
+void ComputationNetwork::OptimizeForInference(const vector<ComputationNodeBasePtr>& outputNodes)
+{
+    if (outputNodes.empty())
+        InvalidArgument("OptimizeForInference: No output nodes given.");
+
+    // first, so that the column slices of the weights are folded into constants below
+    HoistLoopInvariantProjections<ElemType>();
+
+    // folding substitutes nodes under their original names, so the output nodes are looked up again by name afterwards
+    vector<wstring> outputNodeNames;
+    for (const auto& node : outputNodes)
+        outputNodeNames.push_back(node->NodeName());
+    auto currentOutputNodes = [&]()
+    {
+        vector<ComputationNodeBasePtr> nodes;
+        for (const auto& name : outputNodeNames)
+            nodes.push_back(GetNodeFromName(name));
+        return nodes;
+    };
+
+    size_t numFoldedConstants = FoldConstantSubgraphs<ElemType>(currentOutputNodes());
+    size_t numFoldedBatchNormalizations = FoldBatchNormalizations<ElemType>(currentOutputNodes());
+    size_t numRemovedNodes = RemoveNodesNotNeededFor(currentOutputNodes());
+    fprintf(stderr, "OptimizeForInference: Folded %d constant nodes and %d batch normalizations, removed %d unused nodes.\n",
+            (int)numFoldedConstants, (int)numFoldedBatchNormalizations, (int)numRemovedNodes);
+
+    // redo necessary post-processing
+    CompileNetwork();
+}
+
+// replaces every node without an MBLayout whose inputs are all LearnableParameters by a LearnableParameter holding its value
+// Since nodes are visited in evaluation order, whole subgraphs collapse into a single LearnableParameter.
+template <class ElemType>
+size_t ComputationNetwork::FoldConstantSubgraphs(const vector<ComputationNodeBasePtr>& outputNodes)
+{
+    size_t numFolded = 0;
+    for (const auto& node : ComputationNodeBase::EnumerateNodes(outputNodes))
+    {
+        // nodes with state or randomness must stay as they are, even if they do not depend on the data
+        if (node->IsLeaf() || node->HasMBLayout() || node->Is<IStatefulNode>() || node->Is<RngUser>())
+            continue;
+        auto valueNode = dynamic_pointer_cast<ComputationNode<ElemType>>(node);
+        if (!valueNode || valueNode->GetSampleLayout().GetNumElements() == 0)
+            continue;
+        bool isConstant = true;
+        for (const auto& input : node->GetInputs())
+            isConstant &= IsNodePtr<LearnableParameter<ElemType>>(input);
+        if (!isConstant)
+            continue;
+
+        // compute the value once
+        MatrixPool matrixPool;
+        node->RequestMatricesBeforeForwardProp(matrixPool);
+        node->BeginForwardProp();
+        node->ForwardProp(FrameRange(nullptr));
+        node->EndForwardProp();
+        if (valueNode->Value().GetMatrixType() != DENSE)
+            continue;
+
+        wstring constantName = node->NodeName() + L".folded";
+        if (NodeNameExists(constantName))
+            continue;
+        auto constant = AddNodeToNetWithElemType(New<LearnableParameter<ElemType>>(m_deviceId, constantName, node->GetSampleLayout()));
+        InitLearnableParameters(constant, L"fixedValue", 0); // follow the protocol; otherwise deferred initialization will overwrite the value in validation
+        constant->Value().SetValue(valueNode->Value());
+        ComputationNodeBasePtr(constant)->SetLearningRateMultiplier(0);
+
+        SubstituteNode(node, constant);
+        numFolded++;
+    }
+    return numFolded;
+}
+
+// copies the value of a node without MBLayout to a CPU-side buffer
+template <class ElemType>
+static vector<ElemType> GetValueAsVector(const ComputationNodeBasePtr& node)
+{
+    const auto& value = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+    vector<ElemType> result(value.GetNumElements());
+    ElemType* data = result.data();
+    size_t size = result.size();
+    value.CopyToArray(data, size);
+    return result;
+}
+
+template <class ElemType>
+static void SetValueFromVector(const ComputationNodeBasePtr& node, vector<ElemType>& values)
+{
+    auto& value = dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value();
+    value.SetValue(value.GetNumRows(), value.GetNumCols(), value.GetDeviceId(), values.data());
+}
+
+// determines for every element of a tensor of 'shape' the element of a tensor of 'biasShape' that the tensor operations add to it
+// Returns false if 'biasShape' cannot be broadcast to 'shape'.
+static bool TryGetBroadcastIndices(const TensorShape& shape, const TensorShape& biasShape, vector<size_t>& indices)
+{
+    // trailing singleton dimensions do not affect broadcasting, e.g. of the usual [n x 1] bias to a Times() output of shape [n]
+    SmallVector<size_t> biasDims = biasShape.GetDims();
+    while (biasDims.size() > shape.GetRank() && biasDims[biasDims.size() - 1] == 1)
+        biasDims.pop_back();
+    if (biasDims.size() > shape.GetRank())
+        return false;
+    indices.assign(shape.GetNumElements(), 0);
+    size_t stride = 1;
+    size_t biasStride = 1;
+    for (size_t k = 0; k < shape.GetRank(); k++)
+    {
+        size_t dim = shape[k];
+        size_t biasDim = k < biasDims.size() ? biasDims[k] : 1;
+        if (biasDim != dim && biasDim != 1)
+            return false;
+        if (biasDim != 1)
+        {
+            for (size_t i = 0; i < indices.size(); i++)
+                indices[i] += ((i / stride) % dim) * biasStride;
+        }
+        stride *= dim;
+        biasStride *= biasDim;
+    }
+    return true;
+}
+
+// folds BatchNormalization(Plus(Times(W, x), b)) and BatchNormalization(Convolution(W, x)) etc. into the weights and the bias
+// In inference mode, batch normalization is the per-channel affine map y = a * z + (bias - a * runMean) with a = scale / sqrt(runVariance + epsilon),
+// so it can be applied to the weights and the bias of the layer that produces z instead.
+// A Plus with a new bias is inserted if the layer has none. Weights, bias and intermediate nodes must not be used anywhere else.
+template <class ElemType>
+size_t ComputationNetwork::FoldBatchNormalizations(const vector<ComputationNodeBasePtr>& outputNodes)
+{
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    auto countConsumers = [&]()
+    {
+        numConsumers.clear();
+        for (const auto& iter : m_nameToNodeMap)
+            for (const auto& input : iter.second->GetInputs())
+                numConsumers[input]++;
+    };
+    auto isExclusivelyUsed = [&](const ComputationNodeBasePtr& node)
+    {
+        if (numConsumers[node] != 1)
+            return false;
+        for (auto groupIter : GetAllNodeGroups())
+            if (std::find(groupIter->begin(), groupIter->end(), node) != groupIter->end())
+                return false;
+        return true;
+    };
+    countConsumers();
+
+    size_t numFolded = 0;
+    for (const auto& node : ComputationNodeBase::EnumerateNodes(outputNodes))
+    {
+        auto bn = dynamic_pointer_cast<BatchNormalizationNode<ElemType>>(node);
+        if (!bn || bn->SamplesSeen() == 0 || bn->ImageLayout() != ImageLayoutKind::CHW)
+            continue;
+        bool hasParameters = true;
+        for (size_t i = 1; i < node->GetNumInputs(); i++)
+            hasParameters &= IsNodePtr<LearnableParameter<ElemType>>(node->GetInputs()[i]);
+        if (!hasParameters)
+            continue;
+
+        // match the layer and its bias, if any
+        ComputationNodeBasePtr layer = node->GetInputs()[0];
+        ComputationNodeBasePtr plus;
+        ComputationNodeBasePtr bias;
+        if (IsNodePtr<PlusNode<ElemType>>(layer))
+        {
+            plus = layer;
+            for (size_t i = 0; i < 2; i++)
+            {
+                if (IsNodePtr<LearnableParameter<ElemType>>(plus->GetInputs()[i]) && !plus->GetInputs()[1 - i]->IsLeaf())
+                {
+                    bias = plus->GetInputs()[i];
+                    layer = plus->GetInputs()[1 - i];
+                }
+            }
+            if (!bias || !isExclusivelyUsed(bias) || plus->GetSampleLayout().GetNumElements() != layer->GetSampleLayout().GetNumElements())
+                continue;
+        }
+        if (!isExclusivelyUsed(node->GetInputs()[0]) || (plus && !isExclusivelyUsed(layer)))
+            continue;
+
+        // determine the channel (element of the batch-normalization parameters) of each output element and weight
+        const auto& outputShape = layer->GetSampleLayout();
+        size_t numOutputElements = outputShape.GetNumElements();
+        size_t numChannels = node->GetInputs()[1]->GetSampleLayout().GetNumElements();
+        if (numChannels == 0 || numOutputElements % numChannels != 0)
+            continue;
+        size_t spatialSize = numOutputElements / numChannels; // (1 unless spatial)
+
+        ComputationNodeBasePtr weights = layer->GetInputs().empty() ? nullptr : layer->GetInputs()[0];
+        if (!weights || !IsNodePtr<LearnableParameter<ElemType>>(weights) || !isExclusivelyUsed(weights))
+            continue;
+        size_t numWeights = weights->GetSampleLayout().GetNumElements();
+        size_t weightModulus, weightDivisor; // weight i belongs to channel (i % weightModulus) / weightDivisor
+        if (IsNodePtr<TimesNode<ElemType>>(layer))
+        {
+            // the weight matrix is [numOutputElements x inputDim]; if the product has extra dimensions (from x), output elements of different channels share rows
+            if (numWeights != numOutputElements * layer->GetInputs()[1]->GetSampleLayout().GetNumElements())
+                continue;
+            weightModulus = numOutputElements;
+            weightDivisor = spatialSize;
+        }
+        else if (auto convolution = dynamic_pointer_cast<ConvolutionNode<ElemType>>(layer))
+        {
+            // for CHW convolutions, the kernels of the output maps are stored one after the other
+            auto sharing = convolution->Sharing();
+            if (convolution->Transpose() || convolution->ImageLayout() != ImageLayoutKind::CHW || convolution->MapCount().GetNumElements() != numChannels ||
+                std::find(sharing.begin(), sharing.end(), false) != sharing.end())
+                continue;
+            weightModulus = numWeights;
+            weightDivisor = numWeights / numChannels;
+        }
+        else
+            continue;
+
+        // determine the bias element added to each output element; a new bias gets the shape of the channels, broadcast over the spatial dimensions
+        TensorShape biasShape;
+        if (bias)
+            biasShape = bias->GetSampleLayout();
+        else
+        {
+            SmallVector<size_t> dims = outputShape.GetDims();
+            size_t k = 0;
+            for (size_t size = 1; size < spatialSize && k < dims.size(); k++)
+            {
+                size *= dims[k];
+                dims[k] = 1;
+            }
+            biasShape = TensorShape(dims);
+        }
+        vector<size_t> biasIndices;
+        if (!TryGetBroadcastIndices(outputShape, biasShape, biasIndices))
+            continue;
+        vector<size_t> biasChannels(biasShape.GetNumElements(), SIZE_MAX);
+        bool isPerChannel = true;
+        for (size_t i = 0; i < numOutputElements; i++)
+        {
+            size_t& channel = biasChannels[biasIndices[i]];
+            if (channel == SIZE_MAX)
+                channel = i / spatialSize;
+            isPerChannel &= (channel == i / spatialSize);
+        }
+        wstring foldedName = bn->NodeName() + L".folded";
+        wstring biasName = bn->NodeName() + L".foldedBias";
+        if (!isPerChannel || (!bias && (NodeNameExists(foldedName) || NodeNameExists(biasName))))
+            continue;
+
+        // compute the per-channel affine map
+        auto scaleValues    = GetValueAsVector<ElemType>(node->GetInputs()[1]);
+        auto biasValues     = GetValueAsVector<ElemType>(node->GetInputs()[2]);
+        auto runMean        = GetValueAsVector<ElemType>(node->GetInputs()[3]);
+        auto runVariance    = GetValueAsVector<ElemType>(node->GetInputs()[4]);
+        if (biasValues.size() != numChannels || runMean.size() != numChannels || runVariance.size() != numChannels)
+            continue;
+        double epsilon = bn->Epsilon();
+        if (!bn->UseCNTKEngine() && node->GetDeviceId() >= 0)
+            epsilon = max(epsilon, 1e-5); // the cuDNN engine does not allow smaller values
+        vector<ElemType> multipliers(numChannels);
+        vector<ElemType> offsets(numChannels);
+        for (size_t c = 0; c < numChannels; c++)
+        {
+            multipliers[c] = (ElemType)(scaleValues[c] / sqrt(runVariance[c] + epsilon));
+            offsets[c] = biasValues[c] - multipliers[c] * runMean[c];
+        }
+
+        // apply it to the weights and the bias
+        auto weightValues = GetValueAsVector<ElemType>(weights);
+        for (size_t i = 0; i < numWeights; i++)
+            weightValues[i] *= multipliers[(i % weightModulus) / weightDivisor];
+        SetValueFromVector(weights, weightValues);
+
+        if (!bias)
+        {
+            auto newBias = AddNodeToNetWithElemType(New<LearnableParameter<ElemType>>(m_deviceId, biasName, biasShape));
+            InitLearnableParameters(newBias, L"fixedValue", 0); // follow the protocol; otherwise deferred initialization will overwrite the value in validation
+            bias = newBias;
+            plus = AddNodeToNetAndAttachInputs(New<PlusNode<ElemType>>(m_deviceId, foldedName), { layer, bias });
+        }
+        auto layerBias = GetValueAsVector<ElemType>(bias);
+        for (size_t j = 0; j < layerBias.size(); j++)
+            layerBias[j] = multipliers[biasChannels[j]] * layerBias[j] + offsets[biasChannels[j]];
+        SetValueFromVector(bias, layerBias);
+
+        SubstituteNode(node, plus);
+        countConsumers();
+        numFolded++;
+    }
+    return numFolded;
+}
+
+// deletes all nodes that none of the output nodes depend on
+size_t ComputationNetwork::RemoveNodesNotNeededFor(const vector<ComputationNodeBasePtr>& outputNodes)
+{
+    auto neededNodeList = ComputationNodeBase::EnumerateNodes(outputNodes);
+    set<ComputationNodeBasePtr> neededNodes(neededNodeList.begin(), neededNodeList.end());
+    vector<wstring> unneededNodeNames;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (neededNodes.find(iter.second) == neededNodes.end())
+            unneededNodeNames.push_back(iter.first);
+    }
+    // unneeded nodes are only consumed by other unneeded nodes; cut those links first, since DeleteNode() cannot null a typed input
+    for (const auto& nodeName : unneededNodeNames)
+        GetNodeFromName(nodeName)->DetachInputs();
+    for (const auto& nodeName : unneededNodeNames)
+        DeleteNode(nodeName);
+    return unneededNodeNames.size();
+}
+
 // Helper class to form a logical DBN layer while exporting the network (used by SaveToDbnFile)
 class DbnLayer
 {
@@ -1504,6 +1832,7 @@ template void ComputationNetwork::InitLearnableParametersWithBilinearFill<float>
 template void ComputationNetwork::Read<float>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template void ComputationNetwork::OptimizeForInference<float>(const vector<ComputationNodeBasePtr>& outputNodes);
 template /*static*/ void ComputationNetwork::SetDropoutRate<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate);
 template /*static*/ void ComputationNetwork::SetIRngUserSeed<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
@@ -1515,6 +1844,7 @@ template void ComputationNetwork::InitLearnableParametersWithBilinearFill<double
 template void ComputationNetwork::Read<double>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template void ComputationNetwork::OptimizeForInference<double>(const vector<ComputationNodeBasePtr>& outputNodes);
 template /*static*/ void ComputationNetwork::SetDropoutRate<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate);
 template /*static*/ void ComputationNetwork::SetIRngUserSeed<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
@@ -50,6 +50,7 @@ public:
 
     ComputationNetwork() :
         m_randomSeedOffset(0),
+        m_memoryMapModel(false),
         m_isCompiled(false),
         m_areMatricesAllocated(false),
         m_pMBLayoutOfNetwork(make_shared<MBLayout>(1, 0, L"*")),
@@ -101,6 +102,12 @@ public:
     // design BUGBUG: binary files do not know whether they are float or double.
     // TODO: modify file format to know this; then eliminate the <ElemType> dependency (and in some future, allow nodes to be different)
     template <class ElemType> void Read(const std::wstring& fileName);
+    // If enabled, Read() maps the model file into memory, and the parameters of a CPU network use the mapped values in place
+    // instead of copies (for models saved with CNTK_MODEL_VERSION_16 or later). All processes that load the same model then
+    // share one physical copy of the parameters.
+    void SetMemoryMapModel(bool enable) { m_memoryMapModel = enable; }
+    // encoding of the LearnableParameter values in files written by Save(), e.g. float16 to ship smaller models
+    void SetParameterStorageEncoding(ParameterStorageEncoding encoding) { m_environment->parameterStorageEncoding = encoding; }
     template <class ElemType> void Load(const std::wstring& fileName)
     {
         Read<ElemType>(fileName);
@@ -118,6 +125,8 @@ public:
     }
 
     void Save(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary) const;
+    // serialize into an already open file, e.g. an in-memory file that is written out asynchronously
+    void Save(File& fstream) const;
     void SaveEdited(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary);
 
 private:
@@ -134,7 +143,10 @@ public:
     void ForwardProp(const ComputationNodeBasePtr rootNode);
 
     // main entry point for backprop
-    void Backprop(const ComputationNodeBasePtr rootNode);
+    // If given, 'onParameterGradientReady' is called for every learnable parameter as soon as its gradient is final,
+    // which allows to overlap e.g. distributed gradient aggregation with the rest of the backward pass.
+    typedef std::function<void(const ComputationNodeBasePtr&)> ParameterGradientReadyCallback;
+    void Backprop(const ComputationNodeBasePtr rootNode, const ParameterGradientReadyCallback& onParameterGradientReady = nullptr);
 
     template <class NODESET> // version that takes multiple nodes
     void ForwardProp(const NODESET& nodes)
@@ -202,6 +214,10 @@ public:
     void FormNestedNetwork(const ComputationNodeBasePtr& rootNode);
     ComputationNodeBasePtr GetNestedNetwork(const ComputationNodeBasePtr& rootNode);
 
+    // rewrites W * RowStack(x, dh) inside recurrent loops such that the product with the inputs from outside the loop is computed outside the loop
+    template <class ElemType>
+    size_t HoistLoopInvariantProjections();
+
     // The methods below determine evaluation order, which is tricky in presence of recurrent loops.
     // TODO: Can this be moved to a separate class?
 private:
@@ -374,6 +390,7 @@ public:
     void RenameNode(ComputationNodeBasePtr node, const std::wstring& newNodeName);
     void DeleteNode(const std::wstring& nodeName);
     void ReplaceNode(wstring nodeName, ComputationNodeBasePtr newNode);
+    void SubstituteNode(ComputationNodeBasePtr oldNode, ComputationNodeBasePtr newNode);
     void InsertNode(wstring nodeName, ComputationNodeBasePtr newNode, const std::set<std::wstring>& newNodeTags);
     void ReplaceLeafNode(wstring oldNodeName, ComputationNodeBasePtr newNode);
     void ReplaceFinalCriterionNode(wstring oldNodeName, ComputationNodeBasePtr newNode);
@@ -744,6 +761,18 @@ public:
     template <class ElemType>
     void SaveToDbnFile(ComputationNetworkPtr net, const std::wstring& fileName) const;
 
+    template <class ElemType>
+    void OptimizeForInference(const std::vector<ComputationNodeBasePtr>& outputNodes);
+
+private:
+    template <class ElemType>
+    size_t FoldConstantSubgraphs(const std::vector<ComputationNodeBasePtr>& outputNodes);
+    template <class ElemType>
+    size_t FoldBatchNormalizations(const std::vector<ComputationNodeBasePtr>& outputNodes);
+    size_t RemoveNodesNotNeededFor(const std::vector<ComputationNodeBasePtr>& outputNodes);
+
+public:
+
     // -----------------------------------------------------------------------
     // construction
     // -----------------------------------------------------------------------
@@ -1002,6 +1031,10 @@ protected:
     // them inside a loop over all time steps of the recurrence.
     // For every time step, the entire chain of nodes is called, with the time index
     // passed as a FrameRange object.
+    // The FrameRanges of the time steps are recorded once per minibatch and
+    // replayed by forward and backward propagation. On the CPU, small loop
+    // bodies run without OpenMP parallelism inside the operations, since the
+    // fork/join cost per operation and time step outweighs the gain.
     // -----------------------------------------------------------------------
 
     class SEQTraversalFlowControlNode : public FlowControlNode
@@ -1032,14 +1065,20 @@ protected:
         virtual void ReleaseMatricesAfterBackprop(MatrixPool& matrixPool);
         virtual bool IsOutOfDateWrtInputs() const override;
 
+    private:
+        void RecordSteps();
+
     public:
         ComputationNodeBasePtr m_sourceNode; // one of the nodes of the loop   --TODO: What is the special meaning of this node? It seems to always be a delay node.
         int m_loopId;                        // unique loop id, index in m_allSEQNodes array
         int m_steppingDirection;             // +1 if left to right (t=0..T-1), -1 if rightt to left (t=T-1..0)
+        std::vector<FrameRange> m_steps;     // time steps of the current minibatch in stepping direction, recorded by RecordSteps()
+        bool m_isSingleThreaded;             // run the steps without OpenMP parallelism (small loop body on the CPU)
 
         SEQTraversalFlowControlNode(int loopId, ComputationNodeBasePtr cur)
             : m_loopId(loopId),
-              m_sourceNode(cur)
+              m_sourceNode(cur),
+              m_isSingleThreaded(false)
         {
             SetNodeName(L"Loop_" + m_sourceNode->NodeName());
         }
@@ -1095,6 +1134,9 @@ protected:
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
         PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+
+        // called during Backprop() for each leaf that needs a gradient, once all its consumers have been processed
+        ParameterGradientReadyCallback m_parameterGradientReadyCallback;
     };
 
 public:
@@ -1114,6 +1156,7 @@ public:
 private:
     DEVICEID_TYPE m_deviceId; // TODO: is this shared by all nodes?
     unsigned long m_randomSeedOffset;
+    bool m_memoryMapModel;
 
     // main node holder
     std::map<const std::wstring, ComputationNodeBasePtr, nocase_compare> m_nameToNodeMap; // [name] -> node; this is the main container that holds this networks' nodes
@@ -9,6 +9,8 @@
 #include "ComputationNode.h"
 #include "ComputationNetwork.h"
 #include "RecurrentNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "ReshapingNodes.h"
 #include <string>
 #include <set>
 
@@ -475,4 +477,130 @@ static int DetermineLoopDirection(const std::vector<ComputationNodeBasePtr>& nes
     return steppingDirection;
 }
 
+// -----------------------------------------------------------------------
+// hoisting loop-invariant computation out of recurrent loops
+// -----------------------------------------------------------------------
+
+// Every node of a strongly connected component depends on the recurrence, so nodes that do not, like the input
+// projection W * x of an LSTM, are already left to PAR mode by FormRecurrentLoops(). However, RNNs are often written
+// with a single weight matrix for the stacked input and recurrent state, W * RowStack(x, dh), which turns the input
+// projection into a small per-time-step matrix product inside the loop. This function splits such products by the
+// column blocks of W:
+//     W * RowStack(x, dh)  -->  W[:, columns of x] * x  +  W[:, columns of dh] * dh
+// Now the product with x does not depend on the recurrence anymore, and is computed outside the loop as one product
+// over all frames, in ForwardProp() as well as in Backprop(). The Plus replaces the Times node and takes over its name;
+// RowStack nodes that are no longer used are deleted.
+// Only Times nodes with a matrix as the first input and a RowStack of vectors as the second one are rewritten; the inputs
+// from inside the loop must be consecutive in the RowStack, so that they keep being multiplied in one product.
+// The network must be compiled (all dimensions are known); it is recompiled if anything was changed.
+// Returns the number of rewritten Times nodes.
+template <class ElemType>
+size_t ComputationNetwork::HoistLoopInvariantProjections()
+{
+    VerifyIsCompiled("HoistLoopInvariantProjections");
+
+    // collect the candidates first, since the rewrite changes the set of nodes
+    vector<ComputationNodeBasePtr> candidates;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (iter.second->IsPartOfLoop() && IsNodePtr<TimesNode<ElemType>>(iter.second))
+            candidates.push_back(iter.second);
+    }
+
+    size_t numHoisted = 0;
+    set<ComputationNodeBasePtr> rowStacks;
+    for (const auto& times : candidates)
+    {
+        const auto& weights = times->GetInputs()[0];
+        auto rowStack = dynamic_pointer_cast<RowStackNode<ElemType>>(times->GetInputs()[1]);
+        if (!rowStack || rowStack->GetSpliceDim() != 1 || dynamic_pointer_cast<TimesNode<ElemType>>(times)->OutputRank() != 1 ||
+            weights->HasMBLayout() || weights->GetSampleLayout().GetRank() != 2)
+            continue;
+
+        // determine the columns of W that belong to each stacked input, and the stacked inputs that are computed inside the loop
+        auto loop = FindInRecurrentLoops(m_allSEQNodes, times);
+        const auto& stackedInputs = rowStack->GetInputs();
+        vector<size_t> firstColumns(1, 0);
+        size_t firstInLoop = SIZE_MAX, endInLoop = 0;
+        bool areVectors = true;
+        for (size_t i = 0; i < stackedInputs.size(); i++)
+        {
+            areVectors &= (stackedInputs[i]->GetSampleLayout().GetRank() == 1);
+            firstColumns.push_back(firstColumns.back() + stackedInputs[i]->GetSampleLayout().GetNumElements());
+            if (FindInRecurrentLoops(m_allSEQNodes, stackedInputs[i]) == loop)
+            {
+                firstInLoop = min(firstInLoop, i);
+                endInLoop = i + 1;
+            }
+        }
+        if (!areVectors || firstColumns.back() != weights->GetSampleLayout()[1] || firstInLoop == SIZE_MAX ||
+            (firstInLoop == 0 && endInLoop == stackedInputs.size()))
+            continue;
+        bool areConsecutive = true;
+        for (size_t i = firstInLoop; i < endInLoop; i++)
+            areConsecutive &= (FindInRecurrentLoops(m_allSEQNodes, stackedInputs[i]) == loop);
+        const wstring& name = times->NodeName();
+        wstring newNames[] = { name + L".hoisted", name + L".invariant", name + L".invariant0", name + L".invariant0.W", name + L".invariant0.stack",
+                               name + L".invariant1", name + L".invariant1.W", name + L".invariant1.stack", name + L".recurrent", name + L".recurrent.W", name + L".recurrent.stack" };
+        bool areNamesAvailable = true;
+        for (const auto& newName : newNames)
+            areNamesAvailable &= !NodeNameExists(newName);
+        if (!areConsecutive || !areNamesAvailable)
+            continue;
+
+        // the product of the stacked inputs [begin, end) with the matching columns of W
+        auto project = [&](size_t begin, size_t end, const wstring& projectionName) -> ComputationNodeBasePtr
+        {
+            ComputationNodeBasePtr input = stackedInputs[begin];
+            if (end - begin > 1)
+                input = AddNodeToNetAndAttachInputs(New<RowStackNode<ElemType>>(m_deviceId, projectionName + L".stack"), vector<ComputationNodeBasePtr>(stackedInputs.begin() + begin, stackedInputs.begin() + end));
+            auto columns = AddNodeToNetAndAttachInputs(New<SliceNode<ElemType>>(m_deviceId, projectionName + L".W", (int)firstColumns[begin], (int)firstColumns[end], 2), { weights });
+            return AddNodeToNetAndAttachInputs(New<TimesNode<ElemType>>(m_deviceId, projectionName), { columns, input });
+        };
+
+        // the inputs from outside the loop are at most two runs, before and after the ones from inside
+        vector<ComputationNodeBasePtr> invariantProjections;
+        if (firstInLoop > 0)
+            invariantProjections.push_back(project(0, firstInLoop, name + L".invariant0"));
+        if (endInLoop < stackedInputs.size())
+            invariantProjections.push_back(project(endInLoop, stackedInputs.size(), name + L".invariant1"));
+        ComputationNodeBasePtr invariant = invariantProjections[0];
+        if (invariantProjections.size() > 1)
+            invariant = AddNodeToNetAndAttachInputs(New<PlusNode<ElemType>>(m_deviceId, name + L".invariant"), invariantProjections);
+        auto recurrent = project(firstInLoop, endInLoop, name + L".recurrent");
+        auto sum = AddNodeToNetAndAttachInputs(New<PlusNode<ElemType>>(m_deviceId, name + L".hoisted"), { invariant, recurrent });
+
+        SubstituteNode(times, sum);
+        rowStacks.insert(rowStack);
+        numHoisted++;
+    }
+
+    // delete the RowStack nodes that are no longer used
+    for (const auto& rowStack : rowStacks)
+    {
+        bool isUsed = false;
+        for (const auto& iter : m_nameToNodeMap)
+        {
+            const auto& inputs = iter.second->GetInputs();
+            isUsed |= (std::find(inputs.begin(), inputs.end(), rowStack) != inputs.end());
+        }
+        for (auto group : GetAllNodeGroups())
+            isUsed |= (std::find(group->begin(), group->end(), rowStack) != group->end());
+        if (!isUsed)
+            DeleteNode(rowStack->NodeName());
+    }
+
+    if (numHoisted > 0)
+    {
+        fprintf(stderr, "HoistLoopInvariantProjections: Moved the products with loop-invariant inputs of %d Times operations out of recurrent loops.\n", (int)numHoisted);
+
+        // redo necessary post-processing
+        CompileNetwork();
+    }
+    return numHoisted;
+}
+
+template size_t ComputationNetwork::HoistLoopInvariantProjections<float>();
+template size_t ComputationNetwork::HoistLoopInvariantProjections<double>();
+
 }}}
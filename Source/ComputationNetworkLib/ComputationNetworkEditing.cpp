@@ -205,6 +205,33 @@ void ComputationNetwork::ReplaceNode(wstring nodeName, ComputationNodeBasePtr ne
     }
 }
 
+// replace oldNode by newNode, which is already part of the network, including moving over all network links and node group memberships
+// oldNode is deleted and newNode takes over its name, so that the node can still be found under the old name.
+void ComputationNetwork::SubstituteNode(ComputationNodeBasePtr oldNode, ComputationNodeBasePtr newNode)
+{
+    InvalidateCompiledNetwork();
+
+    // change all nodes that have old node as input to point to the new node instead
+    ChangeNodeInputs(oldNode, newNode);
+
+    // also update node groups
+    for (auto groupIter : GetAllNodeGroups())
+    {
+        auto& group = *groupIter;
+        auto search = std::find(group.begin(), group.end(), oldNode);
+        if (search == group.end())
+            continue;
+        if (std::find(group.begin(), group.end(), newNode) == group.end())
+            *search = newNode;
+        else
+            group.erase(search);
+    }
+
+    wstring nodeName = oldNode->NodeName();
+    DeleteNode(nodeName);
+    RenameNode(newNode, nodeName);
+}
+
 // Inserts a newNode such that the inputNodeName serves as the input to the newNode
 // Prior to this call, inputNodeName should be set as the input to newNode.
 void ComputationNetwork::InsertNode(wstring inputNodeName, ComputationNodeBasePtr newNode, const std::set<std::wstring>& newNodeTags)
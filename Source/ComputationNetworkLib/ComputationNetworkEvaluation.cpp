@@ -10,6 +10,8 @@
 #include "ComputationNetwork.h"
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
+#include "CPUMatrix.h" // for SetNumThreadsOfCallingThread()
+#include "Globals.h"
 #include <string>
 #include <vector>
 #include <list>
@@ -63,7 +65,8 @@ static bool SetRootGradientToScalarOne(ComputationNodeBasePtr nodep)
 //  - ForwardProp() for eval nodes
 //  - ForwardProp() for the training criterion (which will reuse computation results from the previous step)
 //  - Backprop() for the training criterion
-void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // training criterion to compute the gradients for
+void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode, // training criterion to compute the gradients for
+                                  const ParameterGradientReadyCallback& onParameterGradientReady)
 {
     if (!Environment().IsTraining())
         LogicError("Backprop: Requires network is to be in training mode.");
@@ -76,7 +79,10 @@ void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // trai
     ZeroInputGradients(rootNode);
 
     // backpropagate through the network
-    GetNestedNetwork(rootNode)->Backprop(FrameRange(nullptr), true, true);
+    auto network = dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(rootNode));
+    network->m_parameterGradientReadyCallback = onParameterGradientReady;
+    network->Backprop(FrameRange(nullptr), true, true);
+    network->m_parameterGradientReadyCallback = nullptr;
 }
 
 void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -168,6 +174,11 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
         // Extreme Tracing, part 2/4
         if (node->HasEnvironmentPtr() && node->Environment().IsLogLevelNodeTrace() && node->NeedsGradient())
             DumpNode<float>(node, /*dumpGradient=*/true) || DumpNode<double>(node, true);
+
+        // Leaves come before all their consumers in evaluation order, so when we get here
+        // all contributions to the gradient of a learnable parameter have been accumulated.
+        if (m_parameterGradientReadyCallback && node->IsLeaf() && node->NeedsGradient())
+            m_parameterGradientReadyCallback(node);
     }
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
@@ -213,6 +224,43 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
 // unrolls the loop over time steps and runs the network once per time step.
 // -----------------------------------------------------------------------
 
+// limits the OpenMP parallelism of the calling thread for the lifetime of this object
+class SingleThreadedScope
+{
+    int m_previousNumThreads;
+    bool m_isActive;
+
+public:
+    SingleThreadedScope(bool isActive)
+        : m_isActive(isActive)
+    {
+        if (m_isActive)
+            m_previousNumThreads = CPUMatrix<float /*any will do*/>::SetNumThreadsOfCallingThread(1);
+    }
+    ~SingleThreadedScope()
+    {
+        if (m_isActive)
+            CPUMatrix<float>::SetNumThreadsOfCallingThread(m_previousNumThreads);
+    }
+};
+
+// record the FrameRanges of all time steps of the current minibatch, and decide how to run them
+// The per-step operations of a loop are small: each works on one column per parallel sequence. If they are small enough,
+// the OpenMP fork/join inside every operation costs more than it gains, so the whole loop runs on the calling thread.
+// The threshold is Globals::GetMaxSingleThreadedLoopStepSize() (config "maxSingleThreadedLoopStepSize"; 0 disables this).
+void ComputationNetwork::SEQTraversalFlowControlNode::RecordSteps()
+{
+    FrameRangeIteration range(GetMBLayout(), m_steppingDirection);
+    m_steps.clear();
+    for (auto t = range.begin(); t != range.end(); t++)
+        m_steps.push_back(t);
+
+    size_t stepSize = 0;
+    for (auto& node : m_nestedNodes)
+        stepSize = max(stepSize, node->GetSampleLayout().GetNumElements() * GetMBLayout()->GetNumParallelSequences());
+    m_isSingleThreaded = m_nestedNodes[0]->GetDeviceId() == CPUDEVICE && stepSize <= Globals::GetMaxSingleThreadedLoopStepSize();
+}
+
 /*virtual*/ void ComputationNetwork::SEQTraversalFlowControlNode::BeginForwardProp() /*override*/
 {
     // take the opportunity to check that layout is shared by all nodes in the loop
@@ -225,6 +273,8 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
                        m_nestedNodes[0]->NodeName().c_str(), m_nestedNodes[0]->GetMBLayoutAxisString().c_str());
     }
 
+    RecordSteps();
+
     // tell all that loop is about to commence
     for (auto& node : m_nestedNodes)
         node->BeginForwardProp();
@@ -243,16 +293,20 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
     // for every time step run through all nodes in this particular loop (treat the loop like a little ComputationNetwork)
     // Note: Currently, this is limited to linear-time loops. But nothing stops the iteration below to, e.g., be a 2D iteration over an image
     // if we implement an according FrameRangeIteration.
-    FrameRangeIteration range(GetMBLayout(), m_steppingDirection);
-    for (auto t = range.begin(); t != range.end(); t++)
     {
-        for (auto& node : m_nestedNodes)
+        SingleThreadedScope singleThreaded(m_isSingleThreaded);
+        for (const auto& t : m_steps)
         {
-            node->ForwardProp(t);
-            node->BumpEvalTimeStamp();
+            for (auto& node : m_nestedNodes)
+                node->ForwardProp(t);
         }
     }
 
+    // Time stamps are only compared outside the loop, so it suffices to bump them once. Bumping them in evaluation order
+    // keeps every node newer than its inputs.
+    for (auto& node : m_nestedNodes)
+        node->BumpEvalTimeStamp();
+
     // Extreme Tracing, part 3/4
     for (auto& node : m_nestedNodes)
     {
@@ -273,6 +327,10 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
 // called before first iteration step of ComputeGradient()
 /*virtual*/ void ComputationNetwork::SEQTraversalFlowControlNode::BeginBackprop() /*override*/
 {
+    // the steps were recorded by the forward pass of the same minibatch, unless it was skipped since nothing had changed
+    if (m_steps.size() != GetMBLayout()->GetNumTimeSteps())
+        RecordSteps();
+
     for (auto& node2 : m_nestedNodes)
         node2->BeginBackprop();
 }
@@ -281,14 +339,13 @@ static bool DumpNode(ComputationNodeBasePtr nodep, bool dumpGradient)
 {
     childrenInThisLoop, childrenInOuterLoop;    // TODO: think through what these mean when coming from PAR mode
     const auto& recurrentNodes = m_nestedNodes; // BUGBUG: -ForForward?? Does this mean we can remove non-ForForward?
-    auto pMBLayout = recurrentNodes[0]->GetMBLayout();
-    FrameRangeIteration range(pMBLayout, m_steppingDirection);
-    for (auto t = range.rbegin(); t != range.rend(); t++) // note: reverse iteration
+    SingleThreadedScope singleThreaded(m_isSingleThreaded);
+    for (auto t = m_steps.rbegin(); t != m_steps.rend(); t++) // note: reverse iteration
     {
         for (auto nodeIter2 = recurrentNodes.rbegin(); nodeIter2 != recurrentNodes.rend(); ++nodeIter2)
         {
             auto& node2 = *nodeIter2;
-            node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
+            node2->Backprop(*t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
         }
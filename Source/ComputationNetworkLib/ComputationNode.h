@@ -44,7 +44,8 @@
 #define CNTK_MODEL_VERSION_13 13 // batch norm: switch running inverse std deviation -> variance, MB count -> samplesSeen; CuDNN v5
 #define CNTK_MODEL_VERSION_14 14 // axis parameter in OptimizedRNNStackNode
 #define CNTK_MODEL_VERSION_15 15 // add new nodes: LambdaRankNode and NDCG1Eval
-#define CURRENT_CNTK_MODEL_VERSION CNTK_MODEL_VERSION_15
+#define CNTK_MODEL_VERSION_16 16 // page-aligned LearnableParameter values with an encoding tag (native, float16, bfloat16, int8), for memory-mapped loading
+#define CURRENT_CNTK_MODEL_VERSION CNTK_MODEL_VERSION_16
 
 extern bool g_shareNodeValueMatrices;
 
@@ -138,6 +139,13 @@ struct /*interface*/ IStatefulNode
     typedef std::shared_ptr<INodeState> NodeStatePtr;
     virtual NodeStatePtr ExportState() = 0;
     virtual void ImportState(const NodeStatePtr& state) = 0;
+
+    // Per-sequence state, for carrying individual streams over from one minibatch to the next (e.g. interleaved sessions
+    // of streaming evaluation). ExportSequenceState() returns the state at the end of parallel sequence s of the last
+    // minibatch. ImportSequenceStates() sets up the states the parallel sequences of the next minibatch continue from;
+    // a nullptr state means the sequence starts in the next minibatch.
+    virtual NodeStatePtr ExportSequenceState(size_t s) = 0;
+    virtual void ImportSequenceStates(const std::vector<NodeStatePtr>& states) = 0;
 };
 typedef IStatefulNode::NodeStatePtr NodeStatePtr;
 
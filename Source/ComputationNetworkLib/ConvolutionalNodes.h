@@ -148,6 +148,7 @@ public:
     TensorShape LowerPad() const { return m_lowerPad; }
     TensorShape UpperPad() const { return m_upperPad; }
     bool Transpose() const { return m_transpose; }
+    ImageLayoutKind ImageLayout() const { return m_imageLayout; }
     size_t MaxTempMemSizeInSamples() const { return m_maxTempMemSizeInSamples; }
     PoolKind PoolingKind() const { return m_poolKind; }
 
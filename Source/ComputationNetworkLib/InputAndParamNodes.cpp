@@ -10,6 +10,7 @@
 #include "Globals.h"     // for ShouldForceConstantRandomSeed()
 
 #include <string>
+#include <cmath>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -414,7 +415,12 @@ void LearnableParameter<ElemType>::Save(File& fstream) const /*override*/
     Base::Save(fstream);
     fstream << m_learningRateMultiplier;
     m_sampleLayout.Save(fstream);
-    fstream << Value();
+    bool isAligned = !fstream.IsTextBased() && Value().GetMatrixType() == DENSE;
+    fstream << isAligned;
+    if (isAligned)
+        SaveAlignedValue(fstream);
+    else
+        fstream << Value();
 }
 
 template <class ElemType>
@@ -447,13 +453,218 @@ void LearnableParameter<ElemType>::Load(File& fstream, size_t modelVersion) /*ov
         }
     }
 
-    LoadValue(fstream);
+    bool isAligned = false;
+    if (modelVersion >= CNTK_MODEL_VERSION_16)
+        fstream >> isAligned;
+    if (isAligned)
+        LoadAlignedValue(fstream);
+    else
+        LoadValue(fstream);
     SetDims(sampleLayout, false); // note: call this after LoadValue() since LoadValue() overwrites m_sampleLayout
     VerifyDataSize(Value());      // sanity check
 
     m_initString.clear(); // deferred initialization not possible after loading
 }
 
+// conversions for the reduced precision storage encodings (round to nearest even)
+static uint16_t FloatToFloat16(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x7f800000) // Inf or NaN
+        return (uint16_t)(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0));
+    if (absBits >= 0x477ff000) // rounds to a value beyond the largest half (65504)
+        return (uint16_t)(sign | 0x7c00);
+    if (absBits < 0x38800000) // denormal half: let the FPU round by adding 0.5, whose mantissa ulp is the smallest half denormal
+    {
+        float f;
+        memcpy(&f, &absBits, sizeof(f));
+        f += 0.5f;
+        memcpy(&absBits, &f, sizeof(f));
+        return (uint16_t)(sign | (absBits - 0x3f000000));
+    }
+
+    uint32_t mantissaOdd = (absBits >> 13) & 1;
+    absBits += 0xc8000fff + mantissaOdd; // rebias the exponent from 127 to 15 and round
+    return (uint16_t)(sign | (absBits >> 13));
+}
+
+static float Float16ToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) // Inf or NaN
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else // zero or denormal
+    {
+        float f = mantissa / 16777216.0f; // mantissa * 2^-24
+        memcpy(&bits, &f, sizeof(bits));
+        bits |= sign;
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static uint16_t FloatToBFloat16(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000) // NaN: keep it a NaN
+        return (uint16_t)((bits >> 16) | 0x40);
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+static float BFloat16ToFloat(uint16_t value)
+{
+    uint32_t bits = (uint32_t)value << 16;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Layout of an aligned value: element size, dimensions, encoding, per-row scales (int8 only),
+// padding to s_valueAlignment, and the column-major values in the given encoding.
+template <class ElemType>
+void LearnableParameter<ElemType>::SaveAlignedValue(File& fstream) const
+{
+    const auto& value = Value();
+    size_t numRows = value.GetNumRows();
+    size_t numCols = value.GetNumCols();
+    size_t numElements = value.GetNumElements();
+
+    auto encoding = HasEnvironmentPtr() ? Environment().parameterStorageEncoding : ParameterStorageEncoding::native;
+    if (encoding == ParameterStorageEncoding::int8 && numCols == 1)
+        encoding = ParameterStorageEncoding::native; // a scale per element does not save anything for vectors (e.g. biases)
+
+    fstream << sizeof(ElemType) << numRows << numCols << (int)encoding;
+
+    const ElemType* data;
+    std::unique_ptr<ElemType[]> buffer;
+    if (value.GetCurrentMatrixLocation() == CPU)
+        data = value.Data();
+    else
+    {
+        buffer.reset(value.CopyToArray());
+        data = buffer.get();
+    }
+
+    switch (encoding)
+    {
+    case ParameterStorageEncoding::native:
+    {
+        fstream.PadToAlignment(s_valueAlignment);
+        fwriteOrDie(data, sizeof(ElemType), numElements, fstream);
+        break;
+    }
+    case ParameterStorageEncoding::float16:
+    case ParameterStorageEncoding::bfloat16:
+    {
+        std::vector<uint16_t> encoded(numElements);
+        for (size_t i = 0; i < numElements; i++)
+            encoded[i] = (encoding == ParameterStorageEncoding::float16) ? FloatToFloat16((float)data[i]) : FloatToBFloat16((float)data[i]);
+        fstream.PadToAlignment(s_valueAlignment);
+        fwriteOrDie(encoded.data(), sizeof(uint16_t), numElements, fstream);
+        break;
+    }
+    case ParameterStorageEncoding::int8:
+    {
+        // symmetric quantization: the largest magnitude of each row maps to 127
+        std::vector<float> scales(numRows, 0);
+        for (size_t j = 0; j < numCols; j++)
+            for (size_t i = 0; i < numRows; i++)
+                scales[i] = std::max(scales[i], (float)fabs(data[j * numRows + i]));
+        for (auto& scale : scales)
+            scale /= 127;
+
+        std::vector<int8_t> encoded(numElements);
+        for (size_t j = 0; j < numCols; j++)
+            for (size_t i = 0; i < numRows; i++)
+                encoded[j * numRows + i] = (scales[i] == 0) ? 0 : (int8_t)std::max(-127.0f, std::min(127.0f, roundf((float)data[j * numRows + i] / scales[i])));
+
+        fwriteOrDie(scales.data(), sizeof(float), numRows, fstream);
+        fstream.PadToAlignment(s_valueAlignment);
+        fwriteOrDie(encoded.data(), sizeof(int8_t), numElements, fstream);
+        break;
+    }
+    default:
+        LogicError("LearnableParameter: Unexpected parameter storage encoding %d.", (int)encoding);
+    }
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::LoadAlignedValue(File& fstream)
+{
+    size_t elementSize, numRows, numCols;
+    fstream >> elementSize >> numRows >> numCols;
+    if (elementSize != sizeof(ElemType))
+        RuntimeError("LearnableParameter: %ls has element size %d in the model file, expected %d.", NodeName().c_str(), (int)elementSize, (int)sizeof(ElemType));
+
+    int encodingTag;
+    fstream >> encodingTag;
+    auto encoding = (ParameterStorageEncoding)encodingTag;
+
+    CreateMatrixIfNull(m_value);
+    size_t numElements = numRows * numCols;
+    if (encoding != ParameterStorageEncoding::native)
+    {
+        // reduced precision values are converted back to ElemType
+        std::vector<ElemType> buffer(numElements);
+        switch (encoding)
+        {
+        case ParameterStorageEncoding::float16:
+        case ParameterStorageEncoding::bfloat16:
+        {
+            std::vector<uint16_t> encoded(numElements);
+            fstream.PadToAlignment(s_valueAlignment);
+            freadOrDie(encoded.data(), sizeof(uint16_t), numElements, fstream);
+            for (size_t i = 0; i < numElements; i++)
+                buffer[i] = (ElemType)((encoding == ParameterStorageEncoding::float16) ? Float16ToFloat(encoded[i]) : BFloat16ToFloat(encoded[i]));
+            break;
+        }
+        case ParameterStorageEncoding::int8:
+        {
+            std::vector<float> scales(numRows);
+            std::vector<int8_t> encoded(numElements);
+            freadOrDie(scales.data(), sizeof(float), numRows, fstream);
+            fstream.PadToAlignment(s_valueAlignment);
+            freadOrDie(encoded.data(), sizeof(int8_t), numElements, fstream);
+            for (size_t j = 0; j < numCols; j++)
+                for (size_t i = 0; i < numRows; i++)
+                    buffer[j * numRows + i] = (ElemType)(encoded[j * numRows + i] * scales[i]);
+            break;
+        }
+        default:
+            RuntimeError("LearnableParameter: %ls has unknown storage encoding %d in the model file.", NodeName().c_str(), (int)encoding);
+        }
+        Value().SetValue(numRows, numCols, Value().GetDeviceId(), buffer.data());
+    }
+    else if (fstream.IsMappedIntoMemory() && Value().GetDeviceId() == CPUDEVICE && Value().GetMatrixType() == DENSE)
+    {
+        fstream.PadToAlignment(s_valueAlignment);
+        // use the values in place; pages stay shared with other processes until written to (copy-on-write)
+        auto data = reinterpret_cast<ElemType*>(fstream.ReadMapped(numElements * sizeof(ElemType)));
+        Value().SetValue(numRows, numCols, CPUDEVICE, data, matrixFlagDontOwnBuffer);
+        m_valueMapping = fstream.GetMapping();
+    }
+    else
+    {
+        fstream.PadToAlignment(s_valueAlignment);
+        std::vector<ElemType> buffer(numElements);
+        freadOrDie(buffer.data(), sizeof(ElemType), numElements, fstream);
+        Value().SetValue(numRows, numCols, Value().GetDeviceId(), buffer.data());
+    }
+    SetDims(TensorShape(numRows, numCols), false);
+}
+
 template <class ElemType>
 /*virtual*/ void LearnableParameter<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const wstring& newName, const CopyNodeFlags flags) const /*override*/
 {
@@ -125,6 +125,13 @@ public:
 
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
 
+private:
+    // Dense values in binary files are stored as a raw page-aligned blob, which can be used in place from a mapped file.
+    void SaveAlignedValue(File& fstream) const;
+    void LoadAlignedValue(File& fstream);
+    static const size_t s_valueAlignment = 4096;
+
+public:
     // computation functions don't do anything for parameter nodes
     virtual void UpdateFunctionMBSize() override;
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange&) override;
@@ -163,6 +170,9 @@ private:
 
     // flags related to gradient update
     float m_regMultiplier; // The multiplier to adjust the L1Reg and L2Reg for Learnable node
+
+    // memory-mapped model file that Value() points into, if loaded that way; keeps the mapping alive
+    std::shared_ptr<char> m_valueMapping;
 };
 
 // -----------------------------------------------------------------------
@@ -625,6 +625,112 @@ public:
 template class TransposeTimesNode<float>;
 template class TransposeTimesNode<double>;
 
+// -----------------------------------------------------------------------
+// EmbeddingLookupNode (E, indexSequence) -- embedding lookup
+// Returns the columns of the [dim x vocab] embedding matrix E that are selected
+// by a scalar sequence of word indices, i.e. the same as Times (E, OneHot (indexSequence))
+// without materializing the one-hot input or running a product over the vocabulary.
+// The gradient of E is block sparse with only the columns of the words in the minibatch,
+// so that the sparse code paths of the learners (AdaGrad, FSAdaGrad, L2) update those
+// columns only, at a cost proportional to the minibatch rather than the vocabulary.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class EmbeddingLookupNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<2>
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"EmbeddingLookup"; }
+
+    // our inputs
+    static const size_t EMBEDDINGMATRIX = 0;
+    static const size_t INDEXDATA = 1;
+
+public:
+    DeclareConstructorFromConfigWithNumInputs(EmbeddingLookupNode);
+    EmbeddingLookupNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : Base(deviceId, name),
+          m_oneHot(0, 0, deviceId, SPARSE, matrixFormatSparseCSC)
+    {
+    }
+
+    virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override
+    {
+        InputRef(INDEXDATA).MaskMissingValueColumnsTo(FrameRange(InputRef(INDEXDATA).GetMBLayout()), -1); // indicates an invalid column to Gather
+        Value().DoGatherColumnsOf(/*beta=*/0, InputRef(INDEXDATA).Value(), InputRef(EMBEDDINGMATRIX).ValueAsMatrix(), /*alpha=*/1);
+    }
+
+    virtual void /*ComputationNodeNonLooping::*/ BackpropToNonLooping(size_t inputIndex) override
+    {
+        if (inputIndex != EMBEDDINGMATRIX)
+            return;
+
+        // one-hot [vocab x T] of the indices, gaps (index -1) are empty columns
+        let& index = InputRef(INDEXDATA).Value();
+        size_t vocabSize = InputRef(EMBEDDINGMATRIX).GetAsMatrixNumCols();
+        size_t numCols = index.GetNumCols();
+        std::vector<ElemType> buffer(numCols);
+        index.CopySection(1, numCols, buffer.data(), 1);
+
+        std::vector<CPUSPARSE_INDEX_TYPE> colStarts(numCols + 1, 0);
+        std::vector<CPUSPARSE_INDEX_TYPE> rows;
+        rows.reserve(numCols);
+        for (size_t t = 0; t < numCols; t++)
+        {
+            if (buffer[t] >= 0)
+            {
+                if (buffer[t] >= vocabSize)
+                    InvalidArgument("%ls: Word index %d is out of range for the embedding matrix with %d columns.", NodeDescription().c_str(), (int) buffer[t], (int) vocabSize);
+                rows.push_back((CPUSPARSE_INDEX_TYPE) buffer[t]);
+            }
+            colStarts[t + 1] = (CPUSPARSE_INDEX_TYPE) rows.size();
+        }
+        std::vector<ElemType> ones(rows.size(), 1);
+        m_oneHot.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), ones.data(), rows.size(), vocabSize, numCols);
+
+        // E gradient += output gradient * oneHot', which only touches the columns of the words in the minibatch
+        Matrix<ElemType>::MultiplyAndAdd(Gradient(), false, m_oneHot, true, InputRef(EMBEDDINGMATRIX).GradientAsMatrix());
+    }
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return childIndex == INDEXDATA; }
+
+    virtual void AllocateGradientMatricesForInputs(MatrixPool& matrixPool) override
+    {
+        // the gradient of a learnable embedding is block sparse; it is allocated directly instead of from the pool, as in TimesNodeBase
+        if (Input(EMBEDDINGMATRIX)->NeedsGradient() && Input(EMBEDDINGMATRIX)->IsLeaf())
+        {
+            Input(EMBEDDINGMATRIX)->CreateGradientMatrixIfNull();
+            Input(EMBEDDINGMATRIX)->Gradient().SwitchToMatrixType(SPARSE, MatrixFormat::matrixFormatSparseBlockCol, false);
+        }
+
+        Base::AllocateGradientMatricesForInputs(matrixPool);
+    }
+
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
+    {
+        ComputationNodeBase::Validate(isFinalValidationPass);
+
+        // inherit MBLayout from the index data
+        m_pMBLayout = Input(INDEXDATA)->GetMBLayout();
+        if (isFinalValidationPass)
+        {
+            if (Input(EMBEDDINGMATRIX)->HasMBLayout())
+                InvalidArgument("%ls requires the first argument (embedding matrix) to not be minibatch data.", NodeDescription().c_str());
+            if (!Input(INDEXDATA)->HasMBLayout() || Input(INDEXDATA)->GetSampleLayout().GetNumElements() != 1)
+                InvalidArgument("%ls requires the second argument (index data) to be a scalar sequence.", NodeDescription().c_str());
+        }
+
+        // one column of the embedding matrix per index
+        SetDims(TensorShape(Input(EMBEDDINGMATRIX)->GetAsMatrixNumRows()), HasMBLayout());
+    }
+
+private:
+    Matrix<ElemType> m_oneHot; // sparse [vocab x T], one-hot of the indices, for the gradient
+};
+
+template class EmbeddingLookupNode<float>;
+template class EmbeddingLookupNode<double>;
+
 // -----------------------------------------------------------------------
 // SumElementsNode (input)
 // Sums up all elements in the input across all samples into a single scalar.
@@ -494,6 +494,62 @@ template<class ElemType, int direction>
         LogicError("Unrecognized direction in DelayedValueNodeBase");
 }
 
+template<class ElemType, int direction>
+/*virtual*/ NodeStatePtr DelayedValueNodeBase<ElemType, direction>::/*IStatefulNode::*/ ExportSequenceState(size_t s) /*override*/
+{
+    int dir = direction;
+    if (dir != -1 || m_timeStep != 1)
+        RuntimeError("%ls %ls operation: Per-sequence state is only supported for PastValue with timeStep=1.", NodeName().c_str(), OperationName().c_str());
+    if (!m_delayedActivationMBLayout || s >= m_delayedActivationMBLayout->GetNumParallelSequences())
+        LogicError("ExportSequenceState: Parallel sequence %d does not exist in the last minibatch.", (int)s);
+
+    // The state is the activation of the last frame of the last sequence in the parallel sequence.
+    const MBLayout::SequenceInfo* lastSequence = nullptr;
+    for (const auto& sequenceInfo : m_delayedActivationMBLayout->GetAllSequences())
+    {
+        if (sequenceInfo.s == s && sequenceInfo.seqId != GAP_SEQUENCE_ID && (!lastSequence || lastSequence->tBegin < sequenceInfo.tBegin))
+            lastSequence = &sequenceInfo;
+    }
+
+    if (!lastSequence)
+        LogicError("ExportSequenceState: Parallel sequence %d of the last minibatch has no frames.", (int)s);
+
+    size_t t = min(lastSequence->tEnd, m_delayedActivationMBLayout->GetNumTimeSteps()) - 1;
+    auto pState = make_shared<DelayedValueNodeState<ElemType>>(m_deviceId);
+    pState->CacheState(m_delayedValue->ColumnSlice(t * m_delayedActivationMBLayout->GetNumParallelSequences() + s, 1));
+    return pState;
+}
+
+template<class ElemType, int direction>
+/*virtual*/ void DelayedValueNodeBase<ElemType, direction>::/*IStatefulNode::*/ ImportSequenceStates(const std::vector<NodeStatePtr>& states) /*override*/
+{
+    int dir = direction;
+    if (dir != -1 || m_timeStep != 1)
+        RuntimeError("%ls %ls operation: Per-sequence state is only supported for PastValue with timeStep=1.", NodeName().c_str(), OperationName().c_str());
+
+    // Pretend a previous minibatch of a single frame, in which the sequences that are continued do not end.
+    // The next minibatch then has to declare these sequences to begin at time -1.
+    size_t numParallelSequences = states.size();
+    m_delayedValue->Resize(GetSampleLayout().GetNumElements(), numParallelSequences);
+    m_delayedActivationMBLayout = make_shared<MBLayout>();
+    m_delayedActivationMBLayout->Init(numParallelSequences, 1);
+    for (size_t s = 0; s < numParallelSequences; s++)
+    {
+        if (!states[s])
+        {
+            m_delayedActivationMBLayout->AddGap(s, 0, 1);
+            continue;
+        }
+
+        DelayedNodeStatePtr pState = dynamic_pointer_cast<DelayedValueNodeState<ElemType>>(states[s]);
+        if (!pState || pState->IsEmpty())
+            LogicError("Expecting a non-empty DelayValueNodeState after downcasting");
+
+        m_delayedValue->SetColumnSlice(pState->ExportCachedActivity(), s, 1);
+        m_delayedActivationMBLayout->AddSequence(NEW_SEQUENCE_ID, s, 0, 2);
+    }
+}
+
 // instantiate the classes that derive from the above
 template class PastValueNode<float>;
 template class PastValueNode<double>;
@@ -73,6 +73,8 @@ public:
     virtual int /*IRecurrentNode::*/ GetRecurrenceSteppingDirection() const override { return -direction; }
     virtual NodeStatePtr /*IStatefulNode::*/ ExportState() override;
     virtual void /*IStatefulNode::*/ ImportState(const NodeStatePtr& pImportedState) override;
+    virtual NodeStatePtr /*IStatefulNode::*/ ExportSequenceState(size_t s) override;
+    virtual void /*IStatefulNode::*/ ImportSequenceStates(const std::vector<NodeStatePtr>& states) override;
     int TimeStep() const { return m_timeStep; }
     ElemType InitialActivationValue() const { return m_initialStateValue; }
 
@@ -240,8 +240,308 @@ void RandomSampleInclusionFrequencyNode<ElemType>::Validate(bool isFinalValidati
     SetDims(TensorShape(nClasses, 1), false);
 }
 
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<SampledCrossEntropyWithSoftmaxNode<ElemType>>(nodeP);
+        node->m_numSamples = m_numSamples;
+        node->m_randomSeed = m_randomSeed;
+    }
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Save(File& fstream) const
+{
+    Base::Save(fstream);
+    fstream << m_numSamples;
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Load(File& fstream, size_t modelVersion)
+{
+    Base::Load(fstream, modelVersion);
+    fstream >> m_numSamples;
+}
+
+// Rebuilds the alias table only if the sampling weights have been recomputed since it was built, which for a constant or learnable
+// parameter happens once, or after every update of the parameter.
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::UpdateSampler()
+{
+    auto& samplingWeightsNode = InputRef(4);
+    if (m_sampler.Size() != 0 && samplingWeightsNode.GetEvalTimeStamp() == m_samplerTimeStamp)
+        return;
+
+    const Matrix<ElemType>& samplingWeights = samplingWeightsNode.Value();
+    std::vector<ElemType> weights(samplingWeights.GetNumElements());
+    samplingWeights.CopySection(samplingWeights.GetNumRows(), samplingWeights.GetNumCols(), weights.data(), samplingWeights.GetNumRows());
+    m_sampler.Build(weights);
+    m_samplerTimeStamp = samplingWeightsNode.GetEvalTimeStamp();
+}
+
+// log of the expected number of occurrences of class c among the samples; floored so that targets which are never sampled get a finite logit
+template <class ElemType>
+double SampledCrossEntropyWithSoftmaxNode<ElemType>::LogExpectedCount(size_t c) const
+{
+    return log(std::max(m_numSamples * m_sampler.Probability(c), 1e-30));
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::ForwardPropNonLooping()
+{
+    FrameRange fr(InputRef(0).GetMBLayout());
+    InputRef(0).MaskMissingValueColumnsToZero(fr);
+    InputRef(1).MaskMissingValueColumnsToZero(fr);
+    const Matrix<ElemType>& labels = InputRef(0).ValueFor(fr);
+    const Matrix<ElemType>& input = InputRef(1).ValueFor(fr);
+    const Matrix<ElemType>& weights = InputRef(2).ValueAsMatrix();
+    const Matrix<ElemType> bias = InputRef(3).Value().Reshaped(1, InputRef(3).Value().GetNumElements());
+    size_t numClasses = labels.GetNumRows();
+    size_t numCols = labels.GetNumCols();
+    DEVICEID_TYPE deviceId = input.GetDeviceId();
+
+    UpdateSampler();
+
+    // target class of every column: (1, 2, ..., nClasses) * labels - 1, which is -1 for the all-zero gap columns
+    if (m_classIdsPlusOne.GetNumCols() != numClasses)
+    {
+        std::vector<ElemType> classIdsPlusOne(numClasses);
+        for (size_t c = 0; c < numClasses; c++)
+            classIdsPlusOne[c] = (ElemType) (c + 1);
+        m_classIdsPlusOne.SetValue(1, numClasses, deviceId, classIdsPlusOne.data());
+    }
+    m_targetIds.AssignProductOf(m_classIdsPlusOne, false, labels, false);
+
+    std::vector<ElemType> buffer(numCols);
+    m_targetIds.CopySection(1, numCols, buffer.data(), 1);
+    m_targets.resize(numCols);
+    for (size_t t = 0; t < numCols; t++)
+    {
+        m_targets[t] = (int) floor(buffer[t] + 0.5) - 1;
+        if (m_targets[t] < -1 || m_targets[t] >= (int) numClasses)
+            InvalidArgument("%ls %ls operation: The labels must be one-hot vectors.", NodeName().c_str(), OperationName().c_str());
+        buffer[t] = (ElemType) std::max(m_targets[t], 0);
+    }
+    m_targetIds.SetValue(1, numCols, deviceId, buffer.data());
+
+    // draw the samples of this minibatch, shared by all columns
+    CPURNGHandle* cpuRNGHandle = dynamic_cast<CPURNGHandle*>(&GetRNGHandle(CPUDEVICE));
+    m_samples.resize(m_numSamples);
+    std::vector<ElemType> sampleIds(m_numSamples);
+    std::vector<ElemType> sampleOffsets(m_numSamples);
+    for (size_t k = 0; k < m_numSamples; k++)
+    {
+        m_samples[k] = m_sampler.Sample(cpuRNGHandle->Generator());
+        sampleIds[k] = (ElemType) m_samples[k];
+        sampleOffsets[k] = (ElemType) -LogExpectedCount(m_samples[k]);
+    }
+    for (size_t t = 0; t < numCols; t++)
+        buffer[t] = m_targets[t] < 0 ? 0 : (ElemType) -LogExpectedCount(m_targets[t]);
+
+    m_sampleIds.SetValue(1, m_numSamples, deviceId, sampleIds.data());
+    m_sampleOffsets.SetValue(m_numSamples, 1, deviceId, sampleOffsets.data());
+    m_targetOffsets.SetValue(1, numCols, deviceId, buffer.data());
+
+    m_gatheredBias.DoGatherColumnsOf(0, m_sampleIds, bias, 1);
+    m_sampleOffsets += m_gatheredBias.Reshaped(m_numSamples, 1);
+    m_gatheredBias.DoGatherColumnsOf(0, m_targetIds, bias, 1);
+    m_targetOffsets += m_gatheredBias;
+
+    // logits of the samples [numSamples x T] and of the targets [1 x T], only the weights of these classes are touched
+    m_sampledWeights.DoGatherColumnsOf(0, m_sampleIds, weights, 1);
+    m_sampledLogits.AssignProductOf(m_sampledWeights, true, input, false);
+    Matrix<ElemType>::ScaleAndAdd(1, m_sampleOffsets, m_sampledLogits); // column vector, added to every column
+    m_targetWeights.DoGatherColumnsOf(0, m_targetIds, weights, 1);
+    Matrix<ElemType>::InnerProduct(m_targetWeights, input, m_targetLogits, true);
+    m_targetLogits += m_targetOffsets;
+
+    // remove the accidental hits, i.e. the samples that are equal to the target of a column
+    std::vector<std::pair<size_t, size_t>> sortedSamples(m_numSamples); // (class, index of the sample)
+    for (size_t k = 0; k < m_numSamples; k++)
+        sortedSamples[k] = std::make_pair(m_samples[k], k);
+    std::sort(sortedSamples.begin(), sortedSamples.end());
+
+    std::vector<CPUSPARSE_INDEX_TYPE> colStarts(numCols + 1, 0);
+    std::vector<CPUSPARSE_INDEX_TYPE> rows;
+    for (size_t t = 0; t < numCols; t++)
+    {
+        if (m_targets[t] >= 0)
+        {
+            for (auto iter = std::lower_bound(sortedSamples.begin(), sortedSamples.end(), std::make_pair((size_t) m_targets[t], (size_t) 0));
+                 iter != sortedSamples.end() && iter->first == (size_t) m_targets[t]; ++iter)
+                rows.push_back((CPUSPARSE_INDEX_TYPE) iter->second);
+        }
+        colStarts[t + 1] = (CPUSPARSE_INDEX_TYPE) rows.size();
+    }
+    if (!rows.empty())
+    {
+        std::vector<ElemType> values(rows.size(), (ElemType) LZERO);
+        m_hitMask.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), values.data(), rows.size(), m_numSamples, numCols);
+        Matrix<ElemType>::ScaleAndAdd(1, m_hitMask, m_sampledLogits);
+    }
+
+    // log softmax over the candidates of every column, with the target in row 0
+    m_logSoftmax.Resize(m_numSamples + 1, numCols);
+    m_logSoftmax.AssignToRowSliceValuesOf(m_targetLogits, 0, 1);
+    m_logSoftmax.AssignToRowSliceValuesOf(m_sampledLogits, 1, m_numSamples);
+    m_logSoftmax.InplaceLogSoftmax(true);
+
+    // criterion: -sum_t log P(target of column t) over the columns that are not gaps
+    m_targetLogits.AssignRowSliceValuesOf(m_logSoftmax, 0, 1);
+    m_targetLogits.CopySection(1, numCols, buffer.data(), 1);
+    double criterion = 0;
+    for (size_t t = 0; t < numCols; t++)
+    {
+        if (m_targets[t] >= 0)
+            criterion -= buffer[t];
+    }
+    Value().Resize(1, 1);
+    Value().SetValue((ElemType) criterion);
+
+    m_needRecomputeLogitGradients = true;
+}
+
+// Computes the gradients w.r.t. the logits once per minibatch, as they are shared by the gradients of the input, weights and bias.
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::ComputeLogitGradients()
+{
+    if (!m_needRecomputeLogitGradients)
+        return;
+
+    size_t numClasses = InputRef(0).GetSampleMatrixNumRows();
+    size_t numCols = m_targets.size();
+    DEVICEID_TYPE deviceId = m_logSoftmax.GetDeviceId();
+
+    // (softmax - 1 for the target) * gradient of the criterion, and 0 for gaps
+    ElemType criterionGradient = Gradient().Get00Element();
+    std::vector<ElemType> validColumns(numCols);
+    for (size_t t = 0; t < numCols; t++)
+        validColumns[t] = m_targets[t] >= 0 ? criterionGradient : 0;
+    m_validColumns.SetValue(1, numCols, deviceId, validColumns.data());
+
+    m_sampledLogitGradient.AssignRowSliceValuesOf(m_logSoftmax, 1, m_numSamples);
+    m_sampledLogitGradient.InplaceExp();
+    m_sampledLogitGradient.RowElementMultiplyWith(m_validColumns);
+    m_targetLogitGradient.AssignRowSliceValuesOf(m_logSoftmax, 0, 1);
+    m_targetLogitGradient.InplaceExp();
+    m_targetLogitGradient.ElementMultiplyWith(m_validColumns);
+    m_targetLogitGradient -= m_validColumns;
+
+    // class of the target of every column (none for gaps), followed by the class of every sample
+    std::vector<CPUSPARSE_INDEX_TYPE> colStarts(numCols + m_numSamples + 1, 0);
+    std::vector<CPUSPARSE_INDEX_TYPE> rows;
+    for (size_t t = 0; t < numCols; t++)
+    {
+        if (m_targets[t] >= 0)
+            rows.push_back((CPUSPARSE_INDEX_TYPE) m_targets[t]);
+        colStarts[t + 1] = (CPUSPARSE_INDEX_TYPE) rows.size();
+    }
+    for (size_t k = 0; k < m_numSamples; k++)
+    {
+        rows.push_back((CPUSPARSE_INDEX_TYPE) m_samples[k]);
+        colStarts[numCols + k + 1] = (CPUSPARSE_INDEX_TYPE) rows.size();
+    }
+    std::vector<ElemType> ones(rows.size(), 1);
+    m_classScatter.SetMatrixFromCSCFormat(colStarts.data(), rows.data(), ones.data(), rows.size(), numClasses, numCols + m_numSamples);
+
+    m_needRecomputeLogitGradients = false;
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::BackpropToNonLooping(size_t inputIndex)
+{
+    // the labels and the sampling weights receive no gradient
+    if (inputIndex == 0 || inputIndex == 4)
+        return;
+
+    ComputeLogitGradients();
+
+    FrameRange fr(InputRef(0).GetMBLayout());
+    size_t numCols = m_targets.size();
+    if (inputIndex == 1)
+    {
+        // input: sum of the weights of the candidates, weighted with their logit gradients
+        auto gradient = InputRef(1).GradientFor(fr);
+        Matrix<ElemType>::MultiplyAndAdd(m_sampledWeights, false, m_sampledLogitGradient, false, gradient);
+        m_targetWeights.RowElementMultiplyWith(m_targetLogitGradient); // m_targetWeights is recomputed by the next ForwardProp()
+        gradient += m_targetWeights;
+    }
+    else if (inputIndex == 2)
+    {
+        // weights: gradient of every target and sample, scattered to the column of its class
+        const Matrix<ElemType>& input = InputRef(1).ValueFor(fr);
+        m_candidateGradients.Resize(input.GetNumRows(), numCols + m_numSamples);
+        m_candidateGradients.SetColumnSlice(input, 0, numCols);
+        m_candidateGradients.ColumnSlice(0, numCols).RowElementMultiplyWith(m_targetLogitGradient);
+        auto sampleGradients = m_candidateGradients.ColumnSlice(numCols, m_numSamples);
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, input, false, m_sampledLogitGradient, true, 0, sampleGradients);
+        // the gradient is sparse block column (see AllocateGradientMatricesForInputs()), with the columns of the candidate classes only
+        Matrix<ElemType>::MultiplyAndAdd(m_candidateGradients, false, m_classScatter, true, InputRef(2).GradientAsMatrix());
+    }
+    else if (inputIndex == 3)
+    {
+        // bias: sum of the logit gradients of every class
+        m_candidateLogitGradients.Resize(1, numCols + m_numSamples);
+        m_candidateLogitGradients.SetColumnSlice(m_targetLogitGradient, 0, numCols);
+        Matrix<ElemType>::VectorSum(m_sampledLogitGradient, m_sampledLogitGradientSums, false);
+        m_candidateLogitGradients.SetColumnSlice(m_sampledLogitGradientSums.Reshaped(1, m_numSamples), numCols, m_numSamples);
+        auto biasGradient = InputRef(3).Gradient().Reshaped(InputRef(3).Gradient().GetNumElements(), 1);
+        Matrix<ElemType>::MultiplyAndAdd(m_classScatter, false, m_candidateLogitGradients.Reshaped(numCols + m_numSamples, 1), false, biasGradient);
+    }
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::Validate(bool isFinalValidationPass)
+{
+    Base::Validate(isFinalValidationPass);
+    m_pMBLayout = nullptr; // this node reduces over the minibatch
+
+    if (m_numSamples == 0)
+        InvalidArgument("%ls %ls operation: Number of requested samples is zero.", NodeName().c_str(), OperationName().c_str());
+
+    size_t numClasses = Input(0)->GetSampleLayout().GetNumElements();
+    size_t hiddenDim = Input(1)->GetSampleLayout().GetNumElements();
+    Input(2)->ValidateInferInputDimsFrom(TensorShape(hiddenDim, numClasses));
+    Input(3)->ValidateInferInputDimsFrom(TensorShape(numClasses));
+
+    if (isFinalValidationPass)
+    {
+        if (!Input(0)->HasMBLayout() || !Input(1)->HasMBLayout())
+            InvalidArgument("%ls %ls operation: The labels and the input must be minibatch data.", NodeName().c_str(), OperationName().c_str());
+        if (Input(0)->GetMBLayout() != Input(1)->GetMBLayout())
+            InvalidArgument("%ls %ls operation: The labels and the input must have the same dynamic axis.", NodeName().c_str(), OperationName().c_str());
+        if (Input(2)->HasMBLayout() || Input(3)->HasMBLayout() || Input(4)->HasMBLayout())
+            InvalidArgument("%ls %ls operation: The weights, bias and sampling weights must not be minibatch data.", NodeName().c_str(), OperationName().c_str());
+        if (Input(2)->GetAsMatrixNumRows() != hiddenDim || Input(2)->GetAsMatrixNumCols() != numClasses)
+            InvalidArgument("%ls %ls operation: The weights must have the shape [%d x %d] (input dimension x number of classes), but have [%d x %d].", NodeName().c_str(), OperationName().c_str(),
+                            (int) hiddenDim, (int) numClasses, (int) Input(2)->GetAsMatrixNumRows(), (int) Input(2)->GetAsMatrixNumCols());
+        if (Input(3)->GetSampleLayout().GetNumElements() != numClasses || Input(4)->GetSampleLayout().GetNumElements() != numClasses)
+            InvalidArgument("%ls %ls operation: The bias and the sampling weights must have the dimension %d of the labels.", NodeName().c_str(), OperationName().c_str(), (int) numClasses);
+    }
+
+    SetDims(TensorShape(1), false);
+}
+
+template <class ElemType>
+void SampledCrossEntropyWithSoftmaxNode<ElemType>::AllocateGradientMatricesForInputs(MatrixPool& matrixPool)
+{
+    // the gradient of the weights only has the columns of the candidate classes, so it is allocated as a sparse matrix directly instead of from the pool
+    if (Input(2)->NeedsGradient())
+    {
+        Input(2)->CreateGradientMatrixIfNull();
+        Input(2)->Gradient().SwitchToMatrixType(SPARSE, MatrixFormat::matrixFormatSparseBlockCol, false);
+    }
+
+    Base::AllocateGradientMatricesForInputs(matrixPool);
+}
+
 template class RandomSampleNode<float>;
 template class RandomSampleNode<double>;
 template class RandomSampleInclusionFrequencyNode<float>;
 template class RandomSampleInclusionFrequencyNode<double>;
+template class SampledCrossEntropyWithSoftmaxNode<float>;
+template class SampledCrossEntropyWithSoftmaxNode<double>;
 }}}
\ No newline at end of file
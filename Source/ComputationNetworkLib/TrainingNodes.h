@@ -10,6 +10,7 @@
 #include "RNGHandle.h"
 #include "InputAndParamNodes.h"
 #include "CPURNGHandle.h"
+#include "AliasSampler.h"
 
 
 #define __STDC_FORMAT_MACROS
@@ -1317,6 +1318,115 @@ private:
     double EstimateNumberOfTries();
 };
 
+// ------------------------------------------------------------------------------------------------------------------------------------------------
+// SampledCrossEntropyWithSoftmaxNode(labels, input, weights, bias, samplingWeights, numSamples):
+// Cross entropy with softmax over the target class and numSamples classes sampled from samplingWeights, instead of over all classes.
+// The logit of every candidate class c is corrected by -log(numSamples * p(c)), and sampled classes that equal the target ("accidental hits")
+// are excluded, so that the criterion estimates the full cross entropy at the cost of O(numSamples) instead of O(nClasses) logits per frame.
+// The samples are drawn once per minibatch, with replacement, from an alias table that is only rebuilt when samplingWeights change.
+//
+// Parameters:
+// * Input(0): labels, one-hot vectors of dimension nClasses (typically sparse).
+// * Input(1): input, e.g. the output of the last hidden layer, of dimension hiddenDim.
+// * Input(2): weights, Matrix of shape (hiddenDim x nClasses) holding the output embedding of class c in column c. Its gradient is a sparse
+//             block column matrix that only contains the columns of the target and sampled classes.
+// * Input(3): bias, vector of dimension nClasses.
+// * Input(4): samplingWeights, vector of dimension nClasses providing sampling weights >= 0, e.g. the unigram counts. Receives no gradient.
+// * numSamples: number of sampled classes per minibatch.
+// --------------------------------------------------------------------------------------------------------------------------------------------------
+
+template <class ElemType>
+class SampledCrossEntropyWithSoftmaxNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<5>, public RngUser
+{
+    typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"SampledCrossEntropyWithSoftmax"; }
+
+public:
+    SampledCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name, size_t numSamples = 0)
+        : Base(deviceId, name),
+          m_numSamples(numSamples),
+          m_samplerTimeStamp(-1),
+          m_classIdsPlusOne(deviceId),
+          m_targetIds(deviceId),
+          m_sampleIds(deviceId),
+          m_targetOffsets(deviceId),
+          m_sampleOffsets(deviceId),
+          m_gatheredBias(deviceId),
+          m_targetWeights(deviceId),
+          m_sampledWeights(deviceId),
+          m_targetLogits(deviceId),
+          m_sampledLogits(deviceId),
+          m_hitMask(0, 0, deviceId, SPARSE, matrixFormatSparseCSC),
+          m_logSoftmax(deviceId),
+          m_needRecomputeLogitGradients(false),
+          m_targetLogitGradient(deviceId),
+          m_sampledLogitGradient(deviceId),
+          m_validColumns(deviceId),
+          m_classScatter(0, 0, deviceId, SPARSE, matrixFormatSparseCSC),
+          m_candidateGradients(deviceId),
+          m_candidateLogitGradients(deviceId),
+          m_sampledLogitGradientSums(deviceId)
+    {
+        SetRandomSeed((unsigned long)CreateUniqId());
+    }
+
+    SampledCrossEntropyWithSoftmaxNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : SampledCrossEntropyWithSoftmaxNode(configp->Get(L"deviceId"), L"<placeholder>", configp->Get(L"numSamples"))
+    {
+        AttachInputsFromConfig(configp, this->GetExpectedNumInputs());
+    }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+
+    virtual void /*ComputationNode::*/ ForwardPropNonLooping() override;
+    virtual void /*ComputationNode::*/ BackpropToNonLooping(size_t inputIndex) override;
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+    virtual void AllocateGradientMatricesForInputs(MatrixPool& matrixPool) override;
+
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t childIndex) const override { return childIndex == 1 || childIndex == 2; }
+    virtual bool IsOutOfDateWrtInputs() const override { return true; } // new samples for every minibatch
+
+    size_t GetNumSamples() const { return m_numSamples; }
+
+private:
+    void UpdateSampler();
+    void ComputeLogitGradients();
+    double LogExpectedCount(size_t c) const;
+
+    size_t m_numSamples;
+    AliasSampler m_sampler;
+    int64_t m_samplerTimeStamp; // time stamp of the samplingWeights the sampler was built from
+
+    std::vector<int> m_targets;    // target class of every column, -1 for gaps
+    std::vector<size_t> m_samples; // sampled classes of the current minibatch
+
+    Matrix<ElemType> m_classIdsPlusOne; // (1, 2, ..., nClasses), to get class ids from one-hot labels
+    Matrix<ElemType> m_targetIds;       // [1 x T], gaps mapped to class 0
+    Matrix<ElemType> m_sampleIds;       // [1 x numSamples]
+    Matrix<ElemType> m_targetOffsets;   // [1 x T] bias - log(numSamples * p) of the targets
+    Matrix<ElemType> m_sampleOffsets;   // [numSamples x 1] bias - log(numSamples * p) of the samples
+    Matrix<ElemType> m_gatheredBias;
+    Matrix<ElemType> m_targetWeights;   // [hiddenDim x T] weights of the target of each column
+    Matrix<ElemType> m_sampledWeights;  // [hiddenDim x numSamples]
+    Matrix<ElemType> m_targetLogits;    // [1 x T]
+    Matrix<ElemType> m_sampledLogits;   // [numSamples x T]
+    Matrix<ElemType> m_hitMask;         // sparse [numSamples x T], LZERO at the accidental hits
+    Matrix<ElemType> m_logSoftmax;      // [(1 + numSamples) x T], target in row 0
+
+    // gradients w.r.t. the logits, and their scatter to the classes
+    bool m_needRecomputeLogitGradients;
+    Matrix<ElemType> m_targetLogitGradient;      // [1 x T]
+    Matrix<ElemType> m_sampledLogitGradient;     // [numSamples x T]
+    Matrix<ElemType> m_validColumns;             // [1 x T], gradient of the criterion for valid columns, 0 for gaps
+    Matrix<ElemType> m_classScatter;             // sparse [nClasses x (T + numSamples)], class of the target of each column and of each sample
+    Matrix<ElemType> m_candidateGradients;       // [hiddenDim x (T + numSamples)], weights gradient of each target and sample
+    Matrix<ElemType> m_candidateLogitGradients;  // [1 x (T + numSamples)], bias gradient of each target and sample
+    Matrix<ElemType> m_sampledLogitGradientSums; // [numSamples x 1]
+};
+
 // -----------------------------------------------------------------------
 // ClassBasedCrossEntropyWithSoftmaxNode (labeldata(.,t), inputdata(.,t), embeddingMatrix, clsProbBeforeSoftmaxData(.,t))
 //  - Input(0) [4 x T] label in dense matrix in
@@ -1330,6 +1440,8 @@ private:
 // -----------------------------------------------------------------------
 // calculates: -sum(left_i * log(softmax_i(right))) for class given history and for word given history
 // need to provide class probabilty from external node
+// The samples of a minibatch are grouped by class, so that the word posteriors of each class take one product
+// [nbr_wrd x hdsize] x [hdsize x nbr_samples] and one column-wise log softmax, and likewise one product per class in backprop.
 template <class ElemType>
 class ClassBasedCrossEntropyWithSoftmaxNode : public ComputationNodeNonLooping /*ComputationNode*/<ElemType>, public NumInputs<4>
 {
@@ -1350,7 +1462,13 @@ public:
           m_softMax(deviceId),
           m_grdToSoftMaxInput(deviceId),
           m_clsLogSoftmax(deviceId),
-          m_clsSoftmax(deviceId)
+          m_clsSoftmax(deviceId),
+          m_columnMap(deviceId),
+          m_groupedInput(deviceId),
+          m_groupedInputGradient(deviceId),
+          m_wordTargets(deviceId),
+          m_clsTargets(deviceId),
+          m_clsLogLikelihood(deviceId)
     {
     }
 
@@ -1385,6 +1503,95 @@ private:
         return sz;
     }
 
+    // The samples of a minibatch that belong to the same class. Their class-conditional distributions are computed together,
+    // as one [nbr_wrd x m_nbrSamples] block of the concatenated workspace, with one product against the class's weight columns.
+    struct ClassGroup
+    {
+        size_t m_lftBnd;      // index of first word belonging to the class
+        size_t m_nbrWrd;      // number of words in the class
+        size_t m_firstSample; // first column of the group in m_groupedInput
+        size_t m_nbrSamples;  // number of samples of the class in the minibatch
+        size_t m_offset;      // offset of the group's block in the concatenated workspace
+    };
+
+    // view of the block of a group in a concatenated workspace, one column per sample
+    static Matrix<ElemType> GroupBlock(const Matrix<ElemType>& workspace, const ClassGroup& group)
+    {
+        return workspace.ColumnSlice(group.m_offset, group.m_nbrWrd * group.m_nbrSamples).Reshaped(group.m_nbrWrd, group.m_nbrSamples);
+    }
+
+    // sort the samples by class (stable), and set up the column map that gathers the hidden activations in that order,
+    // as well as the one-hot targets of the words in the concatenated workspace and of the classes
+    void GroupSamplesByClass()
+    {
+        struct Sample
+        {
+            size_t m_column;
+            size_t m_wordIndex;
+            size_t m_classIndex;
+            size_t m_lftBnd;
+            size_t m_nbrWrd;
+        };
+
+        const size_t nS = Input(LABELDATA)->GetNumParallelSequences();
+        const size_t numCols = m_clsLogSoftmax.GetNumCols();
+
+        std::vector<Sample> samples;
+        std::vector<size_t> classBegin(m_nbrCls + 1, 0); // counts per class, then start of each class in sorted order
+        ForColumnsWithClass([&](size_t s, size_t t, const FrameRange& /*fr*/, size_t y_t, size_t c_t, size_t /*sz*/, size_t lft_bnd, size_t nbr_wrd)
+        {
+            if (nbr_wrd == 0)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
+            if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
+            if (c_t >= m_nbrCls)
+                LogicError("ClassBasedCrossEntropyWithSoftmax: Class index %d out of bounds of the %d classes.", (int)c_t, (int)m_nbrCls);
+
+            samples.push_back(Sample{ t * nS + s, y_t, c_t, lft_bnd, nbr_wrd });
+            classBegin[c_t + 1]++;
+        });
+        for (size_t c = 0; c < m_nbrCls; c++)
+            classBegin[c + 1] += classBegin[c];
+
+        std::vector<size_t> order(samples.size());
+        std::vector<size_t> next(classBegin.begin(), classBegin.end() - 1);
+        for (size_t i = 0; i < samples.size(); i++)
+            order[next[samples[i].m_classIndex]++] = i;
+
+        std::vector<ElemType> columnMap(samples.size());
+        std::vector<ElemType> wordTargets;
+        std::vector<ElemType> clsTargets(m_nbrCls * numCols, 0);
+        m_classGroups.clear();
+        size_t offset = 0;
+        for (size_t c = 0; c < m_nbrCls; c++)
+        {
+            if (classBegin[c] == classBegin[c + 1])
+                continue;
+
+            const Sample& first = samples[order[classBegin[c]]];
+            ClassGroup group = { first.m_lftBnd, first.m_nbrWrd, classBegin[c], classBegin[c + 1] - classBegin[c], offset };
+            wordTargets.resize(offset + group.m_nbrWrd * group.m_nbrSamples, 0);
+            for (size_t j = group.m_firstSample; j < classBegin[c + 1]; j++)
+            {
+                const Sample& sample = samples[order[j]];
+                if (sample.m_lftBnd != group.m_lftBnd || sample.m_nbrWrd != group.m_nbrWrd)
+                    LogicError("ClassBasedCrossEntropyWithSoftmax: Words of class %d have different class-member index ranges.", (int)c);
+
+                columnMap[j] = (ElemType)sample.m_column;
+                wordTargets[offset + (j - group.m_firstSample) * group.m_nbrWrd + (sample.m_wordIndex - group.m_lftBnd)] = 1;
+                clsTargets[sample.m_column * m_nbrCls + c] = 1;
+            }
+            m_classGroups.push_back(group);
+            offset += group.m_nbrWrd * group.m_nbrSamples;
+        }
+        m_totalNbrWords = offset;
+
+        const DEVICEID_TYPE deviceId = m_clsLogSoftmax.GetDeviceId();
+        m_columnMap.SetValue(1, columnMap.size(), deviceId, columnMap.data());
+        m_wordTargets.SetValue(1, wordTargets.size(), deviceId, wordTargets.data());
+        m_clsTargets.SetValue(m_nbrCls, numCols, deviceId, clsTargets.data());
+    }
+
     // compute gradients to input observations, the weights to the observations, and the class log posterior probabilites
     virtual void BackpropToNonLooping(size_t inputIndex) override
     {
@@ -1392,67 +1599,60 @@ private:
         if (inputIndex != 1 && inputIndex != 2 && inputIndex != 3)
             InvalidArgument("ClassCrossEntropyWithSoftmaxNode criterion only takes with respect to input, weight to the input and class log posterior probability.");
 
-        ComputeSoftMaxPartial(); // Note: Flag m_needRecomputeGradientToSoftmaxInput guards so that this computes only once.
-
-        ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& fr, size_t /*y_t*/, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
+        FrameRange fr(InputRef(LABELDATA).GetMBLayout());
+        switch (inputIndex)
         {
-            // compute prb - 1 and prb
-            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(lft_bnd, nbr_wrd);
-            Matrix<ElemType> obs = InputRef(INPUTDATA).ValueFor(fr); // hidden activation vector for current word token
-            Matrix<ElemType> grd_to_soft_max_input = m_grdToSoftMaxInput.ColumnSlice(sz, nbr_wrd);
-
-            switch (inputIndex)
+            case 1:
             {
-                case 1:
-                {
-                    // gradient to input
-                    Matrix<ElemType> grd_t = InputRef(INPUTDATA).GradientFor(fr);
-                    Matrix<ElemType>::MultiplyAndAdd(weightForClass, false, grd_to_soft_max_input, true, grd_t);
-                    break;
-                }
-                case 2:
+                // gradient to input, computed in class order and scattered back to the minibatch columns
+                ComputeSoftMaxPartial(); // Note: Flag m_needRecomputeGradientToSoftmaxInput guards so that this computes only once.
+                m_groupedInputGradient.Resize(m_groupedInput.GetNumRows(), m_groupedInput.GetNumCols());
+                for (const auto& group : m_classGroups)
                 {
-                    // gradient to input weight
-                    Matrix<ElemType> grd_to_wgt_t = InputRef(EMBEDDINGMATRIX).GradientAsMatrix().ColumnSlice(lft_bnd, nbr_wrd);
-                    Matrix<ElemType>::MultiplyAndAdd(obs, false, grd_to_soft_max_input, false, grd_to_wgt_t);
-                    break;
+                    Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(group.m_lftBnd, group.m_nbrWrd);
+                    Matrix<ElemType> grd_to_soft_max_input = GroupBlock(m_grdToSoftMaxInput, group);
+                    Matrix<ElemType> grd = m_groupedInputGradient.ColumnSlice(group.m_firstSample, group.m_nbrSamples);
+                    grd.AssignProductOf(weightForClass, false, grd_to_soft_max_input, false);
                 }
-                case 3:
+                InputRef(INPUTDATA).GradientFor(fr).DoScatterColumnsOf(1, m_columnMap, m_groupedInputGradient, 1);
+                break;
+            }
+            case 2:
+            {
+                // gradient to input weight
+                ComputeSoftMaxPartial();
+                for (const auto& group : m_classGroups)
                 {
-                    Matrix<ElemType> grd_t = InputRef(CLASSPROBINDATA).GradientFor(fr);
-                    grd_t.AssignValuesOf(InputRef(CLASSPROBINDATA).DataFor(m_clsSoftmax, fr));
-                    ComputeCEPartialToSoftmaxInputs(grd_t, Gradient(), c_t);
-                    break;
+                    Matrix<ElemType> obs = m_groupedInput.ColumnSlice(group.m_firstSample, group.m_nbrSamples); // hidden activation vectors of the class's samples
+                    Matrix<ElemType> grd_to_soft_max_input = GroupBlock(m_grdToSoftMaxInput, group);
+                    Matrix<ElemType> grd_to_wgt_t = InputRef(EMBEDDINGMATRIX).GradientAsMatrix().ColumnSlice(group.m_lftBnd, group.m_nbrWrd);
+                    Matrix<ElemType>::MultiplyAndAdd(obs, false, grd_to_soft_max_input, true, grd_to_wgt_t);
                 }
+                break;
             }
-        });
+            case 3:
+            {
+                // softmax(clsprob) - 1 at the class of each word
+                Matrix<ElemType> grd = InputRef(CLASSPROBINDATA).GradientFor(fr);
+                grd.AssignDifferenceOf(m_clsSoftmax, m_clsTargets);
+                Matrix<ElemType>::Scale(Gradient(), grd);
+                MaskMissingColumnsToZero(grd, InputRef(CLASSPROBINDATA).GetMBLayout(), fr);
+                break;
+            }
+        }
     }
 
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
 
 private:
-    void ComputeCEPartialToSoftmaxInputs(Matrix<ElemType>& inputGradientValues, Matrix<ElemType>& gradientValues, size_t y_t)
-    {
-        Matrix<ElemType>::MinusOneAt(inputGradientValues, y_t);
-        Matrix<ElemType>::Scale(gradientValues, inputGradientValues);
-    }
-
     // gradient of cross entropy w.r.t. to input to softmax
     void ComputeSoftMaxPartial()
     {
         if (m_needRecomputeGradientToSoftmaxInput)
         {
-            m_grdToSoftMaxInput.Resize(1, m_totalNbrWords); // buffer that contains a concatenation of class-conditional values
-
-            ForColumnsWithClass([&](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t sz, size_t lft_bnd, size_t nbr_wrd)
-            {
-                Matrix<ElemType> softMax = m_softMax.ColumnSlice(sz, nbr_wrd);
-
-                size_t idx_in_class = y_t - lft_bnd;
-                ComputeCEPartialToSoftmaxInputs(softMax, Gradient(), idx_in_class);
-
-                m_grdToSoftMaxInput.ColumnSlice(sz, nbr_wrd).AssignValuesOf(softMax);
-            });
+            // softmax - 1 at the word, for all samples at once
+            m_grdToSoftMaxInput.AssignDifferenceOf(m_softMax, m_wordTargets);
+            Matrix<ElemType>::Scale(Gradient(), m_grdToSoftMaxInput);
 
             m_needRecomputeGradientToSoftmaxInput = false;
         }
@@ -1472,64 +1672,42 @@ public:
 
         auto& functionValues = Value();
 
-        const size_t hdSize = InputRef(INPUTDATA).GetSampleMatrixNumRows();
         assert(m_nbrCls == InputRef(CLASSPROBINDATA).GetSampleMatrixNumRows());
+        FrameRange fr(InputRef(LABELDATA).GetMBLayout());
 
         // compute the class posteriors
         m_clsLogSoftmax.SetValue(InputRef(CLASSPROBINDATA).Value());
         m_clsLogSoftmax.InplaceLogSoftmax(true);   // log
+        MaskMissingColumnsToZero(m_clsLogSoftmax, InputRef(CLASSPROBINDATA).GetMBLayout(), fr); // gaps must not contribute to the objective below
         m_clsSoftmax.AssignExpOf(m_clsLogSoftmax); // non-log
 
-        // create a large workspace to contain all class-conditioned probs concatenated
-        m_totalNbrWords = ForColumnsWithClass([](size_t /*s*/, size_t /*t*/, const FrameRange& /*fr*/, size_t y_t, size_t /*c_t*/, size_t /*sz*/, size_t lft_bnd, size_t nbr_wrd)
-        {
-            if (nbr_wrd == 0)
-                LogicError("ClassBasedCrossEntropyWithSoftmax: Encountered a class of size 0.");
-            if (y_t < lft_bnd || y_t >= lft_bnd + nbr_wrd)
-                LogicError("ClassBasedCrossEntropyWithSoftmax: Word index out of bounds of class-member index range (word not a class member).");
-        });
+        // create a large workspace to contain all class-conditioned probs concatenated, grouped by class
+        GroupSamplesByClass();
         // now m_totalNbrWords = total size of concatenated vector
 
+        // hidden activations in class order, so that the samples of each class are consecutive columns
+        m_groupedInput.DoGatherColumnsOf(0, m_columnMap, InputRef(INPUTDATA).ValueFor(fr), 1);
+
         // buffer to hold the concatenated class-conditioned prob vectors
-        m_softMax.Resize(1, m_totalNbrWords);
         m_logSoftmax.Resize(1, m_totalNbrWords);
-
-        // accumulate objective
-        functionValues.SetValue(0);
-        ForColumnsWithClass([&](size_t s, size_t t, const FrameRange& fr, size_t y_t, size_t c_t, size_t sz, size_t lft_bnd, size_t nbr_wrd)
+        for (const auto& group : m_classGroups)
         {
             // now get views of various arrays that correspond to the index range of words belonging to this class
+            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(group.m_lftBnd, group.m_nbrWrd); // [hdSize x nbr_wrd]
+            Matrix<ElemType> obs = m_groupedInput.ColumnSlice(group.m_firstSample, group.m_nbrSamples);                                // [hdSize x nbr_samples]
+            Matrix<ElemType> logSoftMax = GroupBlock(m_logSoftmax, group);                                                          // [nbr_wrd x nbr_samples]
 
-            // get hidden vectors for the words in this class
-            Matrix<ElemType> weightForClass = InputRef(EMBEDDINGMATRIX).ValueAsMatrix().ColumnSlice(lft_bnd, nbr_wrd); // [hdSize x nbr_wrd]
-
-            // buffer to hold the class-conditional distribution
-            Matrix<ElemType> softMax_t = m_softMax.ColumnSlice(sz, nbr_wrd); // TODO: declare these outside of the loop to avoid the malloc
-            Matrix<ElemType> logSoftMax_t = m_logSoftmax.ColumnSlice(sz, nbr_wrd);
-
-            Matrix<ElemType> obs = InputRef(INPUTDATA).ValueFor(fr); // hidden activation vector for current word token
-
-            // multiply hidden activation with weight matrix (the slice of the weight matrix for the range of class members)
-            // TODO: can we use 'true' here instead? Above transposition hack won't work with row slices. 'obs' not used elsewhere
-            obs.Reshape(1, hdSize);                                                                                // transpose it (make it a column vector)
-            logSoftMax_t.AssignProductOf(obs /*(1 x hdSize)*/, false, weightForClass /*hdSize x nbr_wrd*/, false); // -> 1 x nbr_word
-
-            // log softmax(W x_t)
-            logSoftMax_t.InplaceLogSoftmax(false);
-
-            // and non-log version
-            softMax_t.SetValue(logSoftMax_t);
-            softMax_t.InplaceExp();
-            // we now have a column vector of class-conditional probabilities over the class members
-
-            // add  the word's class-conditional log posterior
-            size_t idx_in_class = y_t - lft_bnd;
-            Matrix<ElemType>::AddElementToElement(logSoftMax_t, 0, idx_in_class, functionValues, 0, 0); // (1x1)
+            // log softmax(W' x_t) for all samples of the class
+            logSoftMax.AssignProductOf(weightForClass, true, obs, false);
+            logSoftMax.InplaceLogSoftmax(true);
+        }
+        // and non-log version
+        m_softMax.AssignExpOf(m_logSoftmax);
 
-            // add the class log posterior probability (for backprop)
-            auto clsLogSoftmax_t = InputRef(CLASSPROBINDATA).DataFor(m_clsLogSoftmax, fr);
-            Matrix<ElemType>::AddElementToElement(clsLogSoftmax_t, c_t, 0, functionValues, 0, 0); // (1x1)
-        });
+        // sum of the words' class-conditional log posteriors and of the class log posteriors
+        functionValues.AssignInnerProductOfMatrices(m_logSoftmax, m_wordTargets);
+        m_clsLogLikelihood.AssignInnerProductOfMatrices(m_clsLogSoftmax, m_clsTargets);
+        functionValues += m_clsLogLikelihood;
 
         functionValues *= (-1);
 
@@ -1568,10 +1746,19 @@ protected:
 
     // gradient of cross entropy with respect to the input of softmax
     // a 1 row by \sum_t m_nbrWordsInEachTime[t] vector
-    // one slice of size m_nbrWordsInEachTime[t] saves the input to softmax for word y_t
+    // one block of size nbr_wrd x nbr_samples saves the input to softmax for the words of one class
     Matrix<ElemType> m_grdToSoftMaxInput;
     bool m_needRecomputeGradientToSoftmaxInput;
 
+    // samples grouped by class
+    std::vector<ClassGroup> m_classGroups;
+    Matrix<ElemType> m_columnMap;            // [1 x #samples] minibatch column of each sample in class order
+    Matrix<ElemType> m_groupedInput;         // [hdsize x #samples] hidden activations in class order
+    Matrix<ElemType> m_groupedInputGradient; // [hdsize x #samples] gradient to the hidden activations in class order
+    Matrix<ElemType> m_wordTargets;          // [1 x m_totalNbrWords] 1 at the position of each word in the concatenated workspace
+    Matrix<ElemType> m_clsTargets;           // [nbr_cls x T] 1 at the class of each word, 0 in gaps
+    Matrix<ElemType> m_clsLogLikelihood;     // [1 x 1]
+
     size_t m_nbrCls;
     size_t m_totalNbrWords;
 };
@@ -1768,9 +1955,6 @@ public:
                                const Matrix<ElemType>& pos_scores, const Matrix<ElemType>& pair_scores)
     {
         // to-do, shift more than 1 to support muliple sentences per minibatch
-        int iNumPos = lbls.GetNumCols();
-        int iNumLab = lbls.GetNumRows();
-
         int firstLbl = -1;
         for (int ik = 0; ik < lbls.GetNumRows(); ik++)
             if (lbls(ik, 0) != 0)
@@ -1779,25 +1963,7 @@ public:
                 break;
             }
 
-        // need to have
-        alpha.Resize(iNumLab, iNumPos);
-
-        for (int t = 0; t < iNumPos; t++)
-        {
-            for (int k = 0; k < iNumLab; k++)
-            {
-                ElemType fTmp = (ElemType) LZERO;
-                for (int j = 0; j < iNumLab; j++)
-                {
-                    ElemType fAlpha = (j == firstLbl) ? (ElemType) 0.0 : (ElemType) LZERO;
-                    if (t > 0)
-                        fAlpha = alpha(j, t - 1);
-                    fTmp = alpha.LogAdd(fTmp, fAlpha + pair_scores(k, j));
-                }
-                fTmp += pos_scores(k, t); // include position dependent score
-                alpha(k, t) = fTmp;
-            }
-        }
+        Matrix<ElemType>::RCRFForwardCompute(pos_scores, pair_scores, alpha, firstLbl);
     }
 
     // compute backward algorithm
@@ -2216,11 +2382,16 @@ template class DropoutNode<double>;
 // * useCntkEngine is a Boolean flag that specifies which batch normalization implementation to use: CNTK or cuDNN-based.
 // * imageLayout is the image layout. Only cudnn is supported at present.
 // -----------------------------------------------------------------------
+namespace Test {
+    template <class ElemType> struct BatchNormalizationTest;
+}
+
 template <class ElemType>
 class BatchNormalizationNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<5>, public IFreezable
 {
     typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
     static const std::wstring TypeName() { return L"BatchNormalization"; }
+    friend Test::BatchNormalizationTest<ElemType>;
 
 public:
     BatchNormalizationNode(DEVICEID_TYPE deviceId, const wstring& name) :
@@ -2667,6 +2838,8 @@ public:
     bool Spatial() const { return m_spatial; }
     double Epsilon() const { return m_epsilon; }
     bool UseCNTKEngine() const { return m_useCntkEngine; }
+    ImageLayoutKind ImageLayout() const { return m_imageLayoutKind; }
+    size_t SamplesSeen() const { return m_samplesSeen; }
 
 private:
     // Old versioning - do not use. Do not remove until we're sure there are no old models around.
@@ -15,6 +15,7 @@
 #include "Actions.h"
 #include "CNTKEval.h"
 #include "CPUMatrix.h" // for SetNumThreads()
+#include "Globals.h"
 #include "SimpleOutputWriter.h"
 #include "NDLNetworkBuilder.h"
 #ifdef LEAKDETECT
@@ -29,6 +30,8 @@
 #include "InputAndParamNodes.h"
 #include "latticearchive.h"
 #include <limits>
+#include <algorithm>
+#include <functional>
 
 // TODO: Temporary mechanism to enable memory sharing for
 // node output value matrices. This will go away when the
@@ -56,6 +59,10 @@ void CNTKEvalBase<ElemType>::CreateNetwork(const std::string& networkDescription
     ConfigParameters config;
     config.Parse(networkDescription);
 
+    // (process-wide, like in CNTK.cpp)
+    if (config.Exists(L"maxSingleThreadedLoopStepSize"))
+        Globals::SetMaxSingleThreadedLoopStepSize(config(L"maxSingleThreadedLoopStepSize"));
+
     std::vector<wstring> outputNodeNames;
     this->m_net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"outputNodeNames", outputNodeNames);
     
@@ -63,6 +70,14 @@ void CNTKEvalBase<ElemType>::CreateNetwork(const std::string& networkDescription
     {
         LogicError("Unable to construct network from description");
     }
+
+    // Optionally fold batch normalizations and constant subgraphs and remove everything the outputs do not need.
+    // This is opt-in since only the output nodes (outputNodeNames, or the nodes tagged as output) can be evaluated afterwards.
+    if (config(L"optimizeForInference", false))
+    {
+        ScopedNetworkOperationMode modeGuard(this->m_net, NetworkOperationMode::inferring);
+        this->m_net->template OptimizeForInference<ElemType>(this->m_net->OutputNodesByName(outputNodeNames));
+    }
 }
 
 
@@ -268,6 +283,18 @@ void CNTKEvalExtended<ElemType>::StartForwardEvaluation(const std::vector<wstrin
     this->m_net->StartEvaluateMinibatchLoop(m_outputNodes);
     m_inputMatrices = DataReaderHelpers::RetrieveInputMatrices(m_inputNodes);
 
+    m_statefulNodes.clear();
+    for (const auto& outputNode : m_outputNodes)
+    {
+        for (const auto& node : this->m_net->GetAllNodesForRoot(outputNode))
+        {
+            auto statefulNode = dynamic_pointer_cast<IStatefulNode>(node);
+            if (statefulNode && std::find(m_statefulNodes.begin(), m_statefulNodes.end(), statefulNode) == m_statefulNodes.end())
+                m_statefulNodes.push_back(statefulNode);
+        }
+    }
+    m_sessions.clear();
+
     for (const auto& node : m_outputNodes)
     {
         shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
@@ -435,6 +462,268 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs, resetRNN);
 }
 
+template<typename ElemType>
+size_t CNTKEvalExtended<ElemType>::GetNumberOfSamples(const ComputationNodeBasePtr& inputNode, const ValueBuffer<ElemType, Vector>& buffer)
+{
+    auto type = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr())->GetMatrixType();
+    size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+    if (type == MatrixType::DENSE)
+    {
+        if (buffer.m_buffer.size() == 0)
+            RuntimeError("Input %ls: Expected at least one element.", inputNode->GetName().c_str());
+        if (buffer.m_buffer.size() % numRows != 0)
+            RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".",
+                         inputNode->GetName().c_str(), numRows, buffer.m_buffer.size());
+        return buffer.m_buffer.size() / numRows;
+    }
+
+    if (buffer.m_colIndices.size() < 2)
+        RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", inputNode->GetName().c_str());
+    if (buffer.m_colIndices[0] != 0)
+        RuntimeError("Input %ls: First element of column indices must be 0", inputNode->GetName().c_str());
+    if (buffer.m_colIndices.back() != buffer.m_indices.size() || buffer.m_indices.size() != buffer.m_buffer.size())
+        RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices and values (%ld), but was %d",
+                     inputNode->GetName().c_str(), buffer.m_indices.size(), buffer.m_colIndices.back());
+    return buffer.m_colIndices.size() - 1;
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassBatch(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPassBatch() called before StartForwardEvaluation()");
+
+    ForwardPassRequests(inputs, outputs, std::vector<bool>(inputs.size(), false));
+}
+
+template<typename ElemType>
+size_t CNTKEvalExtended<ElemType>::CreateSession()
+{
+    m_sessions[m_nextSessionId] = std::vector<NodeStatePtr>();
+    return m_nextSessionId++;
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::DestroySession(size_t sessionId)
+{
+    if (m_sessions.erase(sessionId) == 0)
+        RuntimeError("DestroySession: Session %d does not exist.", (int)sessionId);
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassSessions(const std::vector<size_t>& sessionIds, const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPassSessions() called before StartForwardEvaluation()");
+
+    if (sessionIds.size() != inputs.size())
+        RuntimeError("Expected inputs for %d sessions, but got %d.", (int)sessionIds.size(), (int)inputs.size());
+
+    std::vector<std::vector<NodeStatePtr>*> sessionStates;
+    std::vector<bool> continued;
+    for (auto sessionId : sessionIds)
+    {
+        auto session = m_sessions.find(sessionId);
+        if (session == m_sessions.end())
+            RuntimeError("ForwardPassSessions: Session %d does not exist.", (int)sessionId);
+        if (std::find(sessionStates.begin(), sessionStates.end(), &session->second) != sessionStates.end())
+            RuntimeError("ForwardPassSessions: Session %d is advanced more than once.", (int)sessionId);
+
+        sessionStates.push_back(&session->second);
+        continued.push_back(!session->second.empty());
+    }
+
+    // The stateful nodes continue the sessions' streams, each in the parallel sequence of its request.
+    for (size_t i = 0; i < m_statefulNodes.size(); ++i)
+    {
+        std::vector<NodeStatePtr> states(sessionStates.size());
+        for (size_t r = 0; r < sessionStates.size(); ++r)
+        {
+            if (continued[r])
+                states[r] = (*sessionStates[r])[i];
+        }
+
+        m_statefulNodes[i]->ImportSequenceStates(states);
+    }
+
+    ForwardPassRequests(inputs, outputs, continued);
+
+    for (size_t r = 0; r < sessionStates.size(); ++r)
+    {
+        sessionStates[r]->resize(m_statefulNodes.size());
+        for (size_t i = 0; i < m_statefulNodes.size(); ++i)
+            (*sessionStates[r])[i] = m_statefulNodes[i]->ExportSequenceState(r);
+    }
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ReorderSessions(const std::vector<size_t>& sessionIds, const std::vector<size_t>& sourceSessionIds)
+{
+    if (sessionIds.size() != sourceSessionIds.size())
+        RuntimeError("ReorderSessions: Expected a source for %d sessions, but got %d.", (int)sessionIds.size(), (int)sourceSessionIds.size());
+
+    // The exported states are never modified, so only the references to them are rearranged.
+    std::vector<std::vector<NodeStatePtr>> states;
+    states.reserve(sourceSessionIds.size());
+    for (auto sourceSessionId : sourceSessionIds)
+    {
+        auto session = m_sessions.find(sourceSessionId);
+        if (session == m_sessions.end())
+            RuntimeError("ReorderSessions: Session %d does not exist.", (int)sourceSessionId);
+        states.push_back(session->second);
+    }
+
+    for (size_t k = 0; k < sessionIds.size(); ++k)
+    {
+        auto session = m_sessions.find(sessionIds[k]);
+        if (session == m_sessions.end())
+            RuntimeError("ReorderSessions: Session %d does not exist.", (int)sessionIds[k]);
+        session->second = std::move(states[k]);
+    }
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassRequests(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs, const std::vector<bool>& continued)
+{
+    if (outputs.size() != inputs.size())
+        RuntimeError("Expected outputs for %d requests, but got %d.", (int)inputs.size(), (int)outputs.size());
+
+    size_t numRequests = inputs.size();
+    if (numRequests == 0)
+        return;
+
+    // Every request becomes a parallel sequence of the minibatch, padded with gaps to the longest request.
+    std::vector<size_t> numSamples(numRequests);
+    for (size_t r = 0; r < numRequests; ++r)
+    {
+        if (inputs[r]->size() != m_inputNodes.size())
+            RuntimeError("Request %d: Expected %d inputs, but got %d.", (int)r, (int)m_inputNodes.size(), (int)inputs[r]->size());
+        if (outputs[r]->size() != m_outputNodes.size())
+            RuntimeError("Request %d: Expected %d outputs, but got %d.", (int)r, (int)m_outputNodes.size(), (int)outputs[r]->size());
+
+        for (size_t i = 0; i < m_inputNodes.size(); ++i)
+        {
+            size_t n = GetNumberOfSamples(m_inputNodes[i], (*inputs[r])[i]);
+            if (i == 0)
+                numSamples[r] = n;
+            else if (n != numSamples[r])
+                RuntimeError("Request %d: Input %ls has %d samples, but input %ls has %d.", (int)r,
+                             m_inputNodes[i]->GetName().c_str(), (int)n, m_inputNodes[0]->GetName().c_str(), (int)numSamples[r]);
+        }
+    }
+
+    size_t numTimeSteps = m_inputNodes.empty() ? 1 : *std::max_element(numSamples.begin(), numSamples.end());
+    size_t numCols = numTimeSteps * numRequests;
+    for (size_t i = 0; i < m_inputNodes.size(); ++i)
+    {
+        auto& inputNode = m_inputNodes[i];
+        auto pMBLayout = inputNode->GetMBLayout();
+        pMBLayout->Init(numRequests, numTimeSteps);
+        for (size_t r = 0; r < numRequests; ++r)
+        {
+            // A continued sequence begins before the minibatch, at the frame of the imported state.
+            pMBLayout->AddSequence(r, r, continued[r] ? -1 : 0, numSamples[r]);
+            if (numSamples[r] < numTimeSteps)
+                pMBLayout->AddGap(r, numSamples[r], numTimeSteps);
+        }
+
+        auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
+        size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+        if (matrix->GetMatrixType() == MatrixType::DENSE)
+        {
+            // Column t * numRequests + r holds sample t of request r.
+            m_batchBuffer.assign(numRows * numCols, 0);
+            for (size_t r = 0; r < numRequests; ++r)
+            {
+                const ElemType* data = (*inputs[r])[i].m_buffer.data();
+                for (size_t t = 0; t < numSamples[r]; ++t)
+                    std::copy(data + t * numRows, data + (t + 1) * numRows, m_batchBuffer.begin() + (t * numRequests + r) * numRows);
+            }
+
+            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), m_batchBuffer.data(), matrixFlagNormal);
+        }
+        else
+        {
+            m_batchBuffer.clear();
+            m_batchIndices.clear();
+            m_batchColIndices.assign(1, 0);
+            for (size_t t = 0; t < numTimeSteps; ++t)
+            {
+                for (size_t r = 0; r < numRequests; ++r)
+                {
+                    if (t < numSamples[r])
+                    {
+                        const auto& buffer = (*inputs[r])[i];
+                        m_batchBuffer.insert(m_batchBuffer.end(), buffer.m_buffer.begin() + buffer.m_colIndices[t], buffer.m_buffer.begin() + buffer.m_colIndices[t + 1]);
+                        m_batchIndices.insert(m_batchIndices.end(), buffer.m_indices.begin() + buffer.m_colIndices[t], buffer.m_indices.begin() + buffer.m_colIndices[t + 1]);
+                    }
+
+                    m_batchColIndices.push_back((int)m_batchIndices.size());
+                }
+            }
+
+            matrix->SetMatrixFromCSCFormat(m_batchColIndices.data(), m_batchIndices.data(), m_batchBuffer.data(),
+                                           m_batchBuffer.size(), numRows, numCols);
+        }
+    }
+
+    ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
+
+    for (size_t i = 0; i < m_outputNodes.size(); ++i)
+    {
+        auto node = m_outputNodes[i];
+        this->m_net->ForwardProp(node);
+        shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        size_t numRows = outputMatrix->GetNumRows();
+        size_t numElements = outputMatrix->GetNumElements();
+        m_batchBuffer.resize(numElements);
+        ElemType* data = m_batchBuffer.data();
+        outputMatrix->CopyToArray(data, numElements);
+
+        // Scatters numOutputCols columns of the output to the request; the columns are given by getColumn.
+        auto scatter = [&](size_t r, size_t numOutputCols, const std::function<size_t(size_t)>& getColumn)
+        {
+            auto& vec = (*outputs[r])[i].m_buffer;
+            if (vec.capacity() < numRows * numOutputCols)
+                RuntimeError("Request %d: Not enough space in output buffer for output '%ls'.", (int)r, node->GetName().c_str());
+
+            vec.resize(numRows * numOutputCols);
+            for (size_t t = 0; t < numOutputCols; ++t)
+            {
+                size_t col = getColumn(t);
+                std::copy(data + col * numRows, data + (col + 1) * numRows, vec.begin() + t * numRows);
+            }
+        };
+
+        auto pMBLayout = node->GetMBLayout();
+        if (!pMBLayout)
+        {
+            // Outputs without a dynamic axis are the same for all requests.
+            for (size_t r = 0; r < numRequests; ++r)
+                scatter(r, outputMatrix->GetNumCols(), [](size_t t) { return t; });
+            continue;
+        }
+
+        std::vector<bool> scattered(numRequests, false);
+        for (const auto& seq : pMBLayout->GetAllSequences())
+        {
+            if (seq.seqId == GAP_SEQUENCE_ID)
+                continue;
+            if (seq.seqId >= numRequests || scattered[seq.seqId])
+                RuntimeError("Output '%ls' does not have exactly one sequence per request.", node->GetName().c_str());
+
+            // Only the frames inside the minibatch; a continued sequence begins before it.
+            size_t tBegin = (size_t)std::max(seq.tBegin, (ptrdiff_t)0);
+            size_t tEnd = std::min(seq.tEnd, pMBLayout->GetNumTimeSteps());
+            scatter(seq.seqId, tEnd - tBegin, [&](size_t t) { return (tBegin + t) * pMBLayout->GetNumParallelSequences() + seq.s; });
+            scattered[seq.seqId] = true;
+        }
+
+        if (std::find(scattered.begin(), scattered.end(), false) != scattered.end())
+            RuntimeError("Output '%ls' does not have exactly one sequence per request.", node->GetName().c_str());
+    }
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
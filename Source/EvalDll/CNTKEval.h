@@ -91,7 +91,7 @@ class CNTKEvalExtended : public CNTKEvalBase<ElemType>, public IEvaluateModelExt
 {
 public:
     CNTKEvalExtended() : CNTKEvalBase<ElemType>(), 
-        m_started(false){}
+        m_started(false), m_nextSessionId(0){}
 
     virtual VariableSchema GetOutputSchema() const override;
 
@@ -107,6 +107,16 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual void ForwardPassBatch(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs) override;
+
+    virtual size_t CreateSession() override;
+
+    virtual void DestroySession(size_t sessionId) override;
+
+    virtual void ForwardPassSessions(const std::vector<size_t>& sessionIds, const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs) override;
+
+    virtual void ReorderSessions(const std::vector<size_t>& sessionIds, const std::vector<size_t>& sourceSessionIds) override;
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -127,9 +137,26 @@ private:
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
 
+    // Stateful nodes needed for the outputs, and for every session their states at the end of its last chunk
+    // (empty before the first chunk).
+    std::vector<shared_ptr<IStatefulNode>> m_statefulNodes;
+    std::map<size_t, std::vector<NodeStatePtr>> m_sessions;
+    size_t m_nextSessionId;
+
+    // Staging buffers of ForwardPassBatch(), reused across calls.
+    std::vector<ElemType> m_batchBuffer;
+    std::vector<int> m_batchIndices;
+    std::vector<int> m_batchColIndices;
+
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
                       std::vector < ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN);
 
+    static size_t GetNumberOfSamples(const ComputationNodeBasePtr& inputNode, const ValueBuffer<ElemType, Vector>& buffer);
+
+    // Evaluates the requests as parallel sequences; continued[r] tells whether request r continues from the state
+    // imported into the stateful nodes.
+    void ForwardPassRequests(const std::vector<const Values<ElemType>*>& inputs, const std::vector<Values<ElemType>*>& outputs, const std::vector<bool>& continued);
+
 };
 } } }
@@ -0,0 +1,209 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBatching.cpp : Dynamic batching of concurrent evaluation requests
+//
+
+#define EVAL_EXPORTS // creating the exports here
+#include "Basics.h"
+#include "CNTKEvalBatching.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+CNTKEvalBatching<ElemType>::CNTKEvalBatching(IEvaluateModelExtended<ElemType>* eval, size_t maxBatchSize, double maxLatencyInMs)
+    : m_eval(eval),
+      m_maxBatchSize(maxBatchSize),
+      m_maxLatency(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(maxLatencyInMs))),
+      m_stopped(false)
+{
+    if (eval == nullptr)
+        InvalidArgument("CNTKEvalBatching: No evaluator given.");
+    if (maxBatchSize == 0)
+        InvalidArgument("CNTKEvalBatching: The maximum batch size must be positive.");
+    if (maxLatencyInMs < 0)
+        InvalidArgument("CNTKEvalBatching: The maximum latency must not be negative.");
+
+    ResetStatistics();
+    m_batchingThread = std::thread([this] { BatchingLoop(); });
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::Evaluate(const Values<ElemType>& inputs, Values<ElemType>& outputs)
+{
+    Request request;
+    request.m_inputs = &inputs;
+    request.m_outputs = &outputs;
+    request.m_submitTime = Clock::now();
+    auto done = request.m_done.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_stopped)
+            LogicError("CNTKEvalBatching: Evaluate() called after Destroy().");
+        m_queue.push_back(&request);
+    }
+
+    m_queueChanged.notify_one();
+
+    // Rethrows the error of the forward pass, if any.
+    done.get();
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::BatchingLoop()
+{
+    std::vector<Request*> batch;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueChanged.wait(lock, [this] { return m_stopped || !m_queue.empty(); });
+            if (m_queue.empty())
+                return; // stopped, and all requests are served
+
+            // Wait for more requests until the batch is full or its oldest request has waited long enough.
+            auto deadline = m_queue.front()->m_submitTime + m_maxLatency;
+            m_queueChanged.wait_until(lock, deadline, [this] { return m_stopped || m_queue.size() >= m_maxBatchSize; });
+
+            size_t batchSize = std::min(m_queue.size(), m_maxBatchSize);
+            batch.assign(m_queue.begin(), m_queue.begin() + batchSize);
+            m_queue.erase(m_queue.begin(), m_queue.begin() + batchSize);
+        }
+
+        EvaluateBatch(batch);
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::EvaluateBatch(const std::vector<Request*>& batch)
+{
+    // A request lives on the stack of its caller, which may return as soon as it is signaled,
+    // so the signaling must not touch the request itself.
+    std::vector<std::promise<void>> done;
+    m_batchInputs.clear();
+    m_batchOutputs.clear();
+    for (auto request : batch)
+    {
+        m_batchInputs.push_back(request->m_inputs);
+        m_batchOutputs.push_back(request->m_outputs);
+        done.push_back(std::move(request->m_done));
+    }
+
+    auto startTime = Clock::now();
+    std::vector<std::exception_ptr> errors(batch.size());
+    try
+    {
+        m_eval->ForwardPassBatch(m_batchInputs, m_batchOutputs);
+    }
+    catch (...)
+    {
+        // Evaluate the requests one by one, so that an invalid request does not fail the others.
+        if (batch.size() == 1)
+            errors[0] = std::current_exception();
+        else
+        {
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                try
+                {
+                    m_eval->ForwardPassBatch({ m_batchInputs[i] }, { m_batchOutputs[i] });
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        }
+    }
+
+    auto endTime = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_statisticsMutex);
+        m_numRequests += batch.size();
+        m_numBatches++;
+        m_totalForwardPassTime += endTime - startTime;
+        for (auto request : batch)
+        {
+            auto latency = endTime - request->m_submitTime;
+            m_totalLatency += latency;
+            m_maxRequestLatency = std::max(m_maxRequestLatency, latency);
+        }
+    }
+
+    for (size_t i = 0; i < done.size(); ++i)
+    {
+        if (errors[i])
+            done[i].set_exception(errors[i]);
+        else
+            done[i].set_value();
+    }
+}
+
+template <typename ElemType>
+EvalBatchingStatistics CNTKEvalBatching<ElemType>::GetStatistics() const
+{
+    typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    double elapsedSeconds = std::chrono::duration<double>(Clock::now() - m_statisticsStartTime).count();
+
+    EvalBatchingStatistics statistics;
+    statistics.m_numRequests = m_numRequests;
+    statistics.m_numBatches = m_numBatches;
+    statistics.m_averageLatencyInMs = m_numRequests > 0 ? Milliseconds(m_totalLatency).count() / m_numRequests : 0;
+    statistics.m_maxLatencyInMs = Milliseconds(m_maxRequestLatency).count();
+    statistics.m_averageForwardPassTimeInMs = m_numBatches > 0 ? Milliseconds(m_totalForwardPassTime).count() / m_numBatches : 0;
+    statistics.m_requestsPerSecond = elapsedSeconds > 0 ? m_numRequests / elapsedSeconds : 0;
+    return statistics;
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::ResetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    m_statisticsStartTime = Clock::now();
+    m_numRequests = 0;
+    m_numBatches = 0;
+    m_totalLatency = Clock::duration::zero();
+    m_maxRequestLatency = Clock::duration::zero();
+    m_totalForwardPassTime = Clock::duration::zero();
+}
+
+template <typename ElemType>
+void CNTKEvalBatching<ElemType>::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_stopped = true;
+    }
+
+    m_queueChanged.notify_all();
+    m_batchingThread.join();
+    delete this;
+}
+
+template class CNTKEvalBatching<float>;
+template class CNTKEvalBatching<double>;
+
+template <typename ElemType>
+void EVAL_API GetEvalBatching(IEvaluateModelExtended<ElemType>* eval, size_t maxBatchSize, double maxLatencyInMs, IEvaluateModelBatching<ElemType>** peval)
+{
+    *peval = new CNTKEvalBatching<ElemType>(eval, maxBatchSize, maxLatencyInMs);
+}
+
+extern "C" EVAL_API void GetEvalBatchingF(IEvaluateModelExtended<float>* eval, size_t maxBatchSize, double maxLatencyInMs, IEvaluateModelBatching<float>** peval)
+{
+    GetEvalBatching(eval, maxBatchSize, maxLatencyInMs, peval);
+}
+
+extern "C" EVAL_API void GetEvalBatchingD(IEvaluateModelExtended<double>* eval, size_t maxBatchSize, double maxLatencyInMs, IEvaluateModelBatching<double>** peval)
+{
+    GetEvalBatching(eval, maxBatchSize, maxLatencyInMs, peval);
+}
+
+} } }
@@ -0,0 +1,76 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBatching.h - Dynamic batching of concurrent evaluation requests
+//
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Eval.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Collects the requests of the calling threads in a queue. A dedicated thread takes up to maxBatchSize requests
+// from the queue, once the queue holds that many or the oldest request has waited for maxLatency, evaluates them
+// with a single ForwardPassBatch() and wakes up the callers.
+template <typename ElemType>
+class CNTKEvalBatching : public IEvaluateModelBatching<ElemType>
+{
+public:
+    CNTKEvalBatching(IEvaluateModelExtended<ElemType>* eval, size_t maxBatchSize, double maxLatencyInMs);
+
+    virtual void Evaluate(const Values<ElemType>& inputs, Values<ElemType>& outputs) override;
+
+    virtual EvalBatchingStatistics GetStatistics() const override;
+
+    virtual void ResetStatistics() override;
+
+    virtual void Destroy() override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request
+    {
+        const Values<ElemType>* m_inputs;
+        Values<ElemType>* m_outputs;
+        Clock::time_point m_submitTime;
+        std::promise<void> m_done;
+    };
+
+    void BatchingLoop();
+    void EvaluateBatch(const std::vector<Request*>& batch);
+
+    IEvaluateModelExtended<ElemType>* m_eval;
+    size_t m_maxBatchSize;
+    Clock::duration m_maxLatency;
+
+    // Requests waiting for evaluation, owned by the threads waiting in Evaluate().
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueChanged;
+    std::deque<Request*> m_queue;
+    bool m_stopped;
+    std::thread m_batchingThread;
+
+    // Only used by the batching thread.
+    std::vector<const Values<ElemType>*> m_batchInputs;
+    std::vector<Values<ElemType>*> m_batchOutputs;
+
+    mutable std::mutex m_statisticsMutex;
+    Clock::time_point m_statisticsStartTime;
+    size_t m_numRequests;
+    size_t m_numBatches;
+    Clock::duration m_totalLatency;
+    Clock::duration m_maxRequestLatency;
+    Clock::duration m_totalForwardPassTime;
+};
+
+} } }
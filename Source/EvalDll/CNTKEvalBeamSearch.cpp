@@ -0,0 +1,303 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBeamSearch.cpp : Beam search decoding with the sessions of the extended evaluation interface
+//
+
+#define EVAL_EXPORTS // creating the exports here
+#include "Basics.h"
+#include "CNTKEvalBeamSearch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+template <typename ElemType>
+CNTKEvalBeamSearch<ElemType>::CNTKEvalBeamSearch(IEvaluateModelExtended<ElemType>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength)
+    : m_eval(eval),
+      m_beamWidth(beamWidth),
+      m_endSymbol(endSymbol),
+      m_maxLength(maxLength)
+{
+    if (eval == nullptr)
+        InvalidArgument("CNTKEvalBeamSearch: No evaluator given.");
+    if (beamWidth == 0)
+        InvalidArgument("CNTKEvalBeamSearch: The beam width must be positive.");
+    if (maxLength == 0)
+        InvalidArgument("CNTKEvalBeamSearch: The maximum length must be positive.");
+
+    VariableSchema inputSchema = eval->GetInputSchema();
+    VariableSchema outputSchema = eval->GetOutputSchema();
+    if (inputSchema.size() != 1 || outputSchema.size() != 1)
+        InvalidArgument("CNTKEvalBeamSearch: The model must have a single input and a single output, but has %d inputs and %d outputs.",
+                        (int)inputSchema.size(), (int)outputSchema.size());
+
+    m_vocabularySize = outputSchema[0].m_numElements;
+    if (inputSchema[0].m_numElements != m_vocabularySize)
+        InvalidArgument("CNTKEvalBeamSearch: The input %ls has dimension %d, but the output %ls has dimension %d.",
+                        inputSchema[0].m_name.c_str(), (int)inputSchema[0].m_numElements, outputSchema[0].m_name.c_str(), (int)m_vocabularySize);
+    if (endSymbol >= m_vocabularySize)
+        InvalidArgument("CNTKEvalBeamSearch: The end symbol %d is not in the vocabulary of size %d.", (int)endSymbol, (int)m_vocabularySize);
+    if (beamWidth > m_vocabularySize)
+        InvalidArgument("CNTKEvalBeamSearch: The beam width %d exceeds the vocabulary size %d.", (int)beamWidth, (int)m_vocabularySize);
+
+    m_sparseInput = inputSchema[0].m_storageType == VariableLayout::Sparse;
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::Decode(const std::vector<std::vector<size_t>>& prefixes, std::vector<std::vector<size_t>>& results, std::vector<double>& scores)
+{
+    for (size_t n = 0; n < prefixes.size(); ++n)
+    {
+        if (prefixes[n].empty())
+            InvalidArgument("CNTKEvalBeamSearch: The prefix of sequence %d is empty.", (int)n);
+        for (auto token : prefixes[n])
+        {
+            if (token >= m_vocabularySize)
+                InvalidArgument("CNTKEvalBeamSearch: The prefix of sequence %d contains the token %d, which is not in the vocabulary of size %d.",
+                                (int)n, (int)token, (int)m_vocabularySize);
+        }
+    }
+
+    results.assign(prefixes.size(), std::vector<size_t>());
+    scores.assign(prefixes.size(), 0);
+    if (prefixes.empty())
+        return;
+
+    // Beam b of sequence n is held by the session sessions[n * beamWidth + b].
+    std::vector<size_t> sessions(prefixes.size() * m_beamWidth);
+    for (auto& session : sessions)
+        session = m_eval->CreateSession();
+
+    try
+    {
+        DecodeWithSessions(prefixes, sessions, results, scores);
+    }
+    catch (...)
+    {
+        for (auto session : sessions)
+            m_eval->DestroySession(session);
+        throw;
+    }
+
+    for (auto session : sessions)
+        m_eval->DestroySession(session);
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::DecodeWithSessions(const std::vector<std::vector<size_t>>& prefixes, const std::vector<size_t>& sessions,
+                                                      std::vector<std::vector<size_t>>& results, std::vector<double>& scores)
+{
+    size_t numSequences = prefixes.size();
+    if (m_stepInputs.size() < sessions.size())
+    {
+        m_stepInputs.resize(sessions.size(), Values<ElemType>(1));
+        m_stepOutputs.resize(sessions.size(), Values<ElemType>(1));
+    }
+
+    std::vector<SequenceState> sequences(numSequences);
+    std::vector<size_t> sessionIds;
+    std::vector<size_t> sourceSessionIds;
+    std::vector<const Values<ElemType>*> inputs;
+    std::vector<Values<ElemType>*> outputs;
+    std::vector<const ElemType*> hypothesisOutputs;
+
+    // The prefixes are evaluated in the sessions of the first beam, and extended by the best first tokens.
+    for (size_t n = 0; n < numSequences; ++n)
+    {
+        SetInput(m_stepInputs[n][0], prefixes[n].data(), prefixes[n].size());
+        m_stepOutputs[n][0].m_buffer.reserve(prefixes[n].size() * m_vocabularySize);
+        sessionIds.push_back(sessions[n * m_beamWidth]);
+        inputs.push_back(&m_stepInputs[n]);
+        outputs.push_back(&m_stepOutputs[n]);
+    }
+
+    m_eval->ForwardPassSessions(sessionIds, inputs, outputs);
+
+    sessionIds.clear();
+    for (size_t n = 0; n < numSequences; ++n)
+    {
+        SequenceState& sequence = sequences[n];
+        sequence.m_hypotheses.assign(1, Hypothesis{ std::vector<size_t>(), 0, 0 });
+        sequence.m_hasFinished = false;
+        sequence.m_done = false;
+
+        const auto& output = m_stepOutputs[n][0].m_buffer;
+        hypothesisOutputs.assign(1, output.data() + output.size() - m_vocabularySize);
+        Extend(sequence, hypothesisOutputs, &sessions[n * m_beamWidth], sessionIds, sourceSessionIds);
+    }
+
+    for (;;)
+    {
+        if (!sessionIds.empty())
+            m_eval->ReorderSessions(sessionIds, sourceSessionIds);
+
+        // Advance the hypotheses of all sequences that are not done by their last token, in a single forward pass.
+        sessionIds.clear();
+        sourceSessionIds.clear();
+        inputs.clear();
+        outputs.clear();
+        for (size_t n = 0; n < numSequences; ++n)
+        {
+            if (sequences[n].m_done)
+                continue;
+
+            for (const auto& hypothesis : sequences[n].m_hypotheses)
+            {
+                size_t k = inputs.size();
+                SetInput(m_stepInputs[k][0], &hypothesis.m_tokens.back(), 1);
+                m_stepOutputs[k][0].m_buffer.reserve(m_vocabularySize);
+                sessionIds.push_back(sessions[n * m_beamWidth + hypothesis.m_beam]);
+                inputs.push_back(&m_stepInputs[k]);
+                outputs.push_back(&m_stepOutputs[k]);
+            }
+        }
+
+        if (sessionIds.empty())
+            break;
+
+        m_eval->ForwardPassSessions(sessionIds, inputs, outputs);
+
+        sessionIds.clear();
+        size_t k = 0;
+        for (size_t n = 0; n < numSequences; ++n)
+        {
+            if (sequences[n].m_done)
+                continue;
+
+            hypothesisOutputs.clear();
+            for (size_t h = 0; h < sequences[n].m_hypotheses.size(); ++h)
+                hypothesisOutputs.push_back(m_stepOutputs[k++][0].m_buffer.data());
+
+            Extend(sequences[n], hypothesisOutputs, &sessions[n * m_beamWidth], sessionIds, sourceSessionIds);
+        }
+    }
+
+    for (size_t n = 0; n < numSequences; ++n)
+    {
+        // A sequence is only done once it has a finished hypothesis, as every hypothesis finishes at the maximum length.
+        assert(sequences[n].m_hasFinished);
+        results[n] = std::move(sequences[n].m_best.m_tokens);
+        scores[n] = sequences[n].m_best.m_score;
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::Extend(SequenceState& sequence, const std::vector<const ElemType*>& outputs, const size_t* sessions,
+                                          std::vector<size_t>& sessionIds, std::vector<size_t>& sourceSessionIds)
+{
+    // Only the beamWidth best tokens of a hypothesis can be among the beamWidth best extensions of all hypotheses,
+    // so each hypothesis contributes these candidates, found by partial selection instead of sorting the vocabulary.
+    m_candidates.clear();
+    m_tokenIndices.resize(m_vocabularySize);
+    for (size_t p = 0; p < outputs.size(); ++p)
+    {
+        const ElemType* output = outputs[p];
+        double maxScore = *std::max_element(output, output + m_vocabularySize);
+        double sum = 0;
+        for (size_t i = 0; i < m_vocabularySize; ++i)
+            sum += exp(output[i] - maxScore);
+        double logNormalizer = maxScore + log(sum);
+
+        std::iota(m_tokenIndices.begin(), m_tokenIndices.end(), 0);
+        std::nth_element(m_tokenIndices.begin(), m_tokenIndices.begin() + m_beamWidth, m_tokenIndices.end(),
+                         [output](size_t a, size_t b) { return output[a] > output[b]; });
+        for (size_t i = 0; i < m_beamWidth; ++i)
+        {
+            size_t token = m_tokenIndices[i];
+            m_candidates.push_back(Candidate{ sequence.m_hypotheses[p].m_score + output[token] - logNormalizer, p, token });
+        }
+    }
+
+    size_t numSelected = std::min(m_beamWidth, m_candidates.size());
+    std::partial_sort(m_candidates.begin(), m_candidates.begin() + numSelected, m_candidates.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.m_score > b.m_score; });
+
+    std::vector<Hypothesis> hypotheses;
+    hypotheses.reserve(numSelected);
+    for (size_t c = 0; c < numSelected; ++c)
+    {
+        const Candidate& candidate = m_candidates[c];
+        const Hypothesis& parent = sequence.m_hypotheses[candidate.m_parent];
+        if (candidate.m_token == m_endSymbol || parent.m_tokens.size() + 1 >= m_maxLength)
+        {
+            if (!sequence.m_hasFinished || candidate.m_score > sequence.m_best.m_score)
+            {
+                sequence.m_best.m_tokens = parent.m_tokens;
+                sequence.m_best.m_tokens.push_back(candidate.m_token);
+                sequence.m_best.m_score = candidate.m_score;
+                sequence.m_hasFinished = true;
+            }
+            continue;
+        }
+
+        // The new hypothesis takes the next beam, whose session continues from the state of the parent.
+        Hypothesis hypothesis;
+        hypothesis.m_tokens = parent.m_tokens;
+        hypothesis.m_tokens.push_back(candidate.m_token);
+        hypothesis.m_score = candidate.m_score;
+        hypothesis.m_beam = hypotheses.size();
+        sessionIds.push_back(sessions[hypothesis.m_beam]);
+        sourceSessionIds.push_back(sessions[parent.m_beam]);
+        hypotheses.push_back(std::move(hypothesis));
+    }
+
+    sequence.m_hypotheses.swap(hypotheses);
+
+    // Log probabilities only decrease with further tokens, so no active hypothesis can beat a better finished one.
+    sequence.m_done = sequence.m_hypotheses.empty() ||
+                      (sequence.m_hasFinished && sequence.m_best.m_score >= sequence.m_hypotheses.front().m_score);
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::SetInput(ValueBuffer<ElemType, Vector>& input, const size_t* tokens, size_t numTokens) const
+{
+    if (m_sparseInput)
+    {
+        input.m_buffer.assign(numTokens, 1);
+        input.m_indices.resize(numTokens);
+        input.m_colIndices.resize(numTokens + 1);
+        for (size_t t = 0; t < numTokens; ++t)
+        {
+            input.m_indices[t] = (int)tokens[t];
+            input.m_colIndices[t] = (int)t;
+        }
+        input.m_colIndices[numTokens] = (int)numTokens;
+    }
+    else
+    {
+        input.m_buffer.assign(numTokens * m_vocabularySize, 0);
+        for (size_t t = 0; t < numTokens; ++t)
+            input.m_buffer[t * m_vocabularySize + tokens[t]] = 1;
+    }
+}
+
+template <typename ElemType>
+void CNTKEvalBeamSearch<ElemType>::Destroy()
+{
+    delete this;
+}
+
+template class CNTKEvalBeamSearch<float>;
+template class CNTKEvalBeamSearch<double>;
+
+template <typename ElemType>
+void EVAL_API GetEvalBeamSearch(IEvaluateModelExtended<ElemType>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength, IEvaluateModelBeamSearch<ElemType>** peval)
+{
+    *peval = new CNTKEvalBeamSearch<ElemType>(eval, beamWidth, endSymbol, maxLength);
+}
+
+extern "C" EVAL_API void GetEvalBeamSearchF(IEvaluateModelExtended<float>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength, IEvaluateModelBeamSearch<float>** peval)
+{
+    GetEvalBeamSearch(eval, beamWidth, endSymbol, maxLength, peval);
+}
+
+extern "C" EVAL_API void GetEvalBeamSearchD(IEvaluateModelExtended<double>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength, IEvaluateModelBeamSearch<double>** peval)
+{
+    GetEvalBeamSearch(eval, beamWidth, endSymbol, maxLength, peval);
+}
+
+} } }
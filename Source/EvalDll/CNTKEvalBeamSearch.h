@@ -0,0 +1,75 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CNTKEvalBeamSearch.h - Beam search decoding with the sessions of the extended evaluation interface
+//
+#pragma once
+
+#include <vector>
+
+#include "Eval.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Keeps up to beamWidth hypotheses per sequence, each in a session of the evaluator. Every step advances the
+// hypotheses of all unfinished sequences by one token with a single ForwardPassSessions(), selects the beamWidth best
+// extensions of every sequence by partial selection, and lets the sessions continue from the states of their parents
+// with ReorderSessions().
+template <typename ElemType>
+class CNTKEvalBeamSearch : public IEvaluateModelBeamSearch<ElemType>
+{
+public:
+    CNTKEvalBeamSearch(IEvaluateModelExtended<ElemType>* eval, size_t beamWidth, size_t endSymbol, size_t maxLength);
+
+    virtual void Decode(const std::vector<std::vector<size_t>>& prefixes, std::vector<std::vector<size_t>>& results, std::vector<double>& scores) override;
+
+    virtual void Destroy() override;
+
+private:
+    struct Hypothesis
+    {
+        std::vector<size_t> m_tokens; // generated tokens, without the prefix
+        double m_score;               // log probability of the tokens
+        size_t m_beam;                // beam whose session holds the state after the tokens
+    };
+
+    struct Candidate
+    {
+        double m_score;
+        size_t m_parent; // index of the extended hypothesis
+        size_t m_token;
+    };
+
+    struct SequenceState
+    {
+        std::vector<Hypothesis> m_hypotheses; // active hypotheses, best first
+        Hypothesis m_best;                    // best finished hypothesis
+        bool m_hasFinished;
+        bool m_done;
+    };
+
+    void DecodeWithSessions(const std::vector<std::vector<size_t>>& prefixes, const std::vector<size_t>& sessions, std::vector<std::vector<size_t>>& results, std::vector<double>& scores);
+
+    // Replaces the hypotheses of a sequence by the best extensions of them, given the output of the model for every hypothesis.
+    // Appends the moves of the states to sessionIds and sourceSessionIds.
+    void Extend(SequenceState& sequence, const std::vector<const ElemType*>& outputs, const size_t* sessions,
+                std::vector<size_t>& sessionIds, std::vector<size_t>& sourceSessionIds);
+
+    void SetInput(ValueBuffer<ElemType, Vector>& input, const size_t* tokens, size_t numTokens) const;
+
+    IEvaluateModelExtended<ElemType>* m_eval;
+    size_t m_beamWidth;
+    size_t m_endSymbol;
+    size_t m_maxLength;
+    size_t m_vocabularySize;
+    bool m_sparseInput;
+
+    // Buffers reused across steps.
+    std::vector<Values<ElemType>> m_stepInputs;
+    std::vector<Values<ElemType>> m_stepOutputs;
+    std::vector<size_t> m_tokenIndices;
+    std::vector<Candidate> m_candidates;
+};
+
+} } }
@@ -0,0 +1,99 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// AliasSampler.h : O(1) sampling from a fixed discrete distribution (Walker's alias method)
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Draws samples with replacement from the distribution p(i) = weights[i] / sum_k weights[k].
+// Building the table is O(n) (Vose's construction); every sample then costs one uniform random number and one table lookup,
+// independent of n, compared to O(log n) for a binary search over the prefix sums of the weights.
+class AliasSampler
+{
+public:
+    template <class WeightType>
+    void Build(const std::vector<WeightType>& weights)
+    {
+        size_t n = weights.size();
+        double sumOfWeights = 0;
+        for (auto weight : weights)
+        {
+            if (!(weight >= 0) || !std::isfinite((double) weight))
+                InvalidArgument("AliasSampler: Sampling weights must be finite and non-negative, found %f.", (double) weight);
+            sumOfWeights += weight;
+        }
+        if (n == 0 || sumOfWeights <= 0)
+            InvalidArgument("AliasSampler: Sampling weights must have a positive sum.");
+
+        m_probabilities.resize(n);
+        m_threshold.resize(n);
+        m_alias.resize(n);
+
+        // scale the probabilities by n, so that the average bucket has the mass 1
+        std::vector<size_t> small, large;
+        for (size_t i = 0; i < n; i++)
+        {
+            m_probabilities[i] = weights[i] / sumOfWeights;
+            m_threshold[i] = m_probabilities[i] * n;
+            m_alias[i] = i;
+            (m_threshold[i] < 1 ? small : large).push_back(i);
+        }
+
+        // fill up each bucket below 1 with mass from a bucket above 1
+        while (!small.empty() && !large.empty())
+        {
+            size_t s = small.back();
+            small.pop_back();
+            size_t l = large.back();
+            m_alias[s] = l;
+            m_threshold[l] -= 1 - m_threshold[s];
+            if (m_threshold[l] < 1)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+
+        // what is left is 1 up to rounding errors
+        for (auto i : small)
+            m_threshold[i] = 1;
+        for (auto i : large)
+            m_threshold[i] = 1;
+    }
+
+    template <class Generator>
+    size_t Sample(Generator& generator) const
+    {
+        double u = std::uniform_real_distribution<double>(0, (double) m_threshold.size())(generator);
+        size_t i = std::min((size_t) u, m_threshold.size() - 1);
+        return (u - i) < m_threshold[i] ? i : m_alias[i];
+    }
+
+    // normalized probability of class i
+    double Probability(size_t i) const
+    {
+        return m_probabilities[i];
+    }
+
+    size_t Size() const
+    {
+        return m_probabilities.size();
+    }
+
+private:
+    std::vector<double> m_probabilities;
+    std::vector<double> m_threshold; // probability of keeping the bucket's own class rather than its alias
+    std::vector<size_t> m_alias;
+};
+
+}}}
@@ -21,6 +21,7 @@
 #include <thread>
 #include <iostream>
 #include <algorithm>
+#include <numeric>
 #ifdef _WIN32
 #define NOMINMAX
 #include "Windows.h"
@@ -646,6 +647,14 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::DoGatherColumnsOf(ElemType beta, const
     else
         Resize(a.GetNumRows(), idx.GetNumCols());
 
+    // check the map upfront, since an exception must not leave the parallel loop below
+    foreach_column(jOut, idx)
+    {
+        auto jInF = idx(0, jOut);
+        if (!std::isnan(jInF) && jInF >= a.GetNumCols())
+            InvalidArgument("DoGatherColumnsOf: Map out of bounds. %ld >= %ld", (long int)jInF, (long int)a.GetNumCols());
+    }
+
     auto& us = *this;
 #pragma omp parallel for // TODO: Depending in circumstance, it may be more efficient to parallelize over rows.
     foreach_column(jOut, us)
@@ -654,8 +663,6 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::DoGatherColumnsOf(ElemType beta, const
         if (std::isnan(jInF) || jInF < 0) // negative index means gap
             continue;
         size_t jIn = (size_t)jInF;
-        if (jIn >= a.GetNumCols())
-            InvalidArgument("DoGatherColumnsOf: Map out of bounds. %ld >= %ld", (long int)jIn, (long int)a.GetNumCols());
         ScaleAndAddColumn(beta, &us(0,jOut), &a(0,jIn), us.GetNumRows(), alpha);
     }
 
@@ -1248,6 +1255,89 @@ void CPUMatrix<ElemType>::FSAdagrad(CPUMatrix<ElemType>& gradients,
     }
 }
 
+// number of elements of one unit of work of the multi-tensor updates
+static const size_t multiTensorUpdateChunkSize = 16384;
+
+// Fused NormalGrad() of many parameters, reading the gradient, smoothed gradient and value of every element once.
+// Per element, this is the same as InplaceTruncate() of the gradients (if clippingThreshold is finite), ScaleAndAdd() of
+// the L2 regularization, and NormalGrad(), except that the gradients themselves are left unchanged.
+template <class ElemType>
+/*static*/ void CPUMatrix<ElemType>::MultiTensorNormalGrad(const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, bool useNesterovMomentum)
+{
+    const auto chunks = GetMultiTensorUpdateChunks(entries, multiTensorUpdateChunkSize);
+    const ElemType threshold = abs(clippingThreshold);
+#pragma omp parallel for
+    for (long k = 0; k < (long) chunks.size(); k++)
+    {
+        const auto& entry = entries[chunks[k].m_entry];
+        const ElemType* grad = entry.m_gradients;
+        ElemType* smoothed = entry.m_smoothedGradients;
+        ElemType* val = entry.m_functionValues;
+        const ElemType lr = (1 - momentum) * entry.m_learnRatePerSample;
+        const ElemType l2 = entry.m_l2RegWeight;
+        for (size_t i = chunks[k].m_begin; i < chunks[k].m_end; i++)
+        {
+            ElemType g = grad[i];
+            if (g > threshold)
+                g = threshold;
+            else if (g < -threshold)
+                g = -threshold;
+            g += l2 * val[i];
+
+            ElemType s = lr * g + momentum * smoothed[i];
+            smoothed[i] = s;
+            val[i] -= useNesterovMomentum ? momentum * s + lr * g : s;
+        }
+    }
+}
+
+// Fused FSAdagrad() of many parameters, with the gradient truncation and L2 regularization of MultiTensorNormalGrad().
+template <class ElemType>
+/*static*/ void CPUMatrix<ElemType>::MultiTensorFSAdagrad(const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, ElemType adaWeight)
+{
+    const auto chunks = GetMultiTensorUpdateChunks(entries, multiTensorUpdateChunkSize);
+    const ElemType threshold = abs(clippingThreshold);
+#pragma omp parallel for
+    for (long k = 0; k < (long) chunks.size(); k++)
+    {
+        const auto& entry = entries[chunks[k].m_entry];
+        const ElemType* grad = entry.m_gradients;
+        ElemType* smoothAda = entry.m_smoothedGradients;
+        ElemType* smoothMom = entry.m_smoothedGradients + entry.m_numElements;
+        ElemType* val = entry.m_functionValues;
+        const ElemType lr = entry.m_learnRatePerSample;
+        const ElemType l2 = entry.m_l2RegWeight;
+        const ElemType adaMul = entry.m_adaMul;
+        for (size_t i = chunks[k].m_begin; i < chunks[k].m_end; i++)
+        {
+            ElemType g = grad[i];
+            if (g > threshold)
+                g = threshold;
+            else if (g < -threshold)
+                g = -threshold;
+            g += l2 * val[i];
+
+            ElemType adaSqr = adaWeight * smoothAda[i] + (1.0f - adaWeight) * g * g;
+            smoothAda[i] = adaSqr;
+            if (adaSqr != 0.0f)
+            {
+                ElemType w = adaMul * ((ElemType) 1.0 / sqrt(adaSqr));
+                if (w > 10.0f)
+                    w = 10.0f;
+                g *= w;
+            }
+
+            if (momentum > 0.0f)
+            {
+                g = momentum * smoothMom[i] + (1.0f - momentum) * g;
+                smoothMom[i] = g;
+            }
+
+            val[i] -= g * lr;
+        }
+    }
+}
+
 template <class ElemType>
 ElemType CPUMatrix<ElemType>::RmsProp(CPUMatrix<ElemType>& gradients,
                                       ElemType RMS_GAMMA,
@@ -1440,10 +1530,13 @@ size_t CPUMatrix<ElemType>::CopyToArray(ElemType*& arrayCopyTo, size_t& currentA
 }
 
 template <typename ElemType>
-void CPUMatrix<ElemType>::CopySection(size_t /*numRows*/, size_t /*numCols*/, ElemType* /*dst*/, size_t /*colStride*/) const
+void CPUMatrix<ElemType>::CopySection(size_t numRows, size_t numCols, ElemType* dst, size_t colStride) const
 {
-    // REVIEW alexeyk: currently not used by CPU, but implement when possible.
-    RuntimeError("Not implemented.");
+    if (numRows > GetNumRows() || numCols > GetNumCols() || (numCols > 1 && colStride < numRows))
+        InvalidArgument("CopySection: The section [%d x %d] does not fit the matrix or the destination.", (int) numRows, (int) numCols);
+
+    for (size_t j = 0; j < numCols; j++)
+        memcpy(dst + j * colStride, Data() + j * GetNumRows(), sizeof(ElemType) * numRows);
 }
 
 template <class ElemType>
@@ -3415,30 +3508,32 @@ void CPUMatrix<ElemType>::VectorMax(CPUMatrix<ElemType>& maxIndexes, CPUMatrix<E
         }
         else
         {
-            std::vector<int> indices(m);
-            int i = 0;
-            std::generate(indices.begin(), indices.end(), [&i]
-                          {
-                              return i++;
-                          });
-
-            const ElemType* curVal =            Data();
-            ElemType* curIdx       = maxIndexes.Data();
-            ElemType* curMax       =  maxValues.Data();
-            for (int icol = 0; icol < n; icol++, curVal += m, curIdx += topK, curMax += topK)
+            // Partial selection of the topK largest values of every column, O(m + topK log topK) per column; the selected
+            // values are then sorted in descending order, e.g. for the hypotheses of a beam search.
+#pragma omp parallel
             {
-                // Partial sort, descending order.
-                std::nth_element(indices.begin(), indices.begin() + topK, indices.end(),
-                                 [curVal](const int& a, const int& b)
-                                 {
-                                     return curVal[a] > curVal[b];
-                                 });
-                // REVIEW alexeyk: the following produces warning (see SCL_SECURE_NO_WARNINGS) so use loop instead.
-                // std::transform(indices.begin(), indices.begin() + topK, curIdx, [](const int& a) { return static_cast<ElemType>(a); });
-                for (int i = 0; i < topK; i++)
+                std::vector<int> indices(m);
+#pragma omp for
+                for (int icol = 0; icol < n; icol++)
                 {
-                    curIdx[i] = static_cast<ElemType>(indices[i]);
-                    curMax[i] = curVal[indices[i]];
+                    const ElemType* curVal = Data() + (size_t) icol * m;
+                    ElemType* curIdx = maxIndexes.Data() + (size_t) icol * topK;
+                    ElemType* curMax = maxValues.Data() + (size_t) icol * topK;
+                    auto greater = [curVal](const int& a, const int& b)
+                    {
+                        return curVal[a] > curVal[b];
+                    };
+
+                    std::iota(indices.begin(), indices.end(), 0);
+                    std::nth_element(indices.begin(), indices.begin() + topK, indices.end(), greater);
+                    std::sort(indices.begin(), indices.begin() + topK, greater);
+                    // REVIEW alexeyk: the following produces warning (see SCL_SECURE_NO_WARNINGS) so use loop instead.
+                    // std::transform(indices.begin(), indices.begin() + topK, curIdx, [](const int& a) { return static_cast<ElemType>(a); });
+                    for (int i = 0; i < topK; i++)
+                    {
+                        curIdx[i] = static_cast<ElemType>(indices[i]);
+                        curMax[i] = curVal[indices[i]];
+                    }
                 }
             }
         }
@@ -5798,72 +5893,97 @@ ElemType CPUMatrix<ElemType>::LogSumOfElements() const
     return fAlpha;
 }
 
+// log (sum_i exp (a[i] + b[i])) for two contiguous vectors
+// Unlike a chain of LogAddD(), the terms are independent of each other, so that both loops can be vectorized.
 template <class ElemType>
-void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha, CPUMatrix<ElemType>& beta,
-                                              const CPUMatrix<ElemType>& lbls,
-                                              const CPUMatrix<ElemType>& pair_scores)
+static ElemType LogSumExpOfSum(const ElemType* a, const ElemType* b, size_t n)
 {
-    int iNumPos = (int) lbls.GetNumCols();
-    int iNumLab = (int) lbls.GetNumRows();
+    ElemType maxVal = (ElemType) LZERO;
+    for (size_t i = 0; i < n; i++)
+        maxVal = std::max(maxVal, a[i] + b[i]);
+    if (maxVal <= (ElemType) LZERO) // all terms are 0
+        return (ElemType) LZERO;
+    ElemType sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += exp(a[i] + b[i] - maxVal);
+    return maxVal + log(sum);
+}
 
-    int lastLbl = -1;
-    for (int ik = 0; ik < lbls.GetNumRows(); ik++)
-        if (lbls(ik, iNumPos - 1) != 0)
-        {
-            lastLbl = ik;
-            break;
-        }
+// log-domain scores of the position before the first one: all paths start with startLbl
+template <class ElemType>
+static std::vector<ElemType> RCRFStartScores(size_t numLabels, int startLbl)
+{
+    std::vector<ElemType> startScores(numLabels, (ElemType) LZERO);
+    if (startLbl >= 0 && startLbl < (int) numLabels)
+        startScores[startLbl] = 0;
+    return startScores;
+}
 
-    beta.RequireSize(iNumLab, iNumPos);
+// alpha(k, t) = log sum_j exp (alpha(j, t - 1) + pair_scores(k, j)) + pos_scores(k, t)
+template <class ElemType>
+void CPUMatrix<ElemType>::RCRFForwardCompute(const CPUMatrix<ElemType>& pos_scores,
+                                             const CPUMatrix<ElemType>& pair_scores,
+                                             CPUMatrix<ElemType>& alpha,
+                                             const int startLbl)
+{
+    int iNumPos = (int) pos_scores.GetNumCols();
+    int iNumLab = (int) pos_scores.GetNumRows();
+
+    alpha.RequireSize(iNumLab, iNumPos);
 
-    for (int t = iNumPos - 1; t >= 0; t--)
+    // the predecessor scores of label k are row k of pair_scores, which are contiguous in the transpose
+    CPUMatrix<ElemType> predecessorScores;
+    predecessorScores.AssignTransposeOf(pair_scores);
+    std::vector<ElemType> startScores = RCRFStartScores<ElemType>(iNumLab, startLbl);
+
+    for (int t = 0; t < iNumPos; t++)
     {
+        const ElemType* prevAlpha = t > 0 ? &alpha(0, t - 1) : startScores.data();
 #pragma omp parallel for
         for (int k = 0; k < iNumLab; k++)
-        {
-            _rcrfBackwardCompute(t, k, alpha, beta, pair_scores);
-        }
+            alpha(k, t) = LogSumExpOfSum(prevAlpha, &predecessorScores(0, k), iNumLab) + pos_scores(k, t);
     }
-};
+}
 
-/// the kernel function for RCRF backward computation
+// beta(k, t) = alpha(k, t) + log sum_j exp (beta(j, t + 1) - zeta(j) + pair_scores(j, k)),
+// where zeta(j) = log sum_m exp (alpha(m, t) + pair_scores(j, m)) normalizes the transitions into label j.
+// zeta does not depend on k, so it is computed once per position.
 template <class ElemType>
-void CPUMatrix<ElemType>::_rcrfBackwardCompute(size_t t, size_t k, const CPUMatrix<ElemType>& alpha,
-                                               CPUMatrix<ElemType>& beta,
-                                               const CPUMatrix<ElemType>& pair_scores)
+void CPUMatrix<ElemType>::RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha, CPUMatrix<ElemType>& beta,
+                                              const CPUMatrix<ElemType>& lbls,
+                                              const CPUMatrix<ElemType>& pair_scores)
 {
-    size_t iNumLab = alpha.GetNumRows();
-    size_t iNumPos = alpha.GetNumCols();
+    int iNumPos = (int) lbls.GetNumCols();
+    int iNumLab = (int) lbls.GetNumRows();
 
-    ElemType fSum;
-    ElemType fTmp = (ElemType) LZERO;
-    if (t == iNumPos - 1)
-    {
-        fSum = (ElemType) LZERO;
-        for (int j = 0; j < iNumLab; j++)
-        {
-            fSum = (ElemType) LogAddD(fSum, alpha(j, t));
-        }
+    beta.RequireSize(iNumLab, iNumPos);
+    if (iNumPos == 0)
+        return;
 
-        fTmp = alpha(k, t) - fSum;
-        beta(k, t) = fTmp;
-    }
-    else
+    CPUMatrix<ElemType> predecessorScores;
+    predecessorScores.AssignTransposeOf(pair_scores);
+
+    // last position: posterior of the label
+    std::vector<ElemType> zeroes(iNumLab, 0);
+    const ElemType logZ = LogSumExpOfSum(&alpha(0, iNumPos - 1), zeroes.data(), iNumLab);
+    for (int k = 0; k < iNumLab; k++)
+        beta(k, iNumPos - 1) = alpha(k, iNumPos - 1) - logZ;
+
+    std::vector<ElemType> betaMinusZeta(iNumLab);
+    for (int t = iNumPos - 2; t >= 0; t--)
     {
+#pragma omp parallel for
         for (int j = 0; j < iNumLab; j++)
-        {
-            fSum = (ElemType) LZERO;
-            for (int m = 0; m < iNumLab; m++)
-            {
-                fSum = (ElemType) LogAddD(fSum, alpha(m, t) + pair_scores(j, m));
-            }
+            betaMinusZeta[j] = beta(j, t + 1) - LogSumExpOfSum(&alpha(0, t), &predecessorScores(0, j), iNumLab);
 
-            fTmp = (ElemType) LogAddD(fTmp, beta(j, t + 1) + alpha(k, t) + pair_scores(j, k) - fSum);
-        }
-        beta(k, t) = fTmp;
+#pragma omp parallel for
+        for (int k = 0; k < iNumLab; k++)
+            beta(k, t) = alpha(k, t) + LogSumExpOfSum(betaMinusZeta.data(), &pair_scores(0, k), iNumLab);
     }
-}
+};
 
+// grd(j, i) += sum_t exp (alpha(i, t - 1) + pair_scores(j, i) - zeta(j) + beta(j, t)) - #transitions from i to j in lbls,
+// with zeta(j) as in RCRFBackwardCompute(), and alpha(., -1) selecting the label at position 0
 template <class ElemType>
 void CPUMatrix<ElemType>::RCRFTransGrdCompute(const CPUMatrix<ElemType>& lbls,
                                               const CPUMatrix<ElemType>& alpha,
@@ -5874,130 +5994,104 @@ void CPUMatrix<ElemType>::RCRFTransGrdCompute(const CPUMatrix<ElemType>& lbls,
     int iNumPos = (int) alpha.GetNumCols();
     int iNumLab = (int) alpha.GetNumRows();
 
-    int firstLbl = -1;
-    for (int ik = 0; ik < lbls.GetNumRows(); ik++)
-        if (lbls(ik, 0) != 0)
-        {
-            firstLbl = ik;
-            break;
-        }
+    // the label at each position (one-hot columns of lbls)
+    std::vector<int> labels(iNumPos, -1);
+    for (int t = 0; t < iNumPos; t++)
+    {
+        for (int ik = 0; ik < lbls.GetNumRows(); ik++)
+            if (lbls(ik, t) != 0)
+            {
+                labels[t] = ik;
+                break;
+            }
+    }
+    int firstLbl = iNumPos > 0 ? labels[0] : -1;
 
-    for (size_t tPos = 0; tPos < iNumPos; tPos++)
+    CPUMatrix<ElemType> predecessorScores;
+    predecessorScores.AssignTransposeOf(pair_scores);
+    std::vector<ElemType> startScores = RCRFStartScores<ElemType>(iNumLab, firstLbl);
+
+    std::vector<ElemType> betaMinusZeta(iNumLab);
+    for (int tPos = 0; tPos < iNumPos; tPos++)
     {
-        CPUMatrix<ElemType> b = beta.ColumnSlice(tPos, 1);
-        CPUMatrix<ElemType> a;
-        if (tPos > 0)
-            a = alpha.ColumnSlice(tPos - 1, 1);
+        const ElemType* prevAlpha = tPos > 0 ? &alpha(0, tPos - 1) : startScores.data();
+
+#pragma omp parallel for
+        for (int j = 0; j < iNumLab; j++)
+            betaMinusZeta[j] = beta(j, tPos) - LogSumExpOfSum(prevAlpha, &predecessorScores(0, j), iNumLab);
 
 #pragma omp parallel for
         for (int i = 0; i < iNumLab; i++)
         {
-            _rcrfTransGrdCompute(i, lbls, alpha, beta, pair_scores, grd, tPos);
+            ElemType* grdColumn = &grd(0, i);
+            const ElemType* pairColumn = &pair_scores(0, i);
+            const ElemType prevAlphaI = prevAlpha[i];
+            for (int j = 0; j < iNumLab; j++)
+                grdColumn[j] += exp(prevAlphaI + pairColumn[j] + betaMinusZeta[j]);
         }
 
         // transition score
-        int i = -1;
-        if (tPos == 0)
-            i = firstLbl;
-        else
-        {
-            for (int ik = 0; ik < lbls.GetNumRows(); ik++)
-                if (lbls(ik, tPos - 1) != 0)
-                {
-                    i = ik;
-                    break;
-                }
-        }
-
-        int j = -1;
-        for (int ik = 0; ik < lbls.GetNumRows(); ik++)
-        {
-            if (lbls(ik, tPos) != 0)
-            {
-                j = ik;
-                break;
-            }
-        }
-
+        int i = tPos == 0 ? firstLbl : labels[tPos - 1];
+        int j = labels[tPos];
         grd(j, i) -= 1.0;
     }
 };
 
+// alpha(k, t) = max_j (alpha(j, t - 1) + pair_scores(k, j)) + pos_scores(k, t), where the path is constrained to start with startLbl
 template <class ElemType>
-void CPUMatrix<ElemType>::_rcrfTransGrdCompute(size_t i,
-                                               const CPUMatrix<ElemType>& lbls,
-                                               const CPUMatrix<ElemType>& alpha,
-                                               const CPUMatrix<ElemType>& beta,
-                                               const CPUMatrix<ElemType>& pair_scores,
-                                               CPUMatrix<ElemType>& grd,
-                                               const size_t tPos // position
-                                               )
+void CPUMatrix<ElemType>::RCRFViterbiCompute(const CPUMatrix<ElemType>& pos_scores,
+                                             const CPUMatrix<ElemType>& pair_scores,
+                                             CPUMatrix<ElemType>& alpha,
+                                             CPUMatrix<ElemType>& backtrace,
+                                             const int startLbl)
 {
-    int iNumLab = (int) alpha.GetNumRows();
+    int iNumPos = (int) pos_scores.GetNumCols();
+    int iNumLab = (int) pos_scores.GetNumRows();
+    if (startLbl < 0 || startLbl >= iNumLab)
+        InvalidArgument("RCRFViterbiCompute: The start label %d is not a valid label.", startLbl);
 
-    int firstLbl = -1;
-    for (int ik = 0; ik < lbls.GetNumRows(); ik++)
-        if (lbls(ik, 0) != 0)
-        {
-            firstLbl = ik;
-            break;
-        }
+    alpha.RequireSize(iNumLab, iNumPos);
+    backtrace.RequireSize(iNumLab, iNumPos);
 
-    CPUMatrix<ElemType> b = beta.ColumnSlice(tPos, 1);
-    CPUMatrix<ElemType> a;
-    if (tPos > 0)
-        a = alpha.ColumnSlice(tPos - 1, 1);
+    CPUMatrix<ElemType> predecessorScores;
+    predecessorScores.AssignTransposeOf(pair_scores);
 
+    for (int t = 0; t < iNumPos; t++)
     {
-        ElemType fTmp = (ElemType) LZERO;
-        for (int j = 0; j < iNumLab; j++)
+#pragma omp parallel for
+        for (int k = 0; k < iNumLab; k++)
         {
-            if (tPos == 0)
+            ElemType fTmp;
+            int iTmp = startLbl;
+            if (t > 1)
             {
-                if (i == firstLbl)
-                {
-                    fTmp = 0;
-                }
-                else
+                // best score first, then the first predecessor that has it, so that the max can be vectorized
+                const ElemType* prevAlpha = &alpha(0, t - 1);
+                const ElemType* predecessorScoresK = &predecessorScores(0, k);
+                fTmp = (ElemType) LZERO;
+                for (int j = 0; j < iNumLab; j++)
+                    fTmp = std::max(fTmp, prevAlpha[j] + predecessorScoresK[j]);
+                if (fTmp > (ElemType) LZERO)
                 {
-                    fTmp = (ElemType) LZERO;
+                    for (int j = 0; j < iNumLab; j++)
+                        if (prevAlpha[j] + predecessorScoresK[j] == fTmp)
+                        {
+                            iTmp = j;
+                            break;
+                        }
                 }
+                fTmp += pos_scores(k, t); // include position dependent score
             }
+            else if (t == 1) // with constrain that the first word is labeled as a given symbol
+                fTmp = alpha(startLbl, 0) + pair_scores(k, startLbl) + pos_scores(k, t);
             else
-            {
-                fTmp = a(i, 0);
-            }
-            fTmp += pair_scores(j, i);
-
-            ElemType fSum = (ElemType) LZERO;
-            for (int k = 0; k < iNumLab; k++)
-            {
-                ElemType fTmp2;
-                if (tPos == 0)
-                {
-                    if (k == firstLbl)
-                    {
-                        fTmp2 = 0;
-                    }
-                    else
-                    {
-                        fTmp2 = (ElemType) LZERO;
-                    }
-                }
-                else
-                {
-                    fTmp2 = a(k, 0);
-                }
-                fSum = (ElemType) LogAddD(fSum, fTmp2 + pair_scores(j, k));
-            }
-
-            fTmp -= fSum;
-            fTmp += b(j, 0);
-
-            grd(j, i) += exp(fTmp);
+                fTmp = (k == startLbl) ? pos_scores(k, t) : (ElemType) LZERO;
+            alpha(k, t) = fTmp;
+            backtrace(k, t) = (ElemType) iTmp;
         }
     }
-};
+}
+
 template <class ElemType>
 CPUMatrix<ElemType>& CPUMatrix<ElemType>::DropFrame(const CPUMatrix<ElemType>& label, const CPUMatrix<ElemType>& gamma, const ElemType& threshhold)
 {
@@ -6066,6 +6160,22 @@ int CPUMatrix<ElemType>::SetNumThreads(int numThreads)
     return numThreads;
 }
 
+// sets the number of OpenMP threads of the operations that are called from the calling thread, and returns the previous number
+// Unlike SetNumThreads(), this does not affect other threads nor change the thread settings of the BLAS library.
+// note: this function does not depend on the <ElemType> parameter
+template <class ElemType>
+int CPUMatrix<ElemType>::SetNumThreadsOfCallingThread(int numThreads)
+{
+#ifdef _OPENMP
+    int previousNumThreads = omp_get_max_threads();
+    omp_set_num_threads(numThreads);
+    return previousNumThreads;
+#else
+    numThreads;
+    return 1;
+#endif
+}
+
 // To ensure Intel MKL calls return the same results on all Intel or Intel compatible CPUs,
 // the function set CBWR compatible mode.
 template <class ElemType>
@@ -93,6 +93,9 @@ public:
 
     ElemType Adagrad(CPUMatrix<ElemType>& gradients, const bool needAveMultiplier);
     void FSAdagrad(CPUMatrix<ElemType>& gradients, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul);
+    // fused updates of many parameters in a single multi-threaded pass, with gradient truncation and L2 regularization folded in
+    static void MultiTensorNormalGrad(const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, bool useNesterovMomentum);
+    static void MultiTensorFSAdagrad(const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, ElemType adaWeight);
     ElemType RmsProp(CPUMatrix<ElemType>& gradients,
                      ElemType RMS_GAMMA,
                      ElemType RMS_WGT_INC,
@@ -389,6 +392,7 @@ public:
 public:
     // This functions do not depend on <ElemType>, i.e. you can call them on any <ElemType>
     static int SetNumThreads(int numThreads);
+    static int SetNumThreadsOfCallingThread(int numThreads);
     static void SetCompatibleMode();
 
     // static BLAS functions
@@ -493,12 +497,15 @@ public:
 
 public:
     // for RCRF
+    // pair_scores(j, i) is the score of label j following label i. All kernels are O(T * L^2) for T positions and L labels.
+    static void RCRFForwardCompute(const CPUMatrix<ElemType>& pos_scores,
+                                   const CPUMatrix<ElemType>& pair_scores,
+                                   CPUMatrix<ElemType>& alpha,
+                                   const int startLbl);
+
     static void RCRFBackwardCompute(const CPUMatrix<ElemType>& alpha, CPUMatrix<ElemType>& beta,
                                     const CPUMatrix<ElemType>& lbls,
                                     const CPUMatrix<ElemType>& pair_scores);
-    static void _rcrfBackwardCompute(size_t t, size_t k, const CPUMatrix<ElemType>& alpha,
-                                     CPUMatrix<ElemType>& beta,
-                                     const CPUMatrix<ElemType>& pair_scores);
 
     static void RCRFTransGrdCompute(const CPUMatrix<ElemType>& lbls,
                                     const CPUMatrix<ElemType>& alpha,
@@ -506,14 +513,12 @@ public:
                                     const CPUMatrix<ElemType>& pair_scores,
                                     CPUMatrix<ElemType>& grd);
 
-    static void _rcrfTransGrdCompute(size_t i,
-                                     const CPUMatrix<ElemType>& lbls,
-                                     const CPUMatrix<ElemType>& alpha,
-                                     const CPUMatrix<ElemType>& beta,
-                                     const CPUMatrix<ElemType>& pair_scores,
-                                     CPUMatrix<ElemType>& grd,
-                                     const size_t tPos // position
-                                     );
+    // Viterbi search of the SequenceDecoderNode; backtrace(k, t) is the best predecessor of label k at position t
+    static void RCRFViterbiCompute(const CPUMatrix<ElemType>& pos_scores,
+                                   const CPUMatrix<ElemType>& pair_scores,
+                                   CPUMatrix<ElemType>& alpha,
+                                   CPUMatrix<ElemType>& backtrace,
+                                   const int startLbl);
 
 protected:
     size_t LocateElement(const size_t i, const size_t j) const;
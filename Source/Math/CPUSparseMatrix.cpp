@@ -262,7 +262,8 @@ void CPUSparseMatrix<ElemType>::SetValue(const CPUSparseMatrix<ElemType>& v)
         }
         else
         {
-            memcpy(GetBlockIds(), v.GetBlockIds(), v.GetBlockSize());
+            memcpy(GetBlockIds(), v.GetBlockIds(), sizeof(size_t) * v.GetBlockSize());
+            SetBlockSize(v.GetBlockSize());
         }
     }
     if (v.m_sliceViewOffset > 0)
@@ -1027,6 +1028,29 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
     }
 }
 
+// sparse += dense, restricted to the blocks of c
+// used for regularizing sparse gradient updates: only the columns (rows) that are present in c are changed
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::ScaleAndAddToBlocks(const ElemType alpha, const CPUMatrix<ElemType>& a, CPUSparseMatrix<ElemType>& c)
+{
+    if (a.GetNumRows() != c.GetNumRows() || a.GetNumCols() != c.GetNumCols())
+        InvalidArgument("CPUSparseMatrix::ScaleAndAddToBlocks: The dimensions of a and c must match.");
+
+    if (c.GetFormat() != MatrixFormat::matrixFormatSparseBlockCol && c.GetFormat() != MatrixFormat::matrixFormatSparseBlockRow)
+        NOT_IMPLEMENTED;
+
+    bool colMajor = (c.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
+    size_t len = colMajor ? c.GetNumRows() : c.GetNumCols();
+#pragma omp parallel for
+    for (long j = 0; j < (long) c.GetBlockSize(); j++)
+    {
+        size_t colOrRow = c.GetBlockIds()[j] - c.GetBlockIdShift();
+        ElemType* values = c.Buffer() + j * len;
+        for (size_t i = 0; i < len; i++)
+            values[i] += alpha * (colMajor ? a(i, colOrRow) : a(colOrRow, i));
+    }
+}
+
 // dense += sparse
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const CPUSparseMatrix<ElemType>& lhs, CPUMatrix<ElemType>& rhs)
@@ -1209,6 +1233,63 @@ ElemType CPUSparseMatrix<ElemType>::Adagrad(CPUMatrix<ElemType>& c, const bool n
         return 1;
 }
 
+// FSAdaGrad update of the columns (rows) present in the block sparse gradients (this) only, i.e. their weights in functionValues
+// and their accumulators in c. The other columns (rows) keep their weights and accumulators until they occur in a gradient again.
+// c has the same layout as for the dense CPUMatrix::FSAdagrad(), AdaGrad accumulators followed by momentum accumulators.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::FSAdagrad(CPUMatrix<ElemType>& c, CPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul)
+{
+    size_t numColsNeeded = 2 * GetNumCols();
+
+    if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+    {
+        c.RequireSize(GetNumRows(), numColsNeeded);
+        c.SetValue(0.0);
+    }
+
+    assert((c.GetNumRows() == GetNumRows()) && (c.GetNumCols() == numColsNeeded));
+
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol && GetFormat() != MatrixFormat::matrixFormatSparseBlockRow)
+        NOT_IMPLEMENTED;
+
+    bool colMajor = (GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
+    size_t len = colMajor ? GetNumRows() : GetNumCols();
+    size_t n = GetNumRows() * GetNumCols();
+    ElemType* smoothAda = c.Data();
+    ElemType* smoothMom = c.Data() + n;
+    ElemType* val = functionValues.Data();
+#pragma omp parallel for
+    for (long j = 0; j < (long) GetBlockSize(); j++)
+    {
+        size_t colOrRow = GetBlockIds()[j] - GetBlockIdShift();
+        for (size_t i = 0; i < len; i++)
+        {
+            size_t row = colMajor ? i : colOrRow;
+            size_t col = colMajor ? colOrRow : i;
+            size_t index = row + col * GetNumRows();
+
+            ElemType g = Buffer()[j * len + i];
+            ElemType adaSqr = adaWeight * smoothAda[index] + (1.0f - adaWeight) * g * g;
+            smoothAda[index] = adaSqr;
+            if (adaSqr != 0.0f)
+            {
+                ElemType w = adaMul * ((ElemType) 1.0 / sqrt(adaSqr));
+                if (w > 10.0f)
+                    w = 10.0f;
+                g *= w;
+            }
+
+            if (momentum > 0.0f)
+            {
+                g = momentum * smoothMom[index] + (1.0f - momentum) * g;
+                smoothMom[index] = g;
+            }
+
+            val[index] -= g * learnRatePerSample;
+        }
+    }
+}
+
 template <class ElemType>
 CPUSparseMatrix<ElemType>& CPUSparseMatrix<ElemType>::InplaceTruncateTop(const ElemType threshold)
 {
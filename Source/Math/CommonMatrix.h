@@ -15,8 +15,10 @@
 
 #include "Basics.h"
 #include <string>
+#include <algorithm>
 #include <stdint.h>
 #include <memory>
+#include <vector>
 
 #pragma warning( disable: 4251 )
 typedef unsigned char byte;
@@ -205,6 +207,45 @@ enum MatrixFlags
     matrixFlagSetValueOnDevice = 1 << bitPosSetValueOnDevice, // SetValue() call has a buffer that is already on the device
 };
 
+// -----------------------------------------------------------------------
+// MultiTensorUpdateEntry -- one parameter of a fused optimizer update of many parameters at once,
+// see CPUMatrix::MultiTensorNormalGrad() and CPUMatrix::MultiTensorFSAdagrad().
+// All buffers are dense, of m_numElements elements (the smoothed gradients of FSAdaGrad twice as many), and on the same device.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+struct MultiTensorUpdateEntry
+{
+    ElemType* m_functionValues;
+    ElemType* m_gradients;         // read only, clipping and L2 regularization are applied on the fly
+    ElemType* m_smoothedGradients; // FSAdaGrad: AdaGrad accumulators followed by the momentum accumulators
+    size_t m_numElements;
+    ElemType m_learnRatePerSample;
+    ElemType m_l2RegWeight; // already multiplied by the minibatch size
+    ElemType m_adaMul;      // FSAdaGrad only
+};
+
+// a range of elements of one entry; the unit of work of the multi-tensor updates
+struct MultiTensorUpdateChunk
+{
+    size_t m_entry;
+    size_t m_begin;
+    size_t m_end;
+};
+
+// Splits the entries into chunks of at most chunkSize elements, so that small and large parameters are spread evenly over the threads.
+template <class ElemType>
+std::vector<MultiTensorUpdateChunk> GetMultiTensorUpdateChunks(const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, size_t chunkSize)
+{
+    std::vector<MultiTensorUpdateChunk> chunks;
+    for (size_t k = 0; k < entries.size(); k++)
+    {
+        for (size_t begin = 0; begin < entries[k].m_numElements; begin += chunkSize)
+            chunks.push_back(MultiTensorUpdateChunk{ k, begin, std::min(begin + chunkSize, entries[k].m_numElements) });
+    }
+    return chunks;
+}
+
 // -----------------------------------------------------------------------
 // BaseMatrixStorage -- base class for all matrix types (CPU, GPU) x (dense, sparse)
 // -----------------------------------------------------------------------
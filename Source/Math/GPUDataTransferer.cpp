@@ -192,6 +192,16 @@ void GPUDataTransferer::WaitForCopyGPUToCPUAsync()
     SyncEvent(m_inner->m_fetchCompleteEvent);
 }
 
+bool GPUDataTransferer::IsCopyGPUToCPUAsyncComplete()
+{
+    PrepareDevice(m_inner->m_deviceId);
+    auto rc = cudaEventQuery(m_inner->m_fetchCompleteEvent);
+    if (rc == cudaErrorNotReady)
+        return false;
+    rc || "cudaEventQuery failed";
+    return true;
+}
+
 void GPUDataTransferer::WaitForCopyCPUToGPUAsync()
 {
     PrepareDevice(m_inner->m_deviceId);
@@ -92,6 +92,9 @@ public:
 
     void WaitForCopyGPUToCPUAsync();
 
+    // Whether the last copy started by CopyGPUToCPUAsync has completed; does not block.
+    bool IsCopyGPUToCPUAsyncComplete();
+
     // CPU to GPU
     void CopyCPUToGPUAsync(void* cpuBuffer, size_t totalSize, void* gpuBuffer);
 
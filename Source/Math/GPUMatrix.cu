@@ -24,6 +24,7 @@
 #include "cublas_v2.h"
 #include <assert.h>
 #include <memory>
+#include <map>
 #include "CntkBatchNormalization.cuh"
 #include "Convolution.cuh"
 #include "CuDnnRNN.h"
@@ -1412,6 +1413,65 @@ void GPUMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>& gradients,
                                                                          learnRatePerSample, momentum, adaWeight, adaMul);
 }
 
+// number of elements of one thread block of the multi-tensor updates
+static const size_t multiTensorUpdateChunkSize = 4 * GridDim::maxThreadsPerBlock;
+
+// Copies the descriptors of a multi-tensor update to the device, the entries followed by the chunks, with a single copy on the current stream.
+// The device buffer is kept per device and only grows, since every minibatch updates the same parameters. Like the kernels that read it,
+// the copy is ordered on the stream, so it does not overwrite the descriptors of a previous update that is still running.
+template <class ElemType>
+static char* CopyMultiTensorUpdateToDevice(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, const std::vector<MultiTensorUpdateChunk>& chunks)
+{
+    static std::map<DEVICEID_TYPE, std::pair<char*, size_t>> s_buffers; // [deviceId] -> (buffer, capacity)
+
+    size_t entriesSize = sizeof(MultiTensorUpdateEntry<ElemType>) * entries.size(); // a multiple of the alignment of the chunks
+    size_t chunksSize = sizeof(MultiTensorUpdateChunk) * chunks.size();
+    auto& buffer = s_buffers[deviceId];
+    if (buffer.second < entriesSize + chunksSize)
+    {
+        if (buffer.first)
+            TracingGPUMemoryAllocator::Free<char>(deviceId, buffer.first); // (synchronizes the device)
+        buffer.second = std::max(entriesSize + chunksSize, 2 * buffer.second);
+        buffer.first = TracingGPUMemoryAllocator::Allocate<char>(deviceId, buffer.second);
+    }
+
+    std::vector<char> args(entriesSize + chunksSize);
+    memcpy(args.data(), entries.data(), entriesSize);
+    memcpy(args.data() + entriesSize, chunks.data(), chunksSize);
+    CUDA_CALL(cudaMemcpyAsync(buffer.first, args.data(), args.size(), cudaMemcpyHostToDevice, t_stream)); // returns after args have been consumed, as they are pageable
+    return buffer.first;
+}
+
+template <class ElemType>
+/*static*/ void GPUMatrix<ElemType>::MultiTensorNormalGrad(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, bool useNesterovMomentum)
+{
+    const auto chunks = GetMultiTensorUpdateChunks(entries, multiTensorUpdateChunkSize);
+    if (chunks.empty())
+        return;
+
+    PrepareDevice(deviceId);
+    char* d_args = CopyMultiTensorUpdateToDevice(deviceId, entries, chunks);
+    SyncGuard syncGuard;
+    _multiTensorNormalGrad<ElemType><<<(int) chunks.size(), GridDim::maxThreadsPerBlock, 0, t_stream>>>((const MultiTensorUpdateEntry<ElemType>*) d_args,
+                                                                                                     (const MultiTensorUpdateChunk*) (d_args + sizeof(MultiTensorUpdateEntry<ElemType>) * entries.size()),
+                                                                                                     clippingThreshold, momentum, useNesterovMomentum);
+}
+
+template <class ElemType>
+/*static*/ void GPUMatrix<ElemType>::MultiTensorFSAdagrad(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, ElemType adaWeight)
+{
+    const auto chunks = GetMultiTensorUpdateChunks(entries, multiTensorUpdateChunkSize);
+    if (chunks.empty())
+        return;
+
+    PrepareDevice(deviceId);
+    char* d_args = CopyMultiTensorUpdateToDevice(deviceId, entries, chunks);
+    SyncGuard syncGuard;
+    _multiTensorFSAdagrad<ElemType><<<(int) chunks.size(), GridDim::maxThreadsPerBlock, 0, t_stream>>>((const MultiTensorUpdateEntry<ElemType>*) d_args,
+                                                                                                    (const MultiTensorUpdateChunk*) (d_args + sizeof(MultiTensorUpdateEntry<ElemType>) * entries.size()),
+                                                                                                    clippingThreshold, momentum, adaWeight);
+}
+
 template <class ElemType>
 ElemType GPUMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& gradients,
                                       ElemType RMS_GAMMA,
@@ -225,6 +225,9 @@ public:
 
     ElemType Adagrad(GPUMatrix<ElemType>& gradients, const bool needAveMultiplier);
     void FSAdagrad(GPUMatrix<ElemType>& gradients, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul);
+    // fused updates of many parameters with a single kernel launch, cf. CPUMatrix::MultiTensorNormalGrad()
+    static void MultiTensorNormalGrad(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, bool useNesterovMomentum);
+    static void MultiTensorFSAdagrad(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, ElemType adaWeight);
     ElemType RmsProp(GPUMatrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier);
 
     void Reshape(const size_t numRows, const size_t numCols);
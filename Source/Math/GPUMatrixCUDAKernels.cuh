@@ -1453,6 +1453,135 @@ __global__ void _fsadagrad(CUDA_LONG size, ElemType* grad, ElemType* smoothAda,
     }
 }
 
+// fused NormalGrad of many parameters, one thread block per chunk, cf. CPUMatrix::MultiTensorNormalGrad()
+template <class ElemType>
+__global__ void _multiTensorNormalGrad(const MultiTensorUpdateEntry<ElemType>* entries, const MultiTensorUpdateChunk* chunks,
+                                       ElemType threshold, ElemType mom, bool useNesterovMomentum)
+{
+    const MultiTensorUpdateChunk& chunk = chunks[blockIdx.x];
+    const MultiTensorUpdateEntry<ElemType>& entry = entries[chunk.m_entry];
+    const ElemType* grad = entry.m_gradients;
+    ElemType* smoothed = entry.m_smoothedGradients;
+    ElemType* val = entry.m_functionValues;
+    const ElemType lr = (1 - mom) * entry.m_learnRatePerSample;
+    const ElemType l2 = entry.m_l2RegWeight;
+    for (size_t idx = chunk.m_begin + threadIdx.x; idx < chunk.m_end; idx += blockDim.x)
+    {
+        ElemType g = grad[idx];
+        if (g > threshold)
+            g = threshold;
+        else if (g < -threshold)
+            g = -threshold;
+        g += l2 * val[idx];
+
+        ElemType s = lr * g + mom * smoothed[idx];
+        smoothed[idx] = s;
+        val[idx] -= useNesterovMomentum ? mom * s + lr * g : s;
+    }
+}
+
+// fused FSAdaGrad of many parameters, one thread block per chunk, cf. CPUMatrix::MultiTensorFSAdagrad()
+template <class ElemType>
+__global__ void _multiTensorFSAdagrad(const MultiTensorUpdateEntry<ElemType>* entries, const MultiTensorUpdateChunk* chunks,
+                                      ElemType threshold, ElemType mom, ElemType adaWeight)
+{
+    const MultiTensorUpdateChunk& chunk = chunks[blockIdx.x];
+    const MultiTensorUpdateEntry<ElemType>& entry = entries[chunk.m_entry];
+    const ElemType* grad = entry.m_gradients;
+    ElemType* smoothAda = entry.m_smoothedGradients;
+    ElemType* smoothMom = entry.m_smoothedGradients + entry.m_numElements;
+    ElemType* val = entry.m_functionValues;
+    const ElemType lr = entry.m_learnRatePerSample;
+    const ElemType l2 = entry.m_l2RegWeight;
+    const ElemType adaMul = entry.m_adaMul;
+    for (size_t idx = chunk.m_begin + threadIdx.x; idx < chunk.m_end; idx += blockDim.x)
+    {
+        ElemType g = grad[idx];
+        if (g > threshold)
+            g = threshold;
+        else if (g < -threshold)
+            g = -threshold;
+        g += l2 * val[idx];
+
+        ElemType adaSqr = adaWeight * smoothAda[idx] + (1.0f - adaWeight) * g * g;
+        smoothAda[idx] = adaSqr;
+        if (adaSqr != 0.0f)
+        {
+            ElemType w;
+            if (sizeof(ElemType) == sizeof(double))
+            {
+                w = adaMul * rsqrt(adaSqr);
+            }
+            else
+            {
+                w = adaMul * rsqrtf(adaSqr);
+            }
+
+            if (w > 10.0f)
+                w = 10.0f;
+            g *= w;
+        }
+
+        if (mom > 0.0f)
+        {
+            g = mom * smoothMom[idx] + (1.0f - mom) * g;
+            smoothMom[idx] = g;
+        }
+
+        val[idx] -= g * lr;
+    }
+}
+
+// FSAdaGrad for the columns (rows) present in a block sparse gradient, cf. CPUSparseMatrix::FSAdagrad()
+template <class ElemType>
+__global__ void _fsadagrad4BlockSparse(
+    const size_t numRows, // number of rows in the weights and in the gradient
+    const ElemType* grad, // block sparse
+    const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow,
+    const bool colMajor,
+    const size_t len,  // major dim, numRows in colMajor and numcols in rowMajor
+    const CUDA_LONG N, // total number of non-zero values
+    ElemType* smoothAda, ElemType* smoothMom, ElemType* val,
+    ElemType lr, ElemType mom, ElemType adaWeight, ElemType adaMul)
+{
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= N)
+        return;
+
+    CUDA_LONG blockid = id / len;
+    CUDA_LONG row = colMajor ? id - blockid * len : blockId2ColOrRow[blockid];
+    CUDA_LONG col = colMajor ? blockId2ColOrRow[blockid] : id - blockid * len;
+    size_t index = row + col * numRows;
+
+    ElemType g = grad[id];
+    ElemType adaSqr = adaWeight * smoothAda[index] + (1.0f - adaWeight) * g * g;
+    smoothAda[index] = adaSqr;
+    if (adaSqr != 0.0f)
+    {
+        ElemType w;
+        if (sizeof(ElemType) == sizeof(double))
+        {
+            w = adaMul * rsqrt(adaSqr);
+        }
+        else
+        {
+            w = adaMul * rsqrtf(adaSqr);
+        }
+
+        if (w > 10.0f)
+            w = 10.0f;
+        g *= w;
+    }
+
+    if (mom > 0.0f)
+    {
+        g = mom * smoothMom[index] + (1.0f - mom) * g;
+        smoothMom[index] = g;
+    }
+
+    val[index] -= g * lr;
+}
+
 template <class ElemType>
 __global__ void _rmsprop_init(
     ElemType* avars, ElemType* signs, ElemType* steps,
@@ -3131,6 +3260,28 @@ __global__ void _denseMulSparseCSCTransposeToSparseBlockCol(
 }
 
 // gradients update
+// c += alpha * a at the columns (rows) stored in the block sparse c only
+template <class ElemType>
+__global__ void _scaleDenseAndAddToSparseBlock(
+    const ElemType alpha,
+    const ElemType* a,
+    const size_t numRows, // number of rows in a and in c
+    ElemType* c,          // block sparse
+    const GPUSPARSE_INDEX_TYPE* blockId2ColOrRow,
+    const bool colMajor,
+    const size_t len,  // major dim, numRows in colMajor and numcols in rowMajor
+    const CUDA_LONG N) // total number of non-zero values
+{
+    CUDA_LONG id = blockDim.x * blockIdx.x + threadIdx.x;
+    if (id >= N)
+        return;
+
+    CUDA_LONG blockid = id / len;
+    CUDA_LONG row = colMajor ? id - blockid * len : blockId2ColOrRow[blockid];
+    CUDA_LONG col = colMajor ? blockId2ColOrRow[blockid] : id - blockid * len;
+    c[id] += alpha * a[IDX2C(row, col, numRows)];
+}
+
 template <class ElemType>
 __global__ void _scaleSparseBlockAndAddToDense(
     const ElemType alpha,
@@ -165,6 +165,21 @@ void GPUSparseMatrix<ElemType>::SetValue(const CPUSparseMatrix<ElemType>& deepCo
     {
         SetMatrixFromCSCFormat(deepCopy.ColLocation(), deepCopy.RowLocation(), deepCopy.Data(), deepCopy.GetNumElemAllocated(), deepCopy.GetNumRows(), deepCopy.GetNumCols());
     }
+    else if (deepCopy.GetFormat() == matrixFormatSparseBlockCol)
+    {
+        size_t blockSize = deepCopy.NzCount() / deepCopy.GetNumRows();
+        RequireSizeAndAllocate(deepCopy.GetNumRows(), deepCopy.GetNumCols(), deepCopy.NzCount(), true, false);
+
+        PrepareDevice();
+        std::vector<GPUSPARSE_INDEX_TYPE> temp(blockSize);
+        for (size_t i = 0; i < blockSize; ++i)
+            temp[i] = (GPUSPARSE_INDEX_TYPE) deepCopy.BlockIdsLocation()[i];
+        CUDA_CALL(cudaMemcpy(BlockId2ColOrRow(), temp.data(), blockSize * sizeof(GPUSPARSE_INDEX_TYPE), cudaMemcpyHostToDevice));
+
+        SetBlockSize(blockSize);
+
+        CUDA_CALL(cudaMemcpy(Data(), deepCopy.NzValues(), deepCopy.NzSize(), cudaMemcpyHostToDevice));
+    }
     else
         NOT_IMPLEMENTED;
 }
@@ -1369,6 +1384,31 @@ void GPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const GPUSpars
     }
 }
 
+// used for regularizing sparse gradient updates: only the columns (rows) that are present in c are changed
+template <class ElemType>
+void GPUSparseMatrix<ElemType>::ScaleAndAddToBlocks(const ElemType alpha, const GPUMatrix<ElemType>& a, GPUSparseMatrix<ElemType>& c)
+{
+    if (a.GetNumRows() != c.GetNumRows() || a.GetNumCols() != c.GetNumCols())
+        LogicError("ScaleAndAddToBlocks: dimension mismatch");
+
+    if (a.GetComputeDeviceId() != c.GetComputeDeviceId())
+        RuntimeError("GPUSparseMatrix::ScaleAndAddToBlocks: All matrices must be on the same GPU");
+
+    if (c.GetFormat() != matrixFormatSparseBlockCol && c.GetFormat() != matrixFormatSparseBlockRow)
+        NOT_IMPLEMENTED;
+
+    c.VerifyWritable(__func__);
+
+    let nz = c.NzCount();
+    if (nz == 0)
+        return;
+    int blocksPerGrid = (nz + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+    bool colMajor = c.GetFormat() == matrixFormatSparseBlockCol;
+    size_t len = colMajor ? c.GetNumRows() : c.GetNumCols();
+    SyncGuard syncGuard;
+    _scaleDenseAndAddToSparseBlock<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(alpha, a.Data(), a.GetNumRows(), c.Data(), c.BlockId2ColOrRow(), colMajor, len, nz);
+}
+
 template <class ElemType>
 GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceTruncate(const ElemType threshold)
 {
@@ -1489,6 +1529,38 @@ ElemType GPUSparseMatrix<ElemType>::Adagrad(GPUMatrix<ElemType>& c, const bool n
     }
 }
 
+// FSAdaGrad update of the columns (rows) present in the block sparse gradients (this) only, cf. CPUSparseMatrix::FSAdagrad()
+template <class ElemType>
+void GPUSparseMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>& c, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul)
+{
+    VerifyWritable(__func__);
+
+    size_t numColsNeeded = 2 * GetNumCols();
+
+    if (c.IsEmpty() || (c.GetNumCols() < numColsNeeded))
+    {
+        c.RequireSize(GetNumRows(), numColsNeeded);
+        c.SetValue(0.0);
+    }
+
+    assert((c.GetNumRows() == GetNumRows()) && (c.GetNumCols() == numColsNeeded));
+
+    if (GetFormat() != MatrixFormat::matrixFormatSparseBlockCol && GetFormat() != MatrixFormat::matrixFormatSparseBlockRow)
+        NOT_IMPLEMENTED;
+
+    let nz = NzCount();
+    if (nz == 0)
+        return;
+    int blocksPerGrid = (nz + GridDim::maxThreadsPerBlock - 1) / GridDim::maxThreadsPerBlock;
+    bool colMajor = GetFormat() == MatrixFormat::matrixFormatSparseBlockCol;
+    size_t len = colMajor ? GetNumRows() : GetNumCols();
+    size_t n = GetNumRows() * GetNumCols();
+    SyncGuard syncGuard;
+    _fsadagrad4BlockSparse<ElemType><<<blocksPerGrid, GridDim::maxThreadsPerBlock>>>(GetNumRows(), Data(), BlockId2ColOrRow(), colMajor, len, nz,
+                                                                                     c.Data(), c.Data() + n, functionValues.Data(),
+                                                                                     learnRatePerSample, momentum, adaWeight, adaMul);
+}
+
 // sparse X dense = dense
 template <class ElemType>
 void GPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPUSparseMatrix<ElemType>& a, const bool transposeA,
@@ -1320,6 +1320,44 @@ void Matrix<ElemType>::SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYPE* h_CSCC
         { m_GPUSparseMatrix->SetMatrixFromCSCFormat(h_CSCCol, h_Row, h_Val, nz, numRows, numCols, false, -1, transferer); });
 }
 
+template <class ElemType>
+void Matrix<ElemType>::GetSparseBlockColumns(std::vector<size_t>& columnIds, std::vector<ElemType>& values) const
+{
+    if (GetMatrixType() != SPARSE || GetFormat() != matrixFormatSparseBlockCol)
+        LogicError("GetSparseBlockColumns: The matrix is not in sparse block column format.");
+
+    // The GPU block ids are stored as GPUSPARSE_INDEX_TYPE, so going through a CPU copy for both devices.
+    CPUSparseMatrix<ElemType> tempCPUSparseMatrix(matrixFormatSparseBlockCol);
+    const CPUSparseMatrix<ElemType>* cpuSparseMatrix = m_CPUSparseMatrix.get();
+    if (GetDeviceId() >= 0)
+    {
+        m_GPUSparseMatrix->CopyToCPUSparseMatrix(tempCPUSparseMatrix);
+        cpuSparseMatrix = &tempCPUSparseMatrix;
+    }
+
+    size_t numBlocks = (GetNumRows() == 0) ? 0 : cpuSparseMatrix->NzCount() / GetNumRows();
+    columnIds.assign(cpuSparseMatrix->BlockIdsLocation(), cpuSparseMatrix->BlockIdsLocation() + numBlocks);
+    values.assign(cpuSparseMatrix->NzValues(), cpuSparseMatrix->NzValues() + numBlocks * GetNumRows());
+}
+
+template <class ElemType>
+void Matrix<ElemType>::SetMatrixFromSparseBlockColumns(const size_t* columnIds, const ElemType* values, const size_t numBlocks, const size_t numRows, const size_t numCols)
+{
+    if (GetMatrixType() != SPARSE || GetFormat() != matrixFormatSparseBlockCol)
+        LogicError("SetMatrixFromSparseBlockColumns: The matrix is not in sparse block column format.");
+
+    CPUSparseMatrix<ElemType> tempCPUSparseMatrix(matrixFormatSparseBlockCol);
+    CPUSparseMatrix<ElemType>* cpuSparseMatrix = (GetDeviceId() >= 0) ? &tempCPUSparseMatrix : m_CPUSparseMatrix.get();
+
+    cpuSparseMatrix->RequireSizeAndAllocate(numRows, numCols, std::max<size_t>(numBlocks * numRows, 1), true, false);
+    memcpy(cpuSparseMatrix->BlockIdsLocation(), columnIds, numBlocks * sizeof(size_t));
+    memcpy(cpuSparseMatrix->NzValues(), values, numBlocks * numRows * sizeof(ElemType));
+    cpuSparseMatrix->SetBlockSize(numBlocks);
+
+    if (GetDeviceId() >= 0)
+        m_GPUSparseMatrix->SetValue(tempCPUSparseMatrix);
+}
+
 template <class ElemType>
 void Matrix<ElemType>::SetDiagonalValue(const ElemType v)
 {
@@ -1548,9 +1586,105 @@ void Matrix<ElemType>::FSAdagradUpdate(size_t mbSize,
     DISPATCH_MATRIX_ON_FLAG(&gradients, &gradients,
         { m_CPUMatrix->FSAdagrad(*gradients.m_CPUMatrix, *functionValues.m_CPUMatrix, (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum, targetAdagradAvDenom_x_sqrtAdagradSqrFrames); SetDataLocation(CPU); },
         { m_GPUMatrix->FSAdagrad(*gradients.m_GPUMatrix, *functionValues.m_GPUMatrix, (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum, targetAdagradAvDenom_x_sqrtAdagradSqrFrames); SetDataLocation(GPU); },
-        { NOT_IMPLEMENTED; },
-        { NOT_IMPLEMENTED; });
+        { gradients.m_CPUSparseMatrix->FSAdagrad(*m_CPUMatrix, *functionValues.m_CPUMatrix, (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum, targetAdagradAvDenom_x_sqrtAdagradSqrFrames); SetDataLocation(CPU); },
+        { gradients.m_GPUSparseMatrix->FSAdagrad(*m_GPUMatrix, *functionValues.m_GPUMatrix, (ElemType)learnRatePerSample, (ElemType)meanMomentum, (ElemType)varMomentum, targetAdagradAvDenom_x_sqrtAdagradSqrFrames); SetDataLocation(GPU); });
     // Note: Since both 'this' and gradients are changed, we must call SetDataLocation() on 'this' as well.
+    // For block sparse gradients, only the columns present in the gradients are updated.
+}
+
+template <class ElemType>
+/*static*/ DEVICEID_TYPE Matrix<ElemType>::GetMultiTensorUpdateEntries(const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& functionValues,
+                                                                      const std::vector<double>& learnRatesPerSample, const std::vector<double>& l2RegWeights, size_t smoothedGradientsPerElement,
+                                                                      std::vector<MultiTensorUpdateEntry<ElemType>>& entries)
+{
+    size_t numParameters = functionValues.size();
+    if (gradients.size() != numParameters || smoothedGradients.size() != numParameters || learnRatesPerSample.size() != numParameters || l2RegWeights.size() != numParameters)
+        InvalidArgument("MultiTensorUpdate: There must be as many gradients, smoothed gradients, learning rates and regularization weights as parameters.");
+
+    DEVICEID_TYPE deviceId = numParameters > 0 ? functionValues[0]->GetDeviceId() : CPUDEVICE;
+    entries.resize(numParameters);
+    for (size_t k = 0; k < numParameters; k++)
+    {
+        auto& values = *functionValues[k];
+        auto& grad = *gradients[k];
+        auto& smoothed = *smoothedGradients[k];
+        DecideAndMoveToRightDevice(values, grad, smoothed);
+
+        if (values.GetMatrixType() != DENSE || grad.GetMatrixType() != DENSE || smoothed.GetMatrixType() != DENSE)
+            LogicError("MultiTensorUpdate: All matrices must be dense.");
+        if (values.GetDeviceId() != deviceId)
+            LogicError("MultiTensorUpdate: All parameters must be on the same device.");
+        if (grad.GetNumElements() != values.GetNumElements() || smoothed.GetNumElements() != smoothedGradientsPerElement * values.GetNumElements())
+            LogicError("MultiTensorUpdate: The dimensions of the gradients or smoothed gradients do not match the parameter.");
+
+        entries[k] = MultiTensorUpdateEntry<ElemType>{ values.Data(), grad.Data(), smoothed.Data(), values.GetNumElements(),
+                                                       (ElemType) learnRatesPerSample[k], (ElemType) l2RegWeights[k], 0 };
+    }
+    return deviceId;
+}
+
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiTensorNormalGrad(const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& functionValues,
+                                                        const std::vector<double>& learnRatesPerSample, const std::vector<double>& l2RegWeights,
+                                                        const double clippingThreshold, const double momentum, const bool useNAG)
+{
+    std::vector<MultiTensorUpdateEntry<ElemType>> entries;
+    DEVICEID_TYPE deviceId = GetMultiTensorUpdateEntries(smoothedGradients, gradients, functionValues, learnRatesPerSample, l2RegWeights, 1, entries);
+
+    if (deviceId < 0)
+        CPUMatrix<ElemType>::MultiTensorNormalGrad(entries, (ElemType) clippingThreshold, (ElemType) momentum, useNAG);
+    else
+        GPUMatrix<ElemType>::MultiTensorNormalGrad(deviceId, entries, (ElemType) clippingThreshold, (ElemType) momentum, useNAG);
+
+    for (size_t k = 0; k < entries.size(); k++)
+    {
+        functionValues[k]->SetDataLocation(deviceId < 0 ? CPU : GPU, DENSE);
+        smoothedGradients[k]->SetDataLocation(deviceId < 0 ? CPU : GPU, DENSE);
+    }
+}
+
+// Same as FSAdagradUpdate() for every parameter; the AdaGrad normalization of each parameter depends on its own smoothed count.
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::MultiTensorFSAdagradUpdate(size_t mbSize,
+                                                             const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& functionValues,
+                                                             const std::vector<double*>& smoothedCounts, const std::vector<double>& learnRatesPerSample, const std::vector<double>& l2RegWeights,
+                                                             const double clippingThreshold, const double targetAdagradAvDenom, const double meanMomentum, const double varMomentum)
+{
+    if (smoothedCounts.size() != functionValues.size())
+        InvalidArgument("MultiTensorFSAdagradUpdate: There must be as many smoothed counts as parameters.");
+
+    // allocate the AdaGrad and momentum accumulators, like CPUMatrix::FSAdagrad()
+    for (size_t k = 0; k < smoothedGradients.size() && k < gradients.size(); k++)
+    {
+        auto& smoothed = *smoothedGradients[k];
+        auto& grad = *gradients[k];
+        if (smoothed.IsEmpty() || smoothed.GetNumCols() < 2 * grad.GetNumCols())
+        {
+            smoothed.Resize(grad.GetNumRows(), 2 * grad.GetNumCols());
+            smoothed.SetValue(0);
+        }
+    }
+
+    std::vector<MultiTensorUpdateEntry<ElemType>> entries;
+    DEVICEID_TYPE deviceId = GetMultiTensorUpdateEntries(smoothedGradients, gradients, functionValues, learnRatesPerSample, l2RegWeights, 2, entries);
+
+    for (size_t k = 0; k < entries.size(); k++)
+    {
+        double& smoothedCount = *smoothedCounts[k];
+        smoothedCount = varMomentum * smoothedCount + (1.0 - varMomentum) * mbSize;
+        entries[k].m_adaMul = (ElemType)(targetAdagradAvDenom * sqrt(smoothedCount));
+    }
+
+    if (deviceId < 0)
+        CPUMatrix<ElemType>::MultiTensorFSAdagrad(entries, (ElemType) clippingThreshold, (ElemType) meanMomentum, (ElemType) varMomentum);
+    else
+        GPUMatrix<ElemType>::MultiTensorFSAdagrad(deviceId, entries, (ElemType) clippingThreshold, (ElemType) meanMomentum, (ElemType) varMomentum);
+
+    for (size_t k = 0; k < entries.size(); k++)
+    {
+        functionValues[k]->SetDataLocation(deviceId < 0 ? CPU : GPU, DENSE);
+        smoothedGradients[k]->SetDataLocation(deviceId < 0 ? CPU : GPU, DENSE);
+    }
 }
 
 template <class ElemType>
@@ -4704,6 +4838,22 @@ template <class ElemType>
     }
 }
 
+// Used to regularize block sparse gradients without densifying them: the columns (rows) that are absent in c are not touched.
+template <class ElemType>
+/*static*/ void Matrix<ElemType>::ScaleAndAddToSparseBlocks(ElemType alpha, const Matrix<ElemType>& a, Matrix<ElemType>& c)
+{
+    if (a.GetMatrixType() != DENSE || c.GetMatrixType() != SPARSE)
+        LogicError("ScaleAndAddToSparseBlocks: a must be dense and c must be sparse.");
+
+    DecideAndMoveToRightDevice(c, a);
+
+    DISPATCH_MATRIX_ON_FLAG(&c, &c,
+        { NOT_IMPLEMENTED; },
+        { NOT_IMPLEMENTED; },
+        { CPUSparseMatrix<ElemType>::ScaleAndAddToBlocks(alpha, *a.m_CPUMatrix, *c.m_CPUSparseMatrix); },
+        { GPUSparseMatrix<ElemType>::ScaleAndAddToBlocks(alpha, *a.m_GPUMatrix, *c.m_GPUSparseMatrix); });
+}
+
 /// <summary>Matrix-scalar multiply with col-major matrices: c = alpha * a + beta * c</summary>
 /// if a is a column vector, add to all columns of c
 /// if a is a row vector, add to all rows of c
@@ -5362,6 +5512,47 @@ Matrix<ElemType>& Matrix<ElemType>::AssignElementProductOfWithShift(const Matrix
     return *this;
 }
 
+// There is no GPU kernel for the CRF forward pass and the Viterbi decoding; matrices that are not on the CPU are computed on CPU copies.
+template <class ElemType>
+void Matrix<ElemType>::RCRFForwardCompute(const Matrix<ElemType>& pos_scores, const Matrix<ElemType>& pair_scores,
+                                          Matrix<ElemType>& alpha, const int startLbl)
+{
+    if (pos_scores.GetDeviceId() == CPUDEVICE && pair_scores.GetDeviceId() == CPUDEVICE && alpha.GetDeviceId() == CPUDEVICE &&
+        pos_scores.GetMatrixType() == DENSE && pair_scores.GetMatrixType() == DENSE && alpha.GetMatrixType() == DENSE)
+    {
+        alpha.Resize(pos_scores.GetNumRows(), pos_scores.GetNumCols());
+        CPUMatrix<ElemType>::RCRFForwardCompute(*pos_scores.m_CPUMatrix, *pair_scores.m_CPUMatrix, *alpha.m_CPUMatrix, startLbl);
+        return;
+    }
+
+    Matrix<ElemType> cpuPosScores(CPUDEVICE), cpuPairScores(CPUDEVICE), cpuAlpha(CPUDEVICE);
+    cpuPosScores.AssignValuesOf(pos_scores);
+    cpuPairScores.AssignValuesOf(pair_scores);
+    RCRFForwardCompute(cpuPosScores, cpuPairScores, cpuAlpha, startLbl);
+    alpha.AssignValuesOf(cpuAlpha);
+}
+
+template <class ElemType>
+void Matrix<ElemType>::RCRFViterbiCompute(const Matrix<ElemType>& pos_scores, const Matrix<ElemType>& pair_scores,
+                                          Matrix<ElemType>& alpha, Matrix<ElemType>& backtrace, const int startLbl)
+{
+    if (pos_scores.GetDeviceId() == CPUDEVICE && pair_scores.GetDeviceId() == CPUDEVICE && alpha.GetDeviceId() == CPUDEVICE && backtrace.GetDeviceId() == CPUDEVICE &&
+        pos_scores.GetMatrixType() == DENSE && pair_scores.GetMatrixType() == DENSE && alpha.GetMatrixType() == DENSE && backtrace.GetMatrixType() == DENSE)
+    {
+        alpha.Resize(pos_scores.GetNumRows(), pos_scores.GetNumCols());
+        backtrace.Resize(pos_scores.GetNumRows(), pos_scores.GetNumCols());
+        CPUMatrix<ElemType>::RCRFViterbiCompute(*pos_scores.m_CPUMatrix, *pair_scores.m_CPUMatrix, *alpha.m_CPUMatrix, *backtrace.m_CPUMatrix, startLbl);
+        return;
+    }
+
+    Matrix<ElemType> cpuPosScores(CPUDEVICE), cpuPairScores(CPUDEVICE), cpuAlpha(CPUDEVICE), cpuBacktrace(CPUDEVICE);
+    cpuPosScores.AssignValuesOf(pos_scores);
+    cpuPairScores.AssignValuesOf(pair_scores);
+    RCRFViterbiCompute(cpuPosScores, cpuPairScores, cpuAlpha, cpuBacktrace, startLbl);
+    alpha.AssignValuesOf(cpuAlpha);
+    backtrace.AssignValuesOf(cpuBacktrace);
+}
+
 template <class ElemType>
 void Matrix<ElemType>::RCRFBackwardCompute(const Matrix<ElemType>& alpha, Matrix<ElemType>& beta,
                                            Matrix<ElemType>& functionValues, const Matrix<ElemType>& lbls,
@@ -86,6 +86,10 @@ private:
     static void DecideAndMoveToRightDevice(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c);
     static void DecideAndMoveToRightDevice(const Matrix<ElemType>& a, const Matrix<ElemType>& b, const Matrix<ElemType>& c, const Matrix<ElemType>& d);
     static void CopyElementsFromDenseToSparse(CPUMatrix<ElemType>& from, CPUSparseMatrix<ElemType>& dest);
+    // collects the buffers of a multi-tensor update, after moving each parameter's matrices to one device; returns the common device
+    static DEVICEID_TYPE GetMultiTensorUpdateEntries(const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& functionValues,
+                                                     const std::vector<double>& learnRatesPerSample, const std::vector<double>& l2RegWeights, size_t smoothedGradientsPerElement,
+                                                     std::vector<MultiTensorUpdateEntry<ElemType>>& entries);
 
 public:
     // Constructors, destructors and other static matrix builders
@@ -200,6 +204,15 @@ public:
                          const double learnRatePerSample, const double targetAdagradAvDenom,
                          const double meanMomentum, const double varMomentum);
     ElemType RmsProp(Matrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier);
+    // NormalGrad() and FSAdagradUpdate() of many parameters in a single pass over all their elements. All matrices must be dense and on the same device.
+    // The gradients are truncated to +-clippingThreshold (unless infinite) and L2 regularized on the fly, but are not changed themselves.
+    static void MultiTensorNormalGrad(const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& functionValues,
+                                      const std::vector<double>& learnRatesPerSample, const std::vector<double>& l2RegWeights,
+                                      const double clippingThreshold, const double momentum, const bool useNAG);
+    static void MultiTensorFSAdagradUpdate(size_t mbSize,
+                                           const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<Matrix<ElemType>*>& gradients, const std::vector<Matrix<ElemType>*>& functionValues,
+                                           const std::vector<double*>& smoothedCounts, const std::vector<double>& learnRatesPerSample, const std::vector<double>& l2RegWeights,
+                                           const double clippingThreshold, const double targetAdagradAvDenom, const double meanMomentum, const double varMomentum);
 
     void Resize(const size_t numRows, const size_t numCols, const size_t numNZElemToReserve = 10000, bool growOnly = true); // by default we only reallocate if need to grow
     void Resize(const Matrix<ElemType>& other) // TODO: Should this carry over numNZElemToReserve for sparse matrices?
@@ -264,6 +277,11 @@ public:
     void SetMatrixFromCSCFormat(const CPUSPARSE_INDEX_TYPE* h_CSCCol, const CPUSPARSE_INDEX_TYPE* h_Row, const ElemType* h_Val,
         const size_t nz, const size_t numRows, const size_t numCols, DataTransferer* transferer = nullptr);
 
+    // Access to a sparse block column matrix as the ids of its non-zero columns and their values,
+    // numRows values per column, column by column. Used to exchange sparse gradients between workers.
+    void GetSparseBlockColumns(std::vector<size_t>& columnIds, std::vector<ElemType>& values) const;
+    void SetMatrixFromSparseBlockColumns(const size_t* columnIds, const ElemType* values, const size_t numBlocks, const size_t numRows, const size_t numCols);
+
     void MaskColumnsValue(const Matrix<char>& columnsMask, ElemType val);
 
     void SetColumn(const ElemType* colPointer, size_t colInd);
@@ -544,6 +562,8 @@ public:
 
     static void ScaleAndAdd(ElemType alpha, const Matrix<ElemType>& a, Matrix<ElemType>& c);
     static void ScaleAndAdd(ElemType alpha, const Matrix<ElemType>& a, ElemType beta, Matrix<ElemType>& c);
+    // c += alpha * a, but only at the columns (rows) that are present in the block sparse c; c stays sparse
+    static void ScaleAndAddToSparseBlocks(ElemType alpha, const Matrix<ElemType>& a, Matrix<ElemType>& c);
     static void AddScaledDifference(const ElemType alpha, const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& c);
     static void AssignScaledDifference(const ElemType alpha, const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& c);
     static void AddScaledDifference(const Matrix<ElemType>& alpha, const Matrix<ElemType>& a, const Matrix<ElemType>& b, Matrix<ElemType>& c); // c += alpha * (a - b)
@@ -593,6 +613,9 @@ public:
     Matrix<ElemType>& AssignElementProductOfWithShift(const Matrix<ElemType>& a, const Matrix<ElemType>& b, size_t shift);
 
 public:
+    static void RCRFForwardCompute(const Matrix<ElemType>& pos_scores, const Matrix<ElemType>& pair_scores,
+                                   Matrix<ElemType>& alpha, const int startLbl);
+
     static void RCRFBackwardCompute(const Matrix<ElemType>& alpha, Matrix<ElemType>& beta,
                                     Matrix<ElemType>& functionValues, const Matrix<ElemType>& lbls,
                                     const Matrix<ElemType>& pos_scores, const Matrix<ElemType>& pair_scores, const int shift);
@@ -605,6 +628,9 @@ public:
                                     const int startLbl, // the time 0 start symbol in the output layer
                                     const int shift);
 
+    static void RCRFViterbiCompute(const Matrix<ElemType>& pos_scores, const Matrix<ElemType>& pair_scores,
+                                   Matrix<ElemType>& alpha, Matrix<ElemType>& backtrace, const int startLbl);
+
     template <typename T>
     friend class MatrixQuantizer;
 
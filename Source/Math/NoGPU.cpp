@@ -232,6 +232,11 @@ void GPUSparseMatrix<ElemType>::ScaleAndAdd(const ElemType alpha, const GPUSpars
 {
 }
 
+template <class ElemType>
+void GPUSparseMatrix<ElemType>::ScaleAndAddToBlocks(const ElemType alpha, const GPUMatrix<ElemType>& a, GPUSparseMatrix<ElemType>& c)
+{
+}
+
 template <class ElemType>
 GPUSparseMatrix<ElemType>& GPUSparseMatrix<ElemType>::InplaceTruncate(const ElemType threshold)
 {
@@ -248,8 +253,10 @@ ElemType GPUSparseMatrix<ElemType>::Adagrad(GPUMatrix<ElemType>& c, const bool n
 {
     return 1;
 }
-//template<class ElemType>
-//void GPUSparseMatrix<ElemType>::FSAdagrad(CPUMatrix<ElemType>& gradients, CPUMatrix<ElemType>&, ElemType, ElemType, ElemType, ElemType) { }
+template <class ElemType>
+void GPUSparseMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>& c, GPUMatrix<ElemType>& functionValues, ElemType learnRatePerSample, ElemType momentum, ElemType adaWeight, ElemType adaMul)
+{
+}
 
 template <class ElemType>
 void GPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const GPUSparseMatrix<ElemType>& a, const bool transposeA,
@@ -1055,6 +1062,16 @@ void GPUMatrix<ElemType>::FSAdagrad(GPUMatrix<ElemType>& gradients, GPUMatrix<El
 {
 }
 
+template <class ElemType>
+void GPUMatrix<ElemType>::MultiTensorNormalGrad(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, bool useNesterovMomentum)
+{
+}
+
+template <class ElemType>
+void GPUMatrix<ElemType>::MultiTensorFSAdagrad(DEVICEID_TYPE deviceId, const std::vector<MultiTensorUpdateEntry<ElemType>>& entries, ElemType clippingThreshold, ElemType momentum, ElemType adaWeight)
+{
+}
+
 template <class ElemType>
 ElemType GPUMatrix<ElemType>::RmsProp(GPUMatrix<ElemType>& gradients, ElemType RMS_GAMMA, ElemType RMS_WGT_INC, ElemType RMS_WGT_MAX, ElemType RMS_WGT_DEC, ElemType RMS_WGT_MIN, const bool needAveMultiplier)
 {
@@ -2225,6 +2242,7 @@ GPUDataTransferer::GPUDataTransferer(int, bool){}
 GPUDataTransferer::~GPUDataTransferer(){}
 void GPUDataTransferer::CopyGPUToCPUAsync(void*, size_t, void*){}
 void GPUDataTransferer::WaitForCopyGPUToCPUAsync(){}
+bool GPUDataTransferer::IsCopyGPUToCPUAsyncComplete(){ return true; }
 void GPUDataTransferer::CopyCPUToGPUAsync(void*, size_t, void*){}
 void GPUDataTransferer::WaitForCopyCPUToGPUAsync(){}
 
@@ -40,7 +40,8 @@ CNTKTextFormatReader::CNTKTextFormatReader(const ConfigParameters& config)
         {
             // Verbosity is a general config parameter, not specific to the text format reader.
             int verbosity = config(L"verbosity", 0);
-            m_sequenceEnumerator = make_shared<BlockRandomizer>(verbosity, window, m_deserializer, true);
+            bool compressRandomizationWindow = config(L"compressRandomizationWindow", false);
+            m_sequenceEnumerator = make_shared<BlockRandomizer>(verbosity, window, m_deserializer, true, BlockRandomizer::DecimationMode::chunk, false, false, compressRandomizationWindow);
         }
         else
         {
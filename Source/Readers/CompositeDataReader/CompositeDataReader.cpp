@@ -99,7 +99,9 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config) :
         size_t randomizationWindow = config(L"randomizationWindow", requestDataSize);
         // By default using STL random number generator.
         bool useLegacyRandomization = config(L"useLegacyRandomization", false);
-        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, true /* should Prefetch */, BlockRandomizer::DecimationMode::chunk, useLegacyRandomization, multiThreadedDeserialization);
+        // Keeping chunks of the randomization window compressed in memory allows bigger windows for the same memory.
+        bool compressRandomizationWindow = config(L"compressRandomizationWindow", false);
+        m_sequenceEnumerator = std::make_shared<BlockRandomizer>(verbosity, randomizationWindow, deserializer, true /* should Prefetch */, BlockRandomizer::DecimationMode::chunk, useLegacyRandomization, multiThreadedDeserialization, compressRandomizationWindow);
     }
     else
     {
@@ -22,48 +22,6 @@
 #pragma warning(disable : 4996)
 namespace msra { namespace lattices {
 
-// helper to write a symbol hash (string -> int) to a file
-// File has two sections:
-//  - physicalunitname     // line number is mapping, starting with 0
-//  - logunitname physicalunitname   // establishes a mapping; logunitname will get the same numeric index as physicalunitname
-template <class UNITMAP>
-static void writeunitmap(const wstring &symlistpath, const UNITMAP &unitmap)
-{
-    std::vector<std::string> units;
-    units.reserve(unitmap.size());
-    std::vector<std::string> mappings;
-    mappings.reserve(unitmap.size());
-    for (auto iter = unitmap.cbegin(); iter != unitmap.cend(); iter++) // why would 'for (auto iter : unitmap)' not work?
-    {
-        const std::string label = iter->first;
-        const size_t unitid = iter->second;
-        if (units.size() <= unitid)
-            units.resize(unitid + 1); // we grow it on demand; the result must be compact (all entries filled), we check that later
-        if (!units[unitid].empty())   // many-to-one mapping: remember the unit; look it up while writing
-            mappings.push_back(label);
-        else
-            units[unitid] = label;
-    }
-
-    auto_file_ptr flist = fopenOrDie(symlistpath, L"wb");
-    // write (physical) units
-    foreach_index (k, units)
-    {
-        if (units[k].empty())
-            LogicError("build: unitmap has gaps");
-        fprintfOrDie(flist, "%s\n", units[k].c_str());
-    }
-    // write log-phys mappings
-    foreach_index (k, mappings)
-    {
-        const std::string unit = mappings[k];             // logical name
-        const size_t unitid = unitmap.find(unit)->second; // get its unit id; this indexes the units array
-        const std::string tounit = units[unitid];         // and get the name from tehre
-        fprintfOrDie(flist, "%s %s\n", unit.c_str(), tounit.c_str());
-    }
-    fflushOrDie(flist);
-}
-
 // (little helper to do a map::find() with default value)
 template <typename MAPTYPE, typename KEYTYPE, typename VALTYPE>
 static size_t tryfind(const MAPTYPE &map, const KEYTYPE &key, VALTYPE deflt)
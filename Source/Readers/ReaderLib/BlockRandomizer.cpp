@@ -14,6 +14,7 @@
 
 #include "DataReader.h"
 #include "ExceptionCapture.h"
+#include "CompressedChunk.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -24,7 +25,8 @@ BlockRandomizer::BlockRandomizer(
     bool shouldPrefetch,
     DecimationMode decimationMode,
     bool useLegacyRandomization,
-    bool multithreadedGetNextSequence)
+    bool multithreadedGetNextSequence,
+    bool compressChunks)
     : m_verbosity(verbosity),
       m_deserializer(deserializer),
       m_decimationMode(decimationMode),
@@ -35,6 +37,7 @@ BlockRandomizer::BlockRandomizer(
       m_sweepTotalNumberOfSamples(0),
       m_chunkRandomizer(std::make_shared<ChunkRandomizer>(deserializer, randomizationRangeInSamples, useLegacyRandomization)),
       m_multithreadedGetNextSequences(multithreadedGetNextSequence),
+      m_compressChunks(compressChunks),
       m_prefetchedChunk(CHUNKID_MAX)
 {
     assert(deserializer != nullptr);
@@ -296,7 +299,7 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
         if (chunk.m_original->m_id == m_prefetchedChunk && m_prefetch.valid())
         {
             // Taking prefetched chunk.
-            m_chunks[chunk.m_original->m_id] = m_prefetch.get();
+            m_chunks[chunk.m_original->m_id] = CompressChunkIfNeeded(chunk.m_original->m_id, m_prefetch.get());
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in prefetched chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
                 chunk.m_chunkId,
@@ -311,7 +314,7 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_prefetch.wait();
             }
 
-            m_chunks[chunk.m_original->m_id] = m_deserializer->GetChunk(chunk.m_original->m_id);
+            m_chunks[chunk.m_original->m_id] = CompressChunkIfNeeded(chunk.m_original->m_id, m_deserializer->GetChunk(chunk.m_original->m_id));
             if (m_verbosity >= Information)
                 fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: paged in randomized chunk %u (original chunk: %u), now %" PRIu64 " chunks in memory\n",
                 chunk.m_chunkId,
@@ -325,6 +328,45 @@ void BlockRandomizer::LoadDataChunks(const ClosedOpenChunkInterval& windowRange)
                 m_chunks.size(),
                 m_chunkRandomizer->GetRandomizedChunks()[windowRange.m_begin].m_chunkId,
                 m_chunkRandomizer->GetRandomizedChunks()[windowRange.m_end - 1].m_chunkId);
+
+    if (m_compressChunks && m_verbosity >= Notification)
+    {
+        size_t compressedSize = 0, uncompressedSize = 0;
+        for (const auto& c : m_chunks)
+        {
+            auto compressed = std::static_pointer_cast<CompressedChunk>(c.second);
+            compressedSize += compressed->GetCompressedSizeInBytes();
+            uncompressedSize += compressed->GetUncompressedSizeInBytes();
+        }
+
+        fprintf(stderr, "BlockRandomizer::RetrieveDataChunks: chunk window occupies %" PRIu64 " bytes compressed, %" PRIu64 " bytes uncompressed (ratio %.2f)\n",
+                compressedSize,
+                uncompressedSize,
+                compressedSize == 0 ? 1.0 : (double)uncompressedSize / compressedSize);
+    }
+}
+
+// Compresses the chunk if compression of the window is enabled.
+// Compression happens on the main thread after the chunk is paged in, because getting sequence descriptions
+// from the deserializer is not guaranteed to be thread safe with respect to the sequence randomizer.
+ChunkPtr BlockRandomizer::CompressChunkIfNeeded(ChunkIdType chunkId, ChunkPtr chunk)
+{
+    if (!m_compressChunks)
+    {
+        return chunk;
+    }
+
+    std::vector<SequenceDescription> sequences;
+    m_deserializer->GetSequencesForChunk(chunkId, sequences);
+    auto compressed = std::make_shared<CompressedChunk>(chunk, sequences, m_streams, m_multithreadedGetNextSequences);
+
+    if (m_verbosity >= Debug)
+        fprintf(stderr, "BlockRandomizer::CompressChunkIfNeeded: original chunk %u compressed from %" PRIu64 " to %" PRIu64 " bytes\n",
+                chunkId,
+                compressed->GetUncompressedSizeInBytes(),
+                compressed->GetCompressedSizeInBytes());
+
+    return compressed;
 }
 
 // Identifies chunk id that should be prefetched.
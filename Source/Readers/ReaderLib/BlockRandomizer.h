@@ -49,7 +49,8 @@ public:
         bool shouldPrefetch,
         DecimationMode decimationMode = DecimationMode::chunk,
         bool useLegacyRandomization = false,
-        bool multithreadedGetNextSequences = false);
+        bool multithreadedGetNextSequences = false,
+        bool compressChunks = false);
 
     // Starts a new epoch.
     virtual void StartEpoch(const EpochConfiguration& config) override;
@@ -98,6 +99,9 @@ private:
     // Returns next candidate for the prefetch in the given range.
     ChunkIdType GetChunkToPrefetch(const ClosedOpenChunkInterval& windowRange);
 
+    // Compresses the chunk loaded from the deserializer if compression of the window is enabled.
+    ChunkPtr CompressChunkIfNeeded(ChunkIdType chunkId, ChunkPtr chunk);
+
     // Global sample position on the timeline.
     size_t m_globalSamplePosition;
 
@@ -140,6 +144,10 @@ private:
     // TODO temporary; should go away when transformers are moved closer to the deserializer
     bool m_multithreadedGetNextSequences;
 
+    // Whether to keep chunks of the randomization window LZ4 compressed in memory.
+    // Sequences are decompressed on demand in GetNextSequences.
+    bool m_compressChunks;
+
     // General configuration
     // TODO generalize those for ReaderLib / Reader / CNTK
     enum VerbosityLevel
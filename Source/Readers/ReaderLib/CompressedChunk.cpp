@@ -0,0 +1,184 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "CompressedChunk.h"
+#include "Lz4Codec.h"
+#include "ElementTypeUtils.h"
+#include "ExceptionCapture.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Dense sequence that owns its decompressed data.
+struct DecompressedDenseSequenceData : DenseSequenceData
+{
+    const void* GetDataBuffer() override
+    {
+        return m_buffer.data();
+    }
+
+    std::vector<char> m_buffer;
+};
+
+// Sparse sequence that owns its decompressed values and indices.
+struct DecompressedSparseSequenceData : SparseSequenceData
+{
+    const void* GetDataBuffer() override
+    {
+        return m_buffer.data();
+    }
+
+    std::vector<char> m_buffer;
+    std::vector<IndexType> m_indexBuffer;
+};
+
+CompressedChunk::CompressedChunk(
+    ChunkPtr original,
+    const std::vector<SequenceDescription>& sequences,
+    const std::vector<StreamDescriptionPtr>& streams,
+    bool multithreaded)
+    : m_streams(streams),
+      m_compressedSizeInBytes(0),
+      m_uncompressedSizeInBytes(0)
+{
+    assert(original != nullptr);
+
+    m_sequences.resize(sequences.size(), std::vector<CompressedStream>(m_streams.size()));
+    for (size_t i = 0; i < sequences.size(); ++i)
+    {
+        m_sequenceIdToIndex[sequences[i].m_id] = i;
+    }
+
+    auto process = [&](size_t i) -> void {
+        std::vector<SequenceDataPtr> data;
+        original->GetSequence(sequences[i].m_id, data);
+        if (data.size() != m_streams.size())
+        {
+            LogicError("CompressedChunk: expected %d streams, chunk returned %d.", (int)m_streams.size(), (int)data.size());
+        }
+
+        for (size_t j = 0; j < data.size(); ++j)
+        {
+            Compress(data[j], m_streams[j], m_sequences[i][j]);
+        }
+    };
+
+    size_t numSequences = sequences.size();
+    if (multithreaded)
+    {
+        // OpenMP 2.0 (Visual C++) requires a signed loop index.
+        ExceptionCapture capture;
+#pragma omp parallel for schedule(dynamic)
+        for (long long i = 0; i < (long long)numSequences; ++i)
+            capture.SafeRun(process, (size_t)i);
+        capture.RethrowIfHappened();
+    }
+    else
+    {
+        for (size_t i = 0; i < numSequences; ++i)
+            process(i);
+    }
+
+    for (const auto& sequence : m_sequences)
+    {
+        for (const auto& stream : sequence)
+        {
+            m_compressedSizeInBytes += stream.m_data.size();
+            m_uncompressedSizeInBytes += stream.m_uncompressedSize;
+        }
+    }
+}
+
+void CompressedChunk::Compress(const SequenceDataPtr& data, const StreamDescriptionPtr& stream, CompressedStream& result)
+{
+    // Deserializers do not always fill in the layout/type of the sequence, falling back to the stream description.
+    result.m_numberOfSamples = data->m_numberOfSamples;
+    result.m_sampleLayout = data->m_sampleLayout ? data->m_sampleLayout : stream->m_sampleLayout;
+    result.m_elementType = data->m_elementType != ElementType::tvariant ? data->m_elementType : stream->m_elementType;
+
+    size_t elementSize = GetSizeByType(result.m_elementType);
+    const char* values = reinterpret_cast<const char*>(data->GetDataBuffer());
+
+    std::vector<char> shuffled;
+    if (stream->m_storageType == StorageType::dense)
+    {
+        size_t numberOfElements = result.m_sampleLayout->GetNumElements() * result.m_numberOfSamples;
+        shuffled.resize(numberOfElements * elementSize);
+        Lz4Codec::Shuffle(values, elementSize, numberOfElements, shuffled.data());
+    }
+    else if (stream->m_storageType == StorageType::sparse_csc)
+    {
+        auto sparse = static_cast<SparseSequenceData*>(data.get());
+        result.m_nnzCounts = sparse->m_nnzCounts;
+        result.m_totalNnzCount = sparse->m_totalNnzCount;
+
+        size_t valuesSize = result.m_totalNnzCount * elementSize;
+        shuffled.resize(valuesSize + result.m_totalNnzCount * sizeof(IndexType));
+        Lz4Codec::Shuffle(values, elementSize, result.m_totalNnzCount, shuffled.data());
+        Lz4Codec::Shuffle(reinterpret_cast<const char*>(sparse->m_indices), sizeof(IndexType), result.m_totalNnzCount, shuffled.data() + valuesSize);
+    }
+    else
+    {
+        RuntimeError("CompressedChunk: storage type '%d' of stream '%ls' is not supported.", (int)stream->m_storageType, stream->m_name.c_str());
+    }
+
+    result.m_uncompressedSize = shuffled.size();
+    Lz4Codec::Compress(shuffled.data(), shuffled.size(), result.m_data);
+    result.m_data.shrink_to_fit();
+}
+
+SequenceDataPtr CompressedChunk::Decompress(size_t sequenceId, const CompressedStream& compressed, const StreamDescriptionPtr& stream) const
+{
+    size_t elementSize = GetSizeByType(compressed.m_elementType);
+
+    std::vector<char> shuffled(compressed.m_uncompressedSize);
+    Lz4Codec::Decompress(compressed.m_data.data(), compressed.m_data.size(), shuffled.data(), shuffled.size());
+
+    SequenceDataPtr result;
+    if (stream->m_storageType == StorageType::dense)
+    {
+        auto dense = std::make_shared<DecompressedDenseSequenceData>();
+        dense->m_buffer.resize(shuffled.size());
+        Lz4Codec::Unshuffle(shuffled.data(), elementSize, shuffled.size() / elementSize, dense->m_buffer.data());
+        result = dense;
+    }
+    else
+    {
+        auto sparse = std::make_shared<DecompressedSparseSequenceData>();
+        size_t valuesSize = compressed.m_totalNnzCount * elementSize;
+        sparse->m_buffer.resize(valuesSize);
+        Lz4Codec::Unshuffle(shuffled.data(), elementSize, compressed.m_totalNnzCount, sparse->m_buffer.data());
+        sparse->m_indexBuffer.resize(compressed.m_totalNnzCount);
+        Lz4Codec::Unshuffle(shuffled.data() + valuesSize, sizeof(IndexType), compressed.m_totalNnzCount, reinterpret_cast<char*>(sparse->m_indexBuffer.data()));
+        sparse->m_indices = sparse->m_indexBuffer.data();
+        sparse->m_nnzCounts = compressed.m_nnzCounts;
+        sparse->m_totalNnzCount = compressed.m_totalNnzCount;
+        result = sparse;
+    }
+
+    result->m_id = sequenceId;
+    result->m_numberOfSamples = compressed.m_numberOfSamples;
+    result->m_sampleLayout = compressed.m_sampleLayout;
+    result->m_elementType = compressed.m_elementType;
+    return result;
+}
+
+void CompressedChunk::GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result)
+{
+    auto it = m_sequenceIdToIndex.find(sequenceId);
+    if (it == m_sequenceIdToIndex.end())
+    {
+        LogicError("CompressedChunk: sequence %d does not belong to the chunk.", (int)sequenceId);
+    }
+
+    const auto& streams = m_sequences[it->second];
+    for (size_t j = 0; j < streams.size(); ++j)
+    {
+        result.push_back(Decompress(sequenceId, streams[j], m_streams[j]));
+    }
+}
+
+}}}
@@ -0,0 +1,76 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include "DataDeserializer.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// A chunk that keeps the data of all its sequences LZ4 compressed in memory.
+// It is constructed from a chunk provided by a deserializer: all sequences of the original chunk are
+// retrieved, compressed and the original chunk is released. Sequences are decompressed on demand in GetSequence
+// into buffers owned by the returned sequence data, so the chunk can be released independently of them.
+// Used by the BlockRandomizer to trade some CPU for a much larger randomization window per GB of memory.
+// Dense values are byte shuffled before compression, which works well for floating point feature data.
+class CompressedChunk : public Chunk
+{
+public:
+    CompressedChunk(
+        ChunkPtr original,
+        const std::vector<SequenceDescription>& sequences,
+        const std::vector<StreamDescriptionPtr>& streams,
+        bool multithreaded = false);
+
+    // Decompresses the sequence with the given id.
+    virtual void GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result) override;
+
+    // Number of bytes the chunk data occupies in memory.
+    size_t GetCompressedSizeInBytes() const
+    {
+        return m_compressedSizeInBytes;
+    }
+
+    // Number of bytes the chunk data occupies when decompressed.
+    size_t GetUncompressedSizeInBytes() const
+    {
+        return m_uncompressedSizeInBytes;
+    }
+
+private:
+    // Compressed data of a single stream of a sequence.
+    struct CompressedStream
+    {
+        uint32_t m_numberOfSamples;
+        TensorShapePtr m_sampleLayout;
+        ElementType m_elementType;
+        std::vector<IndexType> m_nnzCounts; // Only for sparse streams.
+        IndexType m_totalNnzCount;          // Only for sparse streams.
+        size_t m_uncompressedSize;          // Size of the values (and indices for sparse streams) in bytes.
+        std::vector<char> m_data;
+    };
+
+    void Compress(const SequenceDataPtr& data, const StreamDescriptionPtr& stream, CompressedStream& result);
+    SequenceDataPtr Decompress(size_t sequenceId, const CompressedStream& compressed, const StreamDescriptionPtr& stream) const;
+
+    std::vector<StreamDescriptionPtr> m_streams;
+
+    // Compressed streams of all sequences of the chunk, indexed by the sequence position in the chunk.
+    std::vector<std::vector<CompressedStream>> m_sequences;
+
+    // Mapping from the sequence id into its position in the chunk.
+    std::unordered_map<size_t, size_t> m_sequenceIdToIndex;
+
+    size_t m_compressedSizeInBytes;
+    size_t m_uncompressedSizeInBytes;
+
+    DISABLE_COPY_AND_MOVE(CompressedChunk);
+};
+
+typedef std::shared_ptr<CompressedChunk> CompressedChunkPtr;
+
+}}}
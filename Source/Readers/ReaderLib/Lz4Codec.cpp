@@ -0,0 +1,198 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "Lz4Codec.h"
+#include <cstdint>
+#include <cstring>
+#include "Basics.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Constants of the LZ4 block format.
+static const size_t c_minMatch = 4;         // Minimal length of a match.
+static const size_t c_lastLiterals = 5;     // The last 5 bytes of the block are always literals.
+static const size_t c_matchFindLimit = 12;  // The last match must start at least 12 bytes before the end of the block.
+static const size_t c_maxDistance = 65535;  // Maximal offset of a match.
+static const int c_hashLog = 12;            // Size of the match finder hash table.
+
+static inline uint32_t Read32(const char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - c_hashLog);
+}
+
+// Writes a length that does not fit into the 4 bits of the token as a run of 255s followed by the remainder.
+static inline void WriteLength(size_t length, std::vector<char>& output)
+{
+    while (length >= 255)
+    {
+        output.push_back((char)255);
+        length -= 255;
+    }
+    output.push_back((char)length);
+}
+
+static inline void WriteSequence(const char* literals, size_t literalLength, size_t offset, size_t matchLength, std::vector<char>& output)
+{
+    size_t matchCode = matchLength - c_minMatch;
+    unsigned char token = (unsigned char)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    output.push_back((char)token);
+    if (literalLength >= 15)
+        WriteLength(literalLength - 15, output);
+
+    output.insert(output.end(), literals, literals + literalLength);
+
+    output.push_back((char)(offset & 0xFF));
+    output.push_back((char)(offset >> 8));
+    if (matchCode >= 15)
+        WriteLength(matchCode - 15, output);
+}
+
+static inline void WriteLastLiterals(const char* literals, size_t literalLength, std::vector<char>& output)
+{
+    output.push_back((char)((literalLength < 15 ? literalLength : 15) << 4));
+    if (literalLength >= 15)
+        WriteLength(literalLength - 15, output);
+    output.insert(output.end(), literals, literals + literalLength);
+}
+
+size_t Lz4Codec::Compress(const char* source, size_t size, std::vector<char>& compressed)
+{
+    size_t initialSize = compressed.size();
+    // Worst case: incompressible data plus the length bytes.
+    compressed.reserve(initialSize + size + size / 255 + 16);
+
+    size_t anchor = 0;
+    if (size > c_matchFindLimit)
+    {
+        std::vector<int64_t> table(1 << c_hashLog, -1);
+        size_t matchLimit = size - c_lastLiterals;
+        size_t position = 0;
+        while (position < size - c_matchFindLimit)
+        {
+            uint32_t sequence = Read32(source + position);
+            uint32_t h = Hash(sequence);
+            int64_t candidate = table[h];
+            table[h] = (int64_t)position;
+
+            if (candidate < 0 ||
+                position - (size_t)candidate > c_maxDistance ||
+                Read32(source + candidate) != sequence)
+            {
+                ++position;
+                continue;
+            }
+
+            size_t matchLength = c_minMatch;
+            while (position + matchLength < matchLimit && source[candidate + matchLength] == source[position + matchLength])
+                ++matchLength;
+
+            WriteSequence(source + anchor, position - anchor, position - (size_t)candidate, matchLength, compressed);
+            position += matchLength;
+            anchor = position;
+        }
+    }
+
+    WriteLastLiterals(source + anchor, size - anchor, compressed);
+    return compressed.size() - initialSize;
+}
+
+void Lz4Codec::Decompress(const char* compressed, size_t compressedSize, char* destination, size_t decompressedSize)
+{
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(compressed);
+    const unsigned char* inputEnd = input + compressedSize;
+    size_t position = 0;
+
+    auto readLength = [&](size_t length) -> size_t
+    {
+        if (length != 15)
+            return length;
+
+        unsigned char next;
+        do
+        {
+            if (input >= inputEnd)
+                RuntimeError("Lz4Codec: corrupted block, unexpected end of input while reading a length.");
+            next = *input++;
+            length += next;
+        } while (next == 255);
+        return length;
+    };
+
+    while (input < inputEnd)
+    {
+        unsigned char token = *input++;
+
+        size_t literalLength = readLength(token >> 4);
+        if (literalLength > (size_t)(inputEnd - input) || literalLength > decompressedSize - position)
+            RuntimeError("Lz4Codec: corrupted block, literals are out of bounds.");
+
+        memcpy(destination + position, input, literalLength);
+        input += literalLength;
+        position += literalLength;
+
+        // The last sequence contains only literals.
+        if (input == inputEnd)
+            break;
+
+        if (inputEnd - input < 2)
+            RuntimeError("Lz4Codec: corrupted block, unexpected end of input while reading an offset.");
+
+        size_t offset = input[0] | (input[1] << 8);
+        input += 2;
+        if (offset == 0 || offset > position)
+            RuntimeError("Lz4Codec: corrupted block, invalid match offset %d.", (int)offset);
+
+        size_t matchLength = readLength(token & 0x0F) + c_minMatch;
+        if (matchLength > decompressedSize - position)
+            RuntimeError("Lz4Codec: corrupted block, match is out of bounds.");
+
+        // Matches can overlap with the output, so copying byte by byte unless the regions are disjoint.
+        const char* match = destination + position - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(destination + position, match, matchLength);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; ++i)
+                destination[position + i] = match[i];
+        }
+        position += matchLength;
+    }
+
+    if (position != decompressedSize)
+        RuntimeError("Lz4Codec: corrupted block, decompressed %d bytes instead of expected %d.", (int)position, (int)decompressedSize);
+}
+
+void Lz4Codec::Shuffle(const char* source, size_t elementSize, size_t count, char* destination)
+{
+    for (size_t b = 0; b < elementSize; ++b)
+    {
+        char* plane = destination + b * count;
+        for (size_t i = 0; i < count; ++i)
+            plane[i] = source[i * elementSize + b];
+    }
+}
+
+void Lz4Codec::Unshuffle(const char* source, size_t elementSize, size_t count, char* destination)
+{
+    for (size_t b = 0; b < elementSize; ++b)
+    {
+        const char* plane = source + b * count;
+        for (size_t i = 0; i < count; ++i)
+            destination[i * elementSize + b] = plane[i];
+    }
+}
+
+}}}
@@ -0,0 +1,38 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// A lightweight, dependency free implementation of the LZ4 block format.
+// It is used to keep data in memory compressed (i.e. chunks in the randomization window),
+// so it favors speed of decompression over the compression ratio: the compressor is a simple
+// greedy single-probe hash matcher, the decompressor is a straight copy loop.
+// The produced blocks are compatible with the reference LZ4 block decoder.
+class Lz4Codec
+{
+public:
+    // Compresses 'size' bytes of 'source' and appends the LZ4 block to 'compressed'.
+    // Returns the number of appended bytes.
+    static size_t Compress(const char* source, size_t size, std::vector<char>& compressed);
+
+    // Decompresses an LZ4 block of 'compressedSize' bytes into 'destination'.
+    // The block must decompress into exactly 'decompressedSize' bytes, otherwise an exception is thrown.
+    static void Decompress(const char* compressed, size_t compressedSize, char* destination, size_t decompressedSize);
+
+    // Reorders the bytes of 'count' elements of 'elementSize' bytes each, so that the i-th bytes of all elements
+    // are stored contiguously. This brings together the sign/exponent bytes of floating point values and
+    // considerably improves the compression ratio of dense feature data.
+    static void Shuffle(const char* source, size_t elementSize, size_t count, char* destination);
+
+    // Reverts the Shuffle.
+    static void Unshuffle(const char* source, size_t elementSize, size_t count, char* destination);
+};
+
+}}}
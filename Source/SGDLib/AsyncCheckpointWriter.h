@@ -0,0 +1,75 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "File.h"
+#include "fileutil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Writes checkpoints to disk on a background thread.
+// The caller serializes the model and the checkpoint state into in-memory files (File::CreateInMemory()), which is
+// fast compared to writing to a (network) file system, and hands them over to Write(). Each file is written into a
+// .tmp file next to its destination and renamed on success, so a crash never leaves a corrupted checkpoint behind.
+// At most one write is in flight: Write() waits for the previous one, so at most two snapshots are held in memory
+// (double buffering) and training only stalls if checkpoints are produced faster than they can be written.
+class AsyncCheckpointWriter
+{
+public:
+    AsyncCheckpointWriter()
+    {
+    }
+
+    ~AsyncCheckpointWriter()
+    {
+        try
+        {
+            Wait();
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "AsyncCheckpointWriter: writing the checkpoint failed: %s\n", e.what());
+        }
+    }
+
+    // Writes the in-memory files to their destination paths and afterwards deletes the files in filesToDelete.
+    void Write(std::vector<std::pair<std::shared_ptr<File>, std::wstring>>&& files, std::vector<std::wstring>&& filesToDelete)
+    {
+        Wait();
+
+        m_pendingWrite = std::async(std::launch::async, [](std::vector<std::pair<std::shared_ptr<File>, std::wstring>> files, std::vector<std::wstring> filesToDelete)
+        {
+            for (auto& file : files)
+            {
+                std::wstring tempFileName = file.second + L".tmp";
+                file.first->CopyContentTo(tempFileName);
+                renameOrDie(tempFileName, file.second);
+                file.first.reset(); // release the memory as soon as possible
+            }
+
+            for (const auto& fileName : filesToDelete)
+                _wunlink(fileName.c_str());
+        }, std::move(files), std::move(filesToDelete));
+    }
+
+    // Waits for the write in flight, if any. Rethrows the error of the write if it failed.
+    void Wait()
+    {
+        if (m_pendingWrite.valid())
+            m_pendingWrite.get();
+    }
+
+private:
+    std::future<void> m_pendingWrite;
+
+    DISABLE_COPY_AND_MOVE(AsyncCheckpointWriter);
+};
+
+}}}
@@ -0,0 +1,189 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include "MPIWrapper.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Two level allreduce of CPU buffers:
+//  - the workers of a host reduce their buffers through an MPI shared memory segment, each worker summing up a stripe,
+//  - one leader per host allreduces the host sum with the leaders of the other hosts,
+//  - all workers of the host copy the result back from the shared memory segment.
+// This way every host sends a single copy of the gradients over the network instead of one per worker.
+// Workers are grouped into hosts by MPIWrapper::CurrentNodeName(). For testing on a single machine, the workers
+// of each machine can be split into numLogicalHostsPerMachine logical hosts (round robin by their rank on the machine).
+// The buffers are processed in chunks of chunkSizeInElements, so the shared segment stays small.
+template <class ElemType>
+class HierarchicalAllReducer
+{
+public:
+    HierarchicalAllReducer(const MPIWrapperPtr& mpi, size_t numLogicalHostsPerMachine = 1, size_t chunkSizeInElements = 1024 * 1024)
+        : m_mpi(mpi), m_chunkSize(chunkSizeInElements), m_hostComm(MPI_COMM_NULL), m_leaderComm(MPI_COMM_NULL), m_window(MPI_WIN_NULL)
+    {
+        if (numLogicalHostsPerMachine == 0)
+            InvalidArgument("HierarchicalAllReducer: the number of logical hosts per machine must be positive.");
+        if (m_chunkSize == 0 || m_chunkSize > INT_MAX)
+            InvalidArgument("HierarchicalAllReducer: the chunk size must be positive and at most %d elements.", INT_MAX);
+
+        MPI_Comm comm = m_mpi->Communicator();
+        int rank, size;
+        MPI_Comm_rank(comm, &rank) || MpiFail("MPI_Comm_rank");
+        MPI_Comm_size(comm, &size) || MpiFail("MPI_Comm_size");
+
+        // Group the workers by the name of their machine: the color is the rank of the first worker on the same machine.
+        std::vector<char> names((size_t)size * MPI_MAX_PROCESSOR_NAME, 0);
+        std::string myName = msra::strfun::utf8(m_mpi->CurrentNodeName());
+        strncpy(names.data() + (size_t)rank * MPI_MAX_PROCESSOR_NAME, myName.c_str(), MPI_MAX_PROCESSOR_NAME - 1);
+        MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, names.data(), MPI_MAX_PROCESSOR_NAME, MPI_CHAR, comm) || MpiFail("MPI_Allgather");
+
+        auto sameMachine = [&](int i) { return strncmp(names.data() + (size_t)i * MPI_MAX_PROCESSOR_NAME, names.data() + (size_t)rank * MPI_MAX_PROCESSOR_NAME, MPI_MAX_PROCESSOR_NAME) == 0; };
+        int firstRankOnMachine = rank;
+        int rankOnMachine = 0;
+        for (int i = 0; i < rank; ++i)
+        {
+            if (sameMachine(i))
+            {
+                firstRankOnMachine = std::min(firstRankOnMachine, i);
+                rankOnMachine++;
+            }
+        }
+
+        int color = firstRankOnMachine * (int)numLogicalHostsPerMachine + rankOnMachine % (int)numLogicalHostsPerMachine;
+        MPI_Comm_split(comm, color, rank, &m_hostComm) || MpiFail("MPI_Comm_split");
+        MPI_Comm_rank(m_hostComm, &m_rankOnHost) || MpiFail("MPI_Comm_rank");
+        MPI_Comm_size(m_hostComm, &m_numWorkersOnHost) || MpiFail("MPI_Comm_size");
+
+        // The first worker of each host is its leader.
+        MPI_Comm_split(comm, (m_rankOnHost == 0) ? 0 : MPI_UNDEFINED, rank, &m_leaderComm) || MpiFail("MPI_Comm_split");
+        int numHosts = 0;
+        if (m_rankOnHost == 0)
+            MPI_Comm_size(m_leaderComm, &numHosts) || MpiFail("MPI_Comm_size");
+        MPI_Bcast(&numHosts, 1, MPI_INT, 0, m_hostComm) || MpiFail("MPI_Bcast");
+
+        // Every worker owns a slot of the shared segment; the leader's slot receives the sum.
+        ElemType* mySlot = nullptr;
+        MPI_Win_allocate_shared(m_chunkSize * sizeof(ElemType), sizeof(ElemType), MPI_INFO_NULL, m_hostComm, &mySlot, &m_window) || MpiFail("MPI_Win_allocate_shared");
+        m_slots.resize(m_numWorkersOnHost);
+        for (int i = 0; i < m_numWorkersOnHost; ++i)
+        {
+            MPI_Aint slotSize;
+            int displacementUnit;
+            MPI_Win_shared_query(m_window, i, &slotSize, &displacementUnit, &m_slots[i]) || MpiFail("MPI_Win_shared_query");
+        }
+
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, m_window) || MpiFail("MPI_Win_lock_all");
+
+        if (m_mpi->IsMainNode())
+            fprintf(stderr, "HierarchicalAllReducer: %d workers on %d hosts.\n", size, numHosts);
+    }
+
+    ~HierarchicalAllReducer()
+    {
+        if (m_window != MPI_WIN_NULL)
+        {
+            MPI_Win_unlock_all(m_window);
+            MPI_Win_free(&m_window);
+        }
+
+        if (m_leaderComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_leaderComm);
+
+        if (m_hostComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_hostComm);
+    }
+
+    // Sums up the buffers over all workers in place.
+    // All workers must pass buffers of the same sizes in the same order.
+    void AllReduce(const std::vector<std::pair<ElemType*, size_t>>& buffers)
+    {
+        size_t totalNumElements = 0;
+        for (const auto& buffer : buffers)
+            totalNumElements += buffer.second;
+
+        for (size_t offset = 0; offset < totalNumElements; offset += m_chunkSize)
+        {
+            size_t chunkSize = std::min(m_chunkSize, totalNumElements - offset);
+
+            CopyRange(buffers, offset, chunkSize, m_slots[m_rankOnHost], /*toBuffers=*/false);
+            Synchronize();
+
+            // Each worker sums up its stripe of the chunk over all slots into the leader's slot.
+            size_t stripeBegin = chunkSize * m_rankOnHost / m_numWorkersOnHost;
+            size_t stripeEnd = chunkSize * (m_rankOnHost + 1) / m_numWorkersOnHost;
+            ElemType* sum = m_slots[0];
+            for (int i = 1; i < m_numWorkersOnHost; ++i)
+            {
+                const ElemType* slot = m_slots[i];
+                for (size_t j = stripeBegin; j < stripeEnd; ++j)
+                    sum[j] += slot[j];
+            }
+            Synchronize();
+
+            if (m_leaderComm != MPI_COMM_NULL)
+                MPI_Allreduce(MPI_IN_PLACE, sum, (int)chunkSize, MPIWrapper::GetDataType(sum), MPI_SUM, m_leaderComm) || MpiFail("MPI_Allreduce");
+            Synchronize();
+
+            CopyRange(buffers, offset, chunkSize, sum, /*toBuffers=*/true);
+
+            // The slots are overwritten by the next chunk, so everybody has to be done with the result.
+            Synchronize();
+        }
+    }
+
+private:
+    // Makes the writes to the shared segment visible to the other workers of the host.
+    void Synchronize()
+    {
+        MPI_Win_sync(m_window) || MpiFail("MPI_Win_sync");
+        MPI_Barrier(m_hostComm) || MpiFail("MPI_Barrier");
+        MPI_Win_sync(m_window) || MpiFail("MPI_Win_sync");
+    }
+
+    // Copies the elements [offset, offset + count) of the concatenation of the buffers from or to 'slot'.
+    static void CopyRange(const std::vector<std::pair<ElemType*, size_t>>& buffers, size_t offset, size_t count, ElemType* slot, bool toBuffers)
+    {
+        size_t bufferBegin = 0;
+        for (const auto& buffer : buffers)
+        {
+            size_t bufferEnd = bufferBegin + buffer.second;
+            size_t begin = std::max(offset, bufferBegin);
+            size_t end = std::min(offset + count, bufferEnd);
+            if (begin < end)
+            {
+                ElemType* data = buffer.first + (begin - bufferBegin);
+                ElemType* shared = slot + (begin - offset);
+                if (toBuffers)
+                    memcpy(data, shared, (end - begin) * sizeof(ElemType));
+                else
+                    memcpy(shared, data, (end - begin) * sizeof(ElemType));
+            }
+
+            bufferBegin = bufferEnd;
+            if (bufferBegin >= offset + count)
+                break;
+        }
+    }
+
+    MPIWrapperPtr m_mpi;
+    size_t m_chunkSize;
+
+    MPI_Comm m_hostComm;   // Workers of the same (logical) host.
+    MPI_Comm m_leaderComm; // Leaders of all hosts; MPI_COMM_NULL on the other workers.
+    int m_rankOnHost;
+    int m_numWorkersOnHost;
+
+    MPI_Win m_window;
+    std::vector<ElemType*> m_slots; // Slots of all workers of the host in the shared segment.
+
+    DISABLE_COPY_AND_MOVE(HierarchicalAllReducer);
+};
+
+}}}
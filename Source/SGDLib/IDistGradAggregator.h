@@ -19,6 +19,13 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) = 0;
 
+    // Called during backprop as soon as the gradient is final for the current minibatch.
+    // Aggregators that support it can start exchanging the gradient while the rest of backprop is still running;
+    // AggregateGradients then only completes the aggregation.
+    virtual void OnGradientReady(const Matrix<ElemType>* /*gradient*/)
+    {
+    }
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
@@ -19,6 +19,7 @@
 
 #include "SimpleDistGradAggregator.h"
 #include "V2SimpleDistGradAggregator.h"
+#include "TopKDistGradAggregator.h"
 #include "ProgressTracing.h"
 
 #include <map>
@@ -62,6 +63,10 @@ void SGD<ElemType>::Train(shared_ptr<ComputationNetwork> net, DEVICEID_TYPE devi
     // set tracing flags
     net->EnableNodeTracing(m_traceNodeNamesReal, m_traceNodeNamesCategory, m_traceNodeNamesSparse);
 
+    // this changes the structure of the model that is saved; a network loaded from a checkpoint has been rewritten already
+    if (m_hoistLoopInvariantProjections)
+        net->HoistLoopInvariantProjections<ElemType>();
+
     TrainOrAdaptModel(startEpoch, net, loadNetworkFromCheckpoint, net, nullptr, trainSetDataReader, validationSetDataReader);
 }
 
@@ -629,6 +634,10 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 {
                     // roll back
                     auto bestModelPath = GetModelNameForEpoch(i - m_learnRateAdjustInterval);
+                    // The model might still be written in the background by the main node.
+                    WaitForPendingCheckpoint();
+                    if (m_mpi != nullptr)
+                        m_mpi->WaitAll();
                     LOGPRINTF(stderr, "Loading (rolling back to) previous model with best training-criterion value: %ls.\n", bestModelPath.c_str());
                     net->RereadPersistableParameters<ElemType>(bestModelPath);
                     LoadCheckPointInfo(i - m_learnRateAdjustInterval,
@@ -714,6 +723,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         {
             if (loadedPrevModel)
             {
+                WaitForPendingCheckpoint();
+
                 // If previous best model is loaded, we will first remove epochs that lead to worse results
                 for (int j = 1; j < m_learnRateAdjustInterval; j++)
                 {
@@ -730,11 +741,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             }
             else
             {
-                SaveCheckPointInfo(i, totalTrainingSamplesSeen, learnRatePerSample, smoothedGradients, smoothedCounts, prevCriterion, chosenMinibatchSize);
-                auto modelName = GetModelNameForEpoch(i);
-                if (m_traceLevel > 0)
-                    LOGPRINTF(stderr, "SGD: Saving checkpoint model '%ls'\n", modelName.c_str());
-                net->Save(modelName);
+                vector<wstring> filesToDelete;
                 if (!m_keepCheckPointFiles)
                 {
                     // delete previous checkpoint file to save space
@@ -742,18 +749,20 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                     {
                         if (epochsSinceLastLearnRateAdjust != 1)
                         {
-                            _wunlink(GetCheckPointFileNameForEpoch(i - 1).c_str());
+                            filesToDelete.push_back(GetCheckPointFileNameForEpoch(i - 1));
                         }
                         if (epochsSinceLastLearnRateAdjust == m_learnRateAdjustInterval)
                         {
-                            _wunlink(GetCheckPointFileNameForEpoch(i - m_learnRateAdjustInterval).c_str());
+                            filesToDelete.push_back(GetCheckPointFileNameForEpoch(i - m_learnRateAdjustInterval));
                         }
                     }
                     else
                     {
-                        _wunlink(GetCheckPointFileNameForEpoch(i - 1).c_str());
+                        filesToDelete.push_back(GetCheckPointFileNameForEpoch(i - 1));
                     }
                 }
+
+                SaveCheckPointAndModel(i, net, totalTrainingSamplesSeen, learnRatePerSample, smoothedGradients, smoothedCounts, prevCriterion, chosenMinibatchSize, std::move(filesToDelete));
             }
         }
         else
@@ -773,6 +782,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     }
     // --- END OF MAIN EPOCH LOOP
 
+    WaitForPendingCheckpoint();
+
     // Synchronize all ranks before proceeding to ensure that
     // rank 0 has finished writing the model file
     if (m_mpi != nullptr)
@@ -902,6 +913,15 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 
             if (m_bufferedAsyncGradientAggregation)
                 fprintf(stderr, ", BufferedAsyncGradientAggregation is ENABLED");
+
+            if (m_gradientBucketSizeInBytes > 0)
+                fprintf(stderr, ", overlapped bucketed gradient aggregation is ENABLED");
+
+            if (m_hierarchicalGradientAggregation)
+                fprintf(stderr, ", hierarchical gradient aggregation is ENABLED");
+
+            if (m_topKGradientFraction > 0)
+                fprintf(stderr, ", top-k gradient sparsification (fraction %.6g) is ENABLED", m_topKGradientFraction);
         }
 
         if (useDistributedMBReading)
@@ -1046,7 +1066,19 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 // ===========================================================
 
                 if (learnRatePerSample > 0.01 * m_minLearnRate) // only compute gradient when learning rate is large enough
-                    net->Backprop(criterionNodes[0]);
+                {
+                    // With bucketed aggregation, let the aggregator start exchanging gradients as soon as backprop produced them.
+                    // Not possible with sub-minibatches, since their gradients are accumulated over several backprop passes.
+                    if (useGradientAggregation && m_gradientBucketSizeInBytes > 0 && actualNumSubminibatches == 1)
+                    {
+                        net->Backprop(criterionNodes[0], [this](const ComputationNodeBasePtr& node)
+                        {
+                            m_distGradAgg->OnGradientReady(&dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient());
+                        });
+                    }
+                    else
+                        net->Backprop(criterionNodes[0]);
+                }
 
                 // house-keeping for sub-minibatching
                 if (actualNumSubminibatches > 1)
@@ -1112,6 +1144,26 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                         learnParamsGradients.push_back(currParamsGradient);
                     }
                 }
+
+                // Bucketed aggregation fuses gradients in the order of this list, so it has to be the order in which
+                // backprop produces them, i.e. the reverse evaluation order. It must also be the same on all workers.
+                if (m_gradientBucketSizeInBytes > 0)
+                {
+                    std::unordered_map<const Matrix<ElemType>*, size_t> backpropOrder;
+                    const auto& evalOrder = net->GetEvalOrder(criterionNodes[0]);
+                    size_t position = 0;
+                    for (auto nodeIter = evalOrder.rbegin(); nodeIter != evalOrder.rend(); nodeIter++)
+                    {
+                        auto node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
+                        if (node && node->IsLeaf() && node->NeedsGradient())
+                            backpropOrder[&(node->Gradient())] = position++;
+                    }
+
+                    std::stable_sort(learnParamsGradients.begin(), learnParamsGradients.end(), [&backpropOrder](const Matrix<ElemType>* a, const Matrix<ElemType>* b)
+                    {
+                        return backpropOrder.at(a) < backpropOrder.at(b);
+                    });
+                }
             }
 
             // hoist the criterion into CPU space for all-reduce
@@ -1153,6 +1205,13 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             if (numSamplesInMinibatch != aggregateNumSamples)
                 fprintf(stderr, "SGD: using true #samples %d instead of MB size %d\n", (int)numSamplesInMinibatch, (int)aggregateNumSamples);
 #endif
+            // parameters with dense gradients are collected and updated together after the loop, see UpdateWeightsFused()
+            std::vector<Matrix<ElemType>*> fusedValues, fusedGradients, fusedSmoothedGradients;
+            std::vector<double*> fusedSmoothedCounts;
+            std::vector<double> fusedLearningRates, fusedL2RegWeights;
+            // BUGBUG (Issue #95): Access to net MBLayout can no longer be done if we have multiple input layouts
+            double momentumPerSample = GetMomentumPerSample(epochNumber /*BUGBUG workaround:*/, net->GetMBLayoutPtrOfNetwork()->GetNumParallelSequences());
+
             auto smoothedGradientIter = smoothedGradients.begin();
             auto smoothedCountIter = smoothedCounts.begin();
             for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, smoothedGradientIter++, smoothedCountIter++)
@@ -1166,9 +1225,18 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 #endif
                     double nodeDependentLearningRatePerSample = learnRatePerSample * node->GetLearningRateMultiplier();
                     double nodeDependentRegMultiplier = dynamic_pointer_cast<LearnableParameter<ElemType>>(node)->GetRegMultiplier();
-                    double momentumPerSample = GetMomentumPerSample(epochNumber /*BUGBUG workaround:*/, net->GetMBLayoutPtrOfNetwork()->GetNumParallelSequences());
                     // TODO: Check why l2Factor is not applied to L1. Bug?
-                    // BUGBUG (Issue #95): Access to net MBLayout can no longer be done if we have multiple input layouts
+                    if (CanFuseWeightUpdate(dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient(), m_L1RegWeight * nodeDependentRegMultiplier))
+                    {
+                        fusedValues.push_back(&dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value());
+                        fusedGradients.push_back(&dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient());
+                        fusedSmoothedGradients.push_back(&*smoothedGradientIter);
+                        fusedSmoothedCounts.push_back(&*smoothedCountIter);
+                        fusedLearningRates.push_back(nodeDependentLearningRatePerSample);
+                        fusedL2RegWeights.push_back(m_L2RegWeight * nodeDependentRegMultiplier);
+                        node->BumpEvalTimeStamp();
+                        continue;
+                    }
                     UpdateWeights(dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value(),
                                   dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Gradient(),
                                   *smoothedGradientIter, *smoothedCountIter,
@@ -1183,6 +1251,20 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
 #endif
                 }
             }
+
+            if (!fusedValues.empty())
+            {
+                UpdateWeightsFused(fusedValues, fusedGradients, fusedSmoothedGradients, fusedSmoothedCounts,
+                                   fusedLearningRates, momentumPerSample, numSamplesInMinibatch,
+                                   fusedL2RegWeights, m_useNesterovMomentum);
+#ifdef _DEBUG
+                for (auto value : fusedValues)
+                {
+                    if (value->HasNan("TrainOneEpoch/UpdateWeightsFused(): "))
+                        LogicError("Parameters have NaNs after the fused parameter update.");
+                }
+#endif
+            }
         }
 
         if (m_perfTraceLevel > 0)
@@ -1931,6 +2013,12 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int t
         fprintf(stderr, "Initializing dataParallelSGD for %d-bit quantization.\n", numGradientBits);
 
 #ifdef CNTK_PARALLEL_TRAINING_SUPPORT
+    if (m_gradientBucketSizeInBytes > 0)
+        fprintf(stderr, "WARNING: gradientBucketSizeInMB is not supported with quantized gradient aggregation and will be ignored.\n");
+    if (m_hierarchicalGradientAggregation)
+        fprintf(stderr, "WARNING: useHierarchicalGradientAggregation is not supported with quantized gradient aggregation and will be ignored.\n");
+    if (m_topKGradientFraction > 0)
+        fprintf(stderr, "WARNING: topKGradientFraction is not supported with quantized gradient aggregation and will be ignored.\n");
     m_distGradAgg = std::make_shared<AllReduceDistGradAggregator<ElemType>>(m_mpi, numGradientBits, m_zeroThresholdFor1Bit, true /*useQuantizationForSelfStripe*/, m_bufferedAsyncGradientAggregation, traceLevel, m_syncStatsTrace);
 #else
     if (numGradientBits != (8 * sizeof(ElemType)))
@@ -1938,10 +2026,13 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int t
         RuntimeError("Gradient quantization is unsupported in CNTK binaries built without quantized gradient aggregation support!");
     }
 
-    if (Globals::UseV2Aggregator()) // Currently used to check V2 against baselines.
+    if (m_topKGradientFraction > 0)
+        m_distGradAgg = std::make_shared<TopKDistGradAggregator<ElemType>>(m_mpi, m_topKGradientFraction, m_syncStatsTrace);
+    else if (Globals::UseV2Aggregator()) // Currently used to check V2 against baselines.
         m_distGradAgg = std::make_shared<V2SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace, ::CNTK::MPICommunicator());
     else
-        m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace);
+        m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace, m_gradientBucketSizeInBytes, m_sparseGradientDensityThreshold,
+                                                                                   m_hierarchicalGradientAggregation, m_numLogicalHostsPerMachine, m_hierarchicalAggregationChunkSize);
 #endif // !CNTK_PARALLEL_TRAINING_SUPPORT
 
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
@@ -2011,11 +2102,19 @@ void SGD<ElemType>::UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemT
         sgdUpdateNoise.SetGaussianRandomValue(0, (ElemType) noiseStd);
     }
 
+    // Block sparse gradients (e.g. of embeddings) only hold the columns that are present in the minibatch.
+    // They are regularized and updated lazily, i.e. only at those columns, so that an update costs O(minibatch) rather than O(vocabulary).
+    const bool isBlockSparse = gradientValues.GetMatrixType() == MatrixType::SPARSE &&
+                               (gradientValues.GetFormat() == matrixFormatSparseBlockCol || gradientValues.GetFormat() == matrixFormatSparseBlockRow);
+
     // L2 regularizer
     if (L2RegWeight > 0)
     {
         // multiply by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
-        Matrix<ElemType>::ScaleAndAdd((ElemType)(L2RegWeight * actualMBSize), functionValues, gradientValues);
+        if (isBlockSparse)
+            Matrix<ElemType>::ScaleAndAddToSparseBlocks((ElemType)(L2RegWeight * actualMBSize), functionValues, gradientValues);
+        else
+            Matrix<ElemType>::ScaleAndAdd((ElemType)(L2RegWeight * actualMBSize), functionValues, gradientValues);
     }
 
     if (adpType == GradientsUpdateType::None)
@@ -2025,9 +2124,9 @@ void SGD<ElemType>::UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemT
     }
     else if (adpType == GradientsUpdateType::AdaGrad ||
              (adpType == GradientsUpdateType::RmsProp && gradientValues.GetMatrixType() == MatrixType::SPARSE) ||
-             (adpType == GradientsUpdateType::FSAdaGrad && gradientValues.GetMatrixType() == MatrixType::SPARSE))
+             (adpType == GradientsUpdateType::FSAdaGrad && gradientValues.GetMatrixType() == MatrixType::SPARSE && !isBlockSparse))
     {
-        // rmsprop for sparse is not implemented yet, delegate it with adagrad
+        // rmsprop for sparse and fsadagrad for non-block sparse are not implemented yet, delegate them with adagrad
 
         double aveMultiplier = smoothedGradient.Adagrad(gradientValues, needAveMultiplier);
         Matrix<ElemType>::ScaleAndAdd((ElemType)(-learnRatePerSample / aveMultiplier), gradientValues, functionValues);
@@ -2070,6 +2169,57 @@ void SGD<ElemType>::UpdateWeights(Matrix<ElemType>& functionValues, Matrix<ElemT
 }
 
 // protected:
+template <class ElemType>
+bool SGD<ElemType>::CanFuseWeightUpdate(const Matrix<ElemType>& gradientValues, const double L1RegWeight) const
+{
+    // AdaGrad and RmsProp normalize by averages over whole parameters, as does clipping by the norm; noise and L1 are extra passes
+    GradientsUpdateType adpType = GradUpdateType();
+    return m_fuseParameterUpdates &&
+           (adpType == GradientsUpdateType::None || adpType == GradientsUpdateType::FSAdaGrad) &&
+           gradientValues.GetMatrixType() == MatrixType::DENSE &&
+           (m_clippingThresholdPerSample == numeric_limits<double>::infinity() || m_gradientClippingWithTruncation) &&
+           GradientUpdateNoiseStd() == 0 &&
+           L1RegWeight == 0;
+}
+
+// Same as UpdateWeights() for each parameter, but the per-parameter calls of several element-wise operations are
+// replaced by a single pass over the elements of all parameters, which reads gradient, smoothed gradient and value once.
+// For models with many small parameters, this removes most of the per-call overhead. The gradients are not clipped in place.
+template <class ElemType>
+void SGD<ElemType>::UpdateWeightsFused(const std::vector<Matrix<ElemType>*>& functionValues, const std::vector<Matrix<ElemType>*>& gradientValues,
+                                       const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<double*>& smoothedCounts,
+                                       const std::vector<double>& learnRatesPerSample, const double momentumPerSample,
+                                       size_t actualMBSize,
+                                       const std::vector<double>& L2RegWeights,
+                                       const bool useNesterovMomentum) const
+{
+    // we use simple linear (instead of log linear) exponentiation here
+    const double momentum = MomentumPerMB(momentumPerSample, actualMBSize);
+
+    // make actualMBSize is a valid value
+    assert(actualMBSize > 0);
+
+    // multiply by actualMBSize so that it's invariant to minibatch size since learning rate is per sample
+    const double maxGradientPerMB = m_clippingThresholdPerSample * actualMBSize;
+    std::vector<double> L2RegWeightsPerMB(L2RegWeights.size());
+    for (size_t k = 0; k < L2RegWeights.size(); k++)
+        L2RegWeightsPerMB[k] = L2RegWeights[k] * actualMBSize;
+
+    if (GradUpdateType() == GradientsUpdateType::FSAdaGrad)
+    {
+        const double varMomentum = (exp(-1.0 * actualMBSize / m_gradType.varianceTimeConstant));
+        Matrix<ElemType>::MultiTensorFSAdagradUpdate(actualMBSize, smoothedGradients, gradientValues, functionValues, smoothedCounts,
+                                                     learnRatesPerSample, L2RegWeightsPerMB, maxGradientPerMB,
+                                                     m_gradType.targetAdagradAvDenom, momentum, varMomentum);
+    }
+    else
+    {
+        Matrix<ElemType>::MultiTensorNormalGrad(smoothedGradients, gradientValues, functionValues,
+                                                learnRatesPerSample, L2RegWeightsPerMB, maxGradientPerMB,
+                                                momentum, useNesterovMomentum);
+    }
+}
+
 template <class ElemType>
 void SGD<ElemType>::ClipGradient(Matrix<ElemType>& gradient, const size_t actualMBSize) const
 {
@@ -2110,46 +2260,99 @@ void SGD<ElemType>::SaveCheckPointInfo(const size_t epoch, const size_t totalSam
 
         {
             File fstream(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BVersion"); 
-            fstream << (size_t)CURRENT_CNTK_CHECKPOINT_VERSION; 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
+            SaveCheckPointInfo(fstream, totalSamplesSeen, learnRatePerSample, smoothedGradients, smoothedCounts, prevCriterion, minibatchSize);
+        }
 
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCKP");
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BLearnRate");
-            fstream << totalSamplesSeen << learnRatePerSample << prevCriterion;
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ELearnRate");
+        _wunlink(checkPointFileName.c_str());
+        renameOrDie(tempFileName, checkPointFileName);
+    }
+}
 
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BMinibatchSize");
-            fstream << minibatchSize;
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EMinibatchSize");
+template <class ElemType>
+void SGD<ElemType>::SaveCheckPointInfo(File& fstream, const size_t totalSamplesSeen,
+                                       const double learnRatePerSample,
+                                       const std::list<Matrix<ElemType>>& smoothedGradients,
+                                       const std::vector<double>& smoothedCounts,
+                                       const double prevCriterion,
+                                       const size_t minibatchSize)
+{
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BVersion"); 
+    fstream << (size_t)CURRENT_CNTK_CHECKPOINT_VERSION; 
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
 
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BGradient");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCKP");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BLearnRate");
+    fstream << totalSamplesSeen << learnRatePerSample << prevCriterion;
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ELearnRate");
 
-            for (auto smoothedGradientIter = smoothedGradients.begin(); smoothedGradientIter != smoothedGradients.end(); smoothedGradientIter++)
-            {
-                const Matrix<ElemType>& smoothedGradient = *smoothedGradientIter;
-                fstream << smoothedGradient;
-            }
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BMinibatchSize");
+    fstream << minibatchSize;
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EMinibatchSize");
 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EGradient");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BGradient");
 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"BCount");
+    for (auto smoothedGradientIter = smoothedGradients.begin(); smoothedGradientIter != smoothedGradients.end(); smoothedGradientIter++)
+    {
+        const Matrix<ElemType>& smoothedGradient = *smoothedGradientIter;
+        fstream << smoothedGradient;
+    }
 
-            for (auto sc : smoothedCounts)
-                fstream << sc;
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EGradient");
 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECount");
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"BCount");
 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECKP");
-            if (m_pMASGDHelper)
-                m_pMASGDHelper->SaveToCheckPoint(fstream);
-            // Ensuring that data is written
-            fstream.Flush();
-        }
+    for (auto sc : smoothedCounts)
+        fstream << sc;
 
-        _wunlink(checkPointFileName.c_str());
-        renameOrDie(tempFileName, checkPointFileName);
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECount");
+
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECKP");
+    if (m_pMASGDHelper)
+        m_pMASGDHelper->SaveToCheckPoint(fstream);
+    // Ensuring that data is written
+    fstream.Flush();
+}
+
+template <class ElemType>
+void SGD<ElemType>::SaveCheckPointAndModel(const size_t epoch, const ComputationNetworkPtr& net, const size_t totalSamplesSeen,
+                                           const double learnRatePerSample,
+                                           const std::list<Matrix<ElemType>>& smoothedGradients,
+                                           const std::vector<double>& smoothedCounts,
+                                           const double prevCriterion,
+                                           const size_t minibatchSize,
+                                           std::vector<std::wstring>&& filesToDelete)
+{
+    auto modelName = GetModelNameForEpoch(int(epoch));
+    if (m_asyncCheckpointing)
+    {
+        // Snapshot the checkpoint and the model into host memory, the files are written in the background.
+        std::shared_ptr<File> checkPoint = File::CreateInMemory();
+        SaveCheckPointInfo(*checkPoint, totalSamplesSeen, learnRatePerSample, smoothedGradients, smoothedCounts, prevCriterion, minibatchSize);
+        std::shared_ptr<File> model = File::CreateInMemory();
+        net->Save(*model);
+        if (m_traceLevel > 0)
+            LOGPRINTF(stderr, "SGD: Saving checkpoint model '%ls' in the background\n", modelName.c_str());
+
+        if (!m_checkpointWriter)
+            m_checkpointWriter = make_shared<AsyncCheckpointWriter>();
+        m_checkpointWriter->Write({ { checkPoint, GetCheckPointFileNameForEpoch(int(epoch)) }, { model, modelName } }, std::move(filesToDelete));
     }
+    else
+    {
+        SaveCheckPointInfo(epoch, totalSamplesSeen, learnRatePerSample, smoothedGradients, smoothedCounts, prevCriterion, minibatchSize);
+        if (m_traceLevel > 0)
+            LOGPRINTF(stderr, "SGD: Saving checkpoint model '%ls'\n", modelName.c_str());
+        net->Save(modelName);
+        for (const auto& fileName : filesToDelete)
+            _wunlink(fileName.c_str());
+    }
+}
+
+template <class ElemType>
+void SGD<ElemType>::WaitForPendingCheckpoint()
+{
+    if (m_checkpointWriter)
+        m_checkpointWriter->Wait();
 }
 
 template <class ElemType>
@@ -2564,6 +2767,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_needAveMultiplier = configSGD(L"normWithAveMultiplier", true);
     m_L2RegWeight = configSGD(L"L2RegWeight", 0.0);
     m_L1RegWeight = configSGD(L"L1RegWeight", 0.0);
+    m_fuseParameterUpdates = configSGD(L"fuseParameterUpdates", true);
 
     // for backward support. future setups should use gradUpdateType='AdaGrad', instead of useAdagrad=true
     if (configSGD(L"useAdagrad", false))
@@ -2686,6 +2890,12 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = vector<int>{8 * (int)sizeofElemType}; // means no quantization
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_gradientBucketSizeInBytes = 0;
+    m_sparseGradientDensityThreshold = 0.5;
+    m_hierarchicalGradientAggregation = false;
+    m_numLogicalHostsPerMachine = 1;
+    m_hierarchicalAggregationChunkSize = 1024 * 1024;
+    m_topKGradientFraction = 0;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
@@ -2719,6 +2929,29 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_numGradientBits = configDataParallelSGD(L"gradientBits", ConfigRecordType::Array(intargvector(vector<int>{defaultGradientBits})));
             m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
             m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+            double gradientBucketSizeInMB = configDataParallelSGD(L"gradientBucketSizeInMB", 0.0);
+            if (gradientBucketSizeInMB < 0)
+                InvalidArgument("gradientBucketSizeInMB must be non-negative.");
+            if (gradientBucketSizeInMB > 0 && m_bufferedAsyncGradientAggregation)
+                InvalidArgument("gradientBucketSizeInMB cannot be combined with useBufferedAsyncGradientAggregation.");
+            m_gradientBucketSizeInBytes = (size_t)(gradientBucketSizeInMB * 1024 * 1024);
+            m_sparseGradientDensityThreshold = configDataParallelSGD(L"sparseGradientDensityThreshold", 0.5);
+            if (m_sparseGradientDensityThreshold < 0)
+                InvalidArgument("sparseGradientDensityThreshold must be non-negative.");
+            m_hierarchicalGradientAggregation = configDataParallelSGD(L"useHierarchicalGradientAggregation", false);
+            if (m_hierarchicalGradientAggregation && m_gradientBucketSizeInBytes > 0)
+                InvalidArgument("useHierarchicalGradientAggregation cannot be combined with gradientBucketSizeInMB.");
+            m_numLogicalHostsPerMachine = configDataParallelSGD(L"numLogicalHostsPerMachine", (size_t)1);
+            if (m_numLogicalHostsPerMachine == 0)
+                InvalidArgument("numLogicalHostsPerMachine must be positive.");
+            m_hierarchicalAggregationChunkSize = configDataParallelSGD(L"hierarchicalAggregationChunkSize", (size_t)1024 * 1024);
+            if (m_hierarchicalAggregationChunkSize == 0 || m_hierarchicalAggregationChunkSize > INT_MAX)
+                InvalidArgument("hierarchicalAggregationChunkSize must be positive and at most %d.", INT_MAX);
+            m_topKGradientFraction = configDataParallelSGD(L"topKGradientFraction", 0.0);
+            if (m_topKGradientFraction < 0 || m_topKGradientFraction > 1)
+                InvalidArgument("topKGradientFraction must be in the range [0, 1].");
+            if (m_topKGradientFraction > 0 && (m_bufferedAsyncGradientAggregation || m_gradientBucketSizeInBytes > 0 || m_hierarchicalGradientAggregation))
+                InvalidArgument("topKGradientFraction cannot be combined with useBufferedAsyncGradientAggregation, gradientBucketSizeInMB or useHierarchicalGradientAggregation.");
             for (size_t i = 0; i < m_numGradientBits.size(); i++)
             {
                 if (m_numGradientBits[i] < 1 || m_numGradientBits[i] > defaultGradientBits)
@@ -19,6 +19,7 @@
 #include <random>
 #include "Profiler.h"
 #include "MASGD.h"
+#include "AsyncCheckpointWriter.h"
 
 using namespace std; // ugh! TODO: get rid of this from .h files!!!
 
@@ -274,6 +275,18 @@ protected:
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    // if not 0, gradients are fused into buckets of this size that are aggregated while backprop is still running
+    size_t m_gradientBucketSizeInBytes;
+    // sparse block column gradients are exchanged as their touched columns if these make up at most this fraction of the columns (summed over all workers)
+    double m_sparseGradientDensityThreshold;
+    // if true, gradients are reduced within each host through shared memory before they are reduced across hosts
+    bool m_hierarchicalGradientAggregation;
+    // splits each machine into this many logical hosts for hierarchical aggregation (for testing on a single machine)
+    size_t m_numLogicalHostsPerMachine;
+    // number of gradient elements reduced at a time by hierarchical aggregation, which is the size of the shared memory segment of each worker
+    size_t m_hierarchicalAggregationChunkSize;
+    // if not 0, only this fraction of the entries of each gradient (the largest ones) is exchanged, the rest is carried over to the next minibatch
+    double m_topKGradientFraction;
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
@@ -286,6 +299,9 @@ protected:
     double m_L2RegWeight;
     double m_L1RegWeight;
 
+    // update all parameters with dense gradients in a single pass (momentum SGD and FSAdaGrad), see SGD::UpdateWeightsFused()
+    bool m_fuseParameterUpdates;
+
     // sequence training
     double m_hSmoothingWeight;
     double m_frameDropThresh;
@@ -326,6 +342,8 @@ public:
           // TODO: The next few do not belong into SGD any more than the network or reader we operate on. Either move network and reader in here, or move these out.
           m_modelPath((const wstring&) configSGD(L"modelPath")),
           m_keepCheckPointFiles(configSGD(L"keepCheckPointFiles", false)),
+          m_asyncCheckpointing(configSGD(L"asyncCheckpointing", false)),
+          m_hoistLoopInvariantProjections(configSGD(L"hoistLoopInvariantProjections", false)),
           m_trainCriterionNodeName((const wstring&) configSGD(L"trainCriterionNodeName", L"")),
           m_evalCriterionNodeName ((const wstring&) configSGD(L"evalCriterionNodeName", L"")),
           m_traceNodeNamesReal    (configSGD(L"traceNodeNamesReal",     ConfigRecordType::Array(stringargvector()))),
@@ -491,6 +509,16 @@ public:
                        const double L2RegWeight, const double L1RegWeight,
                        const bool needAveMultiplier,
                        const bool useNesterovMomentum) const;
+    // Whether a parameter can be updated by UpdateWeightsFused() rather than by UpdateWeights(), i.e. whether all steps
+    // of UpdateWeights() for it are element-wise.
+    bool CanFuseWeightUpdate(const Matrix<ElemType>& gradientValues, const double L1RegWeight) const;
+    // UpdateWeights() of many parameters in a single pass over their elements
+    void UpdateWeightsFused(const std::vector<Matrix<ElemType>*>& functionValues, const std::vector<Matrix<ElemType>*>& gradientValues,
+                            const std::vector<Matrix<ElemType>*>& smoothedGradients, const std::vector<double*>& smoothedCounts,
+                            const std::vector<double>& learnRatesPerSample, const double momentumPerSample,
+                            size_t actualMBSize,
+                            const std::vector<double>& L2RegWeights,
+                            const bool useNesterovMomentum) const;
     // return -1 if nothing exists
     int DetermineStartEpoch(const bool makeMode);
 
@@ -505,6 +533,26 @@ protected:
                             const std::vector<double>& smoothedCounts,
                             const double prevCriterion,
                             const size_t minibatchSize);
+    void SaveCheckPointInfo(File& fstream, const size_t totalSamplesSeen,
+                            const double learnRatePerSample,
+                            const std::list<Matrix<ElemType>>& smoothedGradients,
+                            const std::vector<double>& smoothedCounts,
+                            const double prevCriterion,
+                            const size_t minibatchSize);
+
+    // saves the checkpoint and the model of the epoch, then deletes filesToDelete;
+    // with m_asyncCheckpointing, they are snapshotted into memory and written to disk by m_checkpointWriter in the background
+    void SaveCheckPointAndModel(const size_t epoch, const ComputationNetworkPtr& net, const size_t totalSamplesSeen,
+                                const double learnRatePerSample,
+                                const std::list<Matrix<ElemType>>& smoothedGradients,
+                                const std::vector<double>& smoothedCounts,
+                                const double prevCriterion,
+                                const size_t minibatchSize,
+                                std::vector<std::wstring>&& filesToDelete);
+
+    // waits until the checkpoint that is written in the background (if any) is on disk
+    // rethrows the error if writing it failed
+    void WaitForPendingCheckpoint();
 
     bool TryLoadCheckPointInfo(const size_t epochNumber,
                                /*out*/ size_t& totalSamplesSeen,
@@ -543,6 +591,11 @@ public:
 protected:
     std::wstring m_modelPath;
     bool m_keepCheckPointFiles;
+    // if true, the main node serializes checkpoints into memory and writes them to disk on a background thread
+    bool m_asyncCheckpointing;
+    std::shared_ptr<AsyncCheckpointWriter> m_checkpointWriter;
+    // if true, products of recurrent loops with inputs from outside the loop are computed outside of it (see ComputationNetwork::HoistLoopInvariantProjections())
+    bool m_hoistLoopInvariantProjections;
 
     std::wstring m_trainCriterionNodeName;
     std::wstring m_evalCriterionNodeName;
@@ -2,22 +2,49 @@
 
 #include "IDistGradAggregator.h"
 #include "CUDAPageLockedMemAllocator.h"
+#include <deque>
 #include <future>
+#include <numeric>
+#include <unordered_map>
 #include "GPUDataTransferer.h"
 #include "TimerUtility.h"
 #include "MatrixQuantizerImpl.h"
+#include "HierarchicalAllReducer.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+namespace Test { template <class ElemType> struct SimpleDistGradAggregatorTest; }
+
 template <class ElemType>
 class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
 {
     UsingIDistGradAggregatorMembers;
+    friend Test::SimpleDistGradAggregatorTest<ElemType>;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int syncStatsTrace)
-        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
-    {}
+    // If gradientBucketSizeInBytes is not 0, gradients are fused into buckets of at least this size, in the order in which they
+    // are passed to AggregateGradients. A bucket is copied into a fused buffer as soon as all its gradients are reported through
+    // OnGradientReady, and its allreduce is started once the copy is done, so the caller should pass the gradients in the order
+    // backprop produces them.
+    // Gradients in sparse block column format are exchanged as their touched columns as long as the columns touched by all workers
+    // make up at most sparseGradientDensityThreshold of the columns of the gradient, otherwise they are reduced densely.
+    // If useHierarchicalAggregation is set, dense gradients are first reduced within each host through shared memory and only
+    // one worker per host takes part in the allreduce across hosts (see HierarchicalAllReducer).
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int syncStatsTrace, size_t gradientBucketSizeInBytes = 0, double sparseGradientDensityThreshold = 0.5,
+                             bool useHierarchicalAggregation = false, size_t numLogicalHostsPerMachine = 1, size_t hierarchicalAggregationChunkSize = 1024 * 1024)
+        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0),
+          m_gradientBucketSizeInBytes(gradientBucketSizeInBytes), m_sparseGradientDensityThreshold(sparseGradientDensityThreshold), m_maxMPICount(INT_MAX)
+    {
+        if (m_useAsyncAggregation && m_gradientBucketSizeInBytes > 0)
+            InvalidArgument("Bucketed gradient aggregation cannot be combined with buffered async gradient aggregation.");
+
+        if (useHierarchicalAggregation)
+        {
+            if (m_gradientBucketSizeInBytes > 0)
+                InvalidArgument("Bucketed gradient aggregation cannot be combined with hierarchical gradient aggregation.");
+            m_hierarchicalAllReducer.reset(new HierarchicalAllReducer<ElemType>(mpi, numLogicalHostsPerMachine, hierarchicalAggregationChunkSize));
+        }
+    }
 
     ~SimpleDistGradAggregator()
     {
@@ -116,7 +143,197 @@ public:
         }
     }
 
+    // Starts copying the bucket of the gradient into its fused buffer, if this was the last gradient of the bucket not ready yet,
+    // and starts the allreduce of the buckets whose copies have completed. This is called during backprop, so it never blocks
+    // on the GPU: the allreduce of a bucket whose copies are still running is started by a later call or after backprop.
+    void OnGradientReady(const Matrix<ElemType>* gradient) override
+    {
+        // Before the first aggregation the buckets are not known yet, the gradients are aggregated in AggregateGradients.
+        if (!m_initialized || m_gradientBucketSizeInBytes == 0)
+            return;
+
+        auto it = m_gradientIndices.find(gradient);
+        if (it == m_gradientIndices.end() || m_gradientReady[it->second])
+            return;
+
+        m_gradientReady[it->second] = true;
+        size_t bucketIndex = m_gradientBuckets[it->second];
+        if (--m_buckets[bucketIndex].m_numPendingGradients == 0)
+            CopyBucket(bucketIndex);
+
+        LaunchCopiedBuckets(/*waitForCopies=*/false);
+    }
+
 private:
+    // A group of gradients that is reduced with a single allreduce over a fused buffer.
+    struct GradientBucket
+    {
+        std::vector<size_t> m_gradients;  // Indices of the gradients in the bucket.
+        std::vector<size_t> m_offsets;    // Offsets of the gradients in the fused buffer.
+        size_t m_numElements;
+        std::shared_ptr<ElemType> m_buffer;
+        size_t m_numPendingGradients;     // Number of gradients of the current minibatch that are not ready yet.
+        bool m_copied;                    // Whether the copies of the gradients into the buffer were started.
+        bool m_launched;                  // Whether the allreduce of the buffer was started.
+        MPI_Request m_request;
+    };
+
+    void InitializeBuckets(const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        int deviceId = gradients[0]->GetDeviceId();
+        m_bucketedGradients = gradients;
+        m_gradientReady.assign(gradients.size(), false);
+        m_gradientBuckets.resize(gradients.size());
+
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            // Sparse gradients are aggregated separately after backprop.
+            if (m_isSparseGradient[i])
+                continue;
+
+            m_gradientIndices[gradients[i]] = i;
+
+            if (m_buckets.empty() || m_buckets.back().m_numElements * sizeof(ElemType) >= m_gradientBucketSizeInBytes)
+            {
+                m_buckets.push_back(GradientBucket());
+                m_buckets.back().m_numElements = 0;
+            }
+
+            auto& bucket = m_buckets.back();
+            bucket.m_gradients.push_back(i);
+            bucket.m_offsets.push_back(bucket.m_numElements);
+            bucket.m_numElements += gradients[i]->GetNumElements();
+            m_gradientBuckets[i] = m_buckets.size() - 1;
+        }
+
+        for (auto& bucket : m_buckets)
+        {
+            if (deviceId != CPUDEVICE)
+                bucket.m_buffer = AllocateIntermediateBuffer(deviceId, bucket.m_numElements);
+            else
+                bucket.m_buffer.reset(new ElemType[bucket.m_numElements], [](ElemType* p) { delete[] p; });
+
+            bucket.m_numPendingGradients = bucket.m_gradients.size();
+            bucket.m_copied = false;
+            bucket.m_launched = false;
+        }
+
+        if (m_syncStatsTrace > 0)
+            fprintf(stderr, "SimpleDistGradAggregator: fused %d gradients into %d buckets for overlapped aggregation.\n", (int)m_gradientIndices.size(), (int)m_buckets.size());
+    }
+
+    // Starts copying the gradients of the bucket into its fused buffer.
+    // On the GPU the copies run on the fetch stream after the gradients computed so far, and complete asynchronously.
+    void CopyBucket(size_t bucketIndex)
+    {
+        auto& bucket = m_buckets[bucketIndex];
+        int deviceId = m_bucketedGradients[0]->GetDeviceId();
+        if (deviceId >= 0)
+        {
+            std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(deviceId));
+            mainStreamSyncEvent->SynchronizeDataTransferFetchStreamWithEvent<ElemType>();
+        }
+
+        for (size_t k = 0; k < bucket.m_gradients.size(); ++k)
+        {
+            size_t i = bucket.m_gradients[k];
+            Matrix<ElemType>* gradient = m_bucketedGradients[i];
+            ElemType* destination = bucket.m_buffer.get() + bucket.m_offsets[k];
+            if (deviceId >= 0)
+                m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradient->Data(), gradient->GetNumElements(), destination);
+            else
+                memcpy(destination, gradient->Data(), gradient->GetNumElements() * sizeof(ElemType));
+        }
+
+        bucket.m_copied = true;
+        m_copiedBuckets.push_back(bucketIndex);
+    }
+
+    // Starts the allreduce of the copied buckets, in the order in which they were copied, so all workers start them in the same order.
+    // Without waitForCopies, it stops at the first bucket whose copies from the GPU have not completed yet.
+    void LaunchCopiedBuckets(bool waitForCopies)
+    {
+        int deviceId = m_bucketedGradients[0]->GetDeviceId();
+        while (!m_copiedBuckets.empty())
+        {
+            auto& bucket = m_buckets[m_copiedBuckets.front()];
+            if (deviceId >= 0)
+            {
+                for (auto i : bucket.m_gradients)
+                {
+                    if (!waitForCopies && !m_gpuDataTransferers[i]->IsCopyGPUToCPUAsyncComplete())
+                        return;
+                }
+
+                for (auto i : bucket.m_gradients)
+                    m_gpuDataTransferers[i]->WaitForCopyGPUToCPUAsync();
+            }
+
+            MPI_Iallreduce(MPI_IN_PLACE, bucket.m_buffer.get(), bucket.m_numElements, MPIWrapper::GetDataType(bucket.m_buffer.get()), MPI_SUM, m_mpi->Communicator(), &bucket.m_request) || MpiFail("MPI_Iallreduce");
+            bucket.m_launched = true;
+            m_copiedBuckets.pop_front();
+        }
+
+        // Give MPI the chance to progress the buckets in flight while we are going back to backprop.
+        for (auto& bucket : m_buckets)
+        {
+            if (!bucket.m_launched)
+                continue;
+
+            int completed = 0;
+            MPI_Test(&bucket.m_request, &completed, MPI_STATUS_IGNORE) || MpiFail("MPI_Test");
+        }
+    }
+
+    // Launches the buckets that were not launched during backprop.
+    void LaunchRemainingBuckets()
+    {
+        for (size_t b = 0; b < m_buckets.size(); ++b)
+        {
+            if (!m_buckets[b].m_copied)
+                CopyBucket(b);
+        }
+
+        LaunchCopiedBuckets(/*waitForCopies=*/true);
+    }
+
+    // Waits for the allreduce of all buckets, copies the results back into the gradients and prepares the buckets for the next minibatch.
+    void WaitForBuckets()
+    {
+        int deviceId = m_bucketedGradients[0]->GetDeviceId();
+        for (auto& bucket : m_buckets)
+        {
+            MPI_Wait(&bucket.m_request, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            for (size_t k = 0; k < bucket.m_gradients.size(); ++k)
+            {
+                size_t i = bucket.m_gradients[k];
+                Matrix<ElemType>* gradient = m_bucketedGradients[i];
+                ElemType* source = bucket.m_buffer.get() + bucket.m_offsets[k];
+                if (deviceId >= 0)
+                    m_gpuDataTransferers[i]->CopyCPUToGPUAsync(source, gradient->GetNumElements(), gradient->Data());
+                else
+                    memcpy(gradient->Data(), source, gradient->GetNumElements() * sizeof(ElemType));
+            }
+        }
+
+        if (deviceId >= 0)
+        {
+            for (auto& bucket : m_buckets)
+            {
+                for (auto i : bucket.m_gradients)
+                    m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
+            }
+        }
+
+        for (auto& bucket : m_buckets)
+        {
+            bucket.m_numPendingGradients = bucket.m_gradients.size();
+            bucket.m_copied = false;
+            bucket.m_launched = false;
+        }
+        m_gradientReady.assign(m_gradientReady.size(), false);
+    }
+
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
         assert(deviceID >= 0);
@@ -141,14 +358,22 @@ private:
 
             for (size_t i = 0; i < gradients.size(); i++)
             {
-                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
-                if (gradients[i]->GetMatrixType() != DENSE)
-                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+                // Of the sparse gradient matrices, only the sparse block column format (produced by TimesNode for a sparse input) is supported
+                bool isSparse = (gradients[i]->GetMatrixType() != DENSE);
+                if (isSparse && gradients[i]->GetFormat() != matrixFormatSparseBlockCol)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is only supported for the sparse block column format!");
+                if (isSparse && m_useAsyncAggregation)
+                    RuntimeError("Buffered async gradient aggregation for sparse gradient matrices is currently unsupported!");
+                m_isSparseGradient.push_back(isSparse);
 
                 if (deviceId != CPUDEVICE)
                 {
-                    m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, gradients[i]->GetNumElements()));
+                    // The bucket copies run during backprop, so they need their own streams to overlap with it.
+                    m_gpuDataTransferers.push_back(std::make_unique<GPUDataTransferer>(deviceId, m_useAsyncAggregation || (m_gradientBucketSizeInBytes > 0)));
+                    // With bucketing, the intermediate buffers are the fused buffers of the buckets.
+                    // Sparse gradients are copied to the CPU in the sparse format, so they do not need one either.
+                    if (m_gradientBucketSizeInBytes == 0)
+                        m_intermediateCPUBuffers.push_back(isSparse ? nullptr : AllocateIntermediateBuffer(deviceId, gradients[i]->GetNumElements()));
                 }
 
                 if (m_useAsyncAggregation)
@@ -161,6 +386,9 @@ private:
                 m_bufferedGradHeader->Clear();
             }
 
+            if (m_gradientBucketSizeInBytes > 0)
+                InitializeBuckets(gradients);
+
             if (m_mpi->IsMainNode())
             {
                 for (size_t i = 0; i < NumProc() - 1; ++i)
@@ -205,8 +433,12 @@ private:
                 assert(headerCPU->evalErrors[i].first == 0 && headerCPU->evalErrors[i].second == 0);
 
             // If the current node did not process any samples, the gradients should be zero'd
+            // Sparse gradients are not touched, their columns are just not sent (see AggregateSparseGradient).
             for (size_t i = 0; i < numGradMatrices; ++i)
-                gradients[i]->SetValue(0);
+            {
+                if (!m_isSparseGradient[i])
+                    gradients[i]->SetValue(0);
+            }
 
             if (m_useAsyncAggregation)
             {
@@ -216,10 +448,14 @@ private:
         }
 
         // Initiate transfer of the gradient matrices to the CPU if needed
-        if (deviceId >= 0)
+        bool useBuckets = (m_gradientBucketSizeInBytes > 0);
+        if (deviceId >= 0 && !useBuckets)
         {
             for (size_t i = 0; i < numGradMatrices; ++i)
-                m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradients[i]->Data(), gradients[i]->GetNumElements(), m_intermediateCPUBuffers[i].get());
+            {
+                if (!m_isSparseGradient[i])
+                    m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradients[i]->Data(), gradients[i]->GetNumElements(), m_intermediateCPUBuffers[i].get());
+            }
         }
 
         // Initiate receive of the header on the main node
@@ -240,9 +476,20 @@ private:
             MPI_Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, m_mpi->Communicator(), &sendHeaderRequest) || MpiFail("MPI_Isend");
 
         // Perform MPI async allreduce on the gradient data
-        std::vector<MPI_Request> allReduceRequests(numGradMatrices);
-        for (size_t i = 0; i < numGradMatrices; ++i)
+        // With buckets, only the buckets that did not get ready during backprop are left to start.
+        std::vector<MPI_Request> allReduceRequests(useBuckets ? 0 : numGradMatrices);
+        std::vector<std::pair<ElemType*, size_t>> hierarchicalBuffers;
+        if (useBuckets)
+            LaunchRemainingBuckets();
+
+        for (size_t i = 0; i < allReduceRequests.size(); ++i)
         {
+            if (m_isSparseGradient[i])
+            {
+                allReduceRequests[i] = MPI_REQUEST_NULL;
+                continue;
+            }
+
             ElemType* reductionBuffer = gradients[i]->Data();
             if (deviceId >= 0)
             {
@@ -251,9 +498,28 @@ private:
             }
 
             // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
+            // With hierarchical aggregation all gradients are reduced together below.
+            if (m_hierarchicalAllReducer)
+            {
+                hierarchicalBuffers.push_back(std::make_pair(reductionBuffer, gradients[i]->GetNumElements()));
+                allReduceRequests[i] = MPI_REQUEST_NULL;
+                continue;
+            }
+
             MPI_Iallreduce(MPI_IN_PLACE, reductionBuffer, gradients[i]->GetNumElements(), MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, m_mpi->Communicator(), &allReduceRequests[i]) || MpiFail("MPI_Iallreduce");
         }
 
+        if (m_hierarchicalAllReducer)
+            m_hierarchicalAllReducer->AllReduce(hierarchicalBuffers);
+
+        // The sparse gradients are exchanged while the dense allreduces are in flight.
+        // All workers issue these collectives in the same order, so they can be freely mixed with the pending ones.
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            if (m_isSparseGradient[i])
+                AggregateSparseGradient(gradients[i], headerCPU->numSamples != 0, showSyncPerfStats);
+        }
+
         // On the main node wait for the headers to arrive and aggregate
         if (m_mpi->IsMainNode())
         {
@@ -293,8 +559,14 @@ private:
         }
 
         // Wait for the allreduce operations to finish and initiate transfer back to the GPU if needed
-        for (size_t i = 0; i < numGradMatrices; ++i)
+        if (useBuckets)
+            WaitForBuckets();
+
+        for (size_t i = 0; i < allReduceRequests.size(); ++i)
         {
+            if (m_isSparseGradient[i])
+                continue;
+
             MPI_Wait(&allReduceRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
             if (deviceId >= 0)
                 m_gpuDataTransferers[i]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[i].get(), gradients[i]->GetNumElements(), gradients[i]->Data());
@@ -305,10 +577,13 @@ private:
             MPI_Wait(&recvAggHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
 
         // Wait for all the transfers to finish
-        if (deviceId >= 0)
+        if (deviceId >= 0 && !useBuckets)
         {
             for (size_t i = 0; i < numGradMatrices; ++i)
-                m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
+            {
+                if (!m_isSparseGradient[i])
+                    m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
+            }
         }
 
         // Wait for completion of the async send requests
@@ -325,6 +600,91 @@ private:
         }
     }
 
+    // Aggregates a gradient in sparse block column format.
+    // First the workers exchange the numbers of their touched columns. If all touched columns together are at most
+    // m_sparseGradientDensityThreshold of the columns, the workers allgather the ids and values of their touched columns and
+    // sum them up into the union of the columns. Otherwise the gradient is reduced as a dense buffer and set with all its columns.
+    // The decision is based on the exchanged numbers, so all workers take the same path.
+    void AggregateSparseGradient(Matrix<ElemType>* gradient, bool hasSamples, bool showSyncPerfStats)
+    {
+        size_t numRows = gradient->GetNumRows();
+        size_t numCols = gradient->GetNumCols();
+
+        std::vector<size_t> columnIds;
+        std::vector<ElemType> values;
+        if (hasSamples)
+            gradient->GetSparseBlockColumns(columnIds, values);
+
+        int numProc = (int)NumProc();
+        int myNumBlocks = (int)columnIds.size();
+        std::vector<int> numBlocks(numProc);
+        MPI_Allgather(&myNumBlocks, 1, MPI_INT, numBlocks.data(), 1, MPI_INT, m_mpi->Communicator()) || MpiFail("MPI_Allgather");
+
+        size_t totalNumBlocks = std::accumulate(numBlocks.begin(), numBlocks.end(), (size_t)0);
+        bool exchangeColumns = (totalNumBlocks <= m_sparseGradientDensityThreshold * numCols) && (totalNumBlocks * numRows <= m_maxMPICount);
+        if (showSyncPerfStats)
+            fprintf(stderr, "Sparse gradient aggregation: %d touched columns of %d over all workers, %ls.\n", (int)totalNumBlocks, (int)numCols, exchangeColumns ? L"exchanging columns" : L"reducing densely");
+
+        if (exchangeColumns)
+        {
+            std::vector<int> blockOffsets(numProc, 0), valueCounts(numProc), valueOffsets(numProc, 0);
+            for (int j = 0; j < numProc; ++j)
+            {
+                if (j > 0)
+                    blockOffsets[j] = blockOffsets[j - 1] + numBlocks[j - 1];
+                valueCounts[j] = numBlocks[j] * (int)numRows;
+                valueOffsets[j] = blockOffsets[j] * (int)numRows;
+            }
+
+            std::vector<size_t> allColumnIds(totalNumBlocks);
+            std::vector<ElemType> allValues(totalNumBlocks * numRows);
+            MPI_Allgatherv(columnIds.data(), myNumBlocks, MPIWrapper::GetDataType(allColumnIds.data()), allColumnIds.data(), numBlocks.data(), blockOffsets.data(), MPIWrapper::GetDataType(allColumnIds.data()), m_mpi->Communicator()) || MpiFail("MPI_Allgatherv");
+            MPI_Allgatherv(values.data(), myNumBlocks * (int)numRows, MPIWrapper::GetDataType(allValues.data()), allValues.data(), valueCounts.data(), valueOffsets.data(), MPIWrapper::GetDataType(allValues.data()), m_mpi->Communicator()) || MpiFail("MPI_Allgatherv");
+
+            // Merge in the order of the ranks, so that all workers end up with bit identical sums.
+            std::vector<size_t> mergedColumnIds(allColumnIds);
+            std::sort(mergedColumnIds.begin(), mergedColumnIds.end());
+            mergedColumnIds.erase(std::unique(mergedColumnIds.begin(), mergedColumnIds.end()), mergedColumnIds.end());
+
+            std::unordered_map<size_t, size_t> columnToBlock;
+            for (size_t b = 0; b < mergedColumnIds.size(); ++b)
+                columnToBlock[mergedColumnIds[b]] = b;
+
+            std::vector<ElemType> mergedValues(mergedColumnIds.size() * numRows, 0);
+            for (size_t b = 0; b < totalNumBlocks; ++b)
+            {
+                ElemType* destination = mergedValues.data() + columnToBlock[allColumnIds[b]] * numRows;
+                const ElemType* source = allValues.data() + b * numRows;
+                for (size_t r = 0; r < numRows; ++r)
+                    destination[r] += source[r];
+            }
+
+            gradient->SetMatrixFromSparseBlockColumns(mergedColumnIds.data(), mergedValues.data(), mergedColumnIds.size(), numRows, numCols);
+        }
+        else
+        {
+            std::vector<ElemType> dense(numRows * numCols, 0);
+            for (size_t b = 0; b < columnIds.size(); ++b)
+            {
+                ElemType* destination = dense.data() + columnIds[b] * numRows;
+                const ElemType* source = values.data() + b * numRows;
+                for (size_t r = 0; r < numRows; ++r)
+                    destination[r] += source[r];
+            }
+
+            // The MPI counts are ints, so a buffer of more than m_maxMPICount elements is reduced in pieces.
+            for (size_t offset = 0; offset < dense.size(); offset += m_maxMPICount)
+            {
+                int count = (int)std::min(m_maxMPICount, dense.size() - offset);
+                MPI_Allreduce(MPI_IN_PLACE, dense.data() + offset, count, MPIWrapper::GetDataType(dense.data()), MPI_SUM, m_mpi->Communicator()) || MpiFail("MPI_Allreduce");
+            }
+
+            std::vector<size_t> allColumns(numCols);
+            std::iota(allColumns.begin(), allColumns.end(), (size_t)0);
+            gradient->SetMatrixFromSparseBlockColumns(allColumns.data(), dense.data(), numCols, numRows, numCols);
+        }
+    }
+
 private:
     std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
     std::vector<std::shared_ptr<ElemType>> m_intermediateCPUBuffers;
@@ -349,5 +709,24 @@ private:
     size_t m_iterationCount;
 
     bool m_initialized;
+
+    // Minimal size of a bucket of fused gradients; 0 if gradients are reduced one by one after backprop.
+    size_t m_gradientBucketSizeInBytes;
+    std::vector<GradientBucket> m_buckets;
+    std::vector<Matrix<ElemType>*> m_bucketedGradients;
+    std::unordered_map<const Matrix<ElemType>*, size_t> m_gradientIndices;
+    std::vector<size_t> m_gradientBuckets; // Bucket of each gradient.
+    std::vector<bool> m_gradientReady;     // Whether the gradient was reported ready in the current minibatch.
+    std::deque<size_t> m_copiedBuckets;    // Buckets whose copies were started but whose allreduce was not, in the order of the copies.
+
+    // Whether the gradient is in sparse block column format and aggregated by AggregateSparseGradient.
+    std::vector<bool> m_isSparseGradient;
+    double m_sparseGradientDensityThreshold;
+
+    // Largest count passed to a single MPI call for the sparse gradients; INT_MAX, lowered by the tests to exercise the chunking.
+    size_t m_maxMPICount;
+
+    // Reduces the dense gradients within each host before reducing across hosts; null if not enabled.
+    std::unique_ptr<HierarchicalAllReducer<ElemType>> m_hierarchicalAllReducer;
 };
 } } }
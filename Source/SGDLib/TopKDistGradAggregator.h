@@ -0,0 +1,180 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "IDistGradAggregator.h"
+#include "TimerUtility.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+namespace Test { template <class ElemType> struct TopKDistGradAggregatorTest; }
+
+// Gradient aggregator that exchanges only the top-k entries (by magnitude) of every gradient matrix.
+// The entries that are not sent are kept in a residual, which is added to the gradient of the next minibatch
+// (error feedback, same idea as the residuals of the quantized gradient aggregation), so no update is lost, only delayed.
+// k is a fixed fraction of the number of elements of the matrix, so all workers send the same number of entries and
+// the exchange is a plain allgather of (index, value) pairs, which every worker sums up into the aggregated gradient.
+// The selection runs on the CPU; gradients on a GPU are copied to the host and back.
+template <class ElemType>
+class TopKDistGradAggregator : public IDistGradAggregator<ElemType>
+{
+    UsingIDistGradAggregatorMembers;
+    friend Test::TopKDistGradAggregatorTest<ElemType>;
+
+public:
+    TopKDistGradAggregator(const MPIWrapperPtr& mpi, double topKFraction, int syncStatsTrace)
+        : IDistGradAggregator<ElemType>(mpi), m_topKFraction(topKFraction), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0), m_initialized(false)
+    {
+        if (m_topKFraction <= 0 || m_topKFraction > 1)
+            InvalidArgument("TopKDistGradAggregator: the fraction of the gradient entries to send must be in (0, 1].");
+    }
+
+    ~TopKDistGradAggregator()
+    {
+        delete[] m_hostBuffer;
+    }
+
+    bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) override
+    {
+        ResetState(gradients, resetState);
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        AggregateHeader(headerCPU);
+
+        // The gradients of a worker that did not process any samples are zero, but its residuals are still sent.
+        bool hasSamples = (headerCPU->numSamples != 0);
+        for (size_t i = 0; i < gradients.size(); ++i)
+            AggregateGradient(gradients[i], m_residuals[i], hasSamples);
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            fprintf(stderr, "Actual gradient aggregation time: %.6g\n", aggregationTimer.ElapsedSeconds());
+        }
+
+        return (headerCPU->numSamples != 0);
+    }
+
+private:
+    void ResetState(const std::vector<Matrix<ElemType>*>& gradients, bool resetState)
+    {
+        if (!m_initialized)
+        {
+            m_initialized = true;
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                if (gradients[i]->GetMatrixType() != DENSE)
+                    RuntimeError("Top-k gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+                m_residuals.push_back(std::vector<ElemType>(gradients[i]->GetNumElements(), 0));
+            }
+        }
+        else if (resetState)
+        {
+            for (auto& residual : m_residuals)
+                std::fill(residual.begin(), residual.end(), (ElemType)0);
+        }
+    }
+
+    // Sums up the headers of all workers. Every worker adds them up in the rank order, so all end up with the same header.
+    void AggregateHeader(DistGradHeader* headerCPU)
+    {
+        size_t headerSize = headerCPU->Size();
+        std::vector<char> headers(headerSize * NumProc());
+        MPI_Allgather(headerCPU, (int)headerSize, MPI_CHAR, headers.data(), (int)headerSize, MPI_CHAR, m_mpi->Communicator()) || MpiFail("MPI_Allgather");
+
+        headerCPU->Clear();
+        for (size_t j = 0; j < NumProc(); ++j)
+            headerCPU->Aggregate(reinterpret_cast<DistGradHeader*>(headers.data() + j * headerSize), true);
+    }
+
+    void AggregateGradient(Matrix<ElemType>* gradient, std::vector<ElemType>& residual, bool hasSamples)
+    {
+        size_t numElements = gradient->GetNumElements();
+        if (numElements == 0)
+            return;
+
+        // Add the residual of the previous minibatches to the gradient.
+        ElemType* values = residual.data();
+        if (hasSamples)
+        {
+            ElemType* data = gradient->Data();
+            if (gradient->GetDeviceId() >= 0)
+            {
+                gradient->CopyToArray(m_hostBuffer, m_hostBufferSize);
+                data = m_hostBuffer;
+            }
+
+            for (size_t j = 0; j < numElements; ++j)
+                values[j] += data[j];
+        }
+
+        // Select the k entries with the largest magnitude, they are sent and removed from the residual.
+        size_t k = std::max<size_t>(1, (size_t)std::ceil(m_topKFraction * numElements));
+        k = std::min(k, numElements);
+        m_selection.resize(numElements);
+        for (size_t j = 0; j < numElements; ++j)
+            m_selection[j] = j;
+        if (k < numElements)
+        {
+            std::nth_element(m_selection.begin(), m_selection.begin() + k, m_selection.end(), [values](size_t a, size_t b)
+            {
+                return std::abs(values[a]) > std::abs(values[b]);
+            });
+        }
+
+        std::vector<size_t> indices(m_selection.begin(), m_selection.begin() + k);
+        std::vector<ElemType> selectedValues(k);
+        for (size_t j = 0; j < k; ++j)
+        {
+            selectedValues[j] = values[indices[j]];
+            values[indices[j]] = 0;
+        }
+
+        std::vector<size_t> allIndices(k * NumProc());
+        std::vector<ElemType> allValues(k * NumProc());
+        MPI_Allgather(indices.data(), (int)k, MPIWrapper::GetDataType(indices.data()), allIndices.data(), (int)k, MPIWrapper::GetDataType(allIndices.data()), m_mpi->Communicator()) || MpiFail("MPI_Allgather");
+        MPI_Allgather(selectedValues.data(), (int)k, MPIWrapper::GetDataType(selectedValues.data()), allValues.data(), (int)k, MPIWrapper::GetDataType(allValues.data()), m_mpi->Communicator()) || MpiFail("MPI_Allgather");
+
+        // Sum up the entries of all workers in the rank order, so all workers get bit identical gradients.
+        m_aggregated.assign(numElements, 0);
+        for (size_t j = 0; j < allIndices.size(); ++j)
+            m_aggregated[allIndices[j]] += allValues[j];
+
+        if (gradient->GetDeviceId() >= 0)
+            gradient->SetValue(gradient->GetNumRows(), gradient->GetNumCols(), gradient->GetDeviceId(), m_aggregated.data());
+        else
+            memcpy(gradient->Data(), m_aggregated.data(), numElements * sizeof(ElemType));
+    }
+
+    // Fraction of the entries of each gradient matrix that are sent.
+    double m_topKFraction;
+
+    // Entries of the gradients that were not sent yet, one per gradient matrix.
+    std::vector<std::vector<ElemType>> m_residuals;
+
+    // Scratch buffers reused across gradients and minibatches.
+    std::vector<size_t> m_selection;
+    std::vector<ElemType> m_aggregated;
+    ElemType* m_hostBuffer = nullptr;
+    size_t m_hostBufferSize = 0;
+
+    int m_syncStatsTrace;
+
+    // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
+    size_t m_iterationCount;
+
+    bool m_initialized;
+};
+
+}}}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// latticecompactarchive.cpp -- converting lattice archives to the compact, memory-mapped format
+//
+
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+#endif
+
+#include "Basics.h"
+#include "fileutil.h"
+#include "latticearchive.h" // we implement parts of class archive
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace msra { namespace lattices {
+
+// convert an archive to the compact format (see lattice::fwritecompact())
+// The lattices are written in the order of the input TOC, so that sequential reading touches the mapped file sequentially.
+/*static*/ void archive::convertcompact(const std::wstring &intocpath, const std::wstring &outpath,
+                                        const std::unordered_map<std::string, size_t> &modelsymmap)
+{
+    const std::wstring tocpath = outpath + L".toc";
+    const std::wstring symlistpath = outpath + L".symlist";
+
+    // open input archive
+    std::vector<std::wstring> intocpaths(1, intocpath); // set of paths consisting of 1
+    msra::lattices::archive archive(intocpaths, modelsymmap);
+
+    // read the intocpath file once again to get the keys in original order
+    std::vector<char> textbuffer;
+    auto toclines = msra::files::fgetfilelines(intocpath, textbuffer);
+
+    msra::files::make_intermediate_dirs(outpath);
+    auto_file_ptr f(fopenOrDie(outpath, L"wb"));
+    auto_file_ptr ftoc(fopenOrDie(tocpath, L"wb"));
+    lattice::fwritecompactarchiveheader(f);
+
+    lattice L; // (reused across lattices to avoid reallocations)
+    foreach_index (i, toclines)
+    {
+        const char *line = toclines[i];
+        const char *p = strchr(line, '=');
+        if (p == NULL)
+            RuntimeError("convertcompact: invalid TOC line (no = sign): %s", line);
+        const std::wstring key = msra::strfun::utf16(std::string(line, p - line));
+
+        // fetch lattice  --this performs any necessary format conversions already, and maps the units to modelsymmap
+        archive.getlattice(key, L);
+
+        // write to archive
+        uint64_t offset = fgetpos(f);
+        L.fwritecompact(f);
+
+        // write reference to TOC file   --note: TOC file is a headerless UTF8 file; so don't use fprintf %ls format (default code page)
+        fprintfOrDie(ftoc, "%s=%s[%llu]\n", msra::strfun::utf8(key).c_str(), (i == 0) ? msra::strfun::utf8(outpath).c_str() : "", (unsigned long long) offset);
+    }
+    fflushOrDie(f);
+    fflushOrDie(ftoc);
+
+    // write out the unit map that the lattices were mapped to
+    writeunitmap(symlistpath, modelsymmap);
+
+    fprintf(stderr, "convertcompact: converted %d lattices\n", (int) toclines.size());
+}
+}}
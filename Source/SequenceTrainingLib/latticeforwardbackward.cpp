@@ -131,6 +131,65 @@ static bool islogzero(FLOAT v)
     return v < LOGZERO / 2;
 } // is this number to be considered 0
 
+// logsum (n, score) -> log [ sum_k exp (score (k)) ] for k = 0..n-1
+// Unlike a chain of logadd(), this needs one log() for all terms. The maximum is taken out to keep exp() in range,
+// and the exp() terms do not depend on each other, so that the compiler can vectorize the second loop.
+template <typename SCOREFN>
+static double logsum(size_t n, const SCOREFN &score)
+{
+    double maxscore = LOGZERO;
+    for (size_t k = 0; k < n; k++)
+        maxscore = max(maxscore, score(k));
+    if (maxscore <= LOGZERO) // all are 0
+        return LOGZERO;
+    double sum = 0;
+    for (size_t k = 0; k < n; k++)
+        sum += exp(score(k) - maxscore);
+    return maxscore + log(sum);
+}
+
+// ---------------------------------------------------------------------------
+// helpers for multi-threading
+// ---------------------------------------------------------------------------
+
+// minimum number of work items for running a loop multi-threaded; below, the OpenMP fork/join costs more than it saves
+static const int minparallelitems = 16;
+
+// number of frames of a block in foreachframeblock()
+static const size_t framesperblock = 64;
+
+// foreachedgegroup (edgeindices, groupkey, fn) -> fn (group, n) for each run of edges with the same groupkey (j), concurrently
+// 'edgeindices' lists the edges of a batch such that edges with the same key (the node they accumulate into) are consecutive.
+// Since the groups accumulate into different nodes, no two threads write to the same node.
+template <typename KEYFN, typename GROUPFN>
+static void foreachedgegroup(const std::vector<size_t> &edgeindices, const KEYFN &groupkey, const GROUPFN &fn)
+{
+    std::vector<size_t> groupbegins;
+    for (size_t k = 0; k < edgeindices.size(); k++)
+    {
+        if (k == 0 || groupkey(edgeindices[k]) != groupkey(edgeindices[k - 1]))
+            groupbegins.push_back(k);
+    }
+    groupbegins.push_back(edgeindices.size());
+
+    const int numgroups = (int) groupbegins.size() - 1;
+#pragma omp parallel for schedule(dynamic, 4) if (numgroups >= minparallelitems)
+    for (int g = 0; g < numgroups; g++)
+        fn(&edgeindices[groupbegins[g]], groupbegins[g + 1] - groupbegins[g]);
+}
+
+// foreachframeblock (numframes, fn) -> fn (ts, te) for consecutive blocks of frames, concurrently
+// This is used to accumulate per-edge values into per-frame statistics, where edges overlap in time
+// but each frame block is written by one thread only.
+template <typename BLOCKFN>
+static void foreachframeblock(size_t numframes, const BLOCKFN &fn)
+{
+    const int numblocks = (int) ((numframes + framesperblock - 1) / framesperblock);
+#pragma omp parallel for schedule(dynamic) if (numblocks > 1)
+    for (int b = 0; b < numblocks; b++)
+        fn(b * framesperblock, min((b + 1) * framesperblock, numframes));
+}
+
 // ---------------------------------------------------------------------------
 // other helpers go here
 // ---------------------------------------------------------------------------
@@ -506,7 +565,11 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
 
         return totalfwscore;
     }
-    // if we get here, we have no CUDA, and do it the good ol' way
+    // if we get here, we have no CUDA, and do it on the CPU
+    // The edges are processed in the same batches as the CUDA kernel launches (see getforwardbackwardbatches()), as all
+    // edges of a batch only depend on the scores of nodes that are complete. Inside a batch, the edges that accumulate
+    // into the same node (the end node in the forward pass, the start node in the backward pass) form a group; the groups
+    // are processed by multiple threads, and each sums up its scores with a single logsum().
 
     // allocate return values
     logpps.resize(edges.size()); // this is our primary return value
@@ -517,6 +580,48 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
     logbetas.assign(nodes.size(), LOGZERO);
     logbetas.back() = 0.0f;
 
+    std::vector<size_t> batchsizeforward;
+    std::vector<size_t> batchsizebackward;
+    getforwardbackwardbatches(batchsizeforward, batchsizebackward);
+
+    // the edges of the batches, in the order of the groups
+    std::vector<std::vector<size_t>> batchesforward;
+    size_t startindex = 0;
+    for (size_t batchsize : batchsizeforward) // edges are sorted by end node, so the groups are consecutive already
+    {
+        batchesforward.push_back(std::vector<size_t>(batchsize));
+        for (size_t k = 0; k < batchsize; k++)
+            batchesforward.back()[k] = startindex + k;
+        startindex += batchsize;
+    }
+    std::vector<std::vector<size_t>> batchesbackward;
+    for (size_t batchsize : batchsizebackward) // sort by start node to make the groups consecutive
+    {
+        startindex -= batchsize;
+        batchesbackward.push_back(std::vector<size_t>(batchsize));
+        for (size_t k = 0; k < batchsize; k++)
+            batchesbackward.back()[k] = startindex + k;
+        std::stable_sort(batchesbackward.back().begin(), batchesbackward.back().end(), [&](size_t j1, size_t j2)
+                         {
+                             return edges[j1].S < edges[j2].S;
+                         });
+    }
+    const auto endnode = [&](size_t j)
+    {
+        return edges[j].E;
+    };
+    const auto startnode = [&](size_t j)
+    {
+        return edges[j].S;
+    };
+
+    // per-edge LM and acoustic scores
+    const int numedges = (int) edges.size();
+    std::vector<double> edgescores(edges.size());
+#pragma omp parallel for if (numedges >= minparallelitems)
+    for (int j = 0; j < numedges; j++)
+        edgescores[j] = (edges[j].l * lmf + wp + edgeacscores[j]) / amf; // note: edgeacscores[j] == LOGZERO if edge was pruned
+
     // --- sMBR version
 
     if (sMBRmode)
@@ -528,27 +633,48 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
         std::vector<double> logaccbetas(nodes.size(), LOGZERO);  // [i] likewise
         std::vector<double> logframescorrectedge(edges.size());  // raw counts of correct frames in each edge
 
-        // forward pass
-        foreach_index (j, edges)
+        // in sMBR mode, pruned edges are left out entirely
+        const auto ispruned = [&](size_t j)
         {
-            if (islogzero(edgeacscores[j])) // indicates that this edge is pruned
+            return islogzero(edgeacscores[j]); // indicates that this edge is pruned
+        };
+
+#pragma omp parallel for if (numedges >= minparallelitems)
+        for (int j = 0; j < numedges; j++)
+        {
+            if (ispruned(j))
                 continue;
             const auto &e = edges[j];
-            const double inscore = logalphas[e.S];
-            const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf;
-            const double pathscore = inscore + edgescore;
-            logadd(logalphas[e.E], pathscore);
-
             size_t ts = nodes[e.S].t;
             size_t te = nodes[e.E].t;
             size_t framescorrect = 0; // count raw number of correct frames
             for (size_t t = ts; t < te; t++)
                 framescorrect += (thisedgealignments[j][t - ts] == uids[t]);
             logframescorrectedge[j] = (framescorrect > 0) ? log((double) framescorrect) : LOGZERO; // remember for backward pass
-            double loginaccs = logaccalphas[e.S] - logalphas[e.S];
-            logadd(loginaccs, logframescorrectedge[j]);
-            double logpathacc = loginaccs + logalphas[e.S] + edgescore;
-            logadd(logaccalphas[e.E], logpathacc);
+        }
+
+        // forward pass
+        for (const auto &batch : batchesforward)
+        {
+            foreachedgegroup(batch, endnode, [&](const size_t *group, size_t n)
+                             {
+                                 const size_t E = edges[group[0]].E;
+                                 logadd(logalphas[E], logsum(n, [&](size_t k)
+                                                             {
+                                                                 const size_t j = group[k];
+                                                                 return ispruned(j) ? LOGZERO : logalphas[edges[j].S] + edgescores[j];
+                                                             }));
+                                 logadd(logaccalphas[E], logsum(n, [&](size_t k)
+                                                                {
+                                                                    const size_t j = group[k];
+                                                                    if (ispruned(j))
+                                                                        return (double) LOGZERO;
+                                                                    const size_t S = edges[j].S;
+                                                                    double loginaccs = logaccalphas[S] - logalphas[S];
+                                                                    logadd(loginaccs, logframescorrectedge[j]);
+                                                                    return loginaccs + logalphas[S] + edgescores[j]; // logpathacc
+                                                                }));
+                             });
         }
         foreach_index (j, logaccalphas)
             logaccalphas[j] -= logalphas[j];
@@ -562,32 +688,46 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
         }
 
         // backward pass and computation of state-conditioned frames-correct count
-        for (size_t j = edges.size() - 1; j + 1 > 0; j--)
+        for (const auto &batch : batchesbackward)
         {
-            if (islogzero(edgeacscores[j])) // indicates that this edge is pruned
-                continue;
-            const auto &e = edges[j];
-            const double inscore = logbetas[e.E];
-            const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf;
-            const double pathscore = inscore + edgescore;
-            logadd(logbetas[e.S], pathscore);
-
-            double loginaccs = logaccbetas[e.E] - logbetas[e.E];
-            logadd(loginaccs, logframescorrectedge[j]);
-            double logpathacc = loginaccs + logbetas[e.E] + edgescore;
-            logadd(logaccbetas[e.S], logpathacc);
-
-            // sum up to get final expected frames-correct count per state == per edge (since we assume hard state alignment)
-            double logpp = logalphas[e.S] + edgescore + logbetas[e.E] - totalfwscore;
-            if (logpp > 1e-2)
-                fprintf(stderr, "forwardbackward: WARNING: edge J=%d log posterior %.10f > 0\n", (int) j, (float) logpp);
-            if (logpp > 0.0)
-                logpp = 0.0;
-            logpps[j] = logpp;
-            double tmplogeframecorrect = logframescorrectedge[j];
-            logadd(tmplogeframecorrect, logaccalphas[e.S]);
-            logadd(tmplogeframecorrect, logaccbetas[e.E] - logbetas[e.E]);
-            Eframescorrectbuf[j] = exp(tmplogeframecorrect);
+            foreachedgegroup(batch, startnode, [&](const size_t *group, size_t n)
+                             {
+                                 const size_t S = edges[group[0]].S;
+                                 // the end nodes are complete, so these are computed before updating the start node
+                                 for (size_t k = 0; k < n; k++)
+                                 {
+                                     const size_t j = group[k];
+                                     if (ispruned(j))
+                                         continue;
+                                     const auto &e = edges[j];
+                                     // sum up to get final expected frames-correct count per state == per edge (since we assume hard state alignment)
+                                     double logpp = logalphas[e.S] + edgescores[j] + logbetas[e.E] - totalfwscore;
+                                     if (logpp > 1e-2)
+                                         fprintf(stderr, "forwardbackward: WARNING: edge J=%d log posterior %.10f > 0\n", (int) j, (float) logpp);
+                                     if (logpp > 0.0)
+                                         logpp = 0.0;
+                                     logpps[j] = logpp;
+                                     double tmplogeframecorrect = logframescorrectedge[j];
+                                     logadd(tmplogeframecorrect, logaccalphas[e.S]);
+                                     logadd(tmplogeframecorrect, logaccbetas[e.E] - logbetas[e.E]);
+                                     Eframescorrectbuf[j] = exp(tmplogeframecorrect);
+                                 }
+                                 logadd(logaccbetas[S], logsum(n, [&](size_t k)
+                                                               {
+                                                                   const size_t j = group[k];
+                                                                   if (ispruned(j))
+                                                                       return (double) LOGZERO;
+                                                                   const size_t E = edges[j].E;
+                                                                   double loginaccs = logaccbetas[E] - logbetas[E];
+                                                                   logadd(loginaccs, logframescorrectedge[j]);
+                                                                   return loginaccs + logbetas[E] + edgescores[j]; // logpathacc
+                                                               }));
+                                 logadd(logbetas[S], logsum(n, [&](size_t k)
+                                                            {
+                                                                const size_t j = group[k];
+                                                                return ispruned(j) ? LOGZERO : logbetas[edges[j].E] + edgescores[j];
+                                                            }));
+                             });
         }
         foreach_index (j, logaccbetas)
             logaccbetas[j] -= logbetas[j];
@@ -606,13 +746,16 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
     // --- MMI version
 
     // forward pass
-    foreach_index (j, edges)
+    for (const auto &batch : batchesforward)
     {
-        const auto &e = edges[j];
-        const double inscore = logalphas[e.S];
-        const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf; // note: edgeacscores[j] == LOGZERO if edge was pruned
-        const double pathscore = inscore + edgescore;
-        logadd(logalphas[e.E], pathscore);
+        foreachedgegroup(batch, endnode, [&](const size_t *group, size_t n)
+                         {
+                             logadd(logalphas[edges[group[0]].E], logsum(n, [&](size_t k)
+                                                                         {
+                                                                             const size_t j = group[k];
+                                                                             return logalphas[edges[j].S] + edgescores[j];
+                                                                         }));
+                         });
     }
     const double totalfwscore = logalphas.back();
     if (islogzero(totalfwscore))
@@ -623,21 +766,28 @@ double lattice::forwardbackwardlattice(const std::vector<float> &edgeacscores, p
 
     // backward pass
     // this also computes the word posteriors on the fly, since we are at it
-    for (size_t j = edges.size() - 1; j + 1 > 0; j--)
+    for (const auto &batch : batchesbackward)
     {
-        const auto &e = edges[j];
-        const double inscore = logbetas[e.E];
-        const double edgescore = (e.l * lmf + wp + edgeacscores[j]) / amf;
-        const double pathscore = inscore + edgescore;
-        logadd(logbetas[e.S], pathscore);
-
-        // compute lattice posteriors on the fly since we are at it
-        double logpp = logalphas[e.S] + edgescore + logbetas[e.E] - totalfwscore;
-        if (logpp > 1e-2)
-            fprintf(stderr, "forwardbackward: WARNING: edge J=%d log posterior %.10f > 0\n", (int) j, (float) logpp);
-        if (logpp > 0.0)
-            logpp = 0.0;
-        logpps[j] = logpp;
+        foreachedgegroup(batch, startnode, [&](const size_t *group, size_t n)
+                         {
+                             // compute lattice posteriors on the fly since we are at it
+                             for (size_t k = 0; k < n; k++)
+                             {
+                                 const size_t j = group[k];
+                                 const auto &e = edges[j];
+                                 double logpp = logalphas[e.S] + edgescores[j] + logbetas[e.E] - totalfwscore;
+                                 if (logpp > 1e-2)
+                                     fprintf(stderr, "forwardbackward: WARNING: edge J=%d log posterior %.10f > 0\n", (int) j, (float) logpp);
+                                 if (logpp > 0.0)
+                                     logpp = 0.0;
+                                 logpps[j] = logpp;
+                             }
+                             logadd(logbetas[edges[group[0]].S], logsum(n, [&](size_t k)
+                                                                         {
+                                                                             const size_t j = group[k];
+                                                                             return logbetas[edges[j].E] + edgescores[j];
+                                                                         }));
+                         });
     }
 
     const double totalbwscore = logbetas.front();
@@ -952,7 +1102,12 @@ void lattice::forwardbackwardalign(parallelstate &parallelstate,
             parallelstate.getedgeacscores(edgeacscoresgpu);
             parallelstate.copyalignments(thisedgealignmentsgpu);
         }
-        foreach_index (j, edges)
+        // edges are aligned independently, so this runs multi-threaded (except when verifying against the GPU)
+        // The alignment buffer is allocated upfront, since thisedgealignments[j] would allocate it lazily.
+        thisedgealignments.getalignmentsbuffer();
+        const int numedges = (int) edges.size();
+#pragma omp parallel for schedule(dynamic) if (!cpuverification && numedges >= minparallelitems)
+        for (int j = 0; j < numedges; j++)
         {
             const edgeinfowithscores &e = edges[j];
             const size_t ts = nodes[e.S].t;
@@ -970,8 +1125,14 @@ void lattice::forwardbackwardalign(parallelstate &parallelstate,
                 else
                     edgeacscores[j] = alignedge(aligntokens, hset, edgeLLs, *abcs[j], j, returnsenoneids, thisedgealignments[j]);
             }
-            if (cpuverification)
+        }
+        if (cpuverification)
+        {
+            foreach_index (j, edges)
             {
+                const edgeinfowithscores &e = edges[j];
+                const size_t ts = nodes[e.S].t;
+                const size_t te = nodes[e.E].t;
                 const auto &aligntokens = getaligninfo(j); // get alignment tokens
                 bool edgehassil = false;
                 foreach_index (i, aligntokens)
@@ -1017,30 +1178,38 @@ void lattice::sMBRerrorsignal(parallelstate &parallelstate,
     }
 
     //  linear mode
-    foreach_coord (i, j, errorsignal)
-        errorsignal(i, j) = 0.0f; // Note: we don't actually put anything into the numgammas
-    foreach_index (j, edges)
-    {
-        const auto &e = edges[j];
-        if (nodes[e.S].t == nodes[e.E].t) // this happens for dummy !NULL edge at end of file
-            continue;
-        if (minlogpp > LOGZERO && origlogpps[j] < minlogpp) // this is pruned
-            continue;
-
-        size_t ts = nodes[e.S].t;
-        size_t te = nodes[e.E].t;
-
-        const double diff = logEframescorrect[j] - logEframescorrecttotal;
-        // Note: the contribution of the states of an edge to their senones is the same for all states
-        // so we compute it once and add it to all; this will not be the case without hard alignments.
-        const double pp = exp(logpps[j]); // edge posterior
-        const float edgecorrect = (float) (pp * diff) / amf;
-        for (size_t t = ts; t < te; t++)
-        {
-            const size_t s = thisedgealignments[j][t - ts];
-            errorsignal(s, t) += edgecorrect;
-        }
-    }
+    // Edges overlap in time, so the frames are split into blocks, and each thread adds the edges' contributions to its own block.
+    // Edges are added in the same order for every frame, so the result does not depend on the number of threads.
+    foreachframeblock(errorsignal.cols(), [&](size_t tbegin, size_t tend)
+                      {
+                          for (size_t t = tbegin; t < tend; t++)
+                              for (size_t i = 0; i < errorsignal.rows(); i++)
+                                  errorsignal(i, t) = 0.0f; // Note: we don't actually put anything into the numgammas
+                          foreach_index (j, edges)
+                          {
+                              const auto &e = edges[j];
+                              if (nodes[e.S].t == nodes[e.E].t) // this happens for dummy !NULL edge at end of file
+                                  continue;
+                              if (minlogpp > LOGZERO && origlogpps[j] < minlogpp) // this is pruned
+                                  continue;
+
+                              size_t ts = nodes[e.S].t;
+                              size_t te = nodes[e.E].t;
+                              if (te <= tbegin || ts >= tend) // not in this block
+                                  continue;
+
+                              const double diff = logEframescorrect[j] - logEframescorrecttotal;
+                              // Note: the contribution of the states of an edge to their senones is the same for all states
+                              // so we compute it once and add it to all; this will not be the case without hard alignments.
+                              const double pp = exp(logpps[j]); // edge posterior
+                              const float edgecorrect = (float) (pp * diff) / amf;
+                              for (size_t t = max(ts, tbegin); t < min(te, tend); t++)
+                              {
+                                  const size_t s = thisedgealignments[j][t - ts];
+                                  errorsignal(s, t) += edgecorrect;
+                              }
+                          }
+                      });
 }
 
 // compute the error signal for MMI mode
@@ -1059,79 +1228,92 @@ void lattice::mmierrorsignal(parallelstate &parallelstate, double minlogpp, cons
         return;
     }
 
-    for (size_t j = 0; j < (errorsignal).cols(); j++)
-        for (size_t i = 0; i < (errorsignal).rows(); i++)
-            errorsignal(i, j) = VIRGINLOGZERO; // set to zero  --note: may be in-place with logLLs, which now get overwritten
-
-    // size_t warnings = 0;   // [v-hansu] check code for mmi; search this comment to see all related codes
-    foreach_index (j, edges)
-    {
-        const auto &e = edges[j];
-        if (nodes[e.S].t == nodes[e.E].t) // this happens for dummy !NULL edge at end of file
-            continue;
-        if (minlogpp > LOGZERO && origlogpps[j] < minlogpp) // this is pruned
-            continue;
-
-        const auto &aligntokens = getaligninfo(j); // get alignment tokens
-        auto &loggammas = *abcs[j];
-
-        const float edgelogP = (float) logpps[j];
-        // if (islogzero (edgelogP))               // we had a 0 prob
-        //    continue;
-
-        // accumulate this edge's gamma matrix into target posteriors
-        const size_t tedge = nodes[e.S].t;
-        size_t ts = 0;                 // time index into gamma matrix
-        size_t js = 0;                 // state index into gamma matrix
-        foreach_index (k, aligntokens) // we exploit that units have fixed boundaries
-        {
-            const auto &unit = aligntokens[k];
-            const size_t te = ts + unit.frames;
-            const auto &hmm = hset.gethmm(unit.unit); // TODO: inline these expressions
-            const size_t n = hmm.getnumstates();
-            const size_t je = js + n;
-            // P(s) = P(s|e) * P(e)
-            for (size_t t = ts; t < te; t++)
-            {
-                const size_t tutt = t + tedge; // time index w.r.t. utterance
-                // double logsum = LOGZERO;         // [v-hansu] check code for mmi; search this comment to see all related codes
-                for (size_t i = 0; i < n; i++)
-                {
-                    const size_t j = js + i;             // state index for this unit in matrix
-                    const size_t s = hmm.getsenoneid(i); // state class index
-                    const float gammajt = loggammas(j, t);
-                    const float statelogP = edgelogP + gammajt;
-                    logadd(errorsignal(s, tutt), statelogP);
-                }
-            }
-            ts = te;
-            js = je;
-        }
-        assert(ts + 2 == loggammas.cols() && js == loggammas.rows());
-    }
-
-    // check normalizedness (is that an actual English word?)
-    // also count non-zero probs
+    // Like in sMBRerrorsignal(), the frames are split into blocks, and each thread accumulates all edges into its own block.
+    std::vector<size_t> nonzerostatesperblock((errorsignal.cols() + framesperblock - 1) / framesperblock, 0);
+    foreachframeblock(errorsignal.cols(), [&](size_t tbegin, size_t tend)
+                      {
+                          for (size_t j = tbegin; j < tend; j++)
+                              for (size_t i = 0; i < (errorsignal).rows(); i++)
+                                  errorsignal(i, j) = VIRGINLOGZERO; // set to zero  --note: may be in-place with logLLs, which now get overwritten
+
+                          // size_t warnings = 0;   // [v-hansu] check code for mmi; search this comment to see all related codes
+                          foreach_index (j, edges)
+                          {
+                              const auto &e = edges[j];
+                              if (nodes[e.S].t == nodes[e.E].t) // this happens for dummy !NULL edge at end of file
+                                  continue;
+                              if (minlogpp > LOGZERO && origlogpps[j] < minlogpp) // this is pruned
+                                  continue;
+                              if (nodes[e.E].t <= tbegin || nodes[e.S].t >= tend) // not in this block
+                                  continue;
+
+                              const auto &aligntokens = getaligninfo(j); // get alignment tokens
+                              auto &loggammas = *abcs[j];
+
+                              const float edgelogP = (float) logpps[j];
+                              // if (islogzero (edgelogP))               // we had a 0 prob
+                              //    continue;
+
+                              // accumulate this edge's gamma matrix into target posteriors
+                              const size_t tedge = nodes[e.S].t;
+                              size_t ts = 0;                 // time index into gamma matrix
+                              size_t js = 0;                 // state index into gamma matrix
+                              foreach_index (k, aligntokens) // we exploit that units have fixed boundaries
+                              {
+                                  const auto &unit = aligntokens[k];
+                                  const size_t te = ts + unit.frames;
+                                  const auto &hmm = hset.gethmm(unit.unit); // TODO: inline these expressions
+                                  const size_t n = hmm.getnumstates();
+                                  const size_t je = js + n;
+                                  // P(s) = P(s|e) * P(e)
+                                  for (size_t t = max(ts, tbegin - min(tbegin, tedge)); t < te && t + tedge < tend; t++)
+                                  {
+                                      const size_t tutt = t + tedge; // time index w.r.t. utterance
+                                      // double logsum = LOGZERO;         // [v-hansu] check code for mmi; search this comment to see all related codes
+                                      for (size_t i = 0; i < n; i++)
+                                      {
+                                          const size_t j = js + i;             // state index for this unit in matrix
+                                          const size_t s = hmm.getsenoneid(i); // state class index
+                                          const float gammajt = loggammas(j, t);
+                                          const float statelogP = edgelogP + gammajt;
+                                          logadd(errorsignal(s, tutt), statelogP);
+                                      }
+                                  }
+                                  ts = te;
+                                  js = je;
+                              }
+                              assert(ts + 2 == loggammas.cols() && js == loggammas.rows());
+                          }
+
+                          // check normalizedness (is that an actual English word?)
+                          // also count non-zero probs
+                          for (size_t t = tbegin; t < tend; t++)
+                          {
+                              double logsum = LOGZERO;
+                              foreach_row (s, errorsignal)
+                              {
+                                  if (islogzero(errorsignal(s, t)))
+                                      nonzerostatesperblock[tbegin / framesperblock]++;
+                                  else
+                                      logadd(logsum, (double) errorsignal(s, t));
+                                  // TODO: count VIRGINLOGZERO, print per frame
+                              }
+                              if (fabs(logsum) / errorsignal.rows() > 1e-6)
+                                  fprintf(stderr, "forwardbackward: WARNING: overall posterior column(%d) sum = exp (%.10f) != 1\n", (int) t, logsum);
+                          }
+                      });
     size_t nonzerostates = 0;
-    foreach_column (t, errorsignal)
-    {
-        double logsum = LOGZERO;
-        foreach_row (s, errorsignal)
-        {
-            if (islogzero(errorsignal(s, t)))
-                nonzerostates++;
-            else
-                logadd(logsum, (double) errorsignal(s, t));
-            // TODO: count VIRGINLOGZERO, print per frame
-        }
-        if (fabs(logsum) / errorsignal.rows() > 1e-6)
-            fprintf(stderr, "forwardbackward: WARNING: overall posterior column(%d) sum = exp (%.10f) != 1\n", (int) t, logsum);
-    }
+    for (size_t n : nonzerostatesperblock)
+        nonzerostates += n;
     fprintf(stderr, "forwardbackward: %.3f%% non-zero state posteriors\n", 100.0f - nonzerostates * 100.0f / errorsignal.rows() / errorsignal.cols());
 
     // convert to non-log posterior  --that's what we return
-    foreach_coord (i, j, errorsignal)
-        errorsignal(i, j) = expf(errorsignal(i, j));
+    foreachframeblock(errorsignal.cols(), [&](size_t tbegin, size_t tend)
+                      {
+                          for (size_t j = tbegin; j < tend; j++)
+                              for (size_t i = 0; i < errorsignal.rows(); i++)
+                                  errorsignal(i, j) = expf(errorsignal(i, j));
+                      });
 }
 
 // compute ground truth's score
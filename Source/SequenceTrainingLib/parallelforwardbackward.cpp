@@ -789,16 +789,14 @@ void lattice::parallelforwardbackwardalign(parallelstate& parallelstate,
     }
 }
 
-// parallelforwardbackwardlattice() -- compute the latticelevel logpps using forwardbackward
-double lattice::parallelforwardbackwardlattice(parallelstate& parallelstate, const std::vector<float>& edgeacscores,
-                                               const edgealignments& thisedgealignments, const float lmf, const float wp,
-                                               const float amf, const float boostingfactor, std::vector<double>& logpps,
-                                               std::vector<double>& logalphas, std::vector<double>& logbetas, const bool returnEframescorrect,
-                                               const_array_ref<size_t>& uids, std::vector<double>& logEframescorrect,
-                                               std::vector<double>& Eframescorrectbuf, double& logEframescorrecttotal) const
-{                                     // ^^ TODO: remove this
-    vector<size_t> batchsizeforward;  // record the batch size that exclude the data dependency for forward
-    vector<size_t> batchsizebackward; // record the batch size that exclude the data dependency for backward
+// getforwardbackwardbatches() -- split the edges into consecutive batches that can be processed concurrently
+// The edges of a forward batch only start in nodes that no edge of the batch ends in, and the edges of a backward batch
+// (counted from the end) only end in nodes that no edge of the batch starts in. Hence, each batch only depends on node
+// scores that were completed by the batches before it.
+void lattice::getforwardbackwardbatches(std::vector<size_t>& batchsizeforward, std::vector<size_t>& batchsizebackward) const
+{
+    batchsizeforward.clear();  // record the batch size that exclude the data dependency for forward
+    batchsizebackward.clear(); // record the batch size that exclude the data dependency for backward
 
     size_t endindexforward = edges[0].E;
     size_t countbatchforward = 0;
@@ -831,6 +829,19 @@ double lattice::parallelforwardbackwardlattice(parallelstate& parallelstate, con
     }
     batchsizeforward.push_back(countbatchforward);
     batchsizebackward.push_back(countbatchbackward);
+}
+
+// parallelforwardbackwardlattice() -- compute the latticelevel logpps using forwardbackward
+double lattice::parallelforwardbackwardlattice(parallelstate& parallelstate, const std::vector<float>& edgeacscores,
+                                               const edgealignments& thisedgealignments, const float lmf, const float wp,
+                                               const float amf, const float boostingfactor, std::vector<double>& logpps,
+                                               std::vector<double>& logalphas, std::vector<double>& logbetas, const bool returnEframescorrect,
+                                               const_array_ref<size_t>& uids, std::vector<double>& logEframescorrect,
+                                               std::vector<double>& Eframescorrectbuf, double& logEframescorrecttotal) const
+{                                     // ^^ TODO: remove this
+    vector<size_t> batchsizeforward;  // record the batch size that exclude the data dependency for forward
+    vector<size_t> batchsizebackward; // record the batch size that exclude the data dependency for backward
+    getforwardbackwardbatches(batchsizeforward, batchsizebackward);
 
     std::vector<unsigned short> uidsuint(uids.size()); // actually we shall not do this, but as it will not take much time, let us just leave it here now.
     foreach_index (i, uidsuint)
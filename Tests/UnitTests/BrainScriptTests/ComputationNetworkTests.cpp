@@ -72,6 +72,83 @@ BOOST_AUTO_TEST_CASE(CompareNetworkStructureFromModel)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CompareNetworkStructureFromMemoryMappedModel)
+{
+    wstring computationData = getDataPath() + L"/Data/ComputationNetwork/";
+
+    std::vector<wstring> inputModelPaths = getListOfFilesByExtension(L".dnn", computationData);
+
+    for (auto & modelPath : inputModelPaths)
+    {
+        fprintf(stderr, "Model path: %ls\n", modelPath.c_str());
+
+        // Re-save in the current model format, which stores the parameters page-aligned.
+        wstring currentFormatModelPath = modelPath + L"_CurrentFormat";
+        ComputationNetwork::CreateFromFile<float>(CPUDEVICE, modelPath)->Save(currentFormatModelPath);
+
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        net->SetMemoryMapModel(true);
+        net->Load<float>(currentFormatModelPath);
+        net->DumpNodeInfoToFile(L"", true, true, modelPath + L"_Actual.txt", L"");
+        net.reset(); // releases the mapping of the model file
+
+        compareNetworks(modelPath);
+        remove(ws2s(currentFormatModelPath).c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ReducedPrecisionParameterStorage)
+{
+    wstring computationData = getDataPath() + L"/Data/ComputationNetwork/";
+
+    std::vector<wstring> inputModelPaths = getListOfFilesByExtension(L".dnn", computationData);
+
+    // relative precision of each encoding; int8 is relative to the largest magnitude of the row
+    const std::vector<std::pair<ParameterStorageEncoding, float>> encodings =
+    {
+        { ParameterStorageEncoding::float16,  1.0f / 2048 },
+        { ParameterStorageEncoding::bfloat16, 1.0f / 256 },
+        { ParameterStorageEncoding::int8,     1.0f / 254 },
+    };
+
+    for (auto & modelPath : inputModelPaths)
+    {
+        auto net = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, modelPath);
+        for (const auto& encoding : encodings)
+        {
+            wstring encodedModelPath = modelPath + L"_Encoded";
+            net->SetParameterStorageEncoding(encoding.first);
+            net->Save(encodedModelPath);
+            auto encodedNet = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, encodedModelPath);
+            remove(ws2s(encodedModelPath).c_str());
+
+            for (const auto& node : net->GetNodesWithType(L"LearnableParameter"))
+            {
+                const auto& expected = node->As<ComputationNode<float>>()->Value();
+                const auto& actual = encodedNet->GetNodeFromName(node->NodeName())->As<ComputationNode<float>>()->Value();
+                BOOST_REQUIRE_EQUAL(actual.GetNumRows(), expected.GetNumRows());
+                BOOST_REQUIRE_EQUAL(actual.GetNumCols(), expected.GetNumCols());
+
+                size_t numRows = expected.GetNumRows();
+                for (size_t j = 0; j < expected.GetNumCols(); j++)
+                {
+                    for (size_t i = 0; i < numRows; i++)
+                    {
+                        float reference = fabs(expected(i, j));
+                        if (encoding.first == ParameterStorageEncoding::int8 && expected.GetNumCols() > 1)
+                        {
+                            reference = 0;
+                            for (size_t k = 0; k < expected.GetNumCols(); k++)
+                                reference = std::max(reference, (float)fabs(expected(i, k)));
+                        }
+                        BOOST_CHECK_SMALL(actual(i, j) - expected(i, j), reference * encoding.second + 1e-7f);
+                    }
+                }
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }}}}
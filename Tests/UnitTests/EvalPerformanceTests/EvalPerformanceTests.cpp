@@ -0,0 +1,166 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// EvalPerformanceTests.cpp : latency benchmark of the extended evaluation interface (CNTKEvalExtended).
+//
+// The models are built from BrainScript at startup (with random parameters), so the benchmark needs no model files.
+// Every thread uses its own evaluator instance, as required by the interface. A request of batch size N evaluates
+// N independent sequences with a single ForwardPassBatch().
+//
+
+#include "LatencyBenchmark.h"
+#include "Eval.h"
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+
+struct EvalBenchmarkModel
+{
+    std::string m_name;
+    std::string m_networkDescription; // BrainScriptNetworkBuilder section
+    size_t m_sequenceLength;          // samples per sequence, 1 for non-recurrent models
+};
+
+std::vector<EvalBenchmarkModel> GetBenchmarkModels()
+{
+    return {
+        // Feed-forward acoustic model: 11 frames of 40 filterbanks, 3 sigmoid layers.
+        { "dnn",
+          "BrainScriptNetworkBuilder = [ \n"
+          "    features = Input {440} \n"
+          "    model = Sequential ( \n"
+          "        DenseLayer {1024} : Sigmoid : \n"
+          "        DenseLayer {1024} : Sigmoid : \n"
+          "        DenseLayer {1024} : Sigmoid : \n"
+          "        LinearLayer {2000} \n"
+          "    ) \n"
+          "    z = model (features) \n"
+          "    featureNodes = (features) \n"
+          "    outputNodes = (z) \n"
+          "] \n",
+          1 },
+
+        // MNIST-size convolutional network.
+        { "cnn",
+          "BrainScriptNetworkBuilder = [ \n"
+          "    features = Input {28:28:1} \n"
+          "    model = Sequential ( \n"
+          "        ConvolutionalLayer {32, (5:5), pad = true} : ReLU : \n"
+          "        MaxPoolingLayer {(2:2), stride = (2:2)} : \n"
+          "        ConvolutionalLayer {64, (5:5), pad = true} : ReLU : \n"
+          "        MaxPoolingLayer {(2:2), stride = (2:2)} : \n"
+          "        DenseLayer {256} : ReLU : \n"
+          "        LinearLayer {10} \n"
+          "    ) \n"
+          "    z = model (features) \n"
+          "    featureNodes = (features) \n"
+          "    outputNodes = (z) \n"
+          "] \n",
+          1 },
+
+        // Two layer LSTM over sequences of 20 frames of 80 features.
+        { "lstm",
+          "BrainScriptNetworkBuilder = [ \n"
+          "    features = Input {80} \n"
+          "    model = Sequential ( \n"
+          "        RecurrentLSTMLayer {512} : \n"
+          "        RecurrentLSTMLayer {512} : \n"
+          "        LinearLayer {2000} \n"
+          "    ) \n"
+          "    z = model (features) \n"
+          "    featureNodes = (features) \n"
+          "    outputNodes = (z) \n"
+          "] \n",
+          20 },
+    };
+}
+
+// Evaluator of one thread, together with the input and output buffers of its requests.
+class EvalBenchmarkRequest
+{
+public:
+    EvalBenchmarkRequest(const EvalBenchmarkModel& model, const BenchmarkOptions& options, size_t batchSize, size_t seed)
+        : m_eval(nullptr, [](IEvaluateModelExtended<float>* eval) { eval->Destroy(); })
+    {
+        IEvaluateModelExtended<float>* eval;
+        GetEvalExtendedF(&eval);
+        m_eval.reset(eval);
+
+        std::string config = "deviceId = " + std::string(options.useGPU ? "0" : "-1") + " \n"
+                             "precision = \"float\" \n"
+                             "traceLevel = 0 \n"
+                             "optimizeForInference = " + std::string(options.optimizeForInference ? "true" : "false") + " \n" +
+                             (options.maxSingleThreadedLoopStepSize.empty() ? "" : "maxSingleThreadedLoopStepSize = " + options.maxSingleThreadedLoopStepSize + " \n") +
+                             model.m_networkDescription;
+        m_eval->CreateNetwork(config);
+
+        VariableSchema outputSchema = m_eval->GetOutputSchema();
+        m_eval->StartForwardEvaluation({ outputSchema[0].m_name });
+        VariableSchema inputSchema = m_eval->GetInputSchema();
+        outputSchema = m_eval->GetOutputSchema();
+
+        m_inputs.resize(batchSize);
+        m_outputs.resize(batchSize);
+        for (size_t i = 0; i < batchSize; ++i)
+        {
+            m_inputs[i] = inputSchema.CreateBuffers<float>(std::vector<size_t>(inputSchema.size(), model.m_sequenceLength));
+            for (size_t j = 0; j < inputSchema.size(); ++j)
+            {
+                m_inputs[i][j].m_buffer.resize(inputSchema[j].m_numElements * model.m_sequenceLength);
+                FillBenchmarkInput(m_inputs[i][j].m_buffer, seed * batchSize + i);
+            }
+            m_outputs[i] = outputSchema.CreateBuffers<float>(std::vector<size_t>(outputSchema.size(), model.m_sequenceLength));
+
+            m_inputPointers.push_back(&m_inputs[i]);
+            m_outputPointers.push_back(&m_outputs[i]);
+        }
+    }
+
+    void operator()()
+    {
+        m_eval->ForwardPassBatch(m_inputPointers, m_outputPointers);
+    }
+
+private:
+    std::unique_ptr<IEvaluateModelExtended<float>, void (*)(IEvaluateModelExtended<float>*)> m_eval;
+    std::vector<Values<float>> m_inputs;
+    std::vector<Values<float>> m_outputs;
+    std::vector<const Values<float>*> m_inputPointers;
+    std::vector<Values<float>*> m_outputPointers;
+};
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        BenchmarkOptions options = ParseBenchmarkOptions(argc, argv);
+        BenchmarkReporter reporter("CNTKEvalExtended", options);
+
+        for (const auto& model : GetBenchmarkModels())
+        {
+            if (!options.IncludesModel(model.m_name))
+                continue;
+
+            for (size_t batchSize : options.batchSizes)
+            {
+                for (size_t numThreads : options.threadCounts)
+                {
+                    auto result = RunBenchmark(options, numThreads, batchSize * model.m_sequenceLength, [&](size_t threadIndex) -> BenchmarkRequest
+                    {
+                        auto request = std::make_shared<EvalBenchmarkRequest>(model, options, batchSize, threadIndex);
+                        return [request]() { (*request)(); };
+                    });
+                    reporter.Report(model.m_name, batchSize, numThreads, result);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "EvalPerformanceTests: %s\n", e.what());
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// LatencyBenchmark.h -- measurement and reporting shared by the evaluation latency benchmarks
+//
+// A benchmark run evaluates a model for every combination of batch size and thread count. Every thread sends
+// requests of one batch each, back to back, and the latency of every request is recorded. The results are printed
+// as one JSON object per line (model, api, device, batchSize, threads, latency percentiles, throughput, memory),
+// so they can be collected and compared by scripts; progress messages go to stderr.
+//
+
+#pragma once
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Command line options of a benchmark run, given as name=value pairs, e.g.
+//   batchSizes=1,8,32 threads=1,4 requests=200 models=dnn,lstm device=gpu output=results.json
+// optimizeForInference and maxSingleThreadedLoopStepSize are passed to the network config of the eval interface.
+struct BenchmarkOptions
+{
+    std::vector<size_t> batchSizes{ 1, 8, 32, 128 };
+    std::vector<size_t> threadCounts{ 1, 2, 4 };
+    std::vector<std::string> models;  // empty: all models
+    size_t numWarmupRequests = 5;     // per thread, not measured
+    size_t numRequests = 100;         // per thread
+    bool useGPU = false;
+    bool optimizeForInference = false;
+    std::string maxSingleThreadedLoopStepSize; // empty: the default of CNTK
+    std::string outputFile;           // empty: stdout
+
+    bool IncludesModel(const std::string& model) const
+    {
+        return models.empty() || std::find(models.begin(), models.end(), model) != models.end();
+    }
+};
+
+inline std::vector<std::string> SplitBenchmarkOption(const std::string& value)
+{
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= value.size())
+    {
+        size_t end = value.find(',', begin);
+        if (end == std::string::npos)
+            end = value.size();
+        if (end > begin)
+            items.push_back(value.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+inline size_t ParseBenchmarkCount(const std::string& name, const std::string& value)
+{
+    char* end = nullptr;
+    long long count = strtoll(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || count <= 0)
+        throw std::invalid_argument("Invalid value '" + value + "' for benchmark option '" + name + "', expected a positive number.");
+    return (size_t)count;
+}
+
+inline BenchmarkOptions ParseBenchmarkOptions(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        size_t separator = arg.find('=');
+        if (separator == std::string::npos)
+            throw std::invalid_argument("Invalid benchmark option '" + arg + "', expected name=value.");
+
+        std::string name = arg.substr(0, separator);
+        std::string value = arg.substr(separator + 1);
+        if (name == "batchSizes" || name == "threads")
+        {
+            std::vector<size_t> counts;
+            for (const auto& item : SplitBenchmarkOption(value))
+                counts.push_back(ParseBenchmarkCount(name, item));
+            if (counts.empty())
+                throw std::invalid_argument("Benchmark option '" + name + "' must not be empty.");
+            (name == "batchSizes" ? options.batchSizes : options.threadCounts) = counts;
+        }
+        else if (name == "models")
+            options.models = SplitBenchmarkOption(value);
+        else if (name == "warmup")
+            options.numWarmupRequests = (value == "0") ? 0 : ParseBenchmarkCount(name, value);
+        else if (name == "requests")
+            options.numRequests = ParseBenchmarkCount(name, value);
+        else if (name == "device")
+        {
+            if (value != "cpu" && value != "gpu")
+                throw std::invalid_argument("Invalid value '" + value + "' for benchmark option 'device', expected cpu or gpu.");
+            options.useGPU = (value == "gpu");
+        }
+        else if (name == "optimizeForInference")
+            options.optimizeForInference = (value == "true" || value == "1");
+        else if (name == "maxSingleThreadedLoopStepSize")
+            options.maxSingleThreadedLoopStepSize = std::to_string((value == "0") ? 0 : ParseBenchmarkCount(name, value));
+        else if (name == "output")
+            options.outputFile = value;
+        else
+            throw std::invalid_argument("Unknown benchmark option '" + name + "'.");
+    }
+    return options;
+}
+
+// Memory of the process in bytes: the current and the peak resident set (working set on Windows).
+inline void GetProcessMemoryUsage(size_t& currentBytes, size_t& peakBytes)
+{
+    currentBytes = peakBytes = 0;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        currentBytes = counters.WorkingSetSize;
+        peakBytes = counters.PeakWorkingSetSize;
+    }
+#else
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        unsigned long long totalPages = 0, residentPages = 0;
+        if (fscanf(statm, "%llu %llu", &totalPages, &residentPages) == 2)
+            currentBytes = (size_t)residentPages * (size_t)sysconf(_SC_PAGESIZE);
+        fclose(statm);
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        peakBytes = (size_t)usage.ru_maxrss * 1024; // ru_maxrss is in kilobytes
+#endif
+}
+
+struct BenchmarkResult
+{
+    double latencyP50Ms;
+    double latencyP99Ms;
+    double latencyMeanMs;
+    double latencyMaxMs;
+    double samplesPerSecond;
+    double requestsPerSecond;
+    size_t memoryBytes;       // resident memory after the run
+    size_t peakMemoryBytes;   // peak resident memory of the process so far
+    size_t memoryGrowthBytes; // growth of the resident memory during the run, including setting up the threads' evaluators
+};
+
+// Value at the given percentile (0..100) of sorted values, nearest rank.
+inline double Percentile(const std::vector<double>& sortedValues, double percentile)
+{
+    if (sortedValues.empty())
+        return 0;
+    size_t rank = (size_t)(percentile / 100 * sortedValues.size() + 0.5);
+    rank = std::min(std::max<size_t>(rank, 1), sortedValues.size());
+    return sortedValues[rank - 1];
+}
+
+// A request function evaluates one batch; it is created once per thread, before the measurement starts.
+typedef std::function<void()> BenchmarkRequest;
+
+// Runs numThreads threads, each of which sends options.numWarmupRequests untimed and options.numRequests timed requests,
+// and aggregates the latencies of all timed requests. createRequest(threadIndex) sets up the evaluation of a thread
+// (e.g. its own evaluator instance and input/output buffers); it is called sequentially and is not measured.
+inline BenchmarkResult RunBenchmark(const BenchmarkOptions& options, size_t numThreads, size_t samplesPerRequest, const std::function<BenchmarkRequest(size_t)>& createRequest)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    size_t memoryBefore, peakMemory;
+    GetProcessMemoryUsage(memoryBefore, peakMemory);
+
+    std::vector<BenchmarkRequest> requests;
+    for (size_t i = 0; i < numThreads; ++i)
+        requests.push_back(createRequest(i));
+
+    std::vector<std::vector<double>> latencies(numThreads);
+    std::vector<Clock::time_point> startTimes(numThreads), endTimes(numThreads);
+    std::vector<std::string> errors(numThreads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        threads.push_back(std::thread([&, i]() {
+            try
+            {
+                for (size_t j = 0; j < options.numWarmupRequests; ++j)
+                    requests[i]();
+
+                latencies[i].reserve(options.numRequests);
+                startTimes[i] = Clock::now();
+                auto requestStart = startTimes[i];
+                for (size_t j = 0; j < options.numRequests; ++j)
+                {
+                    requests[i]();
+                    auto requestEnd = Clock::now();
+                    latencies[i].push_back(std::chrono::duration<double, std::milli>(requestEnd - requestStart).count());
+                    requestStart = requestEnd;
+                }
+                endTimes[i] = requestStart;
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+        }));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& error : errors)
+    {
+        if (!error.empty())
+            throw std::runtime_error(error);
+    }
+
+    // The threads finish their warmup at different times; the throughput is measured over the span of all timed requests.
+    std::vector<double> allLatencies;
+    auto firstStart = *std::min_element(startTimes.begin(), startTimes.end());
+    auto lastEnd = *std::max_element(endTimes.begin(), endTimes.end());
+    for (const auto& threadLatencies : latencies)
+        allLatencies.insert(allLatencies.end(), threadLatencies.begin(), threadLatencies.end());
+    std::sort(allLatencies.begin(), allLatencies.end());
+
+    BenchmarkResult result;
+    result.latencyP50Ms = Percentile(allLatencies, 50);
+    result.latencyP99Ms = Percentile(allLatencies, 99);
+    double totalLatency = 0;
+    for (double latency : allLatencies)
+        totalLatency += latency;
+    result.latencyMeanMs = totalLatency / allLatencies.size();
+    result.latencyMaxMs = allLatencies.back();
+
+    double elapsedSeconds = std::max(std::chrono::duration<double>(lastEnd - firstStart).count(), 1e-9);
+    result.requestsPerSecond = allLatencies.size() / elapsedSeconds;
+    result.samplesPerSecond = result.requestsPerSecond * samplesPerRequest;
+
+    GetProcessMemoryUsage(result.memoryBytes, result.peakMemoryBytes);
+    result.memoryGrowthBytes = (result.memoryBytes > memoryBefore) ? result.memoryBytes - memoryBefore : 0;
+    return result;
+}
+
+// Writes the results of a benchmark run as JSON lines.
+class BenchmarkReporter
+{
+public:
+    BenchmarkReporter(const std::string& api, const BenchmarkOptions& options)
+        : m_api(api), m_device(options.useGPU ? "gpu" : "cpu"), m_optimized(options.optimizeForInference),
+          m_maxSingleThreadedLoopStepSize(options.maxSingleThreadedLoopStepSize.empty() ? "null" : options.maxSingleThreadedLoopStepSize), m_file(stdout)
+    {
+        if (!options.outputFile.empty())
+        {
+            m_file = fopen(options.outputFile.c_str(), "w");
+            if (!m_file)
+                throw std::runtime_error("Cannot open benchmark output file '" + options.outputFile + "'.");
+        }
+    }
+
+    ~BenchmarkReporter()
+    {
+        if (m_file != stdout)
+            fclose(m_file);
+    }
+
+    void Report(const std::string& model, size_t batchSize, size_t numThreads, const BenchmarkResult& result)
+    {
+        fprintf(m_file, "{\"model\": \"%s\", \"api\": \"%s\", \"device\": \"%s\", \"optimizeForInference\": %s, \"maxSingleThreadedLoopStepSize\": %s, "
+                        "\"batchSize\": %d, \"threads\": %d, "
+                        "\"latencyP50Ms\": %.4f, \"latencyP99Ms\": %.4f, \"latencyMeanMs\": %.4f, \"latencyMaxMs\": %.4f, "
+                        "\"samplesPerSecond\": %.2f, \"requestsPerSecond\": %.2f, "
+                        "\"memoryMB\": %.2f, \"peakMemoryMB\": %.2f, \"memoryGrowthMB\": %.2f}\n",
+                model.c_str(), m_api.c_str(), m_device.c_str(), m_optimized ? "true" : "false", m_maxSingleThreadedLoopStepSize.c_str(), (int)batchSize, (int)numThreads,
+                result.latencyP50Ms, result.latencyP99Ms, result.latencyMeanMs, result.latencyMaxMs,
+                result.samplesPerSecond, result.requestsPerSecond,
+                result.memoryBytes / 1048576.0, result.peakMemoryBytes / 1048576.0, result.memoryGrowthBytes / 1048576.0);
+        fflush(m_file);
+
+        fprintf(stderr, "%s/%s: batchSize=%d threads=%d p50=%.3fms p99=%.3fms %.1f samples/s\n",
+                m_api.c_str(), model.c_str(), (int)batchSize, (int)numThreads, result.latencyP50Ms, result.latencyP99Ms, result.samplesPerSecond);
+    }
+
+private:
+    std::string m_api;
+    std::string m_device;
+    bool m_optimized;
+    std::string m_maxSingleThreadedLoopStepSize; // JSON number, or null for the default
+    FILE* m_file;
+
+    BenchmarkReporter(const BenchmarkReporter&) = delete;
+    BenchmarkReporter& operator=(const BenchmarkReporter&) = delete;
+};
+
+// Deterministic pseudo-random input data in [-1, 1), so that runs are comparable.
+inline void FillBenchmarkInput(std::vector<float>& data, size_t seed)
+{
+    unsigned int state = (unsigned int)(seed * 2654435761u + 1);
+    for (auto& value : data)
+    {
+        state = state * 1664525u + 1013904223u;
+        value = (float)(state >> 8) / (float)(1 << 24) * 2 - 1;
+    }
+}
@@ -0,0 +1,128 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// V2LibraryPerformanceTests.cpp : latency benchmark of the evaluation through the V2 Function API.
+//
+// The models have the same architectures as those of EvalPerformanceTests and are built with the V2 C++ API (with
+// random parameters). All threads evaluate the same Function instance concurrently. A request of batch size N
+// evaluates N independent sequences with a single Forward() into a preallocated output Value.
+//
+
+#include "LatencyBenchmark.h"
+#include "CNTKLibrary.h"
+#include "../V2LibraryTests/Common.h"
+
+using namespace CNTK;
+
+// Dense layer with a bias over an input of any rank: the weights are contracted with the whole input shape.
+FunctionPtr DenseLayer(const Variable& input, size_t outputDim, const DeviceDescriptor& device)
+{
+    auto weights = Parameter(NDShape({ outputDim }).AppendShape(input.Shape()), DataType::Float, GlorotUniformInitializer(), device);
+    auto bias = Parameter({ outputDim }, 0.0f, device);
+    return Plus(bias, Times(weights, input));
+}
+
+// Convolution of a [W x H x C] input with 'pad = true' and a bias per output channel.
+FunctionPtr ConvolutionLayer(const Variable& input, size_t numOutputChannels, size_t kernelWidth, size_t kernelHeight, const DeviceDescriptor& device)
+{
+    size_t numInputChannels = input.Shape()[input.Shape().Rank() - 1];
+    auto convParams = Parameter({ kernelWidth, kernelHeight, numInputChannels, numOutputChannels }, DataType::Float, GlorotUniformInitializer(-1, 2), device);
+    auto bias = Parameter({ 1, 1, numOutputChannels }, 0.0f, device);
+    return Plus(bias, Convolution(convParams, input, { 1, 1, numInputChannels }));
+}
+
+struct V2BenchmarkModel
+{
+    std::string m_name;
+    NDShape m_inputShape;
+    size_t m_sequenceLength; // samples per sequence, 1 for non-recurrent models
+    std::function<FunctionPtr(const Variable&, const DeviceDescriptor&)> m_create;
+};
+
+std::vector<V2BenchmarkModel> GetBenchmarkModels()
+{
+    return {
+        // Feed-forward acoustic model: 11 frames of 40 filterbanks, 3 sigmoid layers.
+        { "dnn", { 440 }, 1, [](const Variable& features, const DeviceDescriptor& device)
+        {
+            FunctionPtr h = features;
+            for (size_t i = 0; i < 3; ++i)
+                h = Sigmoid(DenseLayer(h, 1024, device));
+            return DenseLayer(h, 2000, device);
+        } },
+
+        // MNIST-size convolutional network.
+        { "cnn", { 28, 28, 1 }, 1, [](const Variable& features, const DeviceDescriptor& device)
+        {
+            auto c1 = Pooling(ReLU(ConvolutionLayer(features, 32, 5, 5, device)), PoolingType::Max, { 2, 2 }, { 2, 2 });
+            auto c2 = Pooling(ReLU(ConvolutionLayer(c1, 64, 5, 5, device)), PoolingType::Max, { 2, 2 }, { 2, 2 });
+            return DenseLayer(ReLU(DenseLayer(c2, 256, device)), 10, device);
+        } },
+
+        // Two layer LSTM over sequences of 20 frames of 80 features.
+        { "lstm", { 80 }, 20, [](const Variable& features, const DeviceDescriptor& device)
+        {
+            auto pastValueRecurrenceHook = [](const Variable& x) { return PastValue(x); };
+            FunctionPtr h = features;
+            for (size_t i = 0; i < 2; ++i)
+                h = LSTMPComponentWithSelfStabilization<float>(h, { 512 }, { 512 }, pastValueRecurrenceHook, pastValueRecurrenceHook, device).first;
+            return DenseLayer(h, 2000, device);
+        } },
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        BenchmarkOptions options = ParseBenchmarkOptions(argc, argv);
+        if (options.optimizeForInference)
+            throw std::invalid_argument("optimizeForInference is only supported by EvalPerformanceTests.");
+
+        BenchmarkReporter reporter("V2Function", options);
+        DeviceDescriptor device = options.useGPU ? DeviceDescriptor::GPUDevice(0) : DeviceDescriptor::CPUDevice();
+
+        for (const auto& model : GetBenchmarkModels())
+        {
+            if (!options.IncludesModel(model.m_name))
+                continue;
+
+            auto features = InputVariable(model.m_inputShape, DataType::Float, L"features");
+            auto function = model.m_create(features, device);
+            auto output = function->Output();
+
+            for (size_t batchSize : options.batchSizes)
+            {
+                for (size_t numThreads : options.threadCounts)
+                {
+                    auto result = RunBenchmark(options, numThreads, batchSize * model.m_sequenceLength, [&](size_t threadIndex) -> BenchmarkRequest
+                    {
+                        // All sequences have the same length, so the output has no gaps and can be preallocated.
+                        std::vector<std::vector<float>> sequences(batchSize, std::vector<float>(model.m_inputShape.TotalSize() * model.m_sequenceLength));
+                        for (size_t i = 0; i < batchSize; ++i)
+                            FillBenchmarkInput(sequences[i], threadIndex * batchSize + i);
+                        ValuePtr inputValue = Value::Create(model.m_inputShape, sequences, device, true);
+
+                        NDShape outputShape = output.Shape().AppendShape({ model.m_sequenceLength, batchSize });
+                        ValuePtr outputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(DataType::Float, outputShape, device));
+
+                        return [function, features, output, inputValue, outputValue, device]()
+                        {
+                            std::unordered_map<Variable, ValuePtr> outputs = { { output, outputValue } };
+                            function->Forward({ { features, inputValue } }, outputs, device);
+                        };
+                    });
+                    reporter.Report(model.m_name, batchSize, numThreads, result);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "V2LibraryPerformanceTests: %s\n", e.what());
+        return -1;
+    }
+
+    return 0;
+}
@@ -7,6 +7,9 @@
 #include "EvalTestHelper.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <atomic>
+#include <cmath>
+#include <thread>
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -420,5 +423,396 @@ BOOST_AUTO_TEST_CASE(EvalRNNTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalRNNSessionTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "dh = PastValue(2, o1, timeStep = 1) \n"
+        "o1 = Plus(Times(Constant(0.5, rows=2, cols=2), dh), i1, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    const size_t numSessions = 3;
+    const size_t streamLength = 6;
+    const size_t dim = 2;
+
+    // Evaluate every stream as a whole for reference.
+    std::vector<std::vector<float>> streams(numSessions);
+    std::vector<std::vector<float>> expected(numSessions);
+    for (size_t k = 0; k < numSessions; ++k)
+    {
+        for (size_t i = 0; i < streamLength * dim; ++i)
+            streams[k].push_back((float)(k * 10 + i));
+
+        Values<float> inputBuffer(1);
+        inputBuffer[0].m_buffer = streams[k];
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ streamLength });
+        eval->ForwardPass(inputBuffer, outputBuffer);
+        expected[k] = outputBuffer[0].m_buffer;
+    }
+
+    // Advance the sessions together, session k by chunks of k + 1 samples.
+    std::vector<size_t> sessions;
+    for (size_t k = 0; k < numSessions; ++k)
+        sessions.push_back(eval->CreateSession());
+
+    std::vector<std::vector<float>> results(numSessions);
+    std::vector<size_t> positions(numSessions, 0);
+    for (;;)
+    {
+        std::vector<size_t> sessionIds;
+        std::vector<Values<float>> chunkInputs(numSessions);
+        std::vector<Values<float>> chunkOutputs(numSessions);
+        std::vector<const Values<float>*> inputs;
+        std::vector<Values<float>*> outputs;
+        for (size_t k = 0; k < numSessions; ++k)
+        {
+            size_t chunkSize = std::min(k + 1, streamLength - positions[k]);
+            if (chunkSize == 0)
+                continue;
+
+            chunkInputs[k].resize(1);
+            chunkInputs[k][0].m_buffer.assign(streams[k].begin() + positions[k] * dim, streams[k].begin() + (positions[k] + chunkSize) * dim);
+            chunkOutputs[k] = outputLayouts.CreateBuffers<float>({ chunkSize });
+            sessionIds.push_back(sessions[k]);
+            inputs.push_back(&chunkInputs[k]);
+            outputs.push_back(&chunkOutputs[k]);
+            positions[k] += chunkSize;
+        }
+
+        if (sessionIds.empty())
+            break;
+
+        eval->ForwardPassSessions(sessionIds, inputs, outputs);
+        for (size_t k = 0; k < numSessions; ++k)
+        {
+            if (!chunkOutputs[k].empty())
+                results[k].insert(results[k].end(), chunkOutputs[k][0].m_buffer.begin(), chunkOutputs[k][0].m_buffer.end());
+        }
+    }
+
+    for (size_t k = 0; k < numSessions; ++k)
+    {
+        BOOST_REQUIRE_EQUAL(results[k].size(), expected[k].size());
+        for (size_t i = 0; i < results[k].size(); ++i)
+            BOOST_CHECK_CLOSE(results[k][i], expected[k][i], 1e-4);
+    }
+
+    // A destroyed session cannot be advanced.
+    eval->DestroySession(sessions[0]);
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 1, 2 };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+    BOOST_REQUIRE_THROW(eval->ForwardPassSessions({ sessions[0] }, { &inputBuffer }, { &outputBuffer }), std::exception);
+
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBatchingStressTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(4) \n"
+        "o1 = Plus(Times(Constant(2, rows=3, cols=4), i1), Constant(1, rows=3, cols=1), tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    IEvaluateModelBatching<float> *batching;
+    GetEvalBatchingF(eval, 16, 1.0, &batching);
+
+    // Many threads submit requests of one or two samples, so batches mix sequences of different lengths.
+    const size_t numThreads = 8;
+    const size_t numRequestsPerThread = 200;
+    std::atomic<size_t> numErrors(0);
+    std::atomic<size_t> numMismatches(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        threads.push_back(std::thread([&, i]()
+        {
+            Values<float> inputBuffer(1);
+            Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 2 });
+            for (size_t j = 0; j < numRequestsPerThread; ++j)
+            {
+                size_t numSamples = 1 + j % 2;
+                inputBuffer[0].m_buffer.clear();
+                for (size_t k = 0; k < 4 * numSamples; ++k)
+                    inputBuffer[0].m_buffer.push_back((float)(i + j + k));
+
+                try
+                {
+                    batching->Evaluate(inputBuffer, outputBuffer);
+                }
+                catch (const std::exception&)
+                {
+                    numErrors++;
+                    continue;
+                }
+
+                std::vector<float> expected;
+                for (size_t t = 0; t < numSamples; ++t)
+                {
+                    float sum = 0;
+                    for (size_t k = 0; k < 4; ++k)
+                        sum += inputBuffer[0].m_buffer[t * 4 + k];
+                    expected.insert(expected.end(), 3, 2 * sum + 1);
+                }
+
+                if (outputBuffer[0].m_buffer != expected)
+                    numMismatches++;
+            }
+        }));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    BOOST_CHECK_EQUAL(numErrors.load(), 0);
+    BOOST_CHECK_EQUAL(numMismatches.load(), 0);
+
+    auto statistics = batching->GetStatistics();
+    fprintf(stderr, "Batching: %" PRIu64 " requests in %" PRIu64 " batches, average latency %.3f ms, max latency %.3f ms, %.1f requests/s\n",
+            statistics.m_numRequests, statistics.m_numBatches, statistics.m_averageLatencyInMs, statistics.m_maxLatencyInMs, statistics.m_requestsPerSecond);
+    BOOST_CHECK_EQUAL(statistics.m_numRequests, numThreads * numRequestsPerThread);
+    BOOST_CHECK(statistics.m_numBatches <= statistics.m_numRequests);
+    BOOST_CHECK(statistics.m_maxLatencyInMs >= statistics.m_averageLatencyInMs);
+
+    // The error of an invalid request is reported to its caller.
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 1, 2, 3 };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+    BOOST_REQUIRE_THROW(batching->Evaluate(inputBuffer, outputBuffer), std::exception);
+
+    batching->ResetStatistics();
+    BOOST_CHECK_EQUAL(batching->GetStatistics().m_numRequests, 0);
+
+    batching->Destroy();
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalOptimizeForInferenceTest)
+{
+    // The weights and the bias are computed from Constants only and get folded; 'unused' gets removed.
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(4) \n"
+        "W = Times(Constant(2, rows=3, cols=1), Constant(1, rows=1, cols=4)) \n"
+        "b = Plus(Constant(1, rows=3, cols=1), Constant(0.5, rows=3, cols=1)) \n"
+        "o1 = Plus(Times(W, i1), b, tag=\"output\") \n"
+        "unused = Times(Constant(3, rows=2, cols=4), i1) \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float>* eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+    VariableSchema optimizedInputLayouts;
+    VariableSchema optimizedOutputLayouts;
+    IEvaluateModelExtended<float>* optimizedEval = SetupNetworkAndGetLayouts(modelDefinition + "optimizeForInference = true \n", optimizedInputLayouts, optimizedOutputLayouts);
+
+    BOOST_REQUIRE_EQUAL(optimizedInputLayouts.size(), 1);
+    BOOST_REQUIRE_EQUAL(optimizedOutputLayouts.size(), 1);
+    BOOST_CHECK(optimizedOutputLayouts[0].m_name == outputLayouts[0].m_name);
+    BOOST_CHECK_EQUAL(optimizedOutputLayouts[0].m_numElements, outputLayouts[0].m_numElements);
+
+    // Both networks compute the same outputs.
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 1, 2, 3, 4, -1, 0, 1, 0.5 };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 2 });
+    Values<float> optimizedOutputBuffer = optimizedOutputLayouts.CreateBuffers<float>({ 2 });
+    eval->ForwardPass(inputBuffer, outputBuffer);
+    optimizedEval->ForwardPass(inputBuffer, optimizedOutputBuffer);
+
+    std::vector<float> expected{ 21.5, 21.5, 21.5, 2.5, 2.5, 2.5 };
+    auto buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+    auto optimizedBuf = optimizedOutputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(optimizedBuf.begin(), optimizedBuf.end(), expected.begin(), expected.end());
+
+    optimizedEval->Destroy();
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalHoistLoopInvariantProjectionsTest)
+{
+    // The product of W with the stacked input and recurrent state is inside the loop; the part for i1 gets moved out of it.
+    // The evaluation interface does not expose the network, so the new loop structure is checked by the network tests
+    // (HoistLoopInvariantProjectionsMovesInputProjectionOutOfLoop); this checks the outputs through the evaluation library.
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "W = Parameter(3, 5, init=\"uniform\", randomSeed=1) \n"
+        "delay = PastValue(3, h, timeStep=1) \n"
+        "h = Tanh(Times(W, RowStack(i1, delay)), tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float>* eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+    VariableSchema hoistedInputLayouts;
+    VariableSchema hoistedOutputLayouts;
+    IEvaluateModelExtended<float>* hoistedEval = SetupNetworkAndGetLayouts(modelDefinition + "hoistLoopInvariantProjections = true \n", hoistedInputLayouts, hoistedOutputLayouts);
+
+    BOOST_REQUIRE_EQUAL(hoistedOutputLayouts.size(), 1);
+    BOOST_CHECK(hoistedOutputLayouts[0].m_name == outputLayouts[0].m_name);
+    BOOST_CHECK_EQUAL(hoistedOutputLayouts[0].m_numElements, 3);
+
+    // Both networks compute the same outputs for a sequence of 4 frames.
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 1, 2, -1, 0.5, 0, 3, 0.25, -2 };
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 4 });
+    Values<float> hoistedOutputBuffer = hoistedOutputLayouts.CreateBuffers<float>({ 4 });
+    eval->ForwardPass(inputBuffer, outputBuffer);
+    hoistedEval->ForwardPass(inputBuffer, hoistedOutputBuffer);
+
+    const auto& buf = outputBuffer[0].m_buffer;
+    const auto& hoistedBuf = hoistedOutputBuffer[0].m_buffer;
+    BOOST_REQUIRE_EQUAL(buf.size(), 12);
+    BOOST_REQUIRE_EQUAL(hoistedBuf.size(), 12);
+    for (size_t i = 0; i < buf.size(); ++i)
+        BOOST_CHECK_SMALL(hoistedBuf[i] - buf[i], 1e-5f);
+
+    hoistedEval->Destroy();
+    eval->Destroy();
+}
+
+BOOST_AUTO_TEST_CASE(EvalBeamSearchTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(6) \n"
+        "W = Parameter(8, 6, init=\"uniform\", initValueScale=20, randomSeed=1) \n"
+        "U = Parameter(8, 8, init=\"uniform\", initValueScale=20, randomSeed=2) \n"
+        "Wo = Parameter(6, 8, init=\"uniform\", initValueScale=40, randomSeed=3) \n"
+        "dh = PastValue(8, h, timeStep = 1) \n"
+        "h = Tanh(Plus(Times(W, i1), Times(U, dh))) \n"
+        "o1 = Times(Wo, h, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    const size_t vocabularySize = 6;
+    const size_t endSymbol = 5;
+    const size_t maxLength = 8;
+    const std::vector<std::vector<size_t>> prefixes = { { 0 }, { 1, 2 }, { 0, 4, 4 }, { 3 } };
+
+    // Log probabilities of the token following each token of a sequence, evaluating the sequence as a whole.
+    auto logProbabilities = [&](const std::vector<size_t>& tokens)
+    {
+        Values<float> inputBuffer(1);
+        inputBuffer[0].m_buffer.assign(tokens.size() * vocabularySize, 0);
+        for (size_t t = 0; t < tokens.size(); ++t)
+            inputBuffer[0].m_buffer[t * vocabularySize + tokens[t]] = 1;
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ tokens.size() });
+        eval->ForwardPass(inputBuffer, outputBuffer);
+
+        std::vector<double> result(outputBuffer[0].m_buffer.begin(), outputBuffer[0].m_buffer.end());
+        for (size_t t = 0; t < tokens.size(); ++t)
+        {
+            double sum = 0;
+            for (size_t i = 0; i < vocabularySize; ++i)
+                sum += std::exp(result[t * vocabularySize + i]);
+            for (size_t i = 0; i < vocabularySize; ++i)
+                result[t * vocabularySize + i] -= std::log(sum);
+        }
+        return result;
+    };
+
+    // With a beam width of 1, the search is greedy.
+    IEvaluateModelBeamSearch<float>* beamSearch;
+    GetEvalBeamSearchF(eval, 1, endSymbol, maxLength, &beamSearch);
+    std::vector<std::vector<size_t>> results;
+    std::vector<double> scores;
+    beamSearch->Decode(prefixes, results, scores);
+    BOOST_REQUIRE_EQUAL(results.size(), prefixes.size());
+    for (size_t n = 0; n < prefixes.size(); ++n)
+    {
+        std::vector<size_t> tokens = prefixes[n];
+        std::vector<size_t> expected;
+        double expectedScore = 0;
+        while (expected.empty() || (expected.back() != endSymbol && expected.size() < maxLength))
+        {
+            auto logP = logProbabilities(tokens);
+            auto last = logP.begin() + (tokens.size() - 1) * vocabularySize;
+            size_t token = std::max_element(last, last + vocabularySize) - last;
+            expectedScore += last[token];
+            expected.push_back(token);
+            tokens.push_back(token);
+        }
+
+        BOOST_CHECK_EQUAL_COLLECTIONS(results[n].begin(), results[n].end(), expected.begin(), expected.end());
+        BOOST_CHECK_SMALL(scores[n] - expectedScore, 1e-3);
+    }
+
+    beamSearch->Destroy();
+
+    // With a wider beam, the hypotheses are reordered between the sessions. The score of every result must still be
+    // its log probability, and decoding a sequence on its own must give the same result as decoding it with the others.
+    GetEvalBeamSearchF(eval, 3, endSymbol, maxLength, &beamSearch);
+    beamSearch->Decode(prefixes, results, scores);
+    BOOST_REQUIRE_EQUAL(results.size(), prefixes.size());
+    for (size_t n = 0; n < prefixes.size(); ++n)
+    {
+        BOOST_REQUIRE(!results[n].empty());
+        BOOST_CHECK(results[n].back() == endSymbol || results[n].size() == maxLength);
+
+        std::vector<size_t> tokens = prefixes[n];
+        tokens.insert(tokens.end(), results[n].begin(), results[n].end() - 1);
+        auto logP = logProbabilities(tokens);
+        double expectedScore = 0;
+        for (size_t t = 0; t < results[n].size(); ++t)
+            expectedScore += logP[(prefixes[n].size() - 1 + t) * vocabularySize + results[n][t]];
+        BOOST_CHECK_SMALL(scores[n] - expectedScore, 1e-3);
+
+        std::vector<std::vector<size_t>> singleResults;
+        std::vector<double> singleScores;
+        beamSearch->Decode({ prefixes[n] }, singleResults, singleScores);
+        BOOST_CHECK_EQUAL_COLLECTIONS(singleResults[0].begin(), singleResults[0].end(), results[n].begin(), results[n].end());
+        BOOST_CHECK_SMALL(singleScores[0] - scores[n], 1e-3);
+    }
+
+    BOOST_REQUIRE_THROW(beamSearch->Decode({ {} }, results, scores), std::exception);                 // Empty prefix
+    BOOST_REQUIRE_THROW(beamSearch->Decode({ { vocabularySize } }, results, scores), std::exception); // Token out of the vocabulary
+
+    beamSearch->Destroy();
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
\ No newline at end of file
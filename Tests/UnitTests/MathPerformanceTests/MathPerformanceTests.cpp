@@ -336,10 +336,88 @@ void MandSTest(int count, int devId)
     delete[] data3;
 }
 
+// CRF forward pass and Viterbi decoding as CRFNode and SequenceDecoderNode computed them with element access,
+// against the CPUMatrix kernels. Wall clock time, since the kernels are multi-threaded.
+template <class ElemType>
+void RCRFTest(int numLabels, int numPositions)
+{
+    cout << "Testing RCRF with " << numLabels << " labels and " << numPositions << " positions" << endl;
+    Matrix<ElemType> posScores((size_t) numLabels, (size_t) numPositions, CPUDEVICE);
+    randomInitializeMatrix<ElemType>(posScores, -5, 5);
+    Matrix<ElemType> pairScores((size_t) numLabels, (size_t) numLabels, CPUDEVICE);
+    randomInitializeMatrix<ElemType>(pairScores, -5, 5);
+    const int startLbl = 0;
+
+    Matrix<ElemType> alphaRef((size_t) numLabels, (size_t) numPositions, CPUDEVICE);
+    auto t_start = chrono::high_resolution_clock::now();
+    for (int t = 0; t < numPositions; t++)
+    {
+        for (int k = 0; k < numLabels; k++)
+        {
+            ElemType fTmp = (ElemType) LZERO;
+            for (int j = 0; j < numLabels; j++)
+            {
+                ElemType fAlpha = t > 0 ? alphaRef(j, t - 1) : (j == startLbl ? (ElemType) 0.0 : (ElemType) LZERO);
+                fTmp = alphaRef.LogAdd(fTmp, fAlpha + pairScores(k, j));
+            }
+            alphaRef(k, t) = fTmp + posScores(k, t);
+        }
+    }
+    chrono::duration<double> refTime = chrono::high_resolution_clock::now() - t_start;
+
+    Matrix<ElemType> alpha(CPUDEVICE);
+    t_start = chrono::high_resolution_clock::now();
+    Matrix<ElemType>::RCRFForwardCompute(posScores, pairScores, alpha, startLbl);
+    chrono::duration<double> kernelTime = chrono::high_resolution_clock::now() - t_start;
+
+    ElemType maxDiff = 0;
+    foreach_coord (i, j, alpha)
+        maxDiff = max(maxDiff, (ElemType) fabs(alpha(i, j) - alphaRef(i, j)));
+    cout << "forward: element access in " << refTime.count() << " seconds, kernel in " << kernelTime.count()
+         << " seconds (" << refTime.count() / kernelTime.count() << "x), max difference " << maxDiff << endl;
+
+    Matrix<ElemType> deltaRef((size_t) numLabels, (size_t) numPositions, CPUDEVICE);
+    t_start = chrono::high_resolution_clock::now();
+    for (int t = 0; t < numPositions; t++)
+    {
+        for (int k = 0; k < numLabels; k++)
+        {
+            ElemType fTmp = (ElemType) LZERO;
+            if (t > 1)
+            {
+                for (int j = 0; j < numLabels; j++)
+                    fTmp = max(fTmp, deltaRef(j, t - 1) + pairScores(k, j));
+                fTmp += posScores(k, t);
+            }
+            else if (t == 1)
+                fTmp = deltaRef(startLbl, 0) + pairScores(k, startLbl) + posScores(k, t);
+            else
+                fTmp = (k == startLbl) ? posScores(k, t) : (ElemType) LZERO;
+            deltaRef(k, t) = fTmp;
+        }
+    }
+    refTime = chrono::high_resolution_clock::now() - t_start;
+
+    Matrix<ElemType> delta(CPUDEVICE), backtrace(CPUDEVICE);
+    t_start = chrono::high_resolution_clock::now();
+    Matrix<ElemType>::RCRFViterbiCompute(posScores, pairScores, delta, backtrace, startLbl);
+    kernelTime = chrono::high_resolution_clock::now() - t_start;
+
+    maxDiff = 0;
+    foreach_coord (i, j, delta)
+        maxDiff = max(maxDiff, (ElemType) fabs(delta(i, j) - deltaRef(i, j)));
+    cout << "Viterbi: element access in " << refTime.count() << " seconds, kernel in " << kernelTime.count()
+         << " seconds (" << refTime.count() / kernelTime.count() << "x), max difference " << maxDiff << endl;
+}
+
 int wmain()
 {
     // MandSTest<float>(100, 2);
 
+    cout << endl << "********************RCRF TEST********************" << endl;
+    RCRFTest<float>(50, 100);
+    RCRFTest<float>(500, 100);
+
     /*cout<<endl<<"********************Matrix SquareMultiplyAndWeightedAdd10TimesAvg TEST********************"<<endl;
     SquareMultiplyAndAdd10TimesAvgTest<float>(4096,10);
 
@@ -0,0 +1,57 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "../../../Source/Math/AliasSampler.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(AliasSamplerUnitTests)
+
+BOOST_FIXTURE_TEST_CASE(AliasSamplerFrequencies, RandomSeedFixture)
+{
+    const std::vector<float> weights = { 1.0f, 0.0f, 7.0f, 2.0f, 0.5f, 4.5f, 0.0f, 5.0f };
+    const size_t numDraws = 1000000;
+
+    AliasSampler sampler;
+    sampler.Build(weights);
+    BOOST_CHECK_EQUAL(sampler.Size(), weights.size());
+
+    std::mt19937 generator(42);
+    std::vector<size_t> counts(weights.size(), 0);
+    for (size_t i = 0; i < numDraws; i++)
+        counts[sampler.Sample(generator)]++;
+
+    for (size_t i = 0; i < weights.size(); i++)
+    {
+        double p = weights[i] / 20.0;
+        BOOST_CHECK_CLOSE(sampler.Probability(i), p, 1e-4);
+        // 5 standard deviations of the binomial distribution
+        BOOST_CHECK_SMALL((double) counts[i] / numDraws - p, 5 * sqrt(p * (1 - p) / numDraws) + 1e-12);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(AliasSamplerSingleClass, RandomSeedFixture)
+{
+    AliasSampler sampler;
+    sampler.Build(std::vector<double>{ 0, 0, 3, 0 });
+
+    std::mt19937 generator(7);
+    for (size_t i = 0; i < 1000; i++)
+        BOOST_CHECK_EQUAL(sampler.Sample(generator), 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(AliasSamplerInvalidWeights, RandomSeedFixture)
+{
+    AliasSampler sampler;
+    BOOST_CHECK_THROW(sampler.Build(std::vector<float>{}), std::invalid_argument);
+    BOOST_CHECK_THROW(sampler.Build(std::vector<float>{ 0, 0 }), std::invalid_argument);
+    BOOST_CHECK_THROW(sampler.Build(std::vector<float>{ 1, -1 }), std::invalid_argument);
+    BOOST_CHECK_THROW(sampler.Build(std::vector<double>{ 1, std::numeric_limits<double>::infinity() }), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
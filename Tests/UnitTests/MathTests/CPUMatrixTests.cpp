@@ -626,6 +626,23 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixColumnSlice, RandomSeedFixture)
     BOOST_CHECK(mC.IsEqualTo(mD, c_epsilonFloatE4));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixCopySection, RandomSeedFixture)
+{
+    DMatrix m0(3, 4);
+    m0.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+    // the top 2 x 3 section, into a buffer with a column stride of 5
+    std::vector<double> buffer(5 * 3, 0);
+    m0.CopySection(2, 3, buffer.data(), 5);
+    for (size_t j = 0; j < 3; j++)
+    {
+        for (size_t i = 0; i < 5; i++)
+            BOOST_CHECK_EQUAL(buffer[j * 5 + i], i < 2 ? m0(i, j) : 0);
+    }
+
+    BOOST_CHECK_THROW(m0.CopySection(4, 1, buffer.data(), 5), std::invalid_argument);
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUKhatriRaoProduct, RandomSeedFixture)
 {
     DMatrix mA(3, 4);
@@ -898,6 +915,146 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixSeedingDouble, RandomSeedFixture)
     BOOST_CHECK(m1.IsEqualTo(m2));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixSingleThreadedOperations, RandomSeedFixture)
+{
+    // the setting only affects the calling thread, and operations give the same results with it
+    CPUMatrix<float> m = CPUMatrix<float>::RandomUniform(64, 64, -1, 1, IncrementCounter());
+    CPUMatrix<float> expected(64, 64);
+    expected.AssignSigmoidOf(m);
+
+    int numThreads = CPUMatrix<float>::SetNumThreadsOfCallingThread(1);
+    CPUMatrix<float> actual(64, 64);
+    actual.AssignSigmoidOf(m);
+    BOOST_CHECK_EQUAL(CPUMatrix<float>::SetNumThreadsOfCallingThread(numThreads), 1);
+
+    BOOST_CHECK(actual.IsEqualTo(expected));
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixVectorMaxTopK, RandomSeedFixture)
+{
+    // the topK values of every column in descending order, against a full sort of the column
+    const int numRows = 1000;
+    const int numCols = 13;
+    const int topK = 5;
+    CPUMatrix<float> m = CPUMatrix<float>::RandomUniform(numRows, numCols, -1, 1, IncrementCounter());
+    CPUMatrix<float> maxIndexes;
+    CPUMatrix<float> maxValues;
+    m.VectorMax(maxIndexes, maxValues, true, topK);
+    BOOST_REQUIRE_EQUAL(maxValues.GetNumRows(), topK);
+    BOOST_REQUIRE_EQUAL(maxValues.GetNumCols(), numCols);
+
+    for (int j = 0; j < numCols; j++)
+    {
+        std::vector<float> column(numRows);
+        for (int i = 0; i < numRows; i++)
+            column[i] = m(i, j);
+        std::sort(column.begin(), column.end(), std::greater<float>());
+        for (int i = 0; i < topK; i++)
+        {
+            BOOST_CHECK_EQUAL(maxValues(i, j), column[i]);
+            BOOST_CHECK_EQUAL(m((size_t) maxIndexes(i, j), j), column[i]);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixRCRFComputations, RandomSeedFixture)
+{
+    // the kernels against a direct implementation of the recursions, with the normalizers recomputed for every term
+    const int numLabels = 7;
+    const int numPositions = 9;
+    const int startLbl = 2;
+    DMatrix posScores = DMatrix::RandomUniform(numLabels, numPositions, -2, 2, IncrementCounter());
+    DMatrix pairScores = DMatrix::RandomUniform(numLabels, numLabels, -2, 2, IncrementCounter());
+    DMatrix lbls(numLabels, numPositions);
+    lbls.SetValue(0);
+    std::vector<int> labels(numPositions);
+    for (int t = 0; t < numPositions; t++)
+    {
+        labels[t] = t == 0 ? startLbl : (t * 5 + 3) % numLabels;
+        lbls(labels[t], t) = 1;
+    }
+
+    auto logSumExp = [](const std::vector<double>& v)
+    {
+        double maxVal = *std::max_element(v.begin(), v.end());
+        double sum = 0;
+        for (double x : v)
+            sum += exp(x - maxVal);
+        return maxVal + log(sum);
+    };
+    auto prevAlpha = [&](const DMatrix& alpha, int j, int t)
+    {
+        return t > 0 ? alpha(j, t - 1) : (j == startLbl ? 0.0 : (double) LZERO);
+    };
+    auto zeta = [&](const DMatrix& alpha, int j, int t) // normalizer of the transitions into j at position t
+    {
+        std::vector<double> terms(numLabels);
+        for (int m = 0; m < numLabels; m++)
+            terms[m] = prevAlpha(alpha, m, t) + pairScores(j, m);
+        return logSumExp(terms);
+    };
+
+    DMatrix alpha;
+    DMatrix::RCRFForwardCompute(posScores, pairScores, alpha, startLbl);
+    DMatrix expectedAlpha(numLabels, numPositions);
+    for (int t = 0; t < numPositions; t++)
+        for (int k = 0; k < numLabels; k++)
+            expectedAlpha(k, t) = zeta(expectedAlpha, k, t) + posScores(k, t);
+    BOOST_CHECK(alpha.IsEqualTo(expectedAlpha, c_epsilonFloatE4));
+
+    DMatrix beta;
+    DMatrix::RCRFBackwardCompute(alpha, beta, lbls, pairScores);
+    DMatrix expectedBeta(numLabels, numPositions);
+    std::vector<double> lastAlpha(numLabels);
+    for (int k = 0; k < numLabels; k++)
+        lastAlpha[k] = alpha(k, numPositions - 1);
+    for (int k = 0; k < numLabels; k++)
+        expectedBeta(k, numPositions - 1) = alpha(k, numPositions - 1) - logSumExp(lastAlpha);
+    for (int t = numPositions - 2; t >= 0; t--)
+    {
+        for (int k = 0; k < numLabels; k++)
+        {
+            std::vector<double> terms(numLabels);
+            for (int j = 0; j < numLabels; j++)
+                terms[j] = expectedBeta(j, t + 1) - zeta(alpha, j, t + 1) + pairScores(j, k);
+            expectedBeta(k, t) = alpha(k, t) + logSumExp(terms);
+        }
+    }
+    BOOST_CHECK(beta.IsEqualTo(expectedBeta, c_epsilonFloatE4));
+
+    DMatrix grd(numLabels, numLabels);
+    grd.SetValue(0);
+    DMatrix::RCRFTransGrdCompute(lbls, alpha, beta, pairScores, grd);
+    DMatrix expectedGrd(numLabels, numLabels);
+    expectedGrd.SetValue(0);
+    for (int t = 0; t < numPositions; t++)
+    {
+        for (int i = 0; i < numLabels; i++)
+            for (int j = 0; j < numLabels; j++)
+                expectedGrd(j, i) += exp(prevAlpha(alpha, i, t) + pairScores(j, i) + beta(j, t) - zeta(alpha, j, t));
+        expectedGrd(labels[t], t > 0 ? labels[t - 1] : startLbl) -= 1;
+    }
+    BOOST_CHECK(grd.IsEqualTo(expectedGrd, c_epsilonFloatE4));
+
+    DMatrix delta, backtrace;
+    DMatrix::RCRFViterbiCompute(posScores, pairScores, delta, backtrace, startLbl);
+    for (int t = 1; t < numPositions; t++)
+    {
+        for (int k = 0; k < numLabels; k++)
+        {
+            // the best path into k goes through the backtraced predecessor
+            int best = (int) backtrace(k, t);
+            double bestScore = delta(best, t - 1) + pairScores(k, best);
+            for (int j = 0; j < numLabels; j++)
+                BOOST_CHECK_LE(delta(j, t - 1) + pairScores(k, j), bestScore);
+            BOOST_CHECK_CLOSE(delta(k, t), bestScore + posScores(k, t), 1e-8);
+            if (t == 1)
+                BOOST_CHECK_EQUAL(best, startLbl);
+        }
+    }
+    BOOST_CHECK_CLOSE(delta(startLbl, 0), posScores(startLbl, 0), 1e-8);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -61,6 +61,31 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixCopyColumnSliceToDense, RandomSeedFixture
     BOOST_CHECK(dm1.IsEqualTo(dm2, c_epsilonFloatE4));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixCopyBlockCol, RandomSeedFixture)
+{
+    // a block column matrix as produced by the gradient of a product with sparse input: columns 1, 4 and 7 of 10 are non-zero
+    const size_t m = 5;
+    const size_t n = 10;
+    const size_t numSamples = 4;
+    DenseMatrix lhs(m, numSamples);
+    lhs.SetUniformRandomValue(-1, 1, IncrementCounter());
+    SparseMatrix rhs(MatrixFormat::matrixFormatSparseCSC, n, numSamples, 0);
+    rhs.SetValue(1, 0, 1);
+    rhs.SetValue(7, 1, 1);
+    rhs.SetValue(4, 2, 1);
+    rhs.SetValue(7, 3, 1);
+    SparseMatrix sm0(MatrixFormat::matrixFormatSparseBlockCol);
+    SparseMatrix::MultiplyAndAdd(1, lhs, false, rhs, true, sm0);
+
+    SparseMatrix sm1(MatrixFormat::matrixFormatSparseBlockCol);
+    sm1.SetValue(sm0);
+
+    DenseMatrix dm0 = sm0.CopyColumnSliceToDense(0, n);
+    DenseMatrix dm1 = sm1.CopyColumnSliceToDense(0, n);
+    BOOST_CHECK(dm0.IsEqualTo(dm1, c_epsilonFloatE4));
+    BOOST_CHECK_GT(dm1.FrobeniusNorm(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
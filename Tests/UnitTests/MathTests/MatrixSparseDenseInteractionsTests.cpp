@@ -154,6 +154,112 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixDenseTimesSparseAsSparse, RandomSeedFixture)
 #endif
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixSparseBlockColumnsRoundTrip, RandomSeedFixture)
+{
+    const size_t numRows = 3, numCols = 10;
+    std::vector<size_t> columnIds = { 7, 2, 5 };
+    std::vector<float> values(columnIds.size() * numRows);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = (float) (i + 1);
+
+    Matrix<float> mBlock(CPUDEVICE);
+    mBlock.SwitchToMatrixType(MatrixType::SPARSE, matrixFormatSparseBlockCol, false);
+    mBlock.SetMatrixFromSparseBlockColumns(columnIds.data(), values.data(), columnIds.size(), numRows, numCols);
+    BOOST_CHECK_EQUAL(numRows, mBlock.GetNumRows());
+    BOOST_CHECK_EQUAL(numCols, mBlock.GetNumCols());
+
+    std::vector<size_t> resultColumnIds;
+    std::vector<float> resultValues;
+    mBlock.GetSparseBlockColumns(resultColumnIds, resultValues);
+    BOOST_CHECK(resultColumnIds == columnIds);
+    BOOST_CHECK(resultValues == values);
+
+    // The block ids are the column ids of the dense matrix.
+    Matrix<float> mDense = Matrix<float>::Zeros(numRows, numCols, CPUDEVICE);
+    Matrix<float>::ScaleAndAdd(1.0f, mBlock, mDense);
+    for (size_t b = 0; b < columnIds.size(); ++b)
+    {
+        for (size_t r = 0; r < numRows; ++r)
+            BOOST_CHECK_EQUAL(values[b * numRows + r], mDense(r, columnIds[b]));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUMatrixSparseBlockColumnsFSAdagradAndL2, RandomSeedFixture)
+{
+    const size_t numRows = 4, numCols = 10;
+    const float l2RegWeight = 0.1f;
+    std::vector<size_t> columnIds = { 7, 2, 5 };
+    std::vector<float> values(columnIds.size() * numRows);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = (float) i - 5.0f;
+
+    Matrix<float> mWeights = Matrix<float>::RandomUniform(numRows, numCols, CPUDEVICE, -1.0f, 1.0f, IncrementCounter());
+    Matrix<float> mWeightsDense(mWeights.DeepClone());
+
+    // block sparse gradient, L2 applied to the columns present only
+    Matrix<float> mBlock(CPUDEVICE);
+    mBlock.SwitchToMatrixType(MatrixType::SPARSE, matrixFormatSparseBlockCol, false);
+    mBlock.SetMatrixFromSparseBlockColumns(columnIds.data(), values.data(), columnIds.size(), numRows, numCols);
+    Matrix<float>::ScaleAndAddToSparseBlocks(l2RegWeight, mWeights, mBlock);
+    BOOST_CHECK(mBlock.GetMatrixType() == MatrixType::SPARSE);
+
+    // the same gradient as a dense matrix
+    Matrix<float> mDense = Matrix<float>::Zeros(numRows, numCols, CPUDEVICE);
+    for (size_t b = 0; b < columnIds.size(); ++b)
+    {
+        for (size_t r = 0; r < numRows; ++r)
+            mDense(r, columnIds[b]) = values[b * numRows + r] + l2RegWeight * mWeights(r, columnIds[b]);
+    }
+
+    // In the first update, the columns absent from the gradient are left unchanged by the dense update as well.
+    Matrix<float> mSmoothed(CPUDEVICE), mSmoothedDense(CPUDEVICE);
+    double smoothedCount = 0, smoothedCountDense = 0;
+    mSmoothed.FSAdagradUpdate(8, mBlock, mWeights, smoothedCount, 0.01, 1.0, 0.9, 0.99);
+    mSmoothedDense.FSAdagradUpdate(8, mDense, mWeightsDense, smoothedCountDense, 0.01, 1.0, 0.9, 0.99);
+
+    BOOST_CHECK(mWeights.IsEqualTo(mWeightsDense, c_epsilonFloatE5));
+    BOOST_CHECK(mSmoothed.IsEqualTo(mSmoothedDense, c_epsilonFloatE5));
+
+    // In the second update, with columns 5 and 1, the sparse update is lazy: the accumulators and weights of the absent columns stay unchanged,
+    // while the dense update decays their momentum. The columns present are updated like the dense update does.
+    std::vector<size_t> columnIds2 = { 5, 1 };
+    std::vector<float> values2(columnIds2.size() * numRows);
+    for (size_t i = 0; i < values2.size(); ++i)
+        values2[i] = 3.0f - (float) i;
+    mBlock.SetMatrixFromSparseBlockColumns(columnIds2.data(), values2.data(), columnIds2.size(), numRows, numCols);
+    mDense.SetValue(0);
+    for (size_t b = 0; b < columnIds2.size(); ++b)
+    {
+        for (size_t r = 0; r < numRows; ++r)
+            mDense(r, columnIds2[b]) = values2[b * numRows + r];
+    }
+
+    Matrix<float> mWeightsBefore(mWeights.DeepClone()), mSmoothedBefore(mSmoothed.DeepClone());
+    mSmoothed.FSAdagradUpdate(8, mBlock, mWeights, smoothedCount, 0.01, 1.0, 0.9, 0.99);
+    mSmoothedDense.FSAdagradUpdate(8, mDense, mWeightsDense, smoothedCountDense, 0.01, 1.0, 0.9, 0.99);
+    BOOST_CHECK_EQUAL(smoothedCount, smoothedCountDense);
+
+    for (size_t c = 0; c < numCols; ++c)
+    {
+        bool isPresent = std::find(columnIds2.begin(), columnIds2.end(), c) != columnIds2.end();
+        for (size_t r = 0; r < numRows; ++r)
+        {
+            if (isPresent)
+            {
+                BOOST_CHECK_CLOSE(mWeights(r, c), mWeightsDense(r, c), 1e-3f);
+                BOOST_CHECK_CLOSE(mSmoothed(r, c), mSmoothedDense(r, c), 1e-3f);
+                BOOST_CHECK_CLOSE(mSmoothed(r, numCols + c), mSmoothedDense(r, numCols + c), 1e-3f);
+            }
+            else
+            {
+                BOOST_CHECK_EQUAL(mWeights(r, c), mWeightsBefore(r, c));
+                BOOST_CHECK_EQUAL(mSmoothed(r, c), mSmoothedBefore(r, c));
+                BOOST_CHECK_EQUAL(mSmoothed(r, numCols + c), mSmoothedBefore(r, numCols + c));
+            }
+        }
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(MatrixSparseTimesSparse, RandomSeedFixture)
 {
     Matrix<float> mAdense(c_deviceIdZero);
@@ -1116,6 +1116,81 @@ BOOST_FIXTURE_TEST_CASE(MatrixAssignNumOfDiff, RandomSeedFixture)
         BOOST_CHECK_EQUAL(expectedDiff, actual.Get00Element());
     }
 }
+
+// compares the fused updates with the per-parameter operations on the given device
+static void TestMultiTensorUpdates(RandomSeedFixture& fixture, DEVICEID_TYPE deviceId)
+{
+    // the second parameter spans several chunks of the multi-tensor update
+    const size_t rows[] = { 7, 200 };
+    const size_t cols[] = { 3, 100 };
+    const size_t numParameters = 2;
+    const size_t mbSize = 16;
+    const double clippingThreshold = 0.5, momentum = 0.9, l2RegWeight = 0.01;
+    const std::vector<double> learnRates = { 0.01, 0.02 };
+    const std::vector<double> l2RegWeights = { l2RegWeight, 0 };
+
+    for (int updateType = 0; updateType < 3; updateType++) // momentum SGD, Nesterov momentum, FSAdaGrad
+    {
+        std::vector<SingleMatrix> values, valuesRef, gradients, smoothed, smoothedRef;
+        std::vector<double> smoothedCounts(numParameters, 0), smoothedCountsRef(numParameters, 0);
+        for (size_t k = 0; k < numParameters; k++)
+        {
+            values.push_back(SingleMatrix::RandomUniform(rows[k], cols[k], deviceId, -1.0f, 1.0f, fixture.IncrementCounter()));
+            valuesRef.push_back(values.back().DeepClone());
+            gradients.push_back(SingleMatrix(rows[k], cols[k], deviceId));
+            smoothed.push_back(SingleMatrix::Zeros(rows[k], cols[k], deviceId));
+            smoothedRef.push_back(SingleMatrix::Zeros(rows[k], cols[k], deviceId));
+        }
+
+        for (size_t step = 0; step < 2; step++)
+        {
+            std::vector<SingleMatrix*> pValues, pGradients, pSmoothed;
+            std::vector<double*> pSmoothedCounts;
+            for (size_t k = 0; k < numParameters; k++)
+            {
+                gradients[k].SetUniformRandomValue(-1.0f, 1.0f, fixture.IncrementCounter());
+                pValues.push_back(&values[k]);
+                pGradients.push_back(&gradients[k]);
+                pSmoothed.push_back(&smoothed[k]);
+                pSmoothedCounts.push_back(&smoothedCounts[k]);
+            }
+
+            if (updateType == 2)
+                SingleMatrix::MultiTensorFSAdagradUpdate(mbSize, pSmoothed, pGradients, pValues, pSmoothedCounts, learnRates, l2RegWeights, clippingThreshold, 1.0, momentum, 0.99);
+            else
+                SingleMatrix::MultiTensorNormalGrad(pSmoothed, pGradients, pValues, learnRates, l2RegWeights, clippingThreshold, momentum, updateType == 1);
+
+            // reference: the per-parameter operations of SGD::UpdateWeights()
+            for (size_t k = 0; k < numParameters; k++)
+            {
+                SingleMatrix gradient = gradients[k].DeepClone();
+                gradient.InplaceTruncate((float) clippingThreshold);
+                SingleMatrix::ScaleAndAdd((float) l2RegWeights[k], valuesRef[k], gradient);
+                if (updateType == 2)
+                    smoothedRef[k].FSAdagradUpdate(mbSize, gradient, valuesRef[k], smoothedCountsRef[k], learnRates[k], 1.0, momentum, 0.99);
+                else
+                    smoothedRef[k].NormalGrad(gradient, valuesRef[k], (float) learnRates[k], (float) momentum, updateType == 1);
+            }
+        }
+
+        for (size_t k = 0; k < numParameters; k++)
+        {
+            BOOST_CHECK(values[k].IsEqualTo(valuesRef[k], c_epsilonFloatE5));
+            BOOST_CHECK(smoothed[k].IsEqualTo(smoothedRef[k], c_epsilonFloatE5));
+            BOOST_CHECK_EQUAL(smoothedCounts[k], smoothedCountsRef[k]);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixMultiTensorUpdates, RandomSeedFixture)
+{
+    TestMultiTensorUpdates(*this, CPUDEVICE);
+}
+
+BOOST_FIXTURE_TEST_CASE(MatrixMultiTensorUpdatesGPU, RandomSeedFixture)
+{
+    TestMultiTensorUpdates(*this, c_deviceIdZero);
+}
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -0,0 +1,144 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/NodeTestHelper.h"
+#include "LinearAlgebraNodes.h"
+#include "SGD.h"
+#include "boost/filesystem.hpp"
+#include "boost/filesystem/fstream.hpp"
+#include <iterator>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Exposes the checkpointing of SGD, which TrainOrAdaptModel calls at the end of each epoch.
+template <class ElemType>
+struct SGDCheckpointTest : public SGD<ElemType>
+{
+    SGDCheckpointTest(const ConfigParameters& config)
+        : SGD<ElemType>(config)
+    {
+    }
+
+    using SGD<ElemType>::SaveCheckPointAndModel;
+    using SGD<ElemType>::WaitForPendingCheckpoint;
+    using SGD<ElemType>::GetCheckPointFileNameForEpoch;
+    using SGD<ElemType>::GetModelNameForEpoch;
+};
+
+BOOST_AUTO_TEST_SUITE(CheckpointTestSuite)
+
+// A compiled network and the SGD state that goes into a checkpoint, with the model and checkpoint files in a temporary directory.
+struct CheckpointFixture
+{
+    CheckpointFixture()
+        : m_directory(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("cntk-checkpoint-%%%%-%%%%")),
+          m_net(make_shared<ComputationNetwork>(CPUDEVICE))
+    {
+        ComputationNetworkBuilder<float> builder(*m_net);
+        auto weights = builder.CreateLearnableParameter(L"W", 3, 2);
+        auto input = builder.CreateInputNode(L"x", 2);
+        auto times = builder.Times(weights, input, 1, L"times");
+        auto criterion = m_net->AddNodeToNetAndAttachInputs(New<SumElementsNode<float>>(CPUDEVICE, L"criterion"), { times });
+        PrepareNetworkForTraining(m_net, criterion);
+        SetNodeValue<float>(weights, 3, 2, { 0.5f, -1.25f, 2, 0.125f, -3, 7.75f });
+
+        m_smoothedGradients.push_back(Matrix<float>(3, 2, CPUDEVICE));
+        m_smoothedGradients.back().SetValue(0.25f);
+        m_smoothedCounts.push_back(42);
+    }
+
+    ~CheckpointFixture()
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove_all(m_directory, error);
+    }
+
+    std::unique_ptr<SGDCheckpointTest<float>> CreateSGD(const std::string& subdirectory, bool asyncCheckpointing)
+    {
+        ConfigParameters config;
+        config.Insert("maxEpochs", "3");
+        config.Insert("learningRatesPerSample", "0.01");
+        config.Insert("modelPath", (m_directory / subdirectory / "model").string());
+        config.Insert("asyncCheckpointing", asyncCheckpointing ? "true" : "false");
+        return std::unique_ptr<SGDCheckpointTest<float>>(new SGDCheckpointTest<float>(config));
+    }
+
+    void SaveCheckPointAndModel(SGDCheckpointTest<float>& sgd, size_t epoch, std::vector<std::wstring>&& filesToDelete)
+    {
+        sgd.SaveCheckPointAndModel(epoch, m_net, /*totalSamplesSeen=*/1000 * (epoch + 1), /*learnRatePerSample=*/0.01, m_smoothedGradients, m_smoothedCounts,
+                                   /*prevCriterion=*/1.5, /*minibatchSize=*/64, std::move(filesToDelete));
+    }
+
+    static std::vector<char> ReadFile(const std::wstring& path)
+    {
+        boost::filesystem::ifstream stream(boost::filesystem::path(path), std::ios::binary);
+        BOOST_REQUIRE(stream.good());
+        return std::vector<char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    static void CreateFile(const std::wstring& path)
+    {
+        boost::filesystem::ofstream stream(boost::filesystem::path(path), std::ios::binary);
+        stream << "previous checkpoint";
+    }
+
+    boost::filesystem::path m_directory;
+    ComputationNetworkPtr m_net;
+    std::list<Matrix<float>> m_smoothedGradients;
+    std::vector<double> m_smoothedCounts;
+};
+
+BOOST_FIXTURE_TEST_CASE(AsyncCheckpointMatchesSynchronousCheckpoint, CheckpointFixture)
+{
+    auto syncSGD = CreateSGD("sync", /*asyncCheckpointing=*/false);
+    auto asyncSGD = CreateSGD("async", /*asyncCheckpointing=*/true);
+
+    for (size_t epoch = 0; epoch < 2; epoch++)
+    {
+        // the checkpoint of the previous epoch is deleted once the new one is written
+        std::wstring syncPrevious = syncSGD->GetCheckPointFileNameForEpoch(int(epoch) - 1);
+        std::wstring asyncPrevious = asyncSGD->GetCheckPointFileNameForEpoch(int(epoch) - 1);
+        CreateFile(syncPrevious);
+        CreateFile(asyncPrevious);
+
+        SaveCheckPointAndModel(*syncSGD, epoch, { syncPrevious });
+        SaveCheckPointAndModel(*asyncSGD, epoch, { asyncPrevious });
+        asyncSGD->WaitForPendingCheckpoint();
+
+        BOOST_CHECK(ReadFile(asyncSGD->GetCheckPointFileNameForEpoch(int(epoch))) == ReadFile(syncSGD->GetCheckPointFileNameForEpoch(int(epoch))));
+        BOOST_CHECK(ReadFile(asyncSGD->GetModelNameForEpoch(int(epoch))) == ReadFile(syncSGD->GetModelNameForEpoch(int(epoch))));
+        BOOST_CHECK(!boost::filesystem::exists(asyncSGD->GetCheckPointFileNameForEpoch(int(epoch)) + L".tmp"));
+        BOOST_CHECK(!boost::filesystem::exists(asyncSGD->GetModelNameForEpoch(int(epoch)) + L".tmp"));
+        BOOST_CHECK(!boost::filesystem::exists(asyncPrevious));
+        BOOST_CHECK(!boost::filesystem::exists(syncPrevious));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(AsyncCheckpointReportsWriteErrors, CheckpointFixture)
+{
+    auto asyncSGD = CreateSGD("async", /*asyncCheckpointing=*/true);
+    // a directory in place of the model file makes the background writer fail to rename the written file into place
+    boost::filesystem::create_directories(asyncSGD->GetModelNameForEpoch(0));
+    boost::filesystem::create_directories(asyncSGD->GetModelNameForEpoch(1));
+
+    // the error is not thrown where the checkpoint is handed over, but when waiting for it
+    SaveCheckPointAndModel(*asyncSGD, 0, {});
+    BOOST_CHECK_THROW(asyncSGD->WaitForPendingCheckpoint(), std::runtime_error);
+
+    // a failed write that nobody waited for is reported by the next checkpoint
+    SaveCheckPointAndModel(*asyncSGD, 1, {});
+    BOOST_CHECK_THROW(SaveCheckPointAndModel(*asyncSGD, 2, {}), std::runtime_error);
+
+    // once the error is reported, checkpointing goes on
+    SaveCheckPointAndModel(*asyncSGD, 2, {});
+    asyncSGD->WaitForPendingCheckpoint();
+    BOOST_CHECK(boost::filesystem::is_regular_file(asyncSGD->GetModelNameForEpoch(2)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
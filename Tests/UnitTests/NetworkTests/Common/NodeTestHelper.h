@@ -0,0 +1,76 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// NodeTestHelper.h -- helpers for testing individual nodes in a small network built with ComputationNetworkBuilder
+//
+#pragma once
+
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Compiles the network and allocates the matrices needed to train the criterion.
+inline void PrepareNetworkForTraining(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterion)
+{
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+    net->AllocateAllMatrices({}, {}, criterion);
+}
+
+// Sets the value of an input or parameter node from column-major data.
+template <class ElemType>
+void SetNodeValue(const ComputationNodeBasePtr& node, size_t numRows, size_t numCols, const std::vector<ElemType>& data)
+{
+    auto& value = node->As<ComputationNode<ElemType>>()->Value();
+    value.SetValue(numRows, numCols, value.GetDeviceId(), const_cast<ElemType*>(data.data()));
+    node->BumpEvalTimeStamp();
+}
+
+// Copies the gradient of a node into column-major host memory; sparse gradients are densified.
+template <class ElemType>
+std::vector<ElemType> GetNodeGradient(const ComputationNodeBasePtr& node)
+{
+    Matrix<ElemType> gradient = node->As<ComputationNode<ElemType>>()->Gradient().DeepClone();
+    gradient.SwitchToMatrixType(MatrixType::DENSE, MatrixFormat::matrixFormatDense, /*keepValues=*/true);
+
+    std::vector<ElemType> result(gradient.GetNumElements());
+    for (size_t j = 0; j < gradient.GetNumCols(); j++)
+        for (size_t i = 0; i < gradient.GetNumRows(); i++)
+            result[j * gradient.GetNumRows() + i] = gradient(i, j);
+    return result;
+}
+
+// Evaluates the criterion with one element of a parameter changed by delta; for finite difference checks of gradients.
+template <class ElemType>
+double EvaluateWithPerturbedParameter(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterion,
+                                      const ComputationNodeBasePtr& parameter, size_t index, double delta)
+{
+    auto& value = parameter->As<ComputationNode<ElemType>>()->Value();
+    size_t row = index % value.GetNumRows();
+    size_t col = index / value.GetNumRows();
+    ElemType original = value(row, col);
+
+    value(row, col) = (ElemType)(original + delta);
+    parameter->BumpEvalTimeStamp();
+    net->ForwardProp(criterion);
+    double result = criterion->As<ComputationNode<ElemType>>()->Get00Element();
+
+    value(row, col) = original;
+    parameter->BumpEvalTimeStamp();
+    return result;
+}
+
+// Central difference estimate of the gradient of the criterion with respect to one element of a parameter.
+template <class ElemType>
+double NumericGradient(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterion,
+                       const ComputationNodeBasePtr& parameter, size_t index, double epsilon = 1e-5)
+{
+    double plus = EvaluateWithPerturbedParameter<ElemType>(net, criterion, parameter, index, epsilon);
+    double minus = EvaluateWithPerturbedParameter<ElemType>(net, criterion, parameter, index, -epsilon);
+    return (plus - minus) / (2 * epsilon);
+}
+
+}}}}
@@ -0,0 +1,298 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "MPIWrapper.h"
+#include "Matrix.h"
+#include "DistGradHeader.h"
+#include "SimpleDistGradAggregator.h"
+#include "TopKDistGradAggregator.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+template <class ElemType>
+struct TopKDistGradAggregatorTest
+{
+    static const std::vector<ElemType>& GetResidual(const TopKDistGradAggregator<ElemType>& aggregator, size_t i) { return aggregator.m_residuals[i]; }
+};
+
+template <class ElemType>
+struct SimpleDistGradAggregatorTest
+{
+    static void SetMaxMPICount(SimpleDistGradAggregator<ElemType>& aggregator, size_t maxMPICount) { aggregator.m_maxMPICount = maxMPICount; }
+    static size_t GetNumBuckets(const SimpleDistGradAggregator<ElemType>& aggregator) { return aggregator.m_buckets.size(); }
+    static const std::vector<size_t>& GetBucketGradients(const SimpleDistGradAggregator<ElemType>& aggregator, size_t b) { return aggregator.m_buckets[b].m_gradients; }
+    static bool IsBucketLaunched(const SimpleDistGradAggregator<ElemType>& aggregator, size_t b) { return aggregator.m_buckets[b].m_launched; }
+};
+
+BOOST_AUTO_TEST_SUITE(DistGradAggregatorTestSuite)
+
+// MPIWrapper is a singleton that can only be created once per process; without mpiexec, this is a single worker.
+static MPIWrapperPtr GetMPIWrapper()
+{
+    return MPIWrapper::s_initialized ? MPIWrapper::GetInstance() : MPIWrapper::GetInstance(/*create=*/true);
+}
+
+static std::shared_ptr<DistGradHeader> CreateHeader(size_t numSamples)
+{
+    std::shared_ptr<DistGradHeader> header(DistGradHeader::Create(0), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
+    header->Clear();
+    header->numSamples = numSamples;
+    header->numSamplesWithLabel = numSamples;
+    header->criterion = 1;
+    return header;
+}
+
+// Aggregates a single gradient matrix on a single worker, and checks that the aggregated gradient and the new residual
+// split the previous residual plus the gradient: the k entries with the largest magnitude are sent, the others are kept.
+static void CheckTopKStep(TopKDistGradAggregator<double>& aggregator, const std::vector<double>& gradientValues, size_t k, bool resetState)
+{
+    const size_t numRows = 4;
+    const size_t numCols = gradientValues.size() / numRows;
+    Matrix<double> gradient(numRows, numCols, const_cast<double*>(gradientValues.data()), CPUDEVICE);
+
+    std::vector<double> expectedSum = gradientValues;
+    if (!resetState)
+    {
+        const auto& previousResidual = TopKDistGradAggregatorTest<double>::GetResidual(aggregator, 0);
+        for (size_t j = 0; j < expectedSum.size(); j++)
+            expectedSum[j] += previousResidual[j];
+    }
+
+    auto header = CreateHeader(8);
+    BOOST_CHECK(aggregator.AggregateGradients({ &gradient }, header.get(), resetState));
+    BOOST_CHECK_EQUAL(header->numSamples, (size_t) 8);
+
+    const auto& residual = TopKDistGradAggregatorTest<double>::GetResidual(aggregator, 0);
+    BOOST_REQUIRE_EQUAL(residual.size(), expectedSum.size());
+    size_t numSent = 0;
+    double minSent = INFINITY, maxKept = 0;
+    for (size_t j = 0; j < expectedSum.size(); j++)
+    {
+        double sent = gradient(j % numRows, j / numRows);
+        BOOST_CHECK_EQUAL(sent + residual[j], expectedSum[j]);
+        // every entry is either sent or kept in full
+        BOOST_CHECK(sent == 0 || residual[j] == 0);
+        if (residual[j] == 0 && expectedSum[j] != 0)
+        {
+            numSent++;
+            minSent = std::min(minSent, std::abs(sent));
+        }
+        else
+            maxKept = std::max(maxKept, std::abs(residual[j]));
+    }
+    BOOST_CHECK_EQUAL(numSent, k);
+    BOOST_CHECK_GE(minSent, maxKept);
+}
+
+BOOST_AUTO_TEST_CASE(TopKAggregationCarriesResidualToNextStep)
+{
+    auto mpi = GetMPIWrapper();
+    BOOST_REQUIRE_EQUAL(mpi->NumNodesInUse(), 1);
+
+    // 8 entries, of which ceil(0.25 * 8) = 2 are sent per step
+    TopKDistGradAggregator<double> aggregator(mpi, 0.25, /*syncStatsTrace=*/0);
+    const size_t k = 2;
+
+    // -8 and 6 are sent, -2 and the others are kept
+    CheckTopKStep(aggregator, { 1, -8, 3, 0.5, -2, 6, 0.25, 4 }, k, /*resetState=*/true);
+    auto residual = TopKDistGradAggregatorTest<double>::GetResidual(aggregator, 0);
+    BOOST_CHECK_EQUAL(residual[1], 0);
+    BOOST_CHECK_EQUAL(residual[4], -2);
+
+    // the kept -2 adds up with -5 to the largest entry of the next step
+    CheckTopKStep(aggregator, { 2, 1, -1, 0, -5, 0.5, 1, 0 }, k, /*resetState=*/false);
+    residual = TopKDistGradAggregatorTest<double>::GetResidual(aggregator, 0);
+    BOOST_CHECK_EQUAL(residual[4], 0);
+    BOOST_CHECK_EQUAL(residual[7], 0);
+    BOOST_CHECK_EQUAL(residual[2], 2);
+
+    // the residual is dropped at the start of an epoch, so the kept 3 is not added to 0.5
+    CheckTopKStep(aggregator, { 0.5, 0, 0, 3, 0, 0, -1, 0 }, k, /*resetState=*/true);
+    residual = TopKDistGradAggregatorTest<double>::GetResidual(aggregator, 0);
+    BOOST_CHECK_EQUAL(residual[0], 0.5);
+    BOOST_CHECK_EQUAL(residual[3], 0);
+    BOOST_CHECK_EQUAL(residual[6], 0);
+}
+
+// Every worker touches the same columns of a sparse block column gradient, with the values scaled by its rank + 1.
+// Returns the columns and values of the aggregated gradient.
+static void AggregateSparseBlockColumns(SimpleDistGradAggregator<double>& aggregator, const MPIWrapperPtr& mpi, const std::vector<size_t>& columnIds, const std::vector<double>& values,
+                                        size_t numRows, size_t numCols, std::vector<size_t>& resultColumnIds, std::vector<double>& resultValues)
+{
+    double scale = (double)(mpi->CurrentNodeRank() + 1);
+    std::vector<double> scaledValues(values);
+    for (auto& value : scaledValues)
+        value *= scale;
+
+    Matrix<double> gradient(CPUDEVICE);
+    gradient.SwitchToMatrixType(MatrixType::SPARSE, matrixFormatSparseBlockCol, false);
+    gradient.SetMatrixFromSparseBlockColumns(columnIds.data(), scaledValues.data(), columnIds.size(), numRows, numCols);
+
+    auto header = CreateHeader(1);
+    BOOST_CHECK(aggregator.AggregateGradients({ &gradient }, header.get(), /*resetState=*/true));
+    BOOST_CHECK_EQUAL(header->numSamples, mpi->NumNodesInUse());
+
+    BOOST_CHECK(gradient.GetMatrixType() == MatrixType::SPARSE);
+    BOOST_CHECK(gradient.GetFormat() == matrixFormatSparseBlockCol);
+    BOOST_CHECK_EQUAL(gradient.GetNumRows(), numRows);
+    BOOST_CHECK_EQUAL(gradient.GetNumCols(), numCols);
+    gradient.GetSparseBlockColumns(resultColumnIds, resultValues);
+}
+
+// The expected aggregated value of an entry of the gradients of AggregateSparseBlockColumns.
+static double SumOverWorkers(double value, size_t numWorkers)
+{
+    return value * numWorkers * (numWorkers + 1) / 2;
+}
+
+BOOST_AUTO_TEST_CASE(SparseAggregationExchangesTouchedColumns)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t numRows = 3, numCols = 100;
+    const std::vector<size_t> columnIds = { 7, 2, 5 };
+    std::vector<double> values(columnIds.size() * numRows);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = (double)(i + 1);
+
+    // 3 of 100 columns are touched per worker, below the density threshold, so only these columns are exchanged
+    SimpleDistGradAggregator<double> aggregator(mpi, /*useAsyncAggregation=*/false, /*syncStatsTrace=*/0, /*gradientBucketSizeInBytes=*/0, /*sparseGradientDensityThreshold=*/0.5);
+    std::vector<size_t> resultColumnIds;
+    std::vector<double> resultValues;
+    AggregateSparseBlockColumns(aggregator, mpi, columnIds, values, numRows, numCols, resultColumnIds, resultValues);
+
+    // the result has the union of the touched columns, in ascending order
+    const std::vector<size_t> expectedColumnIds = { 2, 5, 7 };
+    const std::vector<size_t> sourceBlocks = { 1, 2, 0 };
+    BOOST_REQUIRE(resultColumnIds == expectedColumnIds);
+    BOOST_REQUIRE_EQUAL(resultValues.size(), values.size());
+    for (size_t b = 0; b < expectedColumnIds.size(); b++)
+    {
+        for (size_t r = 0; r < numRows; r++)
+            BOOST_CHECK_EQUAL(resultValues[b * numRows + r], SumOverWorkers(values[sourceBlocks[b] * numRows + r], mpi->NumNodesInUse()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SparseAggregationFallsBackToDenseReduction)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t numRows = 3, numCols = 10;
+    const std::vector<size_t> columnIds = { 7, 2, 5 };
+    std::vector<double> values(columnIds.size() * numRows);
+    for (size_t i = 0; i < values.size(); i++)
+        values[i] = (double)(i + 1);
+
+    // 3 of 10 columns are touched, above the density threshold, so the gradient is reduced as a dense buffer
+    SimpleDistGradAggregator<double> aggregator(mpi, /*useAsyncAggregation=*/false, /*syncStatsTrace=*/0, /*gradientBucketSizeInBytes=*/0, /*sparseGradientDensityThreshold=*/0.1);
+    // the 30 elements of the dense buffer are reduced in pieces of 7, 7, 7, 7 and 2
+    SimpleDistGradAggregatorTest<double>::SetMaxMPICount(aggregator, 7);
+    std::vector<size_t> resultColumnIds;
+    std::vector<double> resultValues;
+    AggregateSparseBlockColumns(aggregator, mpi, columnIds, values, numRows, numCols, resultColumnIds, resultValues);
+
+    // the result has all columns, the untouched ones are zero
+    BOOST_REQUIRE_EQUAL(resultColumnIds.size(), numCols);
+    BOOST_REQUIRE_EQUAL(resultValues.size(), numCols * numRows);
+    std::vector<double> expectedValues(numCols * numRows, 0);
+    for (size_t b = 0; b < columnIds.size(); b++)
+    {
+        for (size_t r = 0; r < numRows; r++)
+            expectedValues[columnIds[b] * numRows + r] = SumOverWorkers(values[b * numRows + r], mpi->NumNodesInUse());
+    }
+    for (size_t j = 0; j < numCols; j++)
+    {
+        BOOST_CHECK_EQUAL(resultColumnIds[j], j);
+        for (size_t r = 0; r < numRows; r++)
+            BOOST_CHECK_EQUAL(resultValues[j * numRows + r], expectedValues[j * numRows + r]);
+    }
+}
+
+// Entry j of gradient i in the given minibatch, before scaling by the rank + 1 of the worker.
+// Integer valued, so the sums over the workers are exact in any order.
+static double GradientValue(size_t i, size_t j, size_t minibatch)
+{
+    return (double)((int)((j + 3 * i + minibatch) % 7) - 3);
+}
+
+static void SetGradientValues(const std::vector<Matrix<double>*>& gradients, size_t minibatch, size_t rank)
+{
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        std::vector<double> values(gradients[i]->GetNumElements());
+        for (size_t j = 0; j < values.size(); j++)
+            values[j] = GradientValue(i, j, minibatch) * (rank + 1);
+        gradients[i]->SetValue(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), CPUDEVICE, values.data());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BucketedAggregationMatchesUnbucketedAggregation)
+{
+    auto mpi = GetMPIWrapper();
+    size_t rank = mpi->CurrentNodeRank();
+
+    // buckets of at least 8 elements: the first gradient has 15 elements and gets a bucket of its own, the others share one
+    const std::vector<std::pair<size_t, size_t>> shapes = { { 3, 5 }, { 2, 2 }, { 2, 1 }, { 1, 3 } };
+    std::vector<std::unique_ptr<Matrix<double>>> bucketedMatrices, unbucketedMatrices;
+    std::vector<Matrix<double>*> bucketedGradients, unbucketedGradients;
+    for (const auto& shape : shapes)
+    {
+        bucketedMatrices.emplace_back(new Matrix<double>(shape.first, shape.second, CPUDEVICE));
+        unbucketedMatrices.emplace_back(new Matrix<double>(shape.first, shape.second, CPUDEVICE));
+        bucketedGradients.push_back(bucketedMatrices.back().get());
+        unbucketedGradients.push_back(unbucketedMatrices.back().get());
+    }
+
+    SimpleDistGradAggregator<double> bucketedAggregator(mpi, /*useAsyncAggregation=*/false, /*syncStatsTrace=*/0, /*gradientBucketSizeInBytes=*/8 * sizeof(double));
+    SimpleDistGradAggregator<double> unbucketedAggregator(mpi, /*useAsyncAggregation=*/false, /*syncStatsTrace=*/0);
+
+    for (size_t minibatch = 0; minibatch < 3; minibatch++)
+    {
+        SetGradientValues(bucketedGradients, minibatch, rank);
+        SetGradientValues(unbucketedGradients, minibatch, rank);
+
+        // The buckets are set up by the first aggregation, afterwards backprop reports the gradients in reverse order.
+        // The first gradient is not reported, so its bucket is left to AggregateGradients.
+        if (minibatch > 0)
+        {
+            for (size_t i = bucketedGradients.size() - 1; i > 0; i--)
+                bucketedAggregator.OnGradientReady(bucketedGradients[i]);
+            BOOST_CHECK(!SimpleDistGradAggregatorTest<double>::IsBucketLaunched(bucketedAggregator, 0));
+            BOOST_CHECK(SimpleDistGradAggregatorTest<double>::IsBucketLaunched(bucketedAggregator, 1));
+        }
+
+        auto bucketedHeader = CreateHeader(1);
+        auto unbucketedHeader = CreateHeader(1);
+        BOOST_CHECK(bucketedAggregator.AggregateGradients(bucketedGradients, bucketedHeader.get(), /*resetState=*/minibatch == 0));
+        BOOST_CHECK(unbucketedAggregator.AggregateGradients(unbucketedGradients, unbucketedHeader.get(), /*resetState=*/minibatch == 0));
+        BOOST_CHECK_EQUAL(bucketedHeader->numSamples, unbucketedHeader->numSamples);
+
+        if (minibatch == 0)
+        {
+            BOOST_REQUIRE_EQUAL(SimpleDistGradAggregatorTest<double>::GetNumBuckets(bucketedAggregator), 2);
+            BOOST_CHECK(SimpleDistGradAggregatorTest<double>::GetBucketGradients(bucketedAggregator, 0) == std::vector<size_t>({ 0 }));
+            BOOST_CHECK(SimpleDistGradAggregatorTest<double>::GetBucketGradients(bucketedAggregator, 1) == std::vector<size_t>({ 1, 2, 3 }));
+        }
+
+        // both are the sum of the gradients of all workers
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            for (size_t j = 0; j < bucketedGradients[i]->GetNumElements(); j++)
+            {
+                size_t r = j % shapes[i].first, c = j / shapes[i].first;
+                double expected = SumOverWorkers(GradientValue(i, j, minibatch), mpi->NumNodesInUse());
+                BOOST_CHECK_EQUAL((*bucketedGradients[i])(r, c), expected);
+                BOOST_CHECK_EQUAL((*unbucketedGradients[i])(r, c), expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
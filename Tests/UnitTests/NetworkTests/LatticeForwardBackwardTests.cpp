@@ -0,0 +1,538 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "latticearchive.h"
+#include "simplesenonehmm.h"
+#include "ssematrix.h"
+#include <cmath>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace msra { namespace lattices {
+
+// Runs the lattice-level steps of lattice::forwardbackward() on a synthetic lattice, and the serial computation that
+// the CPU implementation replaced, for comparison.
+// The lattice has a start node, 'numlayers' layers of 'width' nodes, a sentence-end node and a final node connected by
+// a zero-frame !NULL edge. Every layer node is connected to 3 nodes of the next layer, so that the batches of the
+// forward-backward have 'width' groups, and the utterance is longer than a frame block of the error signals.
+class latticetest
+{
+public:
+    static const size_t width = 20;
+    static const size_t numlayers = 6;
+    static const size_t step = 25; // frames per edge
+    static const size_t numunits = 4;
+    static const size_t numstates = 3; // per unit
+    static const size_t numsenones = numunits * numstates;
+    static const size_t numframes = (numlayers + 1) * step;
+
+    const float lmf = 12.0f;
+    const float wp = -1.0f;
+    const float amf = 10.0f;
+
+    struct result
+    {
+        double totalscore;
+        std::vector<double> logalphas;
+        std::vector<double> logbetas;
+        std::vector<double> logpps;
+        std::vector<double> Eframescorrect; // sMBR only
+        double logEframescorrecttotal;      // sMBR only
+        std::vector<float> errorsignal;     // [t * numsenones + s]
+    };
+
+    latticetest()
+        : thisedgealignments(nullptr)
+    {
+        std::mt19937 rng(17);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::normal_distribution<float> normal;
+
+        // nodes
+        const size_t numnodes = 1 + numlayers * width + 2;
+        L.nodes.push_back(nodeinfo(0));
+        for (size_t k = 0; k < numlayers; k++)
+            for (size_t i = 0; i < width; i++)
+                L.nodes.push_back(nodeinfo((k + 1) * step));
+        L.nodes.push_back(nodeinfo(numframes)); // sentence end
+        L.nodes.push_back(nodeinfo(numframes)); // final node, reached by a !NULL edge
+        const auto layernode = [&](size_t k, size_t i)
+        {
+            return 1 + k * width + i;
+        };
+
+        // edges, sorted by end node, then start node, like lattices are
+        std::vector<std::pair<size_t, size_t>> edgenodes;
+        for (size_t i = 0; i < width; i++)
+            edgenodes.push_back(std::make_pair(0, layernode(0, i)));
+        for (size_t k = 0; k + 1 < numlayers; k++)
+        {
+            for (size_t i = 0; i < width; i++)
+            {
+                for (size_t d : { 0, 1, 3 })
+                    edgenodes.push_back(std::make_pair(layernode(k, i), layernode(k + 1, (i + d) % width)));
+            }
+        }
+        for (size_t i = 0; i < width; i++)
+            edgenodes.push_back(std::make_pair(layernode(numlayers - 1, i), numnodes - 2));
+        edgenodes.push_back(std::make_pair(numnodes - 2, numnodes - 1));
+        std::sort(edgenodes.begin(), edgenodes.end(), [](const std::pair<size_t, size_t>& e1, const std::pair<size_t, size_t>& e2)
+                  {
+                      return e1.second != e2.second ? e1.second < e2.second : e1.first < e2.first;
+                  });
+
+        // each edge but the !NULL edge is aligned to a single unit
+        for (const auto& e : edgenodes)
+        {
+            L.edges.push_back(edgeinfowithscores(e.first, e.second, 0.0f, -5.0f * uniform(rng), L.align.size()));
+            size_t edgeframes = L.nodes[e.second].t - L.nodes[e.first].t;
+            if (edgeframes > 0)
+                L.align.push_back(aligninfo(rng() % numunits, edgeframes));
+            edgeacscores.push_back((float) edgeframes * (-3.0f + normal(rng)));
+        }
+        L.info.numnodes = L.nodes.size();
+        L.info.numedges = L.edges.size();
+        L.info.numframes = numframes;
+
+        // the HMMs of the units, with distinct senones
+        hset.hmms.resize(numunits);
+        for (size_t u = 0; u < numunits; u++)
+        {
+            hset.hmms[u].numstates = numstates;
+            for (size_t i = 0; i < numstates; i++)
+                hset.hmms[u].senoneids[i] = (unsigned short) (u * numstates + i);
+        }
+
+        // state alignments for sMBR and normalized state posteriors for MMI
+        thisedgealignments.reset(new lattice::edgealignments(L));
+        for (size_t j = 0; j < L.edges.size(); j++)
+        {
+            const size_t edgeframes = L.nodes[L.edges[j].E].t - L.nodes[L.edges[j].S].t;
+            auto alignment = (*thisedgealignments)[j];
+            for (size_t t = 0; t < edgeframes; t++)
+                alignment[t] = (unsigned short) (rng() % numsenones);
+
+            gammas.push_back(std::make_shared<msra::math::ssematrix<msra::math::ssematrixbase>>(numstates, edgeframes + 2));
+            auto& loggammas = *gammas.back();
+            for (size_t t = 0; t < edgeframes + 2; t++)
+            {
+                float logsum = LOGZERO;
+                for (size_t i = 0; i < numstates; i++)
+                {
+                    loggammas(i, t) = normal(rng);
+                    logsum = (float) (std::max(logsum, loggammas(i, t)) + log1p(exp(-fabs(logsum - loggammas(i, t)))));
+                }
+                for (size_t i = 0; i < numstates; i++)
+                    loggammas(i, t) -= logsum;
+            }
+            abcs.push_back(gammas.back().get());
+        }
+
+        uids.resize(numframes);
+        for (auto& uid : uids)
+            uid = rng() % numsenones;
+    }
+
+    // the CPU implementation
+    result run(bool sMBRmode)
+    {
+        lattice::parallelstate parallelstate; // not enabled
+        const_array_ref<size_t> uidsref(uids.data(), uids.size());
+        std::vector<double> logEframescorrect;
+        result r;
+        r.logEframescorrecttotal = LOGZERO;
+        r.totalscore = L.forwardbackwardlattice(edgeacscores, parallelstate, r.logpps, r.logalphas, r.logbetas, lmf, wp, amf, 0.0f, sMBRmode,
+                                                uidsref, *thisedgealignments, logEframescorrect, r.Eframescorrect, r.logEframescorrecttotal);
+
+        msra::math::ssematrix<msra::math::ssematrixbase> errorsignal(numsenones, numframes);
+        if (sMBRmode)
+        {
+            msra::math::ssematrix<msra::math::ssematrixbase> errorsignalneg(numsenones, numframes);
+            L.sMBRerrorsignal(parallelstate, errorsignal, errorsignalneg, r.logpps, amf, LOGZERO, std::vector<double>(),
+                              logEframescorrectof(r), r.logEframescorrecttotal, *thisedgealignments);
+        }
+        else
+            L.mmierrorsignal(parallelstate, LOGZERO, std::vector<double>(), abcs, false, r.logpps, hset, *thisedgealignments, errorsignal);
+        r.errorsignal = tovector(errorsignal);
+        return r;
+    }
+
+    // the serial computation, one edge at a time
+    result runserial(bool sMBRmode) const
+    {
+        const auto& nodes = L.nodes;
+        const auto& edges = L.edges;
+        result r;
+        r.logalphas.assign(nodes.size(), LOGZERO);
+        r.logalphas.front() = 0;
+        r.logbetas.assign(nodes.size(), LOGZERO);
+        r.logbetas.back() = 0;
+        r.logpps.resize(edges.size());
+        r.logEframescorrecttotal = LOGZERO;
+        const auto edgescore = [&](size_t j)
+        {
+            return (edges[j].l * lmf + wp + edgeacscores[j]) / amf;
+        };
+        std::vector<double> logaccalphas(nodes.size(), LOGZERO);
+        std::vector<double> logaccbetas(nodes.size(), LOGZERO);
+        std::vector<double> logframescorrectedge(edges.size(), LOGZERO);
+        for (size_t j = 0; j < edges.size(); j++)
+        {
+            const auto& e = edges[j];
+            logadd(r.logalphas[e.E], r.logalphas[e.S] + edgescore(j));
+            if (!sMBRmode)
+                continue;
+            size_t framescorrect = 0;
+            for (size_t t = nodes[e.S].t; t < nodes[e.E].t; t++)
+                framescorrect += ((*thisedgealignments)[j][t - nodes[e.S].t] == uids[t]);
+            logframescorrectedge[j] = framescorrect > 0 ? log((double) framescorrect) : LOGZERO;
+            double loginaccs = logaccalphas[e.S] - r.logalphas[e.S];
+            logadd(loginaccs, logframescorrectedge[j]);
+            logadd(logaccalphas[e.E], loginaccs + r.logalphas[e.S] + edgescore(j));
+        }
+        for (size_t i = 0; i < nodes.size(); i++)
+            logaccalphas[i] -= r.logalphas[i];
+        const double totalfwscore = r.logalphas.back();
+
+        if (sMBRmode)
+            r.Eframescorrect.resize(edges.size());
+        for (size_t j = edges.size(); j-- > 0;)
+        {
+            const auto& e = edges[j];
+            logadd(r.logbetas[e.S], r.logbetas[e.E] + edgescore(j));
+            r.logpps[j] = std::min(r.logalphas[e.S] + edgescore(j) + r.logbetas[e.E] - totalfwscore, 0.0);
+            if (!sMBRmode)
+                continue;
+            double loginaccs = logaccbetas[e.E] - r.logbetas[e.E];
+            logadd(loginaccs, logframescorrectedge[j]);
+            logadd(logaccbetas[e.S], loginaccs + r.logbetas[e.E] + edgescore(j));
+            double logEframescorrect = logframescorrectedge[j];
+            logadd(logEframescorrect, logaccalphas[e.S]);
+            logadd(logEframescorrect, logaccbetas[e.E] - r.logbetas[e.E]);
+            r.Eframescorrect[j] = exp(logEframescorrect);
+        }
+        r.totalscore = sMBRmode ? r.logbetas.front() : totalfwscore;
+        if (sMBRmode)
+            r.logEframescorrecttotal = logaccbetas.front() - r.logbetas.front();
+
+        // error signals, accumulated edge by edge
+        std::vector<float> errorsignal(numsenones * numframes, sMBRmode ? 0.0f : (float) (10 * LOGZERO));
+        const auto logEframescorrect = logEframescorrectof(r);
+        for (size_t j = 0; j < edges.size(); j++)
+        {
+            const auto& e = edges[j];
+            const size_t ts = nodes[e.S].t;
+            const size_t te = nodes[e.E].t;
+            if (ts == te)
+                continue;
+            if (sMBRmode)
+            {
+                const float edgecorrect = (float) (exp(r.logpps[j]) * (logEframescorrect[j] - r.logEframescorrecttotal)) / amf;
+                for (size_t t = ts; t < te; t++)
+                    errorsignal[t * numsenones + (*thisedgealignments)[j][t - ts]] += edgecorrect;
+            }
+            else
+            {
+                const auto& hmm = hset.gethmm(L.getaligninfo(j)[0].unit);
+                for (size_t t = ts; t < te; t++)
+                    for (size_t i = 0; i < numstates; i++)
+                        logadd(errorsignal[t * numsenones + hmm.getsenoneid(i)], (float) r.logpps[j] + (*abcs[j])(i, t - ts));
+            }
+        }
+        if (!sMBRmode)
+        {
+            for (auto& value : errorsignal)
+                value = expf(value);
+        }
+        r.errorsignal = errorsignal;
+        return r;
+    }
+
+    // Writes lattices under the keys utt0, utt1, ... to a V2 archive like the lattice tools do, or to a compact archive,
+    // with its .toc and .symlist files. The units of the lattices are indices into 'symlist', whose last entry must be /sp/.
+    // The lattices differ in their acoustic scores, which V2 archives keep since they are not 0.
+    void writearchive(const std::wstring& path, bool compact, const std::vector<std::string>& symlist, size_t numlattices) const
+    {
+        auto_file_ptr f(fopenOrDie(path, L"wb"));
+        auto_file_ptr ftoc(fopenOrDie(path + L".toc", L"wb"));
+        if (compact)
+            lattice::fwritecompactarchiveheader(f);
+        for (size_t i = 0; i < numlattices; i++)
+        {
+            lattice source = L;
+            for (size_t j = 0; j < source.edges.size(); j++)
+                source.edges[j].a = acscore(i, j);
+            source.builduniquealignments(symlist.size() - 1);
+            const uint64_t offset = fgetpos(f);
+            if (compact)
+                source.fwritecompact(f);
+            else
+                source.fwrite(f);
+            fprintfOrDie(ftoc, "utt%d=%s[%llu]\n", (int) i, (i == 0) ? msra::strfun::utf8(path).c_str() : "", (unsigned long long) offset);
+        }
+        fflushOrDie(f);
+        fflushOrDie(ftoc);
+
+        auto_file_ptr fsymlist(fopenOrDie(path + L".symlist", L"wb"));
+        for (const auto& sym : symlist)
+            fprintfOrDie(fsymlist, "%s\n", sym.c_str());
+        fflushOrDie(fsymlist);
+    }
+
+    // checks that two lattices read from archives are identical
+    static void checkequal(const lattice& actual, const lattice& expected)
+    {
+        BOOST_CHECK_EQUAL(actual.info.numnodes, expected.info.numnodes);
+        BOOST_CHECK_EQUAL(actual.info.numedges, expected.info.numedges);
+        BOOST_CHECK_EQUAL(actual.info.lmf, expected.info.lmf);
+        BOOST_CHECK_EQUAL(actual.info.wp, expected.info.wp);
+        BOOST_CHECK_EQUAL(actual.info.frameduration, expected.info.frameduration);
+        BOOST_CHECK_EQUAL(actual.info.numframes, expected.info.numframes);
+        BOOST_CHECK_EQUAL(actual.info.impliedspunitid, expected.info.impliedspunitid);
+        BOOST_CHECK_EQUAL(actual.info.hasacscores, expected.info.hasacscores);
+
+        BOOST_REQUIRE_EQUAL(actual.nodes.size(), expected.nodes.size());
+        for (size_t i = 0; i < actual.nodes.size(); i++)
+            BOOST_CHECK_EQUAL(actual.nodes[i].t, expected.nodes[i].t);
+
+        BOOST_REQUIRE_EQUAL(actual.edges.size(), expected.edges.size());
+        for (size_t j = 0; j < actual.edges.size(); j++)
+        {
+            const auto& e1 = actual.edges[j];
+            const auto& e2 = expected.edges[j];
+            BOOST_CHECK(e1.S == e2.S && e1.E == e2.E && e1.unused == e2.unused && e1.implysp == e2.implysp && e1.firstalign == e2.firstalign);
+            BOOST_CHECK_EQUAL(e1.a, e2.a);
+            BOOST_CHECK_EQUAL(e1.l, e2.l);
+        }
+
+        BOOST_REQUIRE_EQUAL(actual.align.size(), expected.align.size());
+        for (size_t k = 0; k < actual.align.size(); k++)
+        {
+            const auto& a1 = actual.align[k];
+            const auto& a2 = expected.align[k];
+            BOOST_CHECK(a1.unit == a2.unit && a1.frames == a2.frames && a1.unused == a2.unused && a1.last == a2.last);
+        }
+    }
+
+    // checks that a lattice read from an archive written by writearchive() is the i-th lattice, with the units mapped by 'unitmap'
+    void checkread(const lattice& read, size_t i, const std::vector<size_t>& unitmap) const
+    {
+        BOOST_REQUIRE_EQUAL(read.edges.size(), L.edges.size());
+        for (size_t j = 0; j < read.edges.size(); j++)
+        {
+            BOOST_CHECK_EQUAL(read.edges[j].a, acscore(i, j));
+            BOOST_CHECK_EQUAL(read.edges[j].l, L.edges[j].l);
+        }
+        BOOST_REQUIRE_EQUAL(read.align.size(), L.align.size());
+        for (size_t k = 0; k < read.align.size(); k++)
+        {
+            BOOST_CHECK_EQUAL(read.align[k].unit, unitmap[L.align[k].unit]);
+            BOOST_CHECK_EQUAL(read.align[k].frames, L.align[k].frames);
+        }
+    }
+
+private:
+    static float acscore(size_t i, size_t j)
+    {
+        return -0.5f * (j + 1) - i;
+    }
+
+    // the sMBR error signal is computed from the expected frames-correct counts of the edges
+    static std::vector<double> logEframescorrectof(const result& r)
+    {
+        std::vector<double> logEframescorrect(r.Eframescorrect.size());
+        for (size_t j = 0; j < logEframescorrect.size(); j++)
+            logEframescorrect[j] = r.Eframescorrect[j] > 0 ? log(r.Eframescorrect[j]) : LOGZERO;
+        return logEframescorrect;
+    }
+
+    static std::vector<float> tovector(const msra::math::ssematrixbase& m)
+    {
+        std::vector<float> result(m.rows() * m.cols());
+        for (size_t t = 0; t < m.cols(); t++)
+            for (size_t s = 0; s < m.rows(); s++)
+                result[t * m.rows() + s] = m(s, t);
+        return result;
+    }
+
+    // same as logadd() in latticeforwardbackward.cpp
+    template <typename FLOAT>
+    static void logadd(FLOAT& loga, FLOAT logb)
+    {
+        if (logb > loga)
+            std::swap(loga, logb);
+        if (loga <= LOGZERO)
+            return;
+        FLOAT diff = logb - loga;
+        if (diff < (sizeof(FLOAT) == sizeof(float) ? -17.0f : -37.0f))
+            return;
+        loga += sizeof(FLOAT) == sizeof(float) ? (FLOAT) logf(1.0f + expf((float) diff)) : (FLOAT) log(1.0 + exp((double) diff));
+    }
+
+    lattice L;
+    msra::asr::simplesenonehmm hset;
+    std::vector<float> edgeacscores;
+    std::unique_ptr<lattice::edgealignments> thisedgealignments;
+    std::vector<std::shared_ptr<msra::math::ssematrix<msra::math::ssematrixbase>>> gammas;
+    std::vector<msra::math::ssematrixbase*> abcs;
+    std::vector<size_t> uids;
+};
+
+}}
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+using msra::lattices::latticetest;
+
+BOOST_AUTO_TEST_SUITE(LatticeForwardBackwardTestSuite)
+
+static void CheckCloseToSerial(const std::vector<double>& actual, const std::vector<double>& expected, double tolerance)
+{
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+        BOOST_CHECK_SMALL(actual[i] - expected[i], tolerance * std::max(1.0, fabs(expected[i])));
+}
+
+static void CheckForwardBackwardMatchesSerial(bool sMBRmode)
+{
+    latticetest test;
+    latticetest::result expected = test.runserial(sMBRmode);
+    BOOST_REQUIRE_GT(expected.totalscore, LOGZERO / 2);
+
+    latticetest::result actual = test.run(sMBRmode);
+    BOOST_CHECK_CLOSE(actual.totalscore, expected.totalscore, 1e-10);
+    CheckCloseToSerial(actual.logalphas, expected.logalphas, 1e-10);
+    CheckCloseToSerial(actual.logbetas, expected.logbetas, 1e-10);
+    CheckCloseToSerial(actual.logpps, expected.logpps, 1e-10);
+    if (sMBRmode)
+    {
+        BOOST_CHECK_CLOSE(actual.logEframescorrecttotal, expected.logEframescorrecttotal, 1e-10);
+        CheckCloseToSerial(actual.Eframescorrect, expected.Eframescorrect, 1e-10);
+    }
+    BOOST_REQUIRE_EQUAL(actual.errorsignal.size(), expected.errorsignal.size());
+    for (size_t i = 0; i < actual.errorsignal.size(); i++)
+        BOOST_CHECK_SMALL(actual.errorsignal[i] - expected.errorsignal[i], 1e-5f);
+}
+
+BOOST_AUTO_TEST_CASE(MMIForwardBackwardMatchesSerialComputation)
+{
+    CheckForwardBackwardMatchesSerial(/*sMBRmode=*/false);
+}
+
+BOOST_AUTO_TEST_CASE(SMBRForwardBackwardMatchesSerialComputation)
+{
+    CheckForwardBackwardMatchesSerial(/*sMBRmode=*/true);
+}
+
+BOOST_AUTO_TEST_CASE(ForwardBackwardDoesNotDependOnThreadCount)
+{
+#ifdef _OPENMP
+    const int maxThreads = omp_get_max_threads();
+    for (bool sMBRmode : { false, true })
+    {
+        latticetest test;
+        omp_set_num_threads(1);
+        latticetest::result expected = test.run(sMBRmode);
+        for (int numThreads : { 2, 3, 8 })
+        {
+            omp_set_num_threads(numThreads);
+            latticetest::result actual = test.run(sMBRmode);
+            BOOST_CHECK_EQUAL(actual.totalscore, expected.totalscore);
+            BOOST_CHECK(actual.logalphas == expected.logalphas);
+            BOOST_CHECK(actual.logbetas == expected.logbetas);
+            BOOST_CHECK(actual.logpps == expected.logpps);
+            BOOST_CHECK(actual.Eframescorrect == expected.Eframescorrect);
+            BOOST_CHECK(actual.errorsignal == expected.errorsignal);
+        }
+    }
+    omp_set_num_threads(maxThreads);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(CompactArchiveReadsLikeLegacyArchive)
+{
+    latticetest test;
+    const std::wstring legacypath = L"LatticeArchiveTest.legacy.lats";
+    const std::wstring compactpath = L"LatticeArchiveTest.compact.lats";
+    const size_t numlattices = 3;
+
+    // the archives list the units in another order than the model, so that reading them maps the units
+    const std::vector<std::string> symlist = { "u0", "u1", "u2", "u3", "sp" };
+    const std::unordered_map<std::string, size_t> modelsymmap = { { "sp", 0 }, { "u0", 1 }, { "u1", 2 }, { "u2", 3 }, { "u3", 4 } };
+    const std::vector<size_t> unitmap = { 1, 2, 3, 4, 0 };
+    test.writearchive(legacypath, /*compact=*/false, symlist, numlattices);
+    test.writearchive(compactpath, /*compact=*/true, symlist, numlattices);
+
+    {
+        // getlattice() detects the compact archive by its header and reads it from a memory mapping instead of with fread()
+        msra::lattices::archive legacyarchive(std::vector<std::wstring>(1, legacypath + L".toc"), modelsymmap);
+        msra::lattices::archive compactarchive(std::vector<std::wstring>(1, compactpath + L".toc"), modelsymmap);
+        msra::lattices::lattice expected, actual;
+        for (size_t i = 0; i < numlattices; i++)
+        {
+            const std::wstring key = L"utt" + std::to_wstring(i);
+            legacyarchive.getlattice(key, expected);
+            compactarchive.getlattice(key, actual);
+            latticetest::checkequal(actual, expected);
+            test.checkread(actual, i, unitmap);
+        }
+    }
+
+    for (const auto& path : { legacypath, compactpath })
+    {
+        for (const auto& extension : { L"", L".toc", L".symlist" })
+            unlinkOrDie(path + extension);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvertedLegacyArchiveReadsLikeLegacyArchive)
+{
+    latticetest test;
+    const std::wstring legacypath = L"LatticeConversionTest.legacy.lats";
+    const std::wstring convertedpath = L"LatticeConversionTest.compact.lats";
+    const size_t numlattices = 3;
+
+    const std::vector<std::string> symlist = { "u0", "u1", "u2", "u3", "sp" };
+    const std::unordered_map<std::string, size_t> modelsymmap = { { "sp", 0 }, { "u0", 1 }, { "u1", 2 }, { "u2", 3 }, { "u3", 4 } };
+    const std::vector<size_t> unitmap = { 1, 2, 3, 4, 0 };
+    test.writearchive(legacypath, /*compact=*/false, symlist, numlattices);
+
+    // this is what the "convertLatticeArchive" action does; the converted archive stores the units of the model
+    msra::lattices::archive::convertcompact(legacypath + L".toc", convertedpath, modelsymmap);
+
+    {
+        char magic[8];
+        auto_file_ptr f(fopenOrDie(convertedpath, L"rb"));
+        freadOrDie(magic, 1, sizeof(magic), f);
+        BOOST_CHECK(msra::lattices::lattice::iscompactarchive(magic, sizeof(magic)));
+    }
+    {
+        msra::lattices::archive legacyarchive(std::vector<std::wstring>(1, legacypath + L".toc"), modelsymmap);
+        msra::lattices::archive convertedarchive(std::vector<std::wstring>(1, convertedpath + L".toc"), modelsymmap);
+        msra::lattices::lattice expected, actual;
+        for (size_t i = 0; i < numlattices; i++)
+        {
+            const std::wstring key = L"utt" + std::to_wstring(i);
+            legacyarchive.getlattice(key, expected);
+            convertedarchive.getlattice(key, actual);
+            latticetest::checkequal(actual, expected);
+            test.checkread(actual, i, unitmap);
+        }
+    }
+
+    for (const auto& path : { legacypath, convertedpath })
+    {
+        for (const auto& extension : { L"", L".toc", L".symlist" })
+            unlinkOrDie(path + extension);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
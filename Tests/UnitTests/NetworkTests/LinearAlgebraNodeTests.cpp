@@ -0,0 +1,133 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/NodeTestHelper.h"
+#include "LinearAlgebraNodes.h"
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(LinearAlgebraNodeTestSuite)
+
+// SumElements(ElementTimes(EmbeddingLookup(E, indices), outputWeights)), so that the gradient of the lookup output is outputWeights.
+struct EmbeddingLookupNetwork
+{
+    static const size_t dim = 3;
+    static const size_t vocabSize = 5;
+    static const size_t numSequences = 2;
+    static const size_t numTimeSteps = 3;
+    static const size_t numColumns = numSequences * numTimeSteps;
+
+    EmbeddingLookupNetwork()
+        : m_net(make_shared<ComputationNetwork>(CPUDEVICE))
+    {
+        ComputationNetworkBuilder<double> builder(*m_net);
+        m_embedding = builder.CreateLearnableParameter(L"E", dim, vocabSize);
+        m_indices = builder.CreateInputNode(L"indices", 1);
+        m_outputWeights = builder.CreateInputNode(L"outputWeights", dim);
+        m_lookup = m_net->AddNodeToNetAndAttachInputs(New<EmbeddingLookupNode<double>>(CPUDEVICE, L"lookup"), { m_embedding, m_indices });
+        auto product = builder.ElementTimes(m_lookup, m_outputWeights, L"product");
+        m_criterion = m_net->AddNodeToNetAndAttachInputs(New<SumElementsNode<double>>(CPUDEVICE, L"criterion"), { product });
+        PrepareNetworkForTraining(m_net, m_criterion);
+
+        // the second sequence ends after 2 steps, followed by a gap in column 5
+        auto layout = m_net->GetMBLayoutPtrOfNetwork();
+        layout->Init(numSequences, numTimeSteps);
+        layout->AddSequence(0, 0, 0, numTimeSteps);
+        layout->AddSequence(1, 1, 0, 2);
+        layout->AddGap(1, 2, numTimeSteps);
+
+        std::mt19937 generator(3);
+        std::normal_distribution<double> normal;
+        m_embeddingValues.resize(dim * vocabSize);
+        for (auto& value : m_embeddingValues)
+            value = normal(generator);
+        m_outputWeightValues.resize(dim * numColumns);
+        for (auto& value : m_outputWeightValues)
+            value = normal(generator);
+        SetNodeValue(m_embedding, dim, vocabSize, m_embeddingValues);
+        SetNodeValue(m_outputWeights, dim, numColumns, m_outputWeightValues);
+    }
+
+    void SetIndices(const std::vector<double>& indices)
+    {
+        SetNodeValue(m_indices, 1, numColumns, indices);
+    }
+
+    ComputationNetworkPtr m_net;
+    shared_ptr<ComputationNode<double>> m_embedding, m_indices, m_outputWeights, m_lookup;
+    ComputationNodeBasePtr m_criterion;
+    std::vector<double> m_embeddingValues, m_outputWeightValues;
+};
+
+BOOST_AUTO_TEST_CASE(EmbeddingLookupGathersColumnsAndScattersGradient)
+{
+    EmbeddingLookupNetwork network;
+    const size_t dim = network.dim;
+    const size_t numColumns = network.numColumns;
+    const size_t gapColumn = 5;
+    // word 4 occurs twice, word 3 only in the gap column, which must be ignored
+    const std::vector<double> indices = { 4, 0, 2, 4, 1, 3 };
+    network.SetIndices(indices);
+
+    ScopedNetworkOperationMode modeGuard(network.m_net, NetworkOperationMode::training);
+    network.m_net->StartEvaluateMinibatchLoop(network.m_criterion);
+    network.m_net->ForwardProp(network.m_criterion);
+
+    // forward: the columns of E, and the index of the gap column is masked to -1
+    const auto& value = network.m_lookup->Value();
+    BOOST_REQUIRE_EQUAL(value.GetNumRows(), dim);
+    BOOST_REQUIRE_EQUAL(value.GetNumCols(), numColumns);
+    double expectedCriterion = 0;
+    for (size_t j = 0; j < numColumns; j++)
+    {
+        if (j == gapColumn)
+            continue;
+        for (size_t i = 0; i < dim; i++)
+        {
+            double expected = network.m_embeddingValues[(size_t) indices[j] * dim + i];
+            BOOST_CHECK_EQUAL(value(i, j), expected);
+            expectedCriterion += expected * network.m_outputWeightValues[j * dim + i];
+        }
+    }
+    BOOST_CHECK_EQUAL(network.m_indices->Value()(0, gapColumn), -1);
+    BOOST_CHECK_CLOSE(network.m_criterion->Get00Element(), expectedCriterion, 1e-10);
+
+    // backward: a block column gradient with the columns of the words of the minibatch only
+    network.m_net->Backprop(network.m_criterion);
+    const auto& gradientMatrix = network.m_embedding->Gradient();
+    BOOST_CHECK(gradientMatrix.GetMatrixType() == MatrixType::SPARSE);
+    BOOST_CHECK(gradientMatrix.GetFormat() == MatrixFormat::matrixFormatSparseBlockCol);
+
+    std::vector<double> expectedGradient(dim * network.vocabSize, 0);
+    for (size_t j = 0; j < numColumns; j++)
+    {
+        if (j == gapColumn)
+            continue;
+        for (size_t i = 0; i < dim; i++)
+            expectedGradient[(size_t) indices[j] * dim + i] += network.m_outputWeightValues[j * dim + i];
+    }
+    auto gradient = GetNodeGradient<double>(network.m_embedding);
+    BOOST_REQUIRE_EQUAL(gradient.size(), expectedGradient.size());
+    for (size_t k = 0; k < gradient.size(); k++)
+        BOOST_CHECK_SMALL(gradient[k] - expectedGradient[k], 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(EmbeddingLookupRejectsIndicesOutOfRange)
+{
+    EmbeddingLookupNetwork network;
+    network.SetIndices({ 4, 0, 2, 5, 1, 3 }); // 5 is not a column of E
+
+    ScopedNetworkOperationMode modeGuard(network.m_net, NetworkOperationMode::training);
+    network.m_net->StartEvaluateMinibatchLoop(network.m_criterion);
+    BOOST_CHECK_EXCEPTION(network.m_net->ForwardProp(network.m_criterion), std::invalid_argument,
+                          [](const std::invalid_argument& e) { return std::string(e.what()).find("out of bounds") != std::string::npos; });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
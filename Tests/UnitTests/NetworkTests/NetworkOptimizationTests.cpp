@@ -0,0 +1,355 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/NodeTestHelper.h"
+#include "InputAndParamNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "RecurrentNodes.h"
+#include "Globals.h"
+#include <random>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Batch normalization training is not implemented on the CPU, so the tests set the running statistics directly.
+template <class ElemType>
+struct BatchNormalizationTest
+{
+    static void SetSamplesSeen(BatchNormalizationNode<ElemType>& node, size_t samplesSeen) { node.m_samplesSeen = samplesSeen; }
+};
+
+BOOST_AUTO_TEST_SUITE(NetworkOptimizationTestSuite)
+
+static std::vector<float> RandomValues(size_t numElements, std::mt19937& generator, float mean = 0)
+{
+    std::normal_distribution<float> normal(mean, 1);
+    std::vector<float> values(numElements);
+    for (auto& value : values)
+        value = normal(generator);
+    return values;
+}
+
+// Evaluates the node named 'out' for a minibatch of frames in inference mode.
+static std::vector<float> EvaluateOutput(const ComputationNetworkPtr& net, const std::vector<float>& features, size_t numFrames)
+{
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+    auto out = net->GetNodeFromName(L"out");
+    net->AllocateAllMatrices({ out }, {}, nullptr);
+    net->StartEvaluateMinibatchLoop(out);
+
+    net->GetMBLayoutPtrOfNetwork()->InitAsFrameMode(numFrames);
+    SetNodeValue(net->GetNodeFromName(L"features"), features.size() / numFrames, numFrames, features);
+    net->ForwardProp(out);
+
+    const auto& value = out->As<ComputationNode<float>>()->Value();
+    std::vector<float> result(value.GetNumElements());
+    for (size_t j = 0; j < value.GetNumCols(); j++)
+        for (size_t i = 0; i < value.GetNumRows(); i++)
+            result[j * value.GetNumRows() + i] = value(i, j);
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(OptimizeForInferenceFoldsConstantsAndRemovesUnusedNodes)
+{
+    // the network of EvalOptimizeForInferenceTest: W and b are computed from constants only, 'unused' does not contribute to 'out'
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", 4);
+    std::vector<std::pair<shared_ptr<ComputationNode<float>>, float>> constants =
+    {
+        { builder.CreateLearnableParameter(L"c1", 3, 1), 2.0f },
+        { builder.CreateLearnableParameter(L"c2", 1, 4), 1.0f },
+        { builder.CreateLearnableParameter(L"c3", 3, 1), 1.0f },
+        { builder.CreateLearnableParameter(L"c4", 3, 1), 0.5f },
+        { builder.CreateLearnableParameter(L"c5", 2, 4), 3.0f },
+    };
+    auto weights = builder.Times(constants[0].first, constants[1].first, 1, L"W");
+    auto bias = builder.Plus(constants[2].first, constants[3].first, L"b");
+    ComputationNodeBasePtr out = builder.Plus(builder.Times(weights, features, 1, L"Wx"), bias, L"out");
+    builder.Times(constants[4].first, features, 1, L"unused");
+    net->CompileNetwork();
+    for (const auto& constant : constants)
+        constant.first->Value().SetValue(constant.second);
+
+    size_t numNodes = net->GetTotalNumberOfNodes();
+    net->OptimizeForInference<float>({ out });
+
+    // only the input, the folded W and b, and the two nodes that depend on the input are left
+    BOOST_CHECK_LT(net->GetTotalNumberOfNodes(), numNodes);
+    BOOST_CHECK_EQUAL(net->GetTotalNumberOfNodes(), 5);
+    for (const auto& name : { L"c1", L"c2", L"c3", L"c4", L"c5", L"unused" })
+        BOOST_CHECK(!net->NodeNameExists(name));
+    BOOST_CHECK(net->GetNodeFromName(L"W")->Is<LearnableParameter<float>>());
+    BOOST_CHECK(net->GetNodeFromName(L"b")->Is<LearnableParameter<float>>());
+    BOOST_CHECK(net->NodeNameExists(L"Wx"));
+
+    auto output = EvaluateOutput(net, { 1, 2, 3, 4, -1, 0, 1, 0.5 }, 2);
+    std::vector<float> expected{ 21.5, 21.5, 21.5, 2.5, 2.5, 2.5 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(output.begin(), output.end(), expected.begin(), expected.end());
+}
+
+// BatchNormalization(Times(W, features) [+ b]) with the running statistics of a trained model, saved to a model file.
+static void CreateBatchNormalizedLayerModel(const std::wstring& modelPath, bool withBias)
+{
+    const size_t inputDim = 4, outputDim = 3;
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", inputDim);
+    auto weights = builder.CreateLearnableParameter(L"W", outputDim, inputDim);
+    shared_ptr<ComputationNode<float>> layer = builder.Times(weights, features, 1, L"Wx");
+    shared_ptr<ComputationNode<float>> bias;
+    if (withBias)
+    {
+        // the usual [outputDim x 1] bias of NDL, added to the Times() output of shape [outputDim]
+        bias = builder.CreateLearnableParameter(L"b", outputDim, 1);
+        layer = builder.Plus(layer, bias, L"Wxb");
+    }
+    auto scale = builder.CreateLearnableParameter(L"scale", outputDim, 1);
+    auto shift = builder.CreateLearnableParameter(L"shift", outputDim, 1);
+    auto runMean = builder.CreateLearnableParameter(L"runMean", outputDim, 1);
+    auto runVariance = builder.CreateLearnableParameter(L"runVariance", outputDim, 1);
+    ComputationNodeBasePtr out = builder.BatchNormalization(layer, scale, shift, runMean, runVariance, /*spatial=*/false, /*normalizationTimeConstant=*/0, /*blendTimeConstant=*/0,
+                                          /*epsilon=*/1e-5, /*useCntkEngine=*/true, ImageLayoutKind::CHW, L"out");
+    net->AddToNodeGroup(L"output", out);
+    net->CompileNetwork();
+
+    std::mt19937 generator(11);
+    SetNodeValue(weights, outputDim, inputDim, RandomValues(outputDim * inputDim, generator));
+    if (bias)
+        SetNodeValue(bias, outputDim, 1, RandomValues(outputDim, generator));
+    SetNodeValue(scale, outputDim, 1, RandomValues(outputDim, generator, 1));
+    SetNodeValue(shift, outputDim, 1, RandomValues(outputDim, generator));
+    SetNodeValue(runMean, outputDim, 1, RandomValues(outputDim, generator));
+    auto variance = RandomValues(outputDim, generator);
+    for (auto& value : variance)
+        value = 0.5f + value * value;
+    SetNodeValue(runVariance, outputDim, 1, variance);
+    BatchNormalizationTest<float>::SetSamplesSeen(*out->As<BatchNormalizationNode<float>>(), 1000);
+
+    net->Save(modelPath);
+}
+
+BOOST_AUTO_TEST_CASE(OptimizeForInferenceFoldsBatchNormalization)
+{
+    const std::wstring modelPath = L"BatchNormalizationFolding.dnn";
+    std::mt19937 generator(13);
+    auto features = RandomValues(4 * 5, generator, 0.5f);
+
+    for (bool withBias : { true, false })
+    {
+        CreateBatchNormalizedLayerModel(modelPath, withBias);
+        auto net = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, modelPath);
+        auto optimizedNet = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, modelPath);
+        remove(ws2s(modelPath).c_str());
+
+        {
+            ScopedNetworkOperationMode modeGuard(optimizedNet, NetworkOperationMode::inferring);
+            optimizedNet->OptimizeForInference<float>({ optimizedNet->GetNodeFromName(L"out") });
+        }
+
+        // the batch normalization is replaced by a Plus of the (new) bias, under the name of the batch normalization
+        BOOST_CHECK(optimizedNet->GetNodesWithType(L"BatchNormalization").empty());
+        BOOST_CHECK(optimizedNet->GetNodeFromName(L"out")->OperationName() == L"Plus");
+        BOOST_CHECK_EQUAL(optimizedNet->NodeNameExists(L"out.foldedBias"), !withBias);
+        for (const auto& name : { L"scale", L"shift", L"runMean", L"runVariance" })
+            BOOST_CHECK(!optimizedNet->NodeNameExists(name));
+
+        auto expected = EvaluateOutput(net, features, 5);
+        auto output = EvaluateOutput(optimizedNet, features, 5);
+        BOOST_REQUIRE_EQUAL(output.size(), expected.size());
+        for (size_t i = 0; i < output.size(); i++)
+            BOOST_CHECK_SMALL(output[i] - expected[i], 1e-4f);
+    }
+}
+
+// h = Tanh(Times(W, RowStack(features, PastValue(h)))) with the criterion SumElements(h), for 2 sequences of 4 and 3 frames.
+static ComputationNetworkPtr CreateStackedRecurrenceNetwork(bool hoistLoopInvariantProjections)
+{
+    const size_t inputDim = 2, hiddenDim = 3, numSequences = 2, numTimeSteps = 4;
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<double> builder(*net);
+    auto features = builder.CreateInputNode(L"features", inputDim);
+    auto weights = builder.CreateLearnableParameter(L"W", hiddenDim, inputDim + hiddenDim);
+    shared_ptr<ComputationNode<double>> delay = net->AddNodeToNetWithElemType(New<PastValueNode<double>>(CPUDEVICE, L"delay", 0.1, hiddenDim, 1));
+    auto hidden = builder.Tanh(builder.Times(weights, builder.RowStack({ features, delay }, L"stacked"), 1, L"Wx"), L"h");
+    delay->AttachInputs({ hidden });
+    auto criterion = net->AddNodeToNetAndAttachInputs(New<SumElementsNode<double>>(CPUDEVICE, L"criterion"), { hidden });
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+    if (hoistLoopInvariantProjections)
+        BOOST_REQUIRE_EQUAL(net->HoistLoopInvariantProjections<double>(), 1);
+    net->AllocateAllMatrices({}, {}, criterion);
+
+    auto layout = net->GetMBLayoutPtrOfNetwork();
+    layout->Init(numSequences, numTimeSteps);
+    layout->AddSequence(0, 0, 0, numTimeSteps);
+    layout->AddSequence(1, 1, 0, numTimeSteps - 1);
+    layout->AddGap(1, numTimeSteps - 1, numTimeSteps);
+
+    std::mt19937 generator(17);
+    std::normal_distribution<double> normal;
+    std::vector<double> weightValues(hiddenDim * (inputDim + hiddenDim)), featureValues(inputDim * numSequences * numTimeSteps);
+    for (auto& value : weightValues)
+        value = normal(generator);
+    for (auto& value : featureValues)
+        value = normal(generator);
+    SetNodeValue(weights, hiddenDim, inputDim + hiddenDim, weightValues);
+    SetNodeValue(features, inputDim, numSequences * numTimeSteps, featureValues);
+    return net;
+}
+
+// Returns the nodes that the network evaluates in PAR mode for the criterion, and the nodes of its single recurrent loop.
+static void GetTopLevelAndLoopNodes(const ComputationNetworkPtr& net, std::set<std::wstring>& topLevelNodes, std::set<std::wstring>& loopNodes)
+{
+    auto network = dynamic_pointer_cast<FlowControlNode>(net->GetNestedNetwork(net->GetNodeFromName(L"criterion")));
+    BOOST_REQUIRE(network);
+    size_t numLoops = 0;
+    for (const auto& node : network->m_nestedNodes)
+    {
+        if (node->OperationName() != L"SEQTraversalFlowControlNode")
+        {
+            topLevelNodes.insert(node->NodeName());
+            continue;
+        }
+        numLoops++;
+        for (const auto& loopNode : dynamic_pointer_cast<FlowControlNode>(node)->m_nestedNodes)
+            loopNodes.insert(loopNode->NodeName());
+    }
+    BOOST_REQUIRE_EQUAL(numLoops, 1);
+}
+
+BOOST_AUTO_TEST_CASE(HoistLoopInvariantProjectionsMovesInputProjectionOutOfLoop)
+{
+    auto net = CreateStackedRecurrenceNetwork(false);
+    auto hoistedNet = CreateStackedRecurrenceNetwork(true);
+
+    // without hoisting, the whole product with the stacked input is computed per time step inside the loop
+    std::set<std::wstring> topLevelNodes, loopNodes;
+    GetTopLevelAndLoopNodes(net, topLevelNodes, loopNodes);
+    BOOST_CHECK(loopNodes.count(L"Wx") && loopNodes.count(L"stacked"));
+
+    // with hoisting, the product with the input is a node of the top level, which evaluates it once per minibatch over all frames
+    std::set<std::wstring> hoistedTopLevelNodes, hoistedLoopNodes;
+    GetTopLevelAndLoopNodes(hoistedNet, hoistedTopLevelNodes, hoistedLoopNodes);
+    BOOST_CHECK(hoistedTopLevelNodes.count(L"Wx.invariant0"));
+    BOOST_CHECK(!hoistedLoopNodes.count(L"Wx.invariant0"));
+    BOOST_CHECK(!hoistedNet->GetNodeFromName(L"Wx.invariant0")->IsPartOfLoop());
+    BOOST_CHECK(hoistedLoopNodes.count(L"Wx.recurrent") && hoistedLoopNodes.count(L"Wx"));
+    BOOST_CHECK(!hoistedNet->NodeNameExists(L"stacked"));
+    BOOST_CHECK(hoistedNet->GetNodeFromName(L"Wx")->OperationName() == L"Plus");
+
+    // both networks compute the same criterion and weight gradient
+    std::vector<double> criteria, gradients[2];
+    for (const auto& network : { net, hoistedNet })
+    {
+        ScopedNetworkOperationMode modeGuard(network, NetworkOperationMode::training);
+        auto criterion = network->GetNodeFromName(L"criterion");
+        network->StartEvaluateMinibatchLoop(criterion);
+        network->ForwardProp(criterion);
+        network->Backprop(criterion);
+        criteria.push_back(criterion->As<ComputationNode<double>>()->Get00Element());
+        gradients[criteria.size() - 1] = GetNodeGradient<double>(network->GetNodeFromName(L"W"));
+    }
+    BOOST_CHECK_CLOSE(criteria[1], criteria[0], 1e-10);
+    BOOST_REQUIRE_EQUAL(gradients[1].size(), gradients[0].size());
+    for (size_t i = 0; i < gradients[0].size(); i++)
+        BOOST_CHECK_SMALL(gradients[1][i] - gradients[0][i], 1e-12);
+}
+
+#ifdef _OPENMP
+// A PlusNode that records the OpenMP thread count of the calling thread whenever it computes a single time step.
+// (The gradient into inputs outside the loop is computed for all frames at once, after the loop.)
+template <class ElemType>
+class ThreadCountRecordingPlusNode : public PlusNode<ElemType>
+{
+public:
+    ThreadCountRecordingPlusNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : PlusNode<ElemType>(deviceId, name)
+    {
+    }
+
+    virtual void ForwardProp(const FrameRange& fr) override
+    {
+        if (!fr.IsAllFrames())
+            m_numThreads.insert(omp_get_max_threads());
+        PlusNode<ElemType>::ForwardProp(fr);
+    }
+
+    virtual void BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        if (!fr.IsAllFrames())
+            m_numThreads.insert(omp_get_max_threads());
+        PlusNode<ElemType>::BackpropTo(inputIndex, fr);
+    }
+
+    std::set<int> m_numThreads;
+};
+
+// Trains h = Plus(Times(W, features), PastValue(h)) for one minibatch of 2 sequences of 3 frames, whose loop steps have
+// hiddenDim * 2 elements, with the given threshold and 4 OpenMP threads. Returns the thread counts seen inside the loop.
+static std::set<int> GetLoopThreadCounts(size_t hiddenDim, size_t maxSingleThreadedLoopStepSize)
+{
+    const size_t inputDim = 2, numSequences = 2, numTimeSteps = 3;
+    const int numThreads = 4;
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", inputDim);
+    auto weights = builder.CreateLearnableParameter(L"W", hiddenDim, inputDim);
+    shared_ptr<ComputationNode<float>> delay = net->AddNodeToNetWithElemType(New<PastValueNode<float>>(CPUDEVICE, L"delay", 0.1f, hiddenDim, 1));
+    auto hidden = New<ThreadCountRecordingPlusNode<float>>(CPUDEVICE, L"h");
+    net->AddNodeToNetAndAttachInputs(hidden, { builder.Times(weights, features, 1, L"Wx"), delay });
+    delay->AttachInputs({ hidden });
+    ComputationNodeBasePtr criterion = net->AddNodeToNetAndAttachInputs(New<SumElementsNode<float>>(CPUDEVICE, L"criterion"), { hidden });
+    PrepareNetworkForTraining(net, criterion);
+
+    net->GetMBLayoutPtrOfNetwork()->Init(numSequences, numTimeSteps);
+    net->GetMBLayoutPtrOfNetwork()->AddSequence(0, 0, 0, numTimeSteps);
+    net->GetMBLayoutPtrOfNetwork()->AddSequence(1, 1, 0, numTimeSteps);
+    SetNodeValue(weights, hiddenDim, inputDim, std::vector<float>(hiddenDim * inputDim, 0.5f));
+    SetNodeValue(features, inputDim, numSequences * numTimeSteps, std::vector<float>(inputDim * numSequences * numTimeSteps, 1.0f));
+
+    const size_t defaultMaxStepSize = Globals::GetMaxSingleThreadedLoopStepSize();
+    const int maxThreads = omp_get_max_threads();
+    Globals::SetMaxSingleThreadedLoopStepSize(maxSingleThreadedLoopStepSize);
+    omp_set_num_threads(numThreads);
+    {
+        ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+        net->StartEvaluateMinibatchLoop(criterion);
+        net->ForwardProp(criterion);
+        net->Backprop(criterion);
+    }
+    // the loop gives the thread count of the calling thread back
+    BOOST_CHECK_EQUAL(omp_get_max_threads(), numThreads);
+    omp_set_num_threads(maxThreads);
+    Globals::SetMaxSingleThreadedLoopStepSize(defaultMaxStepSize);
+
+    return hidden->m_numThreads;
+}
+
+BOOST_AUTO_TEST_CASE(SmallRecurrentLoopStepsRunSingleThreaded)
+{
+    const std::set<int> singleThreaded = { 1 }, multiThreaded = { 4 };
+
+    // steps of 4 * 2 elements
+    BOOST_CHECK(GetLoopThreadCounts(4, Globals::GetMaxSingleThreadedLoopStepSize()) == singleThreaded);
+    BOOST_CHECK(GetLoopThreadCounts(4, 8) == singleThreaded);
+    BOOST_CHECK(GetLoopThreadCounts(4, 7) == multiThreaded);
+    BOOST_CHECK(GetLoopThreadCounts(4, 0) == multiThreaded);
+
+    // steps above the default threshold keep the thread team
+    BOOST_CHECK(GetLoopThreadCounts(Globals::GetMaxSingleThreadedLoopStepSize(), Globals::GetMaxSingleThreadedLoopStepSize()) == multiThreaded);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,332 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/NodeTestHelper.h"
+#include "TrainingNodes.h"
+#include "AliasSampler.h"
+#include "CPURNGHandle.h"
+#include <cmath>
+#include <numeric>
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(TrainingNodeTestSuite)
+
+// ClassBasedCrossEntropyWithSoftmax(labels, hidden, outputWeights, classLogits) with hidden = hiddenWeights * features and
+// classLogits = classWeights * features, where features selects column j of the weights in minibatch column j. This way the
+// gradients of hiddenWeights and classWeights are the gradients of the node's inputs, column by column.
+struct ClassBasedCrossEntropyNetwork
+{
+    static const size_t hiddenDim = 5;
+    static const size_t numSequences = 2;
+    static const size_t numTimeSteps = 6;
+    static const size_t numColumns = numSequences * numTimeSteps;
+
+    ClassBasedCrossEntropyNetwork(const std::vector<size_t>& classBounds)
+        : m_classBounds(classBounds), m_net(make_shared<ComputationNetwork>(CPUDEVICE))
+    {
+        const size_t numClasses = classBounds.size() - 1;
+        const size_t numWords = classBounds.back();
+
+        ComputationNetworkBuilder<double> builder(*m_net);
+        m_labels = builder.CreateInputNode(L"labels", 4);
+        m_features = builder.CreateInputNode(L"features", numColumns);
+        m_hiddenWeights = builder.CreateLearnableParameter(L"hiddenWeights", hiddenDim, numColumns);
+        m_classWeights = builder.CreateLearnableParameter(L"classWeights", numClasses, numColumns);
+        m_outputWeights = builder.CreateLearnableParameter(L"outputWeights", hiddenDim, numWords);
+        auto hidden = builder.Times(m_hiddenWeights, m_features, 1, L"hidden");
+        auto classLogits = builder.Times(m_classWeights, m_features, 1, L"classLogits");
+        m_criterion = builder.ClassCrossEntropyWithSoftmax(m_labels, hidden, m_outputWeights, classLogits, L"criterion");
+        PrepareNetworkForTraining(m_net, m_criterion);
+
+        // the second sequence ends after 4 steps, followed by a gap
+        auto layout = m_net->GetMBLayoutPtrOfNetwork();
+        layout->Init(numSequences, numTimeSteps);
+        layout->AddSequence(0, 0, 0, numTimeSteps);
+        layout->AddSequence(1, 1, 0, 4);
+        layout->AddGap(1, 4, numTimeSteps);
+
+        std::vector<double> features(numColumns * numColumns, 0);
+        for (size_t j = 0; j < numColumns; j++)
+            features[j * numColumns + j] = 1;
+        SetNodeValue(m_features, numColumns, numColumns, features);
+
+        std::mt19937 generator(7);
+        std::normal_distribution<double> normal;
+        auto randomValues = [&](size_t numElements)
+        {
+            std::vector<double> values(numElements);
+            for (auto& value : values)
+                value = normal(generator);
+            return values;
+        };
+        m_hiddenWeightValues = randomValues(hiddenDim * numColumns);
+        m_classWeightValues = randomValues(numClasses * numColumns);
+        m_outputWeightValues = randomValues(hiddenDim * numWords);
+        SetNodeValue(m_hiddenWeights, hiddenDim, numColumns, m_hiddenWeightValues);
+        SetNodeValue(m_classWeights, numClasses, numColumns, m_classWeightValues);
+        SetNodeValue(m_outputWeights, hiddenDim, numWords, m_outputWeightValues);
+    }
+
+    // Sets the words of the minibatch, in column order (time step major); columns in gaps get labels that are not valid.
+    void SetWords(const std::vector<int>& words)
+    {
+        std::vector<double> labels(4 * numColumns);
+        for (size_t j = 0; j < numColumns; j++)
+        {
+            if (words[j] < 0)
+            {
+                labels[4 * j + 0] = 99;
+                labels[4 * j + 1] = 99;
+                labels[4 * j + 2] = 98;
+                labels[4 * j + 3] = 1;
+                continue;
+            }
+            size_t c = std::upper_bound(m_classBounds.begin(), m_classBounds.end(), (size_t)words[j]) - m_classBounds.begin() - 1;
+            labels[4 * j + 0] = words[j];
+            labels[4 * j + 1] = (double)c;
+            labels[4 * j + 2] = (double)m_classBounds[c];
+            labels[4 * j + 3] = (double)m_classBounds[c + 1];
+        }
+        SetNodeValue(m_labels, 4, numColumns, labels);
+    }
+
+    std::vector<size_t> m_classBounds;
+    ComputationNetworkPtr m_net;
+    shared_ptr<ComputationNode<double>> m_labels, m_features, m_hiddenWeights, m_classWeights, m_outputWeights;
+    ComputationNodeBasePtr m_criterion;
+    std::vector<double> m_hiddenWeightValues, m_classWeightValues, m_outputWeightValues;
+};
+
+BOOST_AUTO_TEST_CASE(ClassBasedCrossEntropyWithSoftmaxMatchesPerSampleComputation)
+{
+    // class 1 has a single word, class 2 occurs only once in the minibatch, and columns 9 and 11 are the gap of the second sequence
+    ClassBasedCrossEntropyNetwork network({ 0, 4, 5, 9, 11 });
+    const std::vector<int> words = { 2, 10, 7, 1, 0, 4, 4, 3, 3, -1, 9, -1 };
+    network.SetWords(words);
+
+    const size_t hiddenDim = network.hiddenDim;
+    const size_t numColumns = network.numColumns;
+    const size_t numClasses = network.m_classBounds.size() - 1;
+    const auto& classBounds = network.m_classBounds;
+    const auto& h = network.m_hiddenWeightValues;   // column j is the hidden activation of minibatch column j
+    const auto& z = network.m_classWeightValues;    // column j holds the class logits of minibatch column j
+    const auto& w = network.m_outputWeightValues;
+
+    // reference: the per-sample formulation, the log softmax over the words of the class and over the classes
+    double expectedObjective = 0;
+    std::vector<double> expectedHiddenGradient(hiddenDim * numColumns, 0);
+    std::vector<double> expectedClassGradient(numClasses * numColumns, 0);
+    std::vector<double> expectedOutputWeightGradient(w.size(), 0);
+    for (size_t j = 0; j < numColumns; j++)
+    {
+        if (words[j] < 0)
+            continue;
+        size_t y = words[j];
+        size_t c = std::upper_bound(classBounds.begin(), classBounds.end(), y) - classBounds.begin() - 1;
+        size_t lftBnd = classBounds[c];
+        size_t nbrWrd = classBounds[c + 1] - lftBnd;
+
+        std::vector<double> wordLogits(nbrWrd, 0);
+        for (size_t k = 0; k < nbrWrd; k++)
+            for (size_t i = 0; i < hiddenDim; i++)
+                wordLogits[k] += w[(lftBnd + k) * hiddenDim + i] * h[j * hiddenDim + i];
+        auto logSumExp = [](const double* x, size_t n)
+        {
+            double maxValue = *std::max_element(x, x + n);
+            double sum = 0;
+            for (size_t k = 0; k < n; k++)
+                sum += exp(x[k] - maxValue);
+            return maxValue + log(sum);
+        };
+        double wordLogNormalizer = logSumExp(wordLogits.data(), nbrWrd);
+        double classLogNormalizer = logSumExp(&z[j * numClasses], numClasses);
+        expectedObjective -= (wordLogits[y - lftBnd] - wordLogNormalizer) + (z[j * numClasses + c] - classLogNormalizer);
+
+        for (size_t k = 0; k < numClasses; k++)
+            expectedClassGradient[j * numClasses + k] = exp(z[j * numClasses + k] - classLogNormalizer) - (k == c ? 1 : 0);
+        for (size_t k = 0; k < nbrWrd; k++)
+        {
+            double wordGradient = exp(wordLogits[k] - wordLogNormalizer) - (lftBnd + k == y ? 1 : 0);
+            for (size_t i = 0; i < hiddenDim; i++)
+            {
+                expectedHiddenGradient[j * hiddenDim + i] += w[(lftBnd + k) * hiddenDim + i] * wordGradient;
+                expectedOutputWeightGradient[(lftBnd + k) * hiddenDim + i] += h[j * hiddenDim + i] * wordGradient;
+            }
+        }
+    }
+
+    ScopedNetworkOperationMode modeGuard(network.m_net, NetworkOperationMode::training);
+    network.m_net->StartEvaluateMinibatchLoop(network.m_criterion);
+    network.m_net->ForwardProp(network.m_criterion);
+    network.m_net->Backprop(network.m_criterion);
+
+    BOOST_CHECK_CLOSE(network.m_criterion->Get00Element(), expectedObjective, 1e-10);
+
+    auto checkGradient = [](const std::vector<double>& actual, const std::vector<double>& expected)
+    {
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); i++)
+            BOOST_CHECK_SMALL(actual[i] - expected[i], 1e-12);
+    };
+    checkGradient(GetNodeGradient<double>(network.m_hiddenWeights), expectedHiddenGradient);
+    checkGradient(GetNodeGradient<double>(network.m_classWeights), expectedClassGradient);
+    checkGradient(GetNodeGradient<double>(network.m_outputWeights), expectedOutputWeightGradient);
+}
+
+BOOST_AUTO_TEST_CASE(ClassBasedCrossEntropyWithSoftmaxRejectsInconsistentClassRanges)
+{
+    ClassBasedCrossEntropyNetwork network({ 0, 4, 5, 9, 11 });
+    network.SetWords({ 2, 10, 7, 1, 0, 4, 4, 3, 3, -1, 9, -1 });
+
+    ScopedNetworkOperationMode modeGuard(network.m_net, NetworkOperationMode::training);
+    network.m_net->StartEvaluateMinibatchLoop(network.m_criterion);
+
+    network.m_net->ForwardProp(network.m_criterion);
+
+    // word 0 in column 4 claims that its class ends after word 2, unlike the other words of class 0
+    auto& labels = network.m_labels->As<ComputationNode<double>>()->Value();
+    labels(3, 4) = 3;
+    network.m_labels->BumpEvalTimeStamp();
+    BOOST_CHECK_EXCEPTION(network.m_net->ForwardProp(network.m_criterion), std::logic_error,
+                          [](const std::logic_error& e) { return std::string(e.what()).find("different class-member index ranges") != std::string::npos; });
+}
+
+// SampledCrossEntropyWithSoftmax(labels, input, weights, bias, samplingWeights) with input = inputWeights * features, where features selects
+// column j of inputWeights in minibatch column j, as above.
+BOOST_AUTO_TEST_CASE(SampledCrossEntropyWithSoftmaxMatchesSampledSoftmax)
+{
+    const size_t hiddenDim = 3, numClasses = 6, numSamples = 5;
+    const size_t numSequences = 2, numTimeSteps = 4, numColumns = numSequences * numTimeSteps;
+    const unsigned long seed = 17;
+    const std::vector<double> samplingWeightValues = { 8, 1, 4, 1, 2, 0.5 };
+    const std::vector<int> targets = { 0, 2, 1, 0, 5, 0, 2, -1 }; // the second sequence ends after 3 steps, followed by a gap
+
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<double> builder(*net);
+    auto labels = builder.CreateInputNode(L"labels", numClasses);
+    auto features = builder.CreateInputNode(L"features", numColumns);
+    auto inputWeights = builder.CreateLearnableParameter(L"inputWeights", hiddenDim, numColumns);
+    auto weights = builder.CreateLearnableParameter(L"weights", hiddenDim, numClasses);
+    auto bias = builder.CreateLearnableParameter(L"bias", numClasses, 1);
+    auto samplingWeights = builder.CreateLearnableParameter(L"samplingWeights", numClasses, 1);
+    samplingWeights->SetLearningRateMultiplier(0);
+    auto input = builder.Times(inputWeights, features, 1, L"input");
+    auto node = net->AddNodeToNetAndAttachInputs(New<SampledCrossEntropyWithSoftmaxNode<double>>(CPUDEVICE, L"criterion", numSamples),
+                                                 { labels, input, weights, bias, samplingWeights });
+    ComputationNodeBasePtr criterion = node;
+    PrepareNetworkForTraining(net, criterion);
+
+    auto layout = net->GetMBLayoutPtrOfNetwork();
+    layout->Init(numSequences, numTimeSteps);
+    layout->AddSequence(0, 0, 0, numTimeSteps);
+    layout->AddSequence(1, 1, 0, 3);
+    layout->AddGap(1, 3, numTimeSteps);
+
+    std::vector<double> labelValues(numClasses * numColumns, 0);
+    std::vector<double> featureValues(numColumns * numColumns, 0);
+    for (size_t j = 0; j < numColumns; j++)
+    {
+        if (targets[j] >= 0)
+            labelValues[j * numClasses + targets[j]] = 1;
+        featureValues[j * numColumns + j] = 1;
+    }
+    SetNodeValue(labels, numClasses, numColumns, labelValues);
+    SetNodeValue(features, numColumns, numColumns, featureValues);
+
+    std::mt19937 generator(5);
+    std::normal_distribution<double> normal;
+    auto randomValues = [&](size_t numElements)
+    {
+        std::vector<double> values(numElements);
+        for (auto& value : values)
+            value = normal(generator);
+        return values;
+    };
+    const auto h = randomValues(hiddenDim * numColumns); // column j is the input of minibatch column j
+    const auto w = randomValues(hiddenDim * numClasses);
+    const auto b = randomValues(numClasses);
+    SetNodeValue(inputWeights, hiddenDim, numColumns, h);
+    SetNodeValue(weights, hiddenDim, numClasses, w);
+    SetNodeValue(bias, numClasses, 1, b);
+    SetNodeValue(samplingWeights, numClasses, 1, samplingWeightValues);
+
+    // the node draws its samples with its own generator, so the same seed gives the same samples
+    AliasSampler sampler;
+    sampler.Build(samplingWeightValues);
+    CPURNGHandle rngHandle(CPUDEVICE, seed);
+    std::vector<size_t> samples(numSamples);
+    for (auto& sample : samples)
+        sample = sampler.Sample(rngHandle.Generator());
+    node->SetRandomSeed(seed);
+
+    // reference: softmax over the target and the samples that are not the target, with the logits corrected by -log(numSamples * p)
+    auto logit = [&](size_t j, size_t c)
+    {
+        double result = b[c] - log(numSamples * samplingWeightValues[c] / std::accumulate(samplingWeightValues.begin(), samplingWeightValues.end(), 0.0));
+        for (size_t i = 0; i < hiddenDim; i++)
+            result += w[c * hiddenDim + i] * h[j * hiddenDim + i];
+        return result;
+    };
+    double expectedObjective = 0;
+    size_t numAccidentalHits = 0;
+    for (size_t j = 0; j < numColumns; j++)
+    {
+        if (targets[j] < 0)
+            continue;
+        double targetLogit = logit(j, targets[j]);
+        double sum = exp(targetLogit);
+        for (auto sample : samples)
+        {
+            if (sample == (size_t) targets[j])
+                numAccidentalHits++;
+            else
+                sum += exp(logit(j, sample));
+        }
+        expectedObjective -= targetLogit - log(sum);
+    }
+    BOOST_REQUIRE_GT(numAccidentalHits, 0);
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->StartEvaluateMinibatchLoop(criterion);
+    net->ForwardProp(criterion);
+    BOOST_CHECK_CLOSE(criterion->Get00Element(), expectedObjective, 1e-10);
+
+    net->Backprop(criterion);
+    auto inputGradient = GetNodeGradient<double>(inputWeights);
+    auto weightGradient = GetNodeGradient<double>(weights);
+    auto biasGradient = GetNodeGradient<double>(bias);
+
+    // every ForwardProp() draws new samples, so the seed is reset before each evaluation to keep the samples above
+    auto numericGradient = [&](const ComputationNodeBasePtr& parameter, size_t index)
+    {
+        const double epsilon = 1e-5;
+        node->SetRandomSeed(seed);
+        double plus = EvaluateWithPerturbedParameter<double>(net, criterion, parameter, index, epsilon);
+        node->SetRandomSeed(seed);
+        double minus = EvaluateWithPerturbedParameter<double>(net, criterion, parameter, index, -epsilon);
+        return (plus - minus) / (2 * epsilon);
+    };
+    auto checkGradient = [&](const ComputationNodeBasePtr& parameter, const std::vector<double>& gradient)
+    {
+        BOOST_REQUIRE_EQUAL(gradient.size(), parameter->As<ComputationNode<double>>()->Value().GetNumElements());
+        for (size_t i = 0; i < gradient.size(); i++)
+            BOOST_CHECK_SMALL(gradient[i] - numericGradient(parameter, i), 1e-6);
+    };
+    checkGradient(inputWeights, inputGradient);
+    checkGradient(weights, weightGradient);
+    checkGradient(bias, biasGradient);
+
+    // the input of the gap column gets no gradient
+    for (size_t i = 0; i < hiddenDim; i++)
+        BOOST_CHECK_EQUAL(inputGradient[(numColumns - 1) * hiddenDim + i], 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
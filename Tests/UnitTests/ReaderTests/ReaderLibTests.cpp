@@ -12,6 +12,7 @@
 #include "BlockRandomizer.h"
 #include "CorpusDescriptor.h"
 #include "SequentialDeserializer.h"
+#include "Lz4Codec.h"
 
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
@@ -538,6 +539,83 @@ BOOST_AUTO_TEST_CASE(BlockRandomizerOneEpochWithChunks2)
     BlockRandomizerOneEpochWithChunks2Test(true);
 }
 
+void BlockRandomizerCompressedChunksTest(bool prefetch)
+{
+    const int sequenceLength = 7;
+    vector<float> data(200);
+    iota(data.begin(), data.end(), 0.0f);
+
+    auto mockDeserializer = make_shared<MockDeserializer>(20, 10, data, sequenceLength);
+
+    auto expectedRandomizer = make_shared<BlockRandomizer>(0, 50, mockDeserializer, prefetch, BlockRandomizer::DecimationMode::chunk, false);
+    auto compressedRandomizer = make_shared<BlockRandomizer>(0, 50, mockDeserializer, prefetch, BlockRandomizer::DecimationMode::chunk, false, false, true);
+
+    EpochConfiguration epochConfiguration;
+    epochConfiguration.m_numberOfWorkers = 1;
+    epochConfiguration.m_workerRank = 0;
+    epochConfiguration.m_minibatchSizeInSamples = 0;
+    epochConfiguration.m_totalEpochSizeInSamples = data.size() * sequenceLength;
+    epochConfiguration.m_epochIndex = 0;
+    expectedRandomizer->StartEpoch(epochConfiguration);
+    compressedRandomizer->StartEpoch(epochConfiguration);
+
+    for (int i = 0; i < data.size() + 1; i++)
+    {
+        Sequences expected = expectedRandomizer->GetNextSequences(sequenceLength);
+        Sequences actual = compressedRandomizer->GetNextSequences(sequenceLength);
+        BOOST_CHECK_EQUAL(expected.m_endOfEpoch, actual.m_endOfEpoch);
+        BOOST_REQUIRE_EQUAL(expected.m_data.size(), actual.m_data.size());
+        if (expected.m_data.empty())
+        {
+            continue;
+        }
+
+        BOOST_REQUIRE_EQUAL(actual.m_data[0].size(), 1);
+        auto& expectedSequence = *expected.m_data[0][0];
+        auto& actualSequence = *actual.m_data[0][0];
+        BOOST_CHECK_EQUAL(expectedSequence.m_numberOfSamples, actualSequence.m_numberOfSamples);
+        const float* expectedBegin = (const float*)expectedSequence.GetDataBuffer();
+        const float* actualBegin = (const float*)actualSequence.GetDataBuffer();
+        BOOST_CHECK_EQUAL_COLLECTIONS(expectedBegin, expectedBegin + sequenceLength,
+                                      actualBegin, actualBegin + sequenceLength);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BlockRandomizerCompressedChunks)
+{
+    BlockRandomizerCompressedChunksTest(false);
+    BlockRandomizerCompressedChunksTest(true);
+}
+
+BOOST_AUTO_TEST_CASE(Lz4CodecRoundTrip)
+{
+    std::mt19937 rng(7);
+    boost::random::uniform_int_distribution<int> distr(0, 3);
+
+    for (size_t size : { 0, 1, 12, 13, 100, 70000, 300000 })
+    {
+        // Mostly repetitive data with some noise, so that both literals and long matches are produced.
+        vector<char> original(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            original[i] = (char)(distr(rng) == 0 ? distr(rng) : i % 17);
+        }
+
+        vector<char> compressed;
+        size_t compressedSize = Lz4Codec::Compress(original.data(), original.size(), compressed);
+        BOOST_CHECK_EQUAL(compressedSize, compressed.size());
+
+        vector<char> decompressed(size);
+        Lz4Codec::Decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size());
+        BOOST_CHECK(original == decompressed);
+
+        vector<char> shuffled(size), unshuffled(size);
+        Lz4Codec::Shuffle(original.data(), 4, size / 4, shuffled.data());
+        Lz4Codec::Unshuffle(shuffled.data(), 4, size / 4, unshuffled.data());
+        BOOST_CHECK(equal(original.begin(), original.begin() + size / 4 * 4, unshuffled.begin()));
+    }
+}
+
 void BlockRandomizerChaosMonkeyTest(bool prefetch)
 {
     const int sequenceLength = 3;
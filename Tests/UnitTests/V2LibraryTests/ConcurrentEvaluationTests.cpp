@@ -0,0 +1,96 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "CNTKLibrary.h"
+#include <functional>
+#include <thread>
+#include <chrono>
+#include "Common.h"
+
+using namespace CNTK;
+using namespace std::placeholders;
+
+// Evaluates the classifier for an input of sequences of equal length, so the output needs no mask.
+std::vector<float> EvaluateClassifier(const FunctionPtr& classifier, const ValuePtr& inputValue, const DeviceDescriptor& device)
+{
+    const auto& inputShape = inputValue->Shape();
+    NDShape outputShape = classifier->Output().Shape().AppendShape({ inputShape[inputShape.Rank() - 2], inputShape[inputShape.Rank() - 1] });
+    std::vector<float> outputData(outputShape.TotalSize());
+    ValuePtr outputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(outputShape, outputData, false));
+
+    std::unordered_map<Variable, ValuePtr> outputs = { { classifier->Output(), outputValue } };
+    classifier->Forward({ { classifier->Arguments()[0], inputValue } }, outputs, device);
+    return outputData;
+}
+
+// Evaluates a single Function instance from multiple threads at the same time, verifies that every thread gets the same results
+// as a sequential evaluation and reports the throughput compared to evaluating from a single thread.
+void TestConcurrentForward(const DeviceDescriptor& device, size_t numThreads)
+{
+    const size_t inputDim = 937;
+    const size_t numOutputClasses = 1024;
+    const size_t numHiddenLayers = 3;
+    const size_t hiddenLayersDim = 512;
+    const size_t numSequences = 16;
+    const size_t numIterations = 20;
+
+    auto inputVar = InputVariable({ inputDim }, DataType::Float, L"features");
+    auto classifier = FullyConnectedFeedForwardClassifierNet(inputVar, numOutputClasses, hiddenLayersDim, numHiddenLayers, device, std::bind(Sigmoid, _1, L""), L"classifierOutput");
+
+    // Every thread evaluates its own input; all sequences of an input have the same length, so the outputs have no gaps
+    std::vector<ValuePtr> inputValues;
+    std::vector<std::vector<float>> expectedOutputs;
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        auto sequences = GenerateSequences<float>(std::vector<size_t>(numSequences, 1 + i % 3), { inputDim });
+        inputValues.push_back(Value::Create({ inputDim }, sequences, device, true));
+        expectedOutputs.push_back(EvaluateClassifier(classifier, inputValues.back(), device));
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t j = 0; j < numIterations * numThreads; ++j)
+        EvaluateClassifier(classifier, inputValues[j % numThreads], device);
+    std::chrono::duration<double> sequentialTime = std::chrono::high_resolution_clock::now() - startTime;
+
+    std::vector<std::string> errors(numThreads);
+    startTime = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        threads.push_back(std::thread([&, i]() {
+            try
+            {
+                for (size_t j = 0; j < numIterations; ++j)
+                    FloatingPointVectorCompare(EvaluateClassifier(classifier, inputValues[i], device), expectedOutputs[i], "TestConcurrentForward: Concurrent Forward results do not match expected values");
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+        }));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+    std::chrono::duration<double> concurrentTime = std::chrono::high_resolution_clock::now() - startTime;
+
+    for (const auto& error : errors)
+    {
+        if (!error.empty())
+            throw std::runtime_error(error);
+    }
+
+    size_t numSamples = numIterations * numThreads * numSequences;
+    fprintf(stderr, "TestConcurrentForward on device=%d: %.1f samples/s with 1 thread, %.1f samples/s with %d threads\n",
+            device.Id(), numSamples / sequentialTime.count(), numSamples / concurrentTime.count(), (int)numThreads);
+}
+
+void ConcurrentEvaluationTests()
+{
+    fprintf(stderr, "\nConcurrentEvaluationTests..\n");
+
+    TestConcurrentForward(DeviceDescriptor::CPUDevice(), 4);
+    if (IsGPUAvailable())
+        TestConcurrentForward(DeviceDescriptor::GPUDevice(0), 4);
+}
@@ -315,6 +315,125 @@ void TestRecurrentFunctionCloning()
     CompareFunctions(clonedFunctionWithParametersShared, clonedFunctionWithParametersFrozen, ParameterCloningMethod::Freeze, cloningReplacements, visitedFunctions);
 }
 
+void TestCompiledNetworkReuse(const DeviceDescriptor& device)
+{
+    Internal::SetComputationNetworkCacheCapacity(4);
+
+    size_t inputDim = 5;
+    size_t outputDim = 3;
+    auto inputVar = InputVariable({ inputDim }, DataType::Float, L"input");
+    Parameter timesParam(MakeSharedObject<NDArrayView>(0.5f, NDShape({ outputDim, inputDim }), device), L"timesParameters");
+    Parameter plusParam(MakeSharedObject<NDArrayView>(0.1f, NDShape({ outputDim }), device), L"plusParameters");
+    auto plusOutput = Plus(plusParam, Times(timesParam, inputVar), L"plusOutput");
+    auto function = Combine({ ReduceSum(plusOutput, L"sum"), plusOutput });
+
+    std::vector<size_t> sequenceLengths(7, 4);
+    auto sequences = GenerateSequences<float>(sequenceLengths, { inputDim });
+    ValuePtr inputValue = Value::Create({ inputDim }, sequences, device, true);
+
+    auto evaluate = [&inputValue, &sequenceLengths, &device](const FunctionPtr& func, const std::unordered_set<Variable>& outputsToRetainBackwardStateFor) {
+        auto sumOutput = func->Outputs()[0];
+        NDShape outputShape = sumOutput.Shape().AppendShape({ sequenceLengths[0], sequenceLengths.size() });
+        std::vector<float> outputData(outputShape.TotalSize());
+        ValuePtr outputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(outputShape, outputData, false));
+
+        std::unordered_map<Variable, ValuePtr> outputs = { { sumOutput, outputValue } };
+        func->Forward({ { func->Arguments()[0], inputValue } }, outputs, device, outputsToRetainBackwardStateFor);
+        return outputData;
+    };
+
+    function->Warmup(device);
+    auto expectedOutput = evaluate(function, {});
+
+    // Changing the outputs to retain the backward state for switches between the networks of the Function
+    FloatingPointVectorCompare(evaluate(function, { function->Outputs()[0] }), expectedOutput, "TestCompiledNetworkReuse: Forward results after changing the backprop roots do not match expected values");
+    FloatingPointVectorCompare(evaluate(function, { function->Outputs()[1] }), expectedOutput, "TestCompiledNetworkReuse: Forward results after changing the backprop roots do not match expected values");
+    FloatingPointVectorCompare(evaluate(function, { function->Outputs()[0] }), expectedOutput, "TestCompiledNetworkReuse: Forward results after changing the backprop roots do not match expected values");
+
+    // A clone that shares the parameters reuses the networks of the destroyed original
+    auto clonedFunction = function->Clone(ParameterCloningMethod::Share);
+    function = nullptr;
+    FloatingPointVectorCompare(evaluate(clonedFunction, {}), expectedOutput, "TestCompiledNetworkReuse: Forward results of the clone do not match expected values");
+    FloatingPointVectorCompare(evaluate(clonedFunction, { clonedFunction->Outputs()[1] }), expectedOutput, "TestCompiledNetworkReuse: Forward results of the clone do not match expected values");
+
+    Internal::SetComputationNetworkCacheCapacity(0);
+}
+
+void TestValueOverCallerBuffer(const DeviceDescriptor& device)
+{
+    size_t inputDim = 4;
+    size_t outputDim = 3;
+    auto inputVar = InputVariable({ inputDim }, DataType::Float, L"input");
+    Parameter timesParam(NDArrayView::RandomUniform<float>({ outputDim, inputDim }, -0.5, 0.5, 1, device), L"timesParameters");
+    auto function = Times(timesParam, Plus(inputVar, PastValue(inputVar)), L"output");
+
+    // Returns the output values of the valid steps of all sequences
+    auto evaluate = [&](const ValuePtr& inputValue, const std::vector<size_t>& sequenceLengths) {
+        size_t maxNumTimeSteps = *std::max_element(sequenceLengths.begin(), sequenceLengths.end());
+        NDShape outputShape = { outputDim, maxNumTimeSteps, sequenceLengths.size() };
+        std::vector<float> outputData(outputShape.TotalSize());
+        auto outputMask = MakeSharedObject<NDMask>(NDShape({ maxNumTimeSteps, sequenceLengths.size() }), DeviceDescriptor::CPUDevice());
+        ValuePtr outputValue = MakeSharedObject<Value>(MakeSharedObject<NDArrayView>(outputShape, outputData, false), outputMask);
+
+        std::unordered_map<Variable, ValuePtr> outputs = { { function->Output(), outputValue } };
+        function->Forward({ { inputVar, inputValue } }, outputs, device);
+
+        std::vector<float> result;
+        for (size_t i = 0; i < sequenceLengths.size(); ++i)
+        {
+            auto sequenceBegin = outputData.begin() + (i * maxNumTimeSteps * outputDim);
+            result.insert(result.end(), sequenceBegin, sequenceBegin + (sequenceLengths[i] * outputDim));
+        }
+
+        return result;
+    };
+
+    auto concatenate = [](const std::vector<std::vector<float>>& sequences) {
+        std::vector<float> buffer;
+        for (const auto& sequence : sequences)
+            buffer.insert(buffer.end(), sequence.begin(), sequence.end());
+
+        return buffer;
+    };
+
+    // Sequences of a single sample each are parallel sequences of one time step over the buffer as is
+    std::vector<size_t> sequenceLengths = { 1, 1, 1 };
+    auto sequences = GenerateSequences<float>(sequenceLengths, { inputDim });
+    auto buffer = concatenate(sequences);
+    auto expectedOutput = evaluate(Value::Create({ inputDim }, sequences, device, true), sequenceLengths);
+
+    ValuePtr bufferValue = Value::Create({ inputDim }, sequenceLengths, buffer.data());
+    FloatingPointVectorCompare(evaluate(bufferValue, sequenceLengths), expectedOutput, "TestValueOverCallerBuffer: Forward results do not match expected values");
+
+    // The Value refers to the buffer instead of a copy of it
+    for (auto& element : buffer)
+        element *= 2;
+    std::vector<float> expectedDoubledOutput;
+    for (auto element : expectedOutput)
+        expectedDoubledOutput.push_back(element * 2);
+    FloatingPointVectorCompare(evaluate(bufferValue, sequenceLengths), expectedDoubledOutput, "TestValueOverCallerBuffer: Forward results after changing the buffer do not match expected values");
+
+    // Evaluating with a Value that owns its data must not write into the buffer bound by the previous evaluation
+    auto bufferContents = buffer;
+    FloatingPointVectorCompare(evaluate(Value::Create({ inputDim }, sequences, device, true), sequenceLengths), expectedOutput, "TestValueOverCallerBuffer: Forward results do not match expected values");
+    if (buffer != bufferContents)
+        throw std::runtime_error("TestValueOverCallerBuffer: The caller's buffer was modified");
+
+    // Longer sequences are copied into one parallel sequence each, like with the Create overload taking the sequences
+    sequenceLengths = { 3, 1, 2 };
+    sequences = GenerateSequences<float>(sequenceLengths, { inputDim });
+    buffer = concatenate(sequences);
+    expectedOutput = evaluate(Value::Create({ inputDim }, sequences, device, true), sequenceLengths);
+
+    bufferValue = Value::Create({ inputDim }, sequenceLengths, buffer.data());
+    if (bufferValue->Shape() != NDShape({ inputDim, 3, sequenceLengths.size() }))
+        throw std::runtime_error("TestValueOverCallerBuffer: The Value does not hold one parallel sequence per sequence");
+
+    for (auto& element : buffer)
+        element *= 2;
+    FloatingPointVectorCompare(evaluate(bufferValue, sequenceLengths), expectedOutput, "TestValueOverCallerBuffer: Forward results of a copied buffer do not match expected values");
+}
+
 void TestTranspose(size_t numAxes, int axis1, int axis2, const DeviceDescriptor& device)
 {
     srand(1);
@@ -489,6 +608,18 @@ void FunctionTests()
 
     TestRecurrentFunctionCloning();
 
+    TestCompiledNetworkReuse(DeviceDescriptor::CPUDevice());
+    if (IsGPUAvailable())
+    {
+        TestCompiledNetworkReuse(DeviceDescriptor::GPUDevice(0));
+    }
+
+    TestValueOverCallerBuffer(DeviceDescriptor::CPUDevice());
+    if (IsGPUAvailable())
+    {
+        TestValueOverCallerBuffer(DeviceDescriptor::GPUDevice(0));
+    }
+
     TestTranspose(2, 0, 1, DeviceDescriptor::CPUDevice());
     if (IsGPUAvailable())
     {
@@ -23,6 +23,7 @@ void TrainSequenceToSequenceTranslator();
 void TrainTruncatedLSTMAcousticModelClassifer();
 void DeviceSelectionTests();
 void MultiThreadsEvaluation(bool);
+void ConcurrentEvaluationTests();
 
 int main()
 {
@@ -59,6 +60,7 @@ int main()
     TrainTruncatedLSTMAcousticModelClassifer();
 
     MultiThreadsEvaluation(IsGPUAvailable());
+    ConcurrentEvaluationTests();
 
     fprintf(stderr, "\nCNTKv2Library tests: Passed\n");
     fflush(stderr);